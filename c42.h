@@ -345,6 +345,22 @@ C42_API int C42_CALL c42_u8a_cmp
     size_t len
 );
 
+/* c42_u8a_scan *************************************************************/
+/**
+ *  Finds the first occurrence of a byte value.
+ *  Scans a machine word at a time where the compiler allows it.
+ *  @param a byte array
+ *  @param len number of bytes in @a a
+ *  @param value byte to search for
+ *  @returns index of first byte equal to @a value or @a len if not found
+ */
+C42_API size_t C42_CALL c42_u8a_scan
+(
+    uint8_t const * a,
+    size_t len,
+    uint_fast8_t value
+);
+
 /* c42_u8a_equal ************************************************************/
 /**
  *  Returns true if the given byte arrays of same length have the same content.
@@ -1027,6 +1043,24 @@ typedef size_t (C42_CALL * c42_utf8_writer_f)
         void * ctx
     );
 
+/* c42_utf8_vwriter_f *******************************************************/
+/**
+ *  Function pointer for vectored (scatter/gather) UTF-8 text writers.
+ *  @param seg array of segments to be written in order; each segment holds
+ *  valid UTF-8 text and has non-zero length
+ *  @param count number of segments; the writer should never be called with 0
+ *  @param ctx context for the writer
+ *  @returns total number of bytes successfully written; as for
+ *  #c42_utf8_writer_f the reason for the error, if any, is left at the
+ *  discretion of the implementation
+ */
+typedef size_t (C42_CALL * c42_utf8_vwriter_f)
+    (
+        c42_u8an_t const * seg,
+        size_t count,
+        void * ctx
+    );
+
 /* c42_sbw_t ****************************************************************/
 /**
  *  Single-buffer writer context structure.
@@ -1066,6 +1100,18 @@ C42_API size_t C42_CALL c42_sbw_write
     void * sbw
 );
 
+/* c42_sbw_writev ***********************************************************/
+/**
+ *  Single-buffer vectored writer processor function.
+ *  See c42_sbw_t and #c42_utf8_vwriter_f.
+ */
+C42_API size_t C42_CALL c42_sbw_writev
+(
+    c42_u8an_t const * seg,
+    size_t count,
+    void * sbw
+);
+
 /* c42_utf8_width_f *********************************************************/
 /**
  *  Computes the width (in some arbitrary user-defined integral units) of the
@@ -1119,11 +1165,266 @@ C42_API int32_t C42_CALL c42_utf8_term_width
     void * ctx
 );
 
+/* c42_utf8_ansi_term_width *************************************************/
+/**
+ *  Computes the 'terminal' width of the given valid UTF-8 string that may
+ *  contain ANSI escape sequences.
+ *  Same as c42_utf8_term_width() except that CSI sequences (ESC [ ... final,
+ *  which includes SGR colour codes), OSC sequences (ESC ] ... terminated by
+ *  BEL or ESC \\) and other 2-byte ESC sequences count as zero width.
+ *  This function can be used as an implementation for #c42_utf8_width_f.
+ *  @param data [in] pointer to valid UTF8 buffer
+ *  @param len [in] size of buffer
+ *  @param ctx [in] not used
+ *  @returns computed width as a non-negative int
+ *  @retval -1 some codepoint is invalid or non-printable, or an escape
+ *      sequence is malformed or truncated
+ *  @retval -2 width too large to fit in the return type
+ */
+C42_API int32_t C42_CALL c42_utf8_ansi_term_width
+(
+    uint8_t const * data,
+    size_t len,
+    void * ctx
+);
+
 #define C42_FMT_MALFORMED 1 /**< bad format string error code */
 #define C42_FMT_WIDTH_ERROR 2 /**< width function returned error */
 #define C42_FMT_WRITE_ERROR 3 /**< write error */
 #define C42_FMT_CONV_ERROR 4 /**< conversion error during escaping of some string */
 #define C42_FMT_NO_CODE 5 /**< feature not implemented */
+#define C42_FMT_ARG_MISMATCH 6
+    /**< typed argument missing, unused or not matching the format */
+
+#define C42_FMT_ARG_UINT 1 /**< unsigned int (type for c42_fmt_arg_t) */
+#define C42_FMT_ARG_SINT 2 /**< signed int (type for c42_fmt_arg_t) */
+#define C42_FMT_ARG_STR 3 /**< NUL-terminated string (type for c42_fmt_arg_t)*/
+
+/* c42_fmt_arg_t ************************************************************/
+/**
+ *  Typed formatting argument.
+ *  Arrays of these are consumed by c42_write_afmt() and friends instead of
+ *  a va_list; they are normally built with #C42_FMT_ARG.
+ */
+typedef struct c42_fmt_arg_s c42_fmt_arg_t;
+struct c42_fmt_arg_s
+{
+    union
+    {
+        uint64_t u; /**< value for #C42_FMT_ARG_UINT */
+        int64_t i; /**< value for #C42_FMT_ARG_SINT */
+        uint8_t const * s; /**< value for #C42_FMT_ARG_STR */
+    } v; /**< argument value */
+    uint8_t type; /**< one of C42_FMT_ARG_xxx */
+    uint8_t size; /**< size in bytes of the original int type */
+};
+
+/* c42_fmt_arg_uint *********************************************************/
+/**
+ *  Builds a typed argument from an unsigned int of the given size.
+ */
+C42_INLINE c42_fmt_arg_t c42_fmt_arg_uint (uint64_t value, size_t size)
+{
+    c42_fmt_arg_t a;
+    a.v.u = value;
+    a.type = C42_FMT_ARG_UINT;
+    a.size = (uint8_t) size;
+    return a;
+}
+
+/* c42_fmt_arg_sint *********************************************************/
+/**
+ *  Builds a typed argument from a signed int of the given size.
+ */
+C42_INLINE c42_fmt_arg_t c42_fmt_arg_sint (int64_t value, size_t size)
+{
+    c42_fmt_arg_t a;
+    a.v.i = value;
+    a.type = C42_FMT_ARG_SINT;
+    a.size = (uint8_t) size;
+    return a;
+}
+
+/* c42_fmt_arg_str **********************************************************/
+/**
+ *  Builds a typed argument from a NUL-terminated byte string.
+ */
+C42_INLINE c42_fmt_arg_t c42_fmt_arg_str (uint8_t const * str, size_t size)
+{
+    c42_fmt_arg_t a;
+    (void) size;
+    a.v.s = str;
+    a.type = C42_FMT_ARG_STR;
+    a.size = sizeof(str);
+    return a;
+}
+
+/* c42_fmt_arg_cstr *********************************************************/
+/**
+ *  Builds a typed argument from a NUL-terminated char string.
+ */
+C42_INLINE c42_fmt_arg_t c42_fmt_arg_cstr (char const * str, size_t size)
+{
+    return c42_fmt_arg_str((uint8_t const *) str, size);
+}
+
+/* c42_fmt_arg_ptr **********************************************************/
+/**
+ *  Builds a typed argument from a pointer (to be used with 'p' type).
+ */
+C42_INLINE c42_fmt_arg_t c42_fmt_arg_ptr (void const * ptr, size_t size)
+{
+    return c42_fmt_arg_uint((uintptr_t) ptr, size);
+}
+
+#if (__STDC_VERSION__ >= 201112L) || C42_DOXY
+/* C42_FMT_ARG **************************************************************/
+/**
+ *  Builds a c42_fmt_arg_t from any int, string or pointer expression
+ *  picking the constructor at compile time based on the expression type.
+ *  Expressions of other types are rejected by the compiler.
+ *  @note needs C11 (_Generic)
+ */
+#define C42_FMT_ARG(_x) (_Generic((_x), \
+    _Bool: c42_fmt_arg_uint, \
+    char: c42_fmt_arg_sint, \
+    signed char: c42_fmt_arg_sint, \
+    unsigned char: c42_fmt_arg_uint, \
+    signed short: c42_fmt_arg_sint, \
+    unsigned short: c42_fmt_arg_uint, \
+    signed int: c42_fmt_arg_sint, \
+    unsigned int: c42_fmt_arg_uint, \
+    signed long: c42_fmt_arg_sint, \
+    unsigned long: c42_fmt_arg_uint, \
+    signed long long: c42_fmt_arg_sint, \
+    unsigned long long: c42_fmt_arg_uint, \
+    char *: c42_fmt_arg_cstr, \
+    char const *: c42_fmt_arg_cstr, \
+    uint8_t *: c42_fmt_arg_str, \
+    uint8_t const *: c42_fmt_arg_str, \
+    void *: c42_fmt_arg_ptr, \
+    void const *: c42_fmt_arg_ptr)((_x), sizeof(_x)))
+
+/* C42_FMT_ARG_COUNT ********************************************************/
+/**
+ *  Counts the arguments following the format string (up to 16).
+ */
+#define C42_FMT_ARG_COUNT(...) C42_FMT_ARG_COUNT_(__VA_ARGS__, \
+    16, 15, 14, 13, 12, 11, 10, 9, \
+    8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define C42_FMT_ARG_COUNT_(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, \
+    _9, _10, _11, _12, _13, _14, _15, _16, _n, ...) _n
+
+#define C42_FMT_ARGS_0(_f) NULL
+#define C42_FMT_ARGS_1(_f, _1) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1) })
+#define C42_FMT_ARGS_2(_f, _1, _2) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2) })
+#define C42_FMT_ARGS_3(_f, _1, _2, _3) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3) })
+#define C42_FMT_ARGS_4(_f, _1, _2, _3, _4) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4) })
+#define C42_FMT_ARGS_5(_f, _1, _2, _3, _4, _5) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5) })
+#define C42_FMT_ARGS_6(_f, _1, _2, _3, _4, _5, _6) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6) })
+#define C42_FMT_ARGS_7(_f, _1, _2, _3, _4, _5, _6, _7) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7) })
+#define C42_FMT_ARGS_8(_f, _1, _2, _3, _4, _5, _6, _7, _8) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8) })
+#define C42_FMT_ARGS_9(_f, _1, _2, _3, _4, _5, _6, _7, _8, _9) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9) })
+#define C42_FMT_ARGS_10(_f, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10) })
+#define C42_FMT_ARGS_11(_f, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11) })
+#define C42_FMT_ARGS_12(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11), C42_FMT_ARG(_12) })
+#define C42_FMT_ARGS_13(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11), C42_FMT_ARG(_12), C42_FMT_ARG(_13) })
+#define C42_FMT_ARGS_14(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11), C42_FMT_ARG(_12), C42_FMT_ARG(_13), C42_FMT_ARG(_14) })
+#define C42_FMT_ARGS_15(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11), C42_FMT_ARG(_12), C42_FMT_ARG(_13), C42_FMT_ARG(_14), \
+      C42_FMT_ARG(_15) })
+#define C42_FMT_ARGS_16(_f, \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16) \
+    ((c42_fmt_arg_t const []) { C42_FMT_ARG(_1), C42_FMT_ARG(_2), \
+      C42_FMT_ARG(_3), C42_FMT_ARG(_4), C42_FMT_ARG(_5), C42_FMT_ARG(_6), \
+      C42_FMT_ARG(_7), C42_FMT_ARG(_8), C42_FMT_ARG(_9), C42_FMT_ARG(_10), \
+      C42_FMT_ARG(_11), C42_FMT_ARG(_12), C42_FMT_ARG(_13), C42_FMT_ARG(_14), \
+      C42_FMT_ARG(_15), C42_FMT_ARG(_16) })
+
+#define C42_FMT_CAT_(_a, _b) _a ## _b
+#define C42_FMT_CAT(_a, _b) C42_FMT_CAT_(_a, _b)
+#define C42_FMT_FIRST_(_f, ...) _f
+#define C42_FMT_FIRST(...) C42_FMT_FIRST_(__VA_ARGS__, 0)
+
+/* C42_FMT_ARGS *************************************************************/
+/**
+ *  Expands to the format string followed by the typed argument array and
+ *  the number of arguments.
+ */
+#define C42_FMT_ARGS(...) \
+    C42_FMT_FIRST(__VA_ARGS__), \
+    C42_FMT_CAT(C42_FMT_ARGS_, C42_FMT_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__), \
+    C42_FMT_ARG_COUNT(__VA_ARGS__)
+
+/* C42_FMT ******************************************************************/
+/**
+ *  Writes formatted text with terminal-style width calculations using
+ *  typed arguments.
+ *  Only the argument constructors are chosen at compile time; the format
+ *  is still interpreted at run time and argument mismatches are reported
+ *  as #C42_FMT_ARG_MISMATCH rather than rejected by the compiler.
+ *  Example: C42_FMT(c42_sbw_write, &sbw, "$s: $>5d", name, count)
+ *  See c42_write_afmt().
+ */
+#define C42_FMT(_writer, _writer_context, ...) \
+    (c42_write_afmt((_writer), (_writer_context), c42_utf8_term_width, NULL, \
+                    C42_FMT_ARGS(__VA_ARGS__)))
+
+/* C42_VFMT *****************************************************************/
+/**
+ *  Same as #C42_FMT but uses a vectored writer.
+ *  See c42_writev_afmt().
+ */
+#define C42_VFMT(_vwriter, _writer_context, ...) \
+    (c42_writev_afmt((_vwriter), (_writer_context), c42_utf8_term_width, \
+                     NULL, C42_FMT_ARGS(__VA_ARGS__)))
+#endif
 
 /* c42_write_vfmt ***********************************************************/
 /**
@@ -1167,7 +1468,9 @@ C42_API int32_t C42_CALL c42_utf8_term_width
  *  * 'N': radix 10
  *  * 'x': radix 16 (hexadecimal) and use '0x' prefix
  *  * 'X': radix 16 (hexadecimal)
- *
+ *  A WIDTH starting with '0' zero-fills integers up to that many chars
+ *  (sign, prefix and group separators included); such widths are limited
+ *  to 1022, larger ones give C42_FMT_MALFORMED.
  *
  */
 C42_API uint_fast8_t C42_CALL c42_write_vfmt
@@ -1195,6 +1498,82 @@ C42_API uint_fast8_t C42_CALL c42_write_fmt
     ...
 );
 
+/* c42_writev_vfmt **********************************************************/
+/**
+ *  Writes formatted UTF-8 text using a vectored writer.
+ *  Literal runs from @a fmt, converted arguments and padding are gathered
+ *  in segments and passed to @a vwriter in as few calls as possible.
+ *  Formatting and return values are the same as for c42_write_vfmt().
+ */
+C42_API uint_fast8_t C42_CALL c42_writev_vfmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    va_list va
+);
+
+/* c42_writev_fmt ***********************************************************/
+/**
+ *  Writes formatted UTF-8 text using a vectored writer.
+ *  See c42_writev_vfmt.
+ */
+C42_API uint_fast8_t C42_CALL c42_writev_fmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    ...
+);
+
+/* c42_write_afmt ***********************************************************/
+/**
+ *  Writes formatted UTF-8 text taking the arguments from an array of typed
+ *  arguments instead of a va_list.
+ *  Formatting is the same as for c42_write_vfmt(); each argument is checked
+ *  against the type in the format: strings must be given for 's' and ints
+ *  for the rest, ints must not be wider than the type in the format and
+ *  their value must be representable in it (no negative values for
+ *  unsigned types, no unsigned values above the maximum of signed ones).
+ *  The format string is parsed at run time as for c42_write_vfmt(), so
+ *  these checks happen once per field while formatting, not when
+ *  compiling.
+ *  @retval 0 success
+ *  @retval C42_FMT_ARG_MISMATCH an argument does not match the format, or
+ *      there are too few or too many arguments
+ *  @returns other C42_FMT_xxx error codes as c42_write_vfmt()
+ */
+C42_API uint_fast8_t C42_CALL c42_write_afmt
+(
+    c42_utf8_writer_f writer,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+);
+
+/* c42_writev_afmt **********************************************************/
+/**
+ *  Writes formatted UTF-8 text with typed arguments using a vectored writer.
+ *  See c42_write_afmt() and c42_writev_vfmt().
+ */
+C42_API uint_fast8_t C42_CALL c42_writev_afmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+);
+
 #define C42_CLCONV_OK 0
 /**< entire input used (return code for #c42_clconv_f) */
 
@@ -1480,6 +1859,11 @@ C42_INLINE void c42_dlist_del
     /**< bad operation; (e.g. write on a read-only file, seek on stdin, etc) */
 #define C42_IO8_NA 22
     /**< feature not available (close read-side of a regular file) */
+#define C42_IO8_FMT_ARG_MISMATCH 23
+    /**< typed formatting argument does not match the format */
+#define C42_IO8_BAD_DATA 24
+    /**< malformed data found by a decoding stream (e.g. decompression) */
+#define C42_IO8_NO_MEM 25 /**< memory allocation failed */
 #define C42_IO8_NOT_IMPLEMENTED 126 /**< feature not implemented */
 #define C42_IO8_OTHER_ERROR 127
     /**< and now for something completely different! */
@@ -1488,12 +1872,32 @@ C42_INLINE void c42_dlist_del
 #define C42_IO8_OP_WRITE 2
 #define C42_IO8_OP_SEEK 4
 
+#define C42_IO8_SEEK_SET 0 /**< seek anchor: beginning of the stream */
+#define C42_IO8_SEEK_CUR 1 /**< seek anchor: current position */
+#define C42_IO8_SEEK_END 2 /**< seek anchor: end of the stream */
+
+#define C42_IO8_SYNC_DATA 1
+    /**< sync flag: only flush data and the metadata needed to read it back
+     *  (fdatasync) */
+
+#define C42_IO8_CLASS_MT_PIO 1
+    /**< class flag: pread and pwrite can be called from several threads at
+     *  once, in any mix, on the same stream (like pread/pwrite on a file
+     *  descriptor); without it callers serialize positional writes with
+     *  all other accesses */
+
 /* c42_io8_t ****************************************************************/
 /**
  * 8-bit I/O stream.
  */
 typedef struct c42_io8_s c42_io8_t;
 
+/* c42_fsa_stat_t ***********************************************************/
+/**
+ *  File attributes; defined with the filesystem interface.
+ */
+typedef struct c42_fsa_stat_s c42_fsa_stat_t;
+
 /* c42_io8_class_t **********************************************************/
 /**
  * 8-bit I/O stream class.
@@ -1516,7 +1920,9 @@ struct c42_io8_class_s
 
     uint_fast8_t (C42_CALL * seek64)
         (uintptr_t ctx, int64_t offset, int anchor, uint64_t * pos);
-    /**< function pointer for seeing with 64-bit int pointer */
+    /**< function pointer for seeing with 64-bit int pointer;
+     *  @a anchor is one of C42_IO8_SEEK_SET, C42_IO8_SEEK_CUR,
+     *  C42_IO8_SEEK_END */
 
     uint_fast8_t (C42_CALL * truncate)
         (uintptr_t ctx);
@@ -1528,6 +1934,76 @@ struct c42_io8_class_s
      *  @param ctx [in] context
      *  @param mode [in] bitmask with flags: C42_IO8_OP_READ | C42_IO8_OP_WRITE
      **/
+
+    uint_fast8_t (C42_CALL * writev)
+        (uintptr_t ctx, c42_u8an_t const * seg, size_t count, size_t * wsize);
+    /**< function pointer for the vectored write operation; can be NULL in
+     *  which case c42_io8_writev() emulates it by calling write for each
+     *  segment */
+
+    uint_fast8_t (C42_CALL * readv)
+        (uintptr_t ctx, c42_u8an_t const * seg, size_t count, size_t * rsize);
+    /**< function pointer for the vectored read operation; can be NULL in
+     *  which case c42_io8_readv() emulates it by calling read for each
+     *  segment */
+
+    uint_fast8_t (C42_CALL * peek)
+        (uintptr_t ctx, size_t min_size, uint8_t const * * ptr, size_t * avail);
+    /**< function pointer for exposing buffered data without copying;
+     *  can be NULL; see c42_io8_peek() */
+
+    uint_fast8_t (C42_CALL * consume)
+        (uintptr_t ctx, size_t size);
+    /**< function pointer for advancing past peeked data; must be provided
+     *  if peek is provided */
+
+    uint_fast8_t (C42_CALL * copy_to)
+        (uintptr_t ctx, c42_io8_t * dst, uint64_t size, uint64_t * csize);
+    /**< function pointer for copying data from this stream to @a dst
+     *  without a user-space buffer (e.g. with sendfile or copy_file_range);
+     *  can be NULL; returns C42_IO8_NA without transferring anything if it
+     *  cannot handle the given destination; see c42_io8_copy() */
+
+    uint_fast8_t (C42_CALL * copy_from)
+        (uintptr_t ctx, c42_io8_t * src, uint64_t size, uint64_t * csize);
+    /**< function pointer for copying data from @a src into this stream
+     *  (e.g. with splice); same rules as copy_to */
+
+    uint_fast8_t (C42_CALL * pread)
+        (uintptr_t ctx, uint8_t * data, size_t size, uint64_t offset,
+         size_t * rsize);
+    /**< function pointer for reading at the given offset without using or
+     *  changing the stream position; can be NULL; implementations should
+     *  allow concurrent calls from several threads */
+
+    uint_fast8_t (C42_CALL * pwrite)
+        (uintptr_t ctx, uint8_t const * data, size_t size, uint64_t offset,
+         size_t * wsize);
+    /**< function pointer for writing at the given offset without using or
+     *  changing the stream position; can be NULL */
+
+    uint_fast8_t (C42_CALL * stat)
+        (uintptr_t ctx, c42_fsa_stat_t * st);
+    /**< function pointer for getting the attributes of the open file;
+     *  can be NULL */
+
+    uint_fast8_t (C42_CALL * allocate)
+        (uintptr_t ctx, uint64_t offset, uint64_t size);
+    /**< function pointer for reserving storage for a range of the file
+     *  (e.g. fallocate) without changing its size; can be NULL */
+
+    uint_fast8_t (C42_CALL * sync)
+        (uintptr_t ctx, int flags);
+    /**< function pointer for flushing written data to storage;
+     *  @a flags is 0 or C42_IO8_SYNC_DATA; can be NULL */
+
+    uint_fast8_t (C42_CALL * advise)
+        (uintptr_t ctx, uint64_t offset, uint64_t size, int advice);
+    /**< function pointer for access pattern hints (e.g. posix_fadvise);
+     *  @a advice is one of C42_FSA_ADV_xxx; can be NULL */
+
+    unsigned int flags;
+    /**< C42_IO8_CLASS_xxx bits describing the class */
 };
 
 struct c42_io8_s
@@ -1553,9 +2029,10 @@ C42_API uint_fast8_t C42_CALL c42_io8_read
 /* c42_io8_read_full ********************************************************/
 /**
  *  Reads chunks until requested size is transferred.
- *  Ignores interruptions (from signals or APCs).
+ *  Ignores interruptions (from signals or APCs). Short reads are retried;
+ *  only a read returning no data counts as end of file.
  *  @returns 0 success; *rsize set to size
- *  @returns C42_IO8_EOF read until end of file
+ *  @returns C42_IO8_EOF read until end of file; *rsize set to bytes read
  *  @returns C42_IO8_xxx some error
  */
 C42_API uint_fast8_t C42_CALL c42_io8_read_full
@@ -1566,6 +2043,189 @@ C42_API uint_fast8_t C42_CALL c42_io8_read_full
     size_t * rsize
 );
 
+/* c42_io8_readv ************************************************************/
+/**
+ *  Reads data into an array of segments from an I/O stream.
+ *  If the stream class has no vectored read function this is emulated by
+ *  reading segments one by one until all are filled or one is filled
+ *  partially.
+ *  @param io stream to read from
+ *  @param seg array of segments
+ *  @param count number of segments
+ *  @param rsize pointer where the total size read is returned; can be NULL
+ *  @returns 0  success; *rsize is 0 on end of file
+ *  @returns C42_IO8_BAD_SIZE total size greater than SIZE_MAX / 2
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_readv
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * rsize
+);
+
+/* c42_io8_readv_full *******************************************************/
+/**
+ *  Fills all segments, ignoring interruptions (signals, APCs).
+ *  @param io stream to read from
+ *  @param seg array of segments
+ *  @param count number of segments
+ *  @param rsize pointer where the total size read is returned; can be NULL
+ *  @returns 0 success
+ *  @returns C42_IO8_EOF end of file reached before filling all segments
+ *  @returns C42_IO8_xxx some error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_readv_full
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * rsize
+);
+
+/* c42_io8_pread ************************************************************/
+/**
+ *  Reads data from the given offset of a stream.
+ *  The stream position is neither used nor changed, so several threads can
+ *  read different parts of the same stream without serializing on it.
+ *  @param io stream to read from
+ *  @param data buffer to fill
+ *  @param size size of buffer
+ *  @param offset position in the stream to read from
+ *  @param rsize pointer where the size read is returned; can be NULL
+ *  @returns 0  success; *rsize is 0 at or past end of file
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class has no positional read
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_pread
+(
+    c42_io8_t * io,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
+);
+
+/* c42_io8_pread_full *******************************************************/
+/**
+ *  Fills the buffer from the given offset, ignoring interruptions.
+ *  @returns 0 success
+ *  @returns C42_IO8_EOF end of file reached before filling the buffer
+ *  @returns C42_IO8_xxx some error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_pread_full
+(
+    c42_io8_t * io,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
+);
+
+/* c42_io8_stat *************************************************************/
+/**
+ *  Gets the attributes of the file behind a stream, such as its size.
+ *  @returns 0 success
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class has no stat
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_stat
+(
+    c42_io8_t * io,
+    c42_fsa_stat_t * st
+);
+
+/* c42_io8_preallocate ******************************************************/
+/**
+ *  Reserves storage for a range of the file so appending to it does not
+ *  fragment it or update allocation metadata on each write.
+ *  The file size does not change.
+ *  @returns 0 success
+ *  @returns C42_IO8_NO_SPACE not enough space
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class cannot preallocate
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_preallocate
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size
+);
+
+/* c42_io8_sync *************************************************************/
+/**
+ *  Flushes written data to storage.
+ *  @param io stream
+ *  @param flags 0 (fsync) or #C42_IO8_SYNC_DATA (fdatasync)
+ *  @returns 0 success
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class has no sync
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_sync
+(
+    c42_io8_t * io,
+    int flags
+);
+
+/* c42_io8_advise ***********************************************************/
+/**
+ *  Tells the stream how a range of it is going to be accessed, so that
+ *  the OS can adapt its caching and read-ahead. Only a hint: the stream
+ *  behaves the same whatever the advice.
+ *  @param io stream
+ *  @param offset start of the range
+ *  @param size size of the range; 0 means up to the end of the stream
+ *  @param advice C42_FSA_ADV_NORMAL, C42_FSA_ADV_SEQUENTIAL,
+ *      C42_FSA_ADV_RANDOM or C42_FSA_ADV_WILLNEED (start reading the range
+ *      in the background)
+ *  @returns 0 success
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class has no advise
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_advise
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    int advice
+);
+
+/* c42_io8_peek *************************************************************/
+/**
+ *  Exposes data at the current read position without copying it.
+ *  Tries to make at least @a min_size bytes available, reading from the
+ *  underlying source as needed; fewer bytes are returned only at end of
+ *  file (0 bytes means end of file). The returned window stays valid until
+ *  the next operation on the stream.
+ *  Streams whose class does not implement this can be wrapped with a
+ *  c42_io8buf_t which provides it on top of any readable stream.
+ *  @param io stream to peek into
+ *  @param min_size minimum number of bytes wanted; 0 is treated as 1
+ *  @param ptr receives pointer to the data
+ *  @param avail receives the number of bytes available at @a ptr
+ *  @returns 0  success
+ *  @returns C42_IO8_TOO_BIG @a min_size exceeds what the stream can expose
+ *      contiguously
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class does not support peeking
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_peek
+(
+    c42_io8_t * io,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+);
+
+/* c42_io8_consume **********************************************************/
+/**
+ *  Advances the read position over data returned by c42_io8_peek().
+ *  @param io stream
+ *  @param size number of bytes to skip; must not exceed the last window
+ *  @returns 0  success
+ *  @returns C42_IO8_BAD_SIZE @a size larger than the available data
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class does not support peeking
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_consume
+(
+    c42_io8_t * io,
+    size_t size
+);
+
 /* c42_io8_write ************************************************************/
 /**
  *  Writes data to an I/O stream.
@@ -1598,6 +2258,159 @@ C42_API uint_fast8_t C42_CALL c42_io8_write_full
     size_t * wsize
 );
 
+/* c42_io8_pwrite ***********************************************************/
+/**
+ *  Writes data at the given offset of a stream without using or changing
+ *  the stream position.
+ *  @param io stream to write to
+ *  @param data data to write
+ *  @param size number of bytes at @a data
+ *  @param offset position in the stream to write at
+ *  @param wsize pointer where the size written is returned; can be NULL
+ *  @returns 0  success
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream class has no positional write
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_pwrite
+(
+    c42_io8_t * io,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+);
+
+/* c42_io8_pwrite_full ******************************************************/
+/**
+ *  Writes all data at the given offset, ignoring interruptions.
+ *  @returns 0  success
+ *  @returns C42_IO8_xxx some error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_pwrite_full
+(
+    c42_io8_t * io,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+);
+
+/* c42_io8_writev ***********************************************************/
+/**
+ *  Writes data from an array of segments to an I/O stream.
+ *  If the stream class has no vectored write function this is emulated by
+ *  writing segments one by one until all are written or one is written
+ *  partially.
+ *  @param io stream to write to
+ *  @param seg array of segments
+ *  @param count number of segments
+ *  @param wsize pointer where the total size written is returned; can be NULL
+ *  @returns 0  success
+ *  @returns C42_IO8_BAD_SIZE total size greater than SIZE_MAX / 2
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_writev
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+);
+
+/* c42_io8_writev_full ******************************************************/
+/**
+ *  Writes all segments, ignoring interruptions (signals, APCs).
+ *  This function will call c42_io8_writev() in a loop, resuming after
+ *  partially written segments, until all data is written or an error occurs.
+ *  @param io stream to write to
+ *  @param seg array of segments
+ *  @param count number of segments
+ *  @param wsize pointer where the total size written is returned; can be NULL
+ *  @returns 0  success
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_writev_full
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+);
+
+/* c42_io8_seek64 ***********************************************************/
+/**
+ *  Changes the current position of a stream.
+ *  @param io stream
+ *  @param offset offset relative to @a anchor
+ *  @param anchor one of C42_IO8_SEEK_SET, C42_IO8_SEEK_CUR, C42_IO8_SEEK_END
+ *  @param pos receives the new position; can be NULL
+ *  @returns 0  success
+ *  @returns C42_IO8_NO_SEEK the stream class does not support seeking
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_seek64
+(
+    c42_io8_t * io,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+);
+
+/* c42_io8_truncate *********************************************************/
+/**
+ *  Truncates the stream at the current position.
+ *  @returns 0  success
+ *  @returns C42_IO8_NOT_IMPLEMENTED the stream class has no truncate
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_truncate
+(
+    c42_io8_t * io
+);
+
+/* c42_io8_close ************************************************************/
+/**
+ *  Closes the stream for the given directions.
+ *  Streams whose class has no close function are considered always closed.
+ *  @param io stream
+ *  @param mode bitmask with C42_IO8_OP_READ | C42_IO8_OP_WRITE
+ *  @returns 0  success
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_close
+(
+    c42_io8_t * io,
+    int mode
+);
+
+/* c42_io8_copy *************************************************************/
+/**
+ *  Copies data from one stream to another.
+ *  The transfer is attempted in this order:
+ *  - the copy_to function of the source class;
+ *  - the copy_from function of the destination class;
+ *  - peeking into the source and writing its buffered data directly;
+ *  - reading into @a buf and writing from it, also used when the first
+ *    peek fails with C42_IO8_TOO_BIG or C42_IO8_NOT_IMPLEMENTED (like an
+ *    io8buf without a read buffer).
+ *  The first two let service providers use kernel-assisted copies
+ *  (copy_file_range, sendfile, splice); the third avoids the bounce copy for
+ *  memory-backed and buffered sources.
+ *  @param dst destination stream
+ *  @param src source stream
+ *  @param max_size maximum number of bytes to copy; use UINT64_MAX to copy
+ *      until end of file
+ *  @param buf bounce buffer used only by the last method
+ *  @param buf_size size of @a buf; if 0 the last method is not available
+ *  @param csize receives the number of bytes copied; can be NULL
+ *  @returns 0 success: @a max_size bytes copied or end of source reached
+ *  @returns C42_IO8_NOT_IMPLEMENTED no method applies
+ *  @returns C42_IO8_xxx read or write error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_copy
+(
+    c42_io8_t * dst,
+    c42_io8_t * src,
+    uint64_t max_size,
+    uint8_t * buf,
+    size_t buf_size,
+    uint64_t * csize
+);
+
 /* c42_io8_write_u8z ********************************************************/
 /**
  *  Writes the given NUL terminated byte string.
@@ -1619,6 +2432,7 @@ C42_API uint_fast8_t C42_CALL c42_io8_write_u8z
 /* c42_io8_wvfmt ************************************************************/
 /**
  *  Writes formatted UTF-8 text (similar to printf formatting).
+ *  The text is gathered in segments and written with c42_io8_writev_full().
  *  @retval 0 success
  *  @retval C42_FMT_MALFORMED bad format string
  *  @retval C42_FMT_WIDTH_ERROR
@@ -1666,15 +2480,45 @@ C42_API uint_fast8_t C42_CALL c42_io8_wfmt
     ...
 );
 
-/* c42_io8_fmt **************************************************************/
+/* c42_io8_wafmt ************************************************************/
 /**
- *  Writes formatted UTF-8 text using terminal-style width calculations.
+ *  Writes formatted UTF-8 text with typed arguments.
+ *  See c42_write_afmt().
+ *  @returns 0 on success or some C42_IO8_xxx error code as c42_io8_wfmt()
+ *  @retval C42_IO8_FMT_ARG_MISMATCH argument does not match the format
  */
-#define c42_io8_fmt(_io, ...) \
-    (c42_io8_wfmt((_io), c42_utf8_term_width, NULL, __VA_ARGS__))
-
-/* c42_io8bc_t **************************************************************/
-/**
+C42_API uint_fast8_t C42_CALL c42_io8_wafmt
+(
+    c42_io8_t * io,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+);
+
+#if (__STDC_VERSION__ >= 201112L) || C42_DOXY
+/* C42_IO8_FMT **************************************************************/
+/**
+ *  Writes formatted UTF-8 text with typed arguments using terminal-style
+ *  width calculations.
+ *  Example: C42_IO8_FMT(&clia->stdio.out, "$s: $>5d\n", name, count)
+ *  @note needs C11 (_Generic)
+ */
+#define C42_IO8_FMT(_io, ...) \
+    (c42_io8_wafmt((_io), c42_utf8_term_width, NULL, \
+                   C42_FMT_ARGS(__VA_ARGS__)))
+#endif
+
+/* c42_io8_fmt **************************************************************/
+/**
+ *  Writes formatted UTF-8 text using terminal-style width calculations.
+ */
+#define c42_io8_fmt(_io, ...) \
+    (c42_io8_wfmt((_io), c42_utf8_term_width, NULL, __VA_ARGS__))
+
+/* c42_io8bc_t **************************************************************/
+/**
  *  I/O Stream with static buffer and counter.
  *  Check c42_io8bc_init().
  */
@@ -1696,6 +2540,9 @@ struct c42_io8bc_s
  *  any data that would not fit in the buffer.
  *  Read request that include missing data (data previously written at an
  *  offset past @a limit) will report C42_IO8_IO_ERROR.
+ *  The stream supports reading, seeking and truncating, including
+ *  c42_io8_peek() and c42_io8_consume() directly on the buffer.
+ *  For a stream that grows as needed use c42_io8mem_t.
  *  @returns @a io8bc casted to c42_io8_t.
  */
 C42_API c42_io8_t * C42_CALL c42_io8bc_init
@@ -1705,6 +2552,115 @@ C42_API c42_io8_t * C42_CALL c42_io8bc_init
     size_t limit
 );
 
+/* c42_io8mr_t **************************************************************/
+/**
+ *  I/O stream over a fixed memory region, such as a mapped file.
+ *  Check c42_io8mr_init().
+ */
+typedef struct c42_io8mr_s c42_io8mr_t;
+struct c42_io8mr_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    uint8_t * data; /**< start of region */
+    size_t size; /**< size of region */
+    size_t offset; /**< current position */
+    uint8_t writable; /**< non-zero if writes are allowed */
+};
+
+/* c42_io8mr_init ***********************************************************/
+/**
+ *  Inits a stream over a memory region.
+ *  Reads, c42_io8_peek() and c42_io8_consume() work directly on the region
+ *  without copying; seeking is allowed anywhere inside it; writes (if
+ *  @a writable) overwrite data in place and report C42_IO8_NO_SPACE at the
+ *  end of the region.
+ *  @returns @a io8mr casted to c42_io8_t.
+ */
+C42_API c42_io8_t * C42_CALL c42_io8mr_init
+(
+    c42_io8mr_t * io8mr,
+    uint8_t * data,
+    size_t size,
+    int writable
+);
+
+#define C42_IO8BUF_RA_MIN 0x1000
+/**< initial and minimum read-ahead of c42_io8buf_t on seekable streams */
+
+/* c42_io8buf_t *************************************************************/
+/**
+ *  Buffered I/O stream wrapping another stream.
+ *  Check c42_io8buf_init().
+ */
+typedef struct c42_io8buf_s c42_io8buf_t;
+struct c42_io8buf_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    c42_io8_t * io; /**< underlying stream */
+    uint8_t * rbuf; /**< read buffer */
+    size_t rsize; /**< size of read buffer; 0 disables read buffering */
+    size_t rpos; /**< offset of next byte to return from the read buffer */
+    size_t rlen; /**< number of valid bytes in the read buffer */
+    size_t ra; /**< bytes read ahead on the next refill (up to rsize) */
+    uint64_t upos; /**< position of the underlying stream, if upos_valid */
+    uint8_t ra_seq; /**< no seek since the last refill */
+    uint8_t ra_advice; /**< last C42_FSA_ADV_xxx hint given to io */
+    uint8_t upos_valid; /**< upos is known: set by seeks and position
+                          queries, cleared when a transfer fails */
+    uint8_t * wbuf; /**< write buffer */
+    size_t wsize; /**< size of write buffer; 0 disables write buffering */
+    size_t wlen; /**< number of bytes pending in the write buffer */
+};
+
+/* c42_io8buf_init **********************************************************/
+/**
+ *  Inits a buffered stream on top of @a io.
+ *  Reads smaller than the read buffer are served from data read ahead in
+ *  chunks of @a rsize; writes smaller than the write buffer are gathered and
+ *  passed down when the buffer fills up, on c42_io8buf_flush(), seek,
+ *  truncate or close. Transfers at least as large as the corresponding
+ *  buffer go straight to the underlying stream.
+ *  On seekable streams, writing or seeking discards the data read ahead and
+ *  moves the underlying position back accordingly; on non-seekable streams
+ *  (the class has no seek64) reading and writing are treated as independent
+ *  directions.
+ *  On seekable streams the amount read ahead adapts to the access pattern:
+ *  it starts at #C42_IO8BUF_RA_MIN and doubles on each refill not preceded
+ *  by a seek, up to @a rsize; it halves each time a seek discards data
+ *  read ahead. Streams that take hints (see c42_io8_advise()) are told
+ *  when the pattern turns sequential or random, and asked to prefetch the
+ *  next window while reading sequentially at full size. Position queries
+ *  (seeking 0 bytes from the current position) keep the data read ahead.
+ *  @param io8buf object to init
+ *  @param io underlying stream
+ *  @param rbuf read buffer; can be NULL if @a rsize is 0
+ *  @param rsize read buffer size
+ *  @param wbuf write buffer; can be NULL if @a wsize is 0
+ *  @param wsize write buffer size
+ *  @returns @a io8buf casted to c42_io8_t.
+ */
+C42_API c42_io8_t * C42_CALL c42_io8buf_init
+(
+    c42_io8buf_t * io8buf,
+    c42_io8_t * io,
+    uint8_t * rbuf,
+    size_t rsize,
+    uint8_t * wbuf,
+    size_t wsize
+);
+
+/* c42_io8buf_flush *********************************************************/
+/**
+ *  Writes all data pending in the write buffer to the underlying stream.
+ *  On error, data not written is kept in the buffer.
+ *  @returns 0  success
+ *  @returns C42_IO8_xxx error from the underlying stream
+ */
+C42_API uint_fast8_t C42_CALL c42_io8buf_flush
+(
+    c42_io8buf_t * io8buf
+);
+
 /** @} */
 
 /* fsa **********************************************************************/
@@ -1715,6 +2671,8 @@ C42_API c42_io8_t * C42_CALL c42_io8bc_init
 #define C42_FSA_SOME_ERROR 1 /**< exactly! */
 #define C42_FSA_BAD_MODE 2 /**< error: bad open mode specified. */
 #define C42_FSA_NO_MEM 3 /**< no mem to open the file */
+#define C42_FSA_NOT_SUPPORTED 4 /**< operation not provided by the interface */
+#define C42_FSA_NOT_FOUND 5 /**< no such file or directory */
 
 #define C42_FSA_OPEN_EXISTING 0 /**< opens existing file or fails */
 #define C42_FSA_OPEN_ALWAYS 1 /**< opens existing file or creates a new one */
@@ -1734,6 +2692,79 @@ C42_API c42_io8_t * C42_CALL c42_io8bc_init
 #define C42_FSA_OR (1 << (C42_FSA_PERM_SHIFT + 2)) /**< others-read perm */
 #define C42_FSA_OW (1 << (C42_FSA_PERM_SHIFT + 1)) /**< others-write perm */
 #define C42_FSA_OX (1 << (C42_FSA_PERM_SHIFT + 0)) /**< others-execute perm */
+#define C42_FSA_DIRECT (1 << 14)
+    /**< open flag: bypass the OS page cache (O_DIRECT); reads and writes
+     *  must use offsets, sizes and buffers aligned to
+     *  c42_fsa_stat_t#block_size (see c42_ma_aligned_alloc()) */
+
+#define C42_FSA_MAP_READ 1 /**< map for reading */
+#define C42_FSA_MAP_RW 3 /**< map for reading and writing (shared) */
+#define C42_FSA_ADV_NORMAL 0 /**< no particular access pattern */
+#define C42_FSA_ADV_SEQUENTIAL 1 /**< pages will be accessed sequentially */
+#define C42_FSA_ADV_RANDOM 2 /**< pages will be accessed in random order */
+#define C42_FSA_ADV_WILLNEED 3 /**< pages will be needed soon */
+
+#define C42_FSA_T_UNKNOWN 0 /**< entry type not known without a stat */
+#define C42_FSA_T_FILE 1 /**< regular file */
+#define C42_FSA_T_DIR 2 /**< directory */
+#define C42_FSA_T_LINK 3 /**< symbolic link */
+#define C42_FSA_T_OTHER 4 /**< device, pipe, socket... */
+
+#define C42_FSA_NOFOLLOW 1 /**< stat flag: do not follow a final symlink */
+
+/* c42_fsa_dir_t ************************************************************/
+/**
+ *  Open directory handle.
+ */
+typedef struct c42_fsa_dir_s c42_fsa_dir_t;
+struct c42_fsa_dir_s
+{
+    uintptr_t handle; /**< implementation specific */
+};
+
+/* c42_fsa_dirent_t *********************************************************/
+/**
+ *  Directory entry returned by c42_fsa_t#dir_read.
+ */
+typedef struct c42_fsa_dirent_s c42_fsa_dirent_t;
+struct c42_fsa_dirent_s
+{
+    uint8_t const * name;
+    /**< NUL-terminated name; valid until the next read or close on the
+     *  directory */
+    size_t name_len; /**< length of name */
+    uint64_t ino; /**< inode number or equivalent file id; 0 if unknown */
+    uint8_t type; /**< C42_FSA_T_xxx hint */
+};
+
+/* c42_fsa_stat_s ***********************************************************/
+/**
+ *  File attributes.
+ */
+struct c42_fsa_stat_s
+{
+    uint64_t size; /**< size in bytes */
+    uint64_t ino; /**< inode number or equivalent file id */
+    int64_t mtime_ns; /**< last modification, in ns since the Unix epoch */
+    uint32_t perm; /**< C42_FSA_UR... permission bits */
+    uint32_t nlink; /**< number of hard links */
+    uint32_t block_size;
+    /**< preferred I/O size; also the alignment of offsets, sizes and
+     *  buffers for files opened with C42_FSA_DIRECT */
+    uint8_t type; /**< C42_FSA_T_xxx */
+};
+
+/* c42_fsa_map_t ************************************************************/
+/**
+ *  Mapped file region.
+ */
+typedef struct c42_fsa_map_s c42_fsa_map_t;
+struct c42_fsa_map_s
+{
+    uint8_t * data; /**< start of mapped data */
+    size_t size; /**< size of mapped data */
+    uintptr_t handle; /**< implementation specific */
+};
 
 /* c42_fsa_t ****************************************************************/
 /**
@@ -1769,6 +2800,124 @@ struct c42_fsa_s
 
     /** Context pointer for c42_fsa_t#file_open function. */
     void * file_open_context;
+
+    /** File map function pointer; can be NULL if mapping is not supported.
+     *  @param [out] map
+     *      receives the mapped region
+     *  @param [in] path
+     *      a NUL-terminated byte-array with the path of the file to map
+     *  @param [in] offset
+     *      offset in file where the mapping starts; must be a multiple of
+     *      the page size
+     *  @param [in] size
+     *      size to map; 0 maps everything from @a offset to the end of file
+     *  @param [in] mode
+     *      C42_FSA_MAP_READ or C42_FSA_MAP_RW
+     *  @param [in] advice
+     *      one of C42_FSA_ADV_NORMAL, C42_FSA_ADV_SEQUENTIAL,
+     *      C42_FSA_ADV_RANDOM, C42_FSA_ADV_WILLNEED
+     *  @param context
+     *      value stored in c42_fsa_t#file_map_context
+     */
+    uint_fast8_t (C42_CALL * file_map)
+        (
+            c42_fsa_map_t * map,
+            uint8_t const * path,
+            uint64_t offset,
+            size_t size,
+            int mode,
+            int advice,
+            void * context
+        );
+
+    /** Changes the access advice for part of a mapped region. */
+    uint_fast8_t (C42_CALL * map_advise)
+        (
+            c42_fsa_map_t * map,
+            size_t offset,
+            size_t size,
+            int advice,
+            void * context
+        );
+
+    /** Unmaps a region returned by c42_fsa_t#file_map. */
+    uint_fast8_t (C42_CALL * unmap)
+        (
+            c42_fsa_map_t * map,
+            void * context
+        );
+
+    /** Context pointer for the map functions. */
+    void * file_map_context;
+
+    /** Directory open function pointer; can be NULL if enumeration is not
+     *  supported.
+     *  @param [out] dir
+     *      receives the directory handle
+     *  @param [in] path
+     *      a NUL-terminated byte-array with the path of the directory
+     *  @param context
+     *      value stored in c42_fsa_t#dir_context
+     */
+    uint_fast8_t (C42_CALL * dir_open)
+        (
+            c42_fsa_dir_t * dir,
+            uint8_t const * path,
+            void * context
+        );
+
+    /** Reads a batch of directory entries.
+     *  Implementations fill as many entries as they get from one bulk
+     *  system call (e.g. getdents64), so large directories need few calls.
+     *  The "." and ".." entries are not returned.
+     *  @param [in] dir
+     *      directory handle
+     *  @param [out] ent_a
+     *      array receiving the entries
+     *  @param [in] ent_m
+     *      number of items in @a ent_a
+     *  @param [out] ent_n
+     *      receives the number of entries filled; 0 at end of directory
+     */
+    uint_fast8_t (C42_CALL * dir_read)
+        (
+            c42_fsa_dir_t * dir,
+            c42_fsa_dirent_t * ent_a,
+            size_t ent_m,
+            size_t * ent_n,
+            void * context
+        );
+
+    /** Gets attributes of an entry relative to the directory handle
+     *  (fstatat-style), without resolving the directory path again; can be
+     *  NULL.
+     *  @param [in] dir
+     *      directory handle
+     *  @param [in] name
+     *      NUL-terminated entry name
+     *  @param [out] st
+     *      receives the attributes
+     *  @param [in] flags
+     *      0 or C42_FSA_NOFOLLOW
+     */
+    uint_fast8_t (C42_CALL * dir_stat)
+        (
+            c42_fsa_dir_t * dir,
+            uint8_t const * name,
+            c42_fsa_stat_t * st,
+            int flags,
+            void * context
+        );
+
+    /** Closes a directory handle. */
+    uint_fast8_t (C42_CALL * dir_close)
+        (
+            c42_fsa_dir_t * dir,
+            void * context
+        );
+
+    /** Context pointer for the directory functions. */
+    void * dir_context;
 };
 
 /* c42_file_open ************************************************************/
@@ -1786,6 +2935,126 @@ C42_INLINE uint_fast8_t C42_CALL c42_file_open
     return fsa->file_open(io, path, mode, fsa->file_open_context);
 }
 
+/* c42_file_map *************************************************************/
+/**
+ *  Maps a file in memory using the given filesystem interface.
+ *  The mapped region can be accessed as a stream with c42_io8mr_init().
+ *  @returns 0 success
+ *  @returns C42_FSA_NOT_SUPPORTED the interface does not support mapping
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_file_map
+(
+    c42_fsa_t * fsa,
+    c42_fsa_map_t * map,
+    uint8_t const * path,
+    uint64_t offset,
+    size_t size,
+    int mode,
+    int advice
+)
+{
+    if (!fsa->file_map) return C42_FSA_NOT_SUPPORTED;
+    return fsa->file_map(map, path, offset, size, mode, advice,
+                         fsa->file_map_context);
+}
+
+/* c42_file_map_advise ******************************************************/
+/**
+ *  Changes the access advice for part of a mapped region.
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_file_map_advise
+(
+    c42_fsa_t * fsa,
+    c42_fsa_map_t * map,
+    size_t offset,
+    size_t size,
+    int advice
+)
+{
+    if (!fsa->map_advise) return C42_FSA_NOT_SUPPORTED;
+    return fsa->map_advise(map, offset, size, advice, fsa->file_map_context);
+}
+
+/* c42_file_unmap ***********************************************************/
+/**
+ *  Unmaps a region mapped with c42_file_map().
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_file_unmap
+(
+    c42_fsa_t * fsa,
+    c42_fsa_map_t * map
+)
+{
+    if (!fsa->unmap) return C42_FSA_NOT_SUPPORTED;
+    return fsa->unmap(map, fsa->file_map_context);
+}
+
+/* c42_dir_open *************************************************************/
+/**
+ *  Opens a directory for enumeration.
+ *  @returns 0 success
+ *  @returns C42_FSA_NOT_SUPPORTED the interface cannot enumerate
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_dir_open
+(
+    c42_fsa_t * fsa,
+    c42_fsa_dir_t * dir,
+    uint8_t const * path
+)
+{
+    if (!fsa->dir_open) return C42_FSA_NOT_SUPPORTED;
+    return fsa->dir_open(dir, path, fsa->dir_context);
+}
+
+/* c42_dir_read *************************************************************/
+/**
+ *  Reads the next batch of entries; *ent_n is 0 at end of directory.
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_dir_read
+(
+    c42_fsa_t * fsa,
+    c42_fsa_dir_t * dir,
+    c42_fsa_dirent_t * ent_a,
+    size_t ent_m,
+    size_t * ent_n
+)
+{
+    return fsa->dir_read(dir, ent_a, ent_m, ent_n, fsa->dir_context);
+}
+
+/* c42_dir_stat *************************************************************/
+/**
+ *  Gets attributes of an entry of an open directory.
+ *  @returns 0 success
+ *  @returns C42_FSA_NOT_FOUND no such entry
+ *  @returns C42_FSA_NOT_SUPPORTED the interface has no per-entry stat
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_dir_stat
+(
+    c42_fsa_t * fsa,
+    c42_fsa_dir_t * dir,
+    uint8_t const * name,
+    c42_fsa_stat_t * st,
+    int flags
+)
+{
+    if (!fsa->dir_stat) return C42_FSA_NOT_SUPPORTED;
+    return fsa->dir_stat(dir, name, st, flags, fsa->dir_context);
+}
+
+/* c42_dir_close ************************************************************/
+/**
+ *  Closes a directory opened with c42_dir_open().
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_dir_close
+(
+    c42_fsa_t * fsa,
+    c42_fsa_dir_t * dir
+)
+{
+    return fsa->dir_close(dir, fsa->dir_context);
+}
+
 /** @} */
 
 /****************************************************************************/
@@ -1923,6 +3192,37 @@ C42_INLINE uint_fast8_t c42_ma_free
 #define C42_MA_ARRAY_FREE(_ma, _ptr, _cur_len) \
     (c42_ma_free((_ma), (_ptr), sizeof(*(_ptr)), (_cur_len)))
 
+/* c42_ma_aligned_alloc *****************************************************/
+/**
+ *  Allocates a block whose address is a multiple of @a align, such as the
+ *  buffers needed for direct I/O (#C42_FSA_DIRECT).
+ *  @param ma allocator
+ *  @param ptr_p receives the aligned address
+ *  @param size size of the block
+ *  @param align alignment; a power of 2
+ *  @returns 0 or C42_MA_xxx error
+ */
+C42_API uint_fast8_t C42_CALL c42_ma_aligned_alloc
+(
+    c42_ma_t * ma,
+    void * * ptr_p,
+    size_t size,
+    size_t align
+);
+
+/* c42_ma_aligned_free ******************************************************/
+/**
+ *  Frees a block allocated with c42_ma_aligned_alloc(); @a size and
+ *  @a align must be the same as for the allocation.
+ */
+C42_API uint_fast8_t C42_CALL c42_ma_aligned_free
+(
+    c42_ma_t * ma,
+    void * ptr,
+    size_t size,
+    size_t align
+);
+
 /* c42_malim_ctx_t **********************************************************/
 /**
  *  Memory allocator with limits (not thread-safe).
@@ -1963,12 +3263,154 @@ C42_API void C42_CALL c42_malim_init
 );
 /** @} */
 
+/** @addtogroup io8
+ *  @{
+ */
+
+/* c42_io8mem_t *************************************************************/
+/**
+ *  Growable in-memory file.
+ *  Data is stored in equally sized chunks allocated on demand from a
+ *  c42_ma_t, so growing never moves existing data.
+ *  Positional reads (c42_io8_pread()) can run concurrently as long as no
+ *  thread writes to the file at the same time.
+ *  Check c42_io8mem_init().
+ */
+typedef struct c42_io8mem_s c42_io8mem_t;
+struct c42_io8mem_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    c42_ma_t * ma; /**< allocator for chunks */
+    uint8_t * * chunk_a; /**< array of chunk pointers */
+    size_t chunk_n; /**< number of allocated chunks */
+    size_t chunk_m; /**< capacity of chunk_a */
+    size_t chunk_size; /**< size of each chunk (power of 2) */
+    size_t size; /**< file size */
+    size_t offset; /**< current position */
+    size_t limit; /**< max file size */
+    uint8_t chunk_shift; /**< log2(chunk_size) */
+};
+
+#define C42_IO8MEM_CHUNK_SIZE 0x10000 /**< default chunk size */
+
+/* c42_io8mem_init **********************************************************/
+/**
+ *  Inits an empty in-memory file.
+ *  The stream supports read, write, seek, truncate and peek/consume (peek
+ *  windows end at chunk boundaries). Writing past the end of file fills the
+ *  gap with zeroes. Writes report C42_IO8_NO_SPACE when @a limit is reached
+ *  or chunk allocation fails.
+ *  @param io8mem object to init
+ *  @param ma allocator used for chunks
+ *  @param chunk_size chunk size (rounded up to a power of 2, min 256);
+ *      0 selects #C42_IO8MEM_CHUNK_SIZE
+ *  @param limit max file size; 0 for no limit
+ *  @returns @a io8mem casted to c42_io8_t.
+ */
+C42_API c42_io8_t * C42_CALL c42_io8mem_init
+(
+    c42_io8mem_t * io8mem,
+    c42_ma_t * ma,
+    size_t chunk_size,
+    size_t limit
+);
+
+/* c42_io8mem_finish ********************************************************/
+/**
+ *  Frees all memory used by the in-memory file.
+ */
+C42_API void C42_CALL c42_io8mem_finish
+(
+    c42_io8mem_t * io8mem
+);
+
+#define C42_LINE_STRIP_CR 1 /**< line reader flag: drop CR before LF */
+
+/* c42_io8_line_reader_t ****************************************************/
+/**
+ *  Line reader over a stream that supports c42_io8_peek() (for instance a
+ *  c42_io8buf_t).
+ *  Lines that fit in a peek window are returned in place; lines spanning
+ *  windows are assembled in a buffer grown through the allocator.
+ *  All fields are internal.
+ *  Check c42_io8_line_reader_init().
+ */
+typedef struct c42_io8_line_reader_s c42_io8_line_reader_t;
+struct c42_io8_line_reader_s
+{
+    c42_io8_t * io;
+    c42_ma_t * ma;
+    uint8_t * buf;
+    size_t buf_size;
+    size_t pending;
+    size_t max_len;
+    unsigned int flags;
+    uint8_t skip;
+};
+
+/* c42_io8_line_reader_init *************************************************/
+/**
+ *  Inits a line reader.
+ *  @param lr [out] line reader
+ *  @param io [in] stream to read from; must support c42_io8_peek()
+ *  @param ma [in] allocator for lines longer than a peek window
+ *  @param flags [in] 0 or #C42_LINE_STRIP_CR
+ *  @param max_len [in] max line length accepted (without terminator);
+ *      0 means no limit
+ */
+C42_API void C42_CALL c42_io8_line_reader_init
+(
+    c42_io8_line_reader_t * lr,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int flags,
+    size_t max_len
+);
+
+/* c42_io8_line_reader_finish ***********************************************/
+/**
+ *  Frees the line buffer.
+ *  Data of the last returned line is consumed from the stream only when
+ *  the next line is requested, so after this the stream is positioned at
+ *  the start of that line.
+ */
+C42_API void C42_CALL c42_io8_line_reader_finish
+(
+    c42_io8_line_reader_t * lr
+);
+
+/* c42_io8_line_read ********************************************************/
+/**
+ *  Reads the next line.
+ *  The returned line excludes the LF terminator; the last line of the
+ *  stream may lack one. The data stays valid until the next call on the
+ *  reader and must not be modified.
+ *  @param lr line reader
+ *  @param line [out] receives the line
+ *  @returns 0 success
+ *  @returns C42_IO8_EOF no more lines
+ *  @returns C42_IO8_TOO_BIG line longer than the max length; the rest of
+ *      it is skipped on the next call
+ *  @returns C42_IO8_NO_MEM cannot grow the line buffer
+ *  @returns C42_IO8_NOT_IMPLEMENTED stream does not support peeking
+ *  @returns C42_IO8_xxx read error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_line_read
+(
+    c42_io8_line_reader_t * lr,
+    c42_u8an_t * line
+);
+
+/** @} */
+
 /****************************************************************************/
 /** @defgroup smt Simple Multithreading
  *  @{
  */
 
 #define C42_SMT_OK 0 /**< ok */
+#define C42_SMT_NO_MEM 1
+    /**< not enough memory to create a mutex or condition variable */
 
 /* c42_smt_tid_t ************************************************************/
 /**
@@ -2460,6 +3902,1877 @@ C42_API c42_rbtree_node_t * C42_CALL c42_rbtree_first
 
 /** @} */
 
+/* Deferred Logging *********************************************************/
+/** @defgroup dlog Deferred Logging
+ *  Logging where the calling thread only copies the format string pointer and
+ *  the raw arguments into a ring buffer it owns; formatting (or dumping in
+ *  binary form) is done later by a background thread.
+ *  @{
+ */
+
+#define C42_DLOG_OK 0 /**< ok */
+#define C42_DLOG_FULL 1 /**< ring buffer full; record dropped */
+#define C42_DLOG_TOO_BIG 2
+    /**< record can never fit in the ring or has too many arguments */
+#define C42_DLOG_NO_MEM 3 /**< not enough memory */
+#define C42_DLOG_SMT_ERROR 4 /**< multithreading error */
+#define C42_DLOG_IO_ERROR 5 /**< error writing or reading the log stream */
+#define C42_DLOG_MALFORMED 6 /**< malformed binary log */
+#define C42_DLOG_FMT_ERROR 7 /**< formatting a decoded record failed */
+
+#define C42_DLOG_TEXT 0 /**< background thread writes formatted text */
+#define C42_DLOG_BINARY 1
+    /**< background thread dumps records in binary form; such logs are turned
+     *  into text with c42_dlog_decode() */
+
+#define C42_DLOG_ARG_MAX 32 /**< max number of arguments in a record */
+
+/* c42_dlog_t ***************************************************************/
+/**
+ *  Deferred logger.
+ *  All fields are internal.
+ */
+typedef struct c42_dlog_s c42_dlog_t;
+
+/* c42_dlog_ring_t **********************************************************/
+/**
+ *  Single-producer ring buffer used by one thread to pass log records to
+ *  the logger's background thread.
+ *  All fields are internal.
+ */
+typedef struct c42_dlog_ring_s c42_dlog_ring_t;
+struct c42_dlog_ring_s
+{
+    c42_np_t links; /**< links in the list of rings of the logger */
+    c42_dlog_t * dlog; /**< logger this ring is attached to */
+    uint8_t * data; /**< ring data */
+    size_t size; /**< size of ring data; power of 2 */
+    size_t volatile head; /**< total bytes consumed */
+    size_t volatile tail; /**< total bytes produced */
+    size_t lost; /**< number of records dropped because the ring was full */
+};
+
+struct c42_dlog_s
+{
+    c42_np_t rings; /**< list of attached rings */
+    c42_smt_t * smt; /**< multithreading interface */
+    c42_ma_t * ma; /**< allocator for rings and format dictionary */
+    c42_smt_mutex_t * mutex; /**< held by the background thread while
+                               processing records; guards the ring list */
+    c42_smt_mutex_t * wake_mutex; /**< guards the sleep/wake handshake only,
+                                    so writers never wait for output */
+    c42_smt_cond_t * cond; /**< signalled under @a wake_mutex to wake up
+                             the background thread */
+    c42_io8_t * out; /**< output stream */
+    c42_utf8_width_f width_func; /**< width function for text output */
+    void * width_context; /**< context for width function */
+    c42_smt_tid_t tid; /**< background thread */
+    c42_rbtree_t fmt_tree; /**< format string dictionary (binary mode) */
+    void * fmt_list; /**< all dictionary nodes (binary mode) */
+    uint32_t fmt_count; /**< number of format strings defined so far */
+    uint8_t mode; /**< #C42_DLOG_TEXT or #C42_DLOG_BINARY */
+    uint8_t volatile sleeping; /**< background thread is waiting */
+    uint8_t volatile stop; /**< background thread should exit */
+    uint8_t ioe; /**< first output error (C42_IO8_xxx) */
+    uint8_t fmte; /**< first formatting error (C42_IO8_xxx) */
+};
+
+/* c42_dlog_init ************************************************************/
+/**
+ *  Inits a deferred logger and starts its background thread.
+ *  @param dlog [out] logger to init
+ *  @param smt [in] multithreading interface
+ *  @param ma [in] allocator; must be thread-safe as it is used by rings
+ *      being attached or detached from any thread
+ *  @param out [in] stream where the background thread writes
+ *  @param mode [in] #C42_DLOG_TEXT or #C42_DLOG_BINARY
+ *  @param width_func [in] width function used for text output
+ *  @param width_context [in] context for @a width_func
+ *  @retval 0 success
+ *  @retval C42_DLOG_NO_MEM
+ *  @retval C42_DLOG_SMT_ERROR
+ *  @retval C42_DLOG_IO_ERROR failed writing the binary log header
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_init
+(
+    c42_dlog_t * dlog,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    c42_io8_t * out,
+    uint_fast8_t mode,
+    c42_utf8_width_f width_func,
+    void * width_context
+);
+
+/* c42_dlog_finish **********************************************************/
+/**
+ *  Stops the background thread after it processes all pending records and
+ *  frees the resources of the logger.
+ *  All rings must be detached before calling this.
+ *  @retval 0 success
+ *  @retval C42_DLOG_SMT_ERROR
+ *  @retval C42_DLOG_IO_ERROR some output failed while the logger was running
+ *  @retval C42_DLOG_FMT_ERROR some record failed formatting
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_finish
+(
+    c42_dlog_t * dlog
+);
+
+/* c42_dlog_ring_attach *****************************************************/
+/**
+ *  Allocates the buffer of a ring and attaches it to the logger.
+ *  Each thread that logs should have its own ring (for instance stored in
+ *  thread-local storage).
+ *  @param ring [out] ring to init
+ *  @param dlog [in] logger
+ *  @param size [in] buffer size; rounded up to a power of 2 (min 0x100)
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_ring_attach
+(
+    c42_dlog_ring_t * ring,
+    c42_dlog_t * dlog,
+    size_t size
+);
+
+/* c42_dlog_ring_detach *****************************************************/
+/**
+ *  Processes all records left in the ring, detaches it from the logger and
+ *  frees its buffer.
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_ring_detach
+(
+    c42_dlog_ring_t * ring
+);
+
+/* c42_dlog_write ***********************************************************/
+/**
+ *  Copies a log record in the ring.
+ *  This never blocks and does not format anything: it copies the pointer
+ *  @a fmt, the arguments and the bytes of string arguments.
+ *  @param ring [in] ring owned by the calling thread
+ *  @param fmt [in] format string; must stay valid while the logger runs
+ *      (normally a string literal)
+ *  @param arg_a [in] typed arguments; string arguments must be
+ *      NUL-terminated as they are copied up to the terminator
+ *  @param arg_n [in] number of arguments
+ *  @retval 0 record queued
+ *  @retval C42_DLOG_FULL not enough space in the ring; record dropped and
+ *      counted in c42_dlog_ring_t#lost
+ *  @retval C42_DLOG_TOO_BIG
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_write
+(
+    c42_dlog_ring_t * ring,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+);
+
+#if (__STDC_VERSION__ >= 201112L) || C42_DOXY
+/* C42_DLOG *****************************************************************/
+/**
+ *  Queues a log record with typed arguments.
+ *  Example: C42_DLOG(ring, "req $d took $q ns\n", req_id, ns)
+ *  @note needs C11 (_Generic)
+ */
+#define C42_DLOG(_ring, ...) \
+    (c42_dlog_write((_ring), C42_FMT_ARGS(__VA_ARGS__)))
+#endif
+
+/* c42_dlog_decode **********************************************************/
+/**
+ *  Converts a binary log produced by a logger in #C42_DLOG_BINARY mode to
+ *  text.
+ *  @param in [in] binary log
+ *  @param out [in] text output
+ *  @param width_func [in] width function for formatting
+ *  @param width_context [in] context for @a width_func
+ *  @param ma [in] allocator for the format dictionary and string arguments
+ *  @retval 0 success
+ *  @retval C42_DLOG_MALFORMED
+ *  @retval C42_DLOG_IO_ERROR
+ *  @retval C42_DLOG_FMT_ERROR
+ *  @retval C42_DLOG_NO_MEM
+ */
+C42_API uint_fast8_t C42_CALL c42_dlog_decode
+(
+    c42_io8_t * in,
+    c42_io8_t * out,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    c42_ma_t * ma
+);
+
+/** @} */
+
+/* Asynchronous I/O *********************************************************/
+/** @defgroup aio Asynchronous I/O
+ *  Submission/completion interface for I/O requests at explicit offsets.
+ *  A provider (c42_aio_t) accepts batches of requests and hands them back in
+ *  batches once completed. Service providers can implement it on top of
+ *  kernel facilities (like io_uring); c42_aiopool_t is a portable provider
+ *  that runs the requests on worker threads created through c42_smt_t.
+ *  @{
+ */
+
+#define C42_AIO_OK 0 /**< ok */
+#define C42_AIO_NO_MEM 1 /**< not enough memory */
+#define C42_AIO_SMT_ERROR 2 /**< multithreading error */
+
+#define C42_AIO_READ 1 /**< read request */
+#define C42_AIO_WRITE 2 /**< write request */
+#define C42_AIO_SYNC 3
+    /**< flush file data to storage with c42_io8_sync(); data, size and
+     *  offset are ignored */
+
+/* c42_aio_req_t ************************************************************/
+/**
+ *  Asynchronous I/O request.
+ *  The request is owned by the provider between submission and the moment
+ *  it is returned by c42_aio_reap().
+ */
+typedef struct c42_aio_req_s c42_aio_req_t;
+struct c42_aio_req_s
+{
+    c42_np_t links; /**< used internally by the provider */
+    c42_io8_t * io; /**< stream to operate on */
+    uint8_t * data; /**< buffer for reading or writing */
+    size_t size; /**< number of bytes to transfer */
+    uint64_t offset; /**< stream offset of the transfer */
+    uintptr_t user; /**< user data, untouched by the provider */
+    size_t done; /**< output: number of bytes transferred */
+    uint8_t op; /**< one of C42_AIO_READ, C42_AIO_WRITE, C42_AIO_SYNC */
+    uint8_t ioe; /**< output: C42_IO8_xxx result; reads stopped by end of
+                   file complete with C42_IO8_EOF */
+};
+
+/* c42_aio_t ****************************************************************/
+/**
+ *  Asynchronous I/O provider interface.
+ */
+typedef struct c42_aio_s c42_aio_t;
+struct c42_aio_s
+{
+    /** Queues requests; can accept fewer than given when full. */
+    uint_fast8_t (C42_CALL * submit)
+        (
+            c42_aio_t * aio,
+            c42_aio_req_t * const * req_a,
+            size_t req_n,
+            size_t * accepted
+        );
+
+    /** Waits until at least @a min_n requests completed (or none are left in
+     *  flight) and returns up to @a max_n of them. */
+    uint_fast8_t (C42_CALL * reap)
+        (
+            c42_aio_t * aio,
+            c42_aio_req_t * * req_a,
+            size_t min_n,
+            size_t max_n,
+            size_t * reaped
+        );
+};
+
+/* c42_aio_submit ***********************************************************/
+/**
+ *  Submits a batch of requests.
+ *  @param aio provider
+ *  @param req_a array of requests
+ *  @param req_n number of requests
+ *  @param accepted receives the number of requests queued (a prefix of
+ *      @a req_a)
+ *  @returns 0 success
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_aio_submit
+(
+    c42_aio_t * aio,
+    c42_aio_req_t * const * req_a,
+    size_t req_n,
+    size_t * accepted
+)
+{
+    return aio->submit(aio, req_a, req_n, accepted);
+}
+
+/* c42_aio_reap *************************************************************/
+/**
+ *  Reaps completed requests.
+ *  Blocks until at least @a min_n requests are complete or there are no more
+ *  requests in flight; pass 0 to poll.
+ *  @param aio provider
+ *  @param req_a array receiving completed requests
+ *  @param min_n minimum number of completions to wait for
+ *  @param max_n capacity of @a req_a
+ *  @param reaped receives the number of requests stored in @a req_a
+ *  @returns 0 success
+ */
+C42_INLINE uint_fast8_t C42_CALL c42_aio_reap
+(
+    c42_aio_t * aio,
+    c42_aio_req_t * * req_a,
+    size_t min_n,
+    size_t max_n,
+    size_t * reaped
+)
+{
+    return aio->reap(aio, req_a, min_n, max_n, reaped);
+}
+
+/* c42_aiopool_t ************************************************************/
+/**
+ *  Thread-pool asynchronous I/O provider.
+ *  All fields except the base c42_aio_t are internal.
+ */
+typedef struct c42_aiopool_s c42_aiopool_t;
+struct c42_aiopool_s
+{
+    c42_aio_t aio; /**< base provider interface */
+    c42_smt_t * smt;
+    c42_ma_t * ma;
+    c42_smt_mutex_t * mutex;
+    c42_smt_mutex_t * io_mutex;
+    c42_smt_cond_t * work_cond;
+    c42_smt_cond_t * done_cond;
+    c42_np_t pending;
+    c42_np_t done;
+    c42_smt_tid_t * tid_a;
+    size_t thread_n;
+    size_t in_flight;
+    uint8_t stop;
+};
+
+/* c42_aiopool_init *********************************************************/
+/**
+ *  Inits a thread-pool provider.
+ *  Requests on streams whose class has positional read/write (see
+ *  c42_io8_pread()) and the C42_IO8_CLASS_MT_PIO flag run concurrently.
+ *  Positional requests on other classes run one at a time under a lock,
+ *  and streams without them are accessed with seek followed by a full
+ *  read or write under the same lock, so any seekable c42_io8_t can be
+ *  used, including streams shared by several requests.
+ *  @param pool [out] provider to init
+ *  @param smt [in] multithreading interface
+ *  @param ma [in] allocator
+ *  @param thread_n [in] number of worker threads (at least 1)
+ *  @retval 0 success
+ *  @retval C42_AIO_NO_MEM
+ *  @retval C42_AIO_SMT_ERROR
+ */
+C42_API uint_fast8_t C42_CALL c42_aiopool_init
+(
+    c42_aiopool_t * pool,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    size_t thread_n
+);
+
+/* c42_aiopool_finish *******************************************************/
+/**
+ *  Waits for the requests in flight, stops the workers and frees resources.
+ *  Completed requests that were not reaped are dropped.
+ */
+C42_API uint_fast8_t C42_CALL c42_aiopool_finish
+(
+    c42_aiopool_t * pool
+);
+
+#define C42_AIO_ORDERED 1
+    /**< c42_aio_read_range() flag: deliver chunks in offset order */
+
+/* c42_aio_chunk_f **********************************************************/
+/**
+ *  Receives one chunk read by c42_aio_read_range().
+ *  @param data chunk bytes; only valid during the call
+ *  @param size chunk size; smaller than requested only for the chunk that
+ *      ends the range or hits end of file
+ *  @param offset stream offset of the chunk
+ *  @param ctx context given to c42_aio_read_range()
+ *  @returns 0 to continue or a C42_IO8_xxx error to stop the transfer
+ */
+typedef uint_fast8_t (C42_CALL * c42_aio_chunk_f)
+    (
+        uint8_t const * data,
+        size_t size,
+        uint64_t offset,
+        void * ctx
+    );
+
+/* c42_aio_read_range *******************************************************/
+/**
+ *  Reads a range of a stream as chunks kept in flight concurrently.
+ *  Up to @a depth chunk reads are queued on @a aio at any time; completed
+ *  chunks are passed to @a chunk_func from the calling thread, either as
+ *  they complete or, with #C42_AIO_ORDERED, in increasing offset order.
+ *  End of file inside the range ends the transfer without error.
+ *  @param aio provider
+ *  @param io stream to read; see c42_aiopool_init() for what a thread-pool
+ *      provider needs from it
+ *  @param offset start of the range
+ *  @param size length of the range; use UINT64_MAX to read until end of file
+ *  @param chunk_size bytes per read request
+ *  @param depth number of chunk reads in flight (and chunk buffers)
+ *  @param ma allocator for the chunk buffers
+ *  @param flags 0 or #C42_AIO_ORDERED
+ *  @param chunk_func chunk consumer
+ *  @param chunk_ctx context for @a chunk_func
+ *  @retval 0 success
+ *  @retval C42_IO8_NO_MEM could not allocate the buffers
+ *  @retval C42_IO8_OTHER_ERROR the provider failed to submit or reap
+ *  @returns the first read error, or the error returned by @a chunk_func;
+ *      requests in flight are reaped before returning
+ */
+C42_API uint_fast8_t C42_CALL c42_aio_read_range
+(
+    c42_aio_t * aio,
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    size_t chunk_size,
+    size_t depth,
+    c42_ma_t * ma,
+    unsigned int flags,
+    c42_aio_chunk_f chunk_func,
+    void * chunk_ctx
+);
+
+/* c42_io8_parallel_read ****************************************************/
+/**
+ *  Reads a range of a stream on @a thread_n worker threads.
+ *  Runs c42_aio_read_range() on a c42_aiopool_t created for the call, with
+ *  two chunks in flight per thread.
+ *  @retval C42_IO8_OTHER_ERROR the worker threads could not be started
+ */
+C42_API uint_fast8_t C42_CALL c42_io8_parallel_read
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    size_t chunk_size,
+    size_t thread_n,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    unsigned int flags,
+    c42_aio_chunk_f chunk_func,
+    void * chunk_ctx
+);
+
+/** @} */
+
+/* Pipes ********************************************************************/
+/** @defgroup pipe Pipes
+ *  Byte stream between one producer thread and one consumer thread, over a
+ *  lock-free ring buffer.
+ *  @{
+ */
+
+#define C42_PIPE_OK 0 /**< ok */
+#define C42_PIPE_NO_MEM 1 /**< not enough memory */
+#define C42_PIPE_SMT_ERROR 2 /**< multithreading error */
+#define C42_PIPE_TOO_BIG 3 /**< requested ring size too large */
+
+/* c42_pipe_t ***************************************************************/
+/**
+ *  Single-producer/single-consumer pipe.
+ *  The producer writes through c42_pipe_t#writer, the consumer reads through
+ *  c42_pipe_t#reader. Neither side takes a lock while the ring is neither
+ *  empty nor full; a side blocks on a condition variable only when it
+ *  cannot make progress.
+ *  Fields other than the two streams are internal.
+ */
+typedef struct c42_pipe_s c42_pipe_t;
+struct c42_pipe_s
+{
+    c42_io8_t reader; /**< read end: read, peek/consume, close */
+    c42_io8_t writer; /**< write end: write, close */
+    c42_smt_t * smt;
+    c42_ma_t * ma;
+    c42_smt_mutex_t * mutex;
+    c42_smt_cond_t * cond;
+    uint8_t * data;
+    size_t size;
+    size_t volatile head;
+    size_t volatile tail;
+    uint8_t volatile r_wait;
+    uint8_t volatile w_wait;
+    uint8_t volatile r_closed;
+    uint8_t volatile w_closed;
+};
+
+/* c42_pipe_init ************************************************************/
+/**
+ *  Inits a pipe.
+ *  @param pipe [out] pipe to init
+ *  @param smt [in] multithreading interface used for blocking
+ *  @param ma [in] allocator for the ring and synchronisation objects
+ *  @param size [in] ring size; rounded up to a power of 2 (min 256)
+ *  @retval 0 success
+ *  @retval C42_PIPE_NO_MEM
+ *  @retval C42_PIPE_SMT_ERROR
+ *  @retval C42_PIPE_TOO_BIG
+ */
+C42_API uint_fast8_t C42_CALL c42_pipe_init
+(
+    c42_pipe_t * pipe,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    size_t size
+);
+
+/* c42_pipe_finish **********************************************************/
+/**
+ *  Frees the pipe resources; both ends must be done using it.
+ */
+C42_API uint_fast8_t C42_CALL c42_pipe_finish
+(
+    c42_pipe_t * pipe
+);
+
+/* c42_pipe_reserve *********************************************************/
+/**
+ *  Producer side: waits for free space and returns it for filling in place.
+ *  @param pipe pipe
+ *  @param ptr receives a pointer to contiguous free space
+ *  @param avail receives the size of the free space (at least 1)
+ *  @returns 0 success
+ *  @returns C42_IO8_BROKEN_PIPE the reader closed its end
+ */
+C42_API uint_fast8_t C42_CALL c42_pipe_reserve
+(
+    c42_pipe_t * pipe,
+    uint8_t * * ptr,
+    size_t * avail
+);
+
+/* c42_pipe_commit **********************************************************/
+/**
+ *  Producer side: publishes @a size bytes filled in the space returned by
+ *  c42_pipe_reserve().
+ */
+C42_API void C42_CALL c42_pipe_commit
+(
+    c42_pipe_t * pipe,
+    size_t size
+);
+
+/** @} */
+
+/* LZ Compression ***********************************************************/
+/** @defgroup lz LZ Compression
+ *  Fast byte-oriented LZ77 codec (LZ4-style sequences) and a block-framed
+ *  stream format on top of it.
+ *
+ *  Stream format:
+ *  - header: "C42LZ" followed by one byte with log2 of the max block size;
+ *  - blocks, each with a header made of two 32-bit little-endian values:
+ *    the stored size (bit 31 set if the block is stored uncompressed) and
+ *    the decompressed size, followed by the stored bytes;
+ *  - a 32-bit zero terminator.
+ *
+ *  Each block is compressed independently so blocks can be decompressed in
+ *  parallel with c42_lz_decompress_block() after scanning the headers.
+ *  @{
+ */
+
+#define C42_LZ_OK 0 /**< ok */
+#define C42_LZ_NO_MEM 1 /**< not enough memory */
+#define C42_LZ_BAD_BLOCK_LOG 2 /**< block size log out of range */
+
+#define C42_LZ_BLOCK_LOG_MIN 10 /**< min log2 of the block size */
+#define C42_LZ_BLOCK_LOG_MAX 22 /**< max log2 of the block size */
+#define C42_LZ_BLOCK_LOG_DEFAULT 16 /**< default log2 of the block size */
+#define C42_LZ_HASH_LOG 12 /**< log2 of the number of hash table entries */
+#define C42_LZ_STREAM_HEADER_SIZE 6 /**< size of the stream header */
+#define C42_LZ_BLOCK_HEADER_SIZE 8 /**< size of a block header */
+#define C42_LZ_RAW_FLAG 0x80000000 /**< stored block flag in block header */
+
+/* c42_lz_compress_block ****************************************************/
+/**
+ *  Compresses one block.
+ *  @param src data to compress
+ *  @param len size of data (max 2^C42_LZ_BLOCK_LOG_MAX)
+ *  @param dst output buffer
+ *  @param cap size of output buffer
+ *  @param table scratch hash table with (1 << C42_LZ_HASH_LOG) entries
+ *  @returns size of compressed data
+ *  @retval 0 compressed data does not fit in @a cap bytes
+ */
+C42_API size_t C42_CALL c42_lz_compress_block
+(
+    uint8_t const * src,
+    size_t len,
+    uint8_t * dst,
+    size_t cap,
+    uint32_t * table
+);
+
+/* c42_lz_decompress_block **************************************************/
+/**
+ *  Decompresses one block.
+ *  @param src compressed data
+ *  @param len size of compressed data
+ *  @param dst output buffer
+ *  @param cap size of output buffer
+ *  @param out_len receives size of decompressed data
+ *  @retval 0 success
+ *  @retval C42_CLCONV_MALFORMED corrupt input or output too small
+ */
+C42_API uint_fast8_t C42_CALL c42_lz_decompress_block
+(
+    uint8_t const * src,
+    size_t len,
+    uint8_t * dst,
+    size_t cap,
+    size_t * out_len
+);
+
+/* c42_lz_enc_t *************************************************************/
+/**
+ *  Stream compressor state for c42_clconv_lz_encode().
+ *  All fields are internal.
+ */
+typedef struct c42_lz_enc_s c42_lz_enc_t;
+struct c42_lz_enc_s
+{
+    c42_ma_t * ma;
+    uint8_t * in;
+    uint8_t * out;
+    uint32_t * table;
+    size_t block_size;
+    size_t in_len;
+    size_t out_pos;
+    size_t out_len;
+    uint8_t ended;
+};
+
+/* c42_lz_enc_init **********************************************************/
+/**
+ *  Inits a stream compressor.
+ *  @param enc [out] compressor state
+ *  @param ma [in] allocator for buffers
+ *  @param block_log [in] log2 of block size, between #C42_LZ_BLOCK_LOG_MIN
+ *      and #C42_LZ_BLOCK_LOG_MAX
+ *  @retval 0 success
+ *  @retval C42_LZ_NO_MEM
+ *  @retval C42_LZ_BAD_BLOCK_LOG
+ */
+C42_API uint_fast8_t C42_CALL c42_lz_enc_init
+(
+    c42_lz_enc_t * enc,
+    c42_ma_t * ma,
+    unsigned int block_log
+);
+
+/* c42_lz_enc_finish ********************************************************/
+/**
+ *  Frees compressor buffers.
+ */
+C42_API void C42_CALL c42_lz_enc_finish
+(
+    c42_lz_enc_t * enc
+);
+
+/* c42_clconv_lz_encode *****************************************************/
+/**
+ *  Compressing converter; see #c42_clconv_f.
+ *  @param ctx pointer to a c42_lz_enc_t
+ *  @retval C42_CLCONV_OK all input used
+ *  @retval C42_CLCONV_FULL output full
+ */
+C42_API uint_fast8_t C42_CALL c42_clconv_lz_encode
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+);
+
+/* c42_lz_dec_t *************************************************************/
+/**
+ *  Stream decompressor state for c42_clconv_lz_decode().
+ *  All fields are internal.
+ */
+typedef struct c42_lz_dec_s c42_lz_dec_t;
+struct c42_lz_dec_s
+{
+    c42_ma_t * ma;
+    uint8_t * in;
+    uint8_t * out;
+    size_t buf_size;
+    size_t block_size;
+    size_t need;
+    size_t have;
+    size_t out_pos;
+    size_t out_len;
+    uint32_t stored;
+    uint32_t raw_len;
+    uint8_t hdr[C42_LZ_BLOCK_HEADER_SIZE];
+    uint8_t state;
+};
+
+/* c42_lz_dec_init **********************************************************/
+/**
+ *  Inits a stream decompressor.
+ *  @param dec [out] decompressor state
+ *  @param ma [in] allocator for buffers
+ *  @param max_block_log [in] largest block size log accepted from the
+ *      stream header; buffers for this size are allocated upfront
+ *  @retval 0 success
+ *  @retval C42_LZ_NO_MEM
+ *  @retval C42_LZ_BAD_BLOCK_LOG
+ */
+C42_API uint_fast8_t C42_CALL c42_lz_dec_init
+(
+    c42_lz_dec_t * dec,
+    c42_ma_t * ma,
+    unsigned int max_block_log
+);
+
+/* c42_lz_dec_finish ********************************************************/
+/**
+ *  Frees decompressor buffers.
+ */
+C42_API void C42_CALL c42_lz_dec_finish
+(
+    c42_lz_dec_t * dec
+);
+
+/* c42_clconv_lz_decode *****************************************************/
+/**
+ *  Decompressing converter; see #c42_clconv_f.
+ *  @param ctx pointer to a c42_lz_dec_t
+ *  @retval C42_CLCONV_OK all input used (or, on the final call with
+ *      @a in NULL, the stream ended properly)
+ *  @retval C42_CLCONV_FULL output full
+ *  @retval C42_CLCONV_MALFORMED corrupt stream or data after its end
+ *  @retval C42_CLCONV_INCOMPLETE final call with a truncated stream
+ */
+C42_API uint_fast8_t C42_CALL c42_clconv_lz_decode
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+);
+
+#define C42_IO8LZ_BUF_SIZE 0x1000 /**< staging buffer size for c42_io8lz_t */
+
+/* c42_io8lz_t **************************************************************/
+/**
+ *  Compressing or decompressing filter stream over another stream.
+ *  Check c42_io8lz_writer_init() and c42_io8lz_reader_init().
+ */
+typedef struct c42_io8lz_s c42_io8lz_t;
+struct c42_io8lz_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    c42_io8_t * io; /**< underlying stream */
+    union
+    {
+        c42_lz_enc_t enc;
+        c42_lz_dec_t dec;
+    } lz; /**< codec state */
+    size_t buf_pos; /**< offset of unused data in buf (reader) */
+    size_t buf_len; /**< amount of data in buf (reader) */
+    uint8_t eof; /**< underlying stream reached end of file (reader) */
+    uint8_t buf[C42_IO8LZ_BUF_SIZE]; /**< staging buffer */
+};
+
+/* c42_io8lz_writer_init ****************************************************/
+/**
+ *  Inits a stream that compresses data written to it into @a io.
+ *  Closing the stream for writing (c42_io8_close()) writes the last block
+ *  and the stream terminator, then closes @a io.
+ *  @returns 0 or C42_LZ_xxx error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8lz_writer_init
+(
+    c42_io8lz_t * lz,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int block_log
+);
+
+/* c42_io8lz_reader_init ****************************************************/
+/**
+ *  Inits a stream that decompresses data read from @a io.
+ *  Reads fail with #C42_IO8_BAD_DATA if the compressed stream is corrupt or
+ *  truncated.
+ *  @returns 0 or C42_LZ_xxx error
+ */
+C42_API uint_fast8_t C42_CALL c42_io8lz_reader_init
+(
+    c42_io8lz_t * lz,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int max_block_log
+);
+
+/* c42_io8lz_finish *********************************************************/
+/**
+ *  Frees codec buffers. A writer must be closed before this.
+ */
+C42_API void C42_CALL c42_io8lz_finish
+(
+    c42_io8lz_t * lz
+);
+
+/** @} */
+
+/* Checksums ****************************************************************/
+/** @defgroup csum Checksums
+ *  CRC32C, a fast 64-bit non-cryptographic hash and io8 filters that
+ *  compute them on the data passing through.
+ *  @{
+ */
+
+/* c42_crc32c ***************************************************************/
+/**
+ *  Updates a CRC32C (Castagnoli) checksum.
+ *  Uses the SSE4.2 crc32 instruction when the library is compiled for it,
+ *  otherwise a slice-by-8 table lookup.
+ *  @param crc checksum of the previous data; 0 to start
+ *  @param data bytes to add
+ *  @param len number of bytes
+ *  @returns updated checksum
+ */
+C42_API uint32_t C42_CALL c42_crc32c
+(
+    uint32_t crc,
+    uint8_t const * data,
+    size_t len
+);
+
+/* c42_h64_t ****************************************************************/
+/**
+ *  Streaming state for the 64-bit hash (XXH64 algorithm).
+ *  All fields are internal.
+ */
+typedef struct c42_h64_s c42_h64_t;
+struct c42_h64_s
+{
+    uint64_t v[4];
+    uint64_t total;
+    uint64_t seed;
+    uint8_t buf[32];
+    uint32_t buf_len;
+};
+
+/* c42_h64_init *************************************************************/
+/**
+ *  Starts a hash computation.
+ */
+C42_API void C42_CALL c42_h64_init
+(
+    c42_h64_t * h,
+    uint64_t seed
+);
+
+/* c42_h64_update ***********************************************************/
+/**
+ *  Adds data to a hash computation.
+ */
+C42_API void C42_CALL c42_h64_update
+(
+    c42_h64_t * h,
+    uint8_t const * data,
+    size_t len
+);
+
+/* c42_h64_digest ***********************************************************/
+/**
+ *  Returns the hash of the data added so far.
+ *  The state is not changed so more data can be added afterwards.
+ */
+C42_API uint64_t C42_CALL c42_h64_digest
+(
+    c42_h64_t const * h
+);
+
+/* c42_h64 ******************************************************************/
+/**
+ *  Computes the 64-bit hash of a buffer.
+ */
+C42_API uint64_t C42_CALL c42_h64
+(
+    uint8_t const * data,
+    size_t len,
+    uint64_t seed
+);
+
+#define C42_IO8SUM_CRC32C 1 /**< c42_io8sum_t computes CRC32C */
+#define C42_IO8SUM_H64 2 /**< c42_io8sum_t computes the 64-bit hash */
+
+/* c42_io8sum_t *************************************************************/
+/**
+ *  Pass-through stream that checksums the data read from or written to
+ *  the underlying stream.
+ *  Peeked data is added when it is consumed, so reading through
+ *  c42_io8_peek() costs no copy.
+ *  Seeking is not supported as it would break the digest.
+ *  Check c42_io8sum_init().
+ */
+typedef struct c42_io8sum_s c42_io8sum_t;
+struct c42_io8sum_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    c42_io8_t * io; /**< underlying stream */
+    uint8_t const * peek_ptr; /**< last peek window (internal) */
+    uint64_t size; /**< number of bytes checksummed */
+    c42_h64_t h64; /**< 64-bit hash state */
+    uint32_t crc32c; /**< CRC32C so far */
+    unsigned int algos; /**< C42_IO8SUM_xxx bitmask */
+};
+
+/* c42_io8sum_init **********************************************************/
+/**
+ *  Inits a checksumming stream over @a io.
+ *  Read and write each update the same digests, so use one filter per
+ *  direction.
+ *  @param sum [out] filter to init
+ *  @param io [in] underlying stream
+ *  @param algos [in] bitmask of #C42_IO8SUM_CRC32C and #C42_IO8SUM_H64
+ *  @param seed [in] seed for the 64-bit hash
+ *  @returns @a sum casted to c42_io8_t
+ */
+C42_API c42_io8_t * C42_CALL c42_io8sum_init
+(
+    c42_io8sum_t * sum,
+    c42_io8_t * io,
+    unsigned int algos,
+    uint64_t seed
+);
+
+/** @} */
+
+/* Clock ********************************************************************/
+/** @defgroup clock Clock
+ *  Time source interface, provided by the service layer (see c42_svc_t).
+ *  @{
+ */
+
+/* c42_clock_t **************************************************************/
+/**
+ *  Clock interface.
+ */
+typedef struct c42_clock_s c42_clock_t;
+struct c42_clock_s
+{
+    uint64_t (C42_CALL * monotonic_ns)
+        (c42_clock_t * clock_p);
+    /**< returns nanoseconds elapsed since an arbitrary fixed point;
+     *  never goes backwards and is not affected by wall clock changes */
+    void * context; /**< implementation specific context data */
+};
+
+/* c42_clock_monotonic_ns ***************************************************/
+/**
+ *  Reads the monotonic clock.
+ */
+C42_INLINE uint64_t c42_clock_monotonic_ns
+(
+    c42_clock_t * clock_p
+)
+{
+    return clock_p->monotonic_ns(clock_p);
+}
+
+/** @} */
+
+/* I/O Statistics ***********************************************************/
+/** @defgroup io8stats I/O Statistics
+ *  Pass-through stream that counts operations and measures their latency.
+ *  @{
+ */
+
+#define C42_IO8STATS_READ 0 /**< read, readv, pread, peek and consume */
+#define C42_IO8STATS_WRITE 1 /**< write, writev and pwrite */
+#define C42_IO8STATS_SEEK 2 /**< seek and seek64 */
+#define C42_IO8STATS_OTHER 3 /**< truncate, close, stat, allocate, sync */
+#define C42_IO8STATS_OP_COUNT 4 /**< number of operation kinds */
+
+#define C42_IO8STATS_BUCKETS 40
+/**< latency histogram buckets; bucket @a i counts latencies that need
+ *  @a i bits in nanoseconds (bucket 0: 0 ns, bucket 1: 1 ns,
+ *  bucket 2: 2-3 ns, ...); the last one also counts anything longer */
+
+/* c42_io8stats_op_t ********************************************************/
+/**
+ *  Counters for one kind of operation.
+ */
+typedef struct c42_io8stats_op_s c42_io8stats_op_t;
+struct c42_io8stats_op_s
+{
+    uint64_t count; /**< calls */
+    uint64_t bytes; /**< bytes transferred */
+    uint64_t short_count; /**< successful transfers shorter than requested */
+    uint64_t interrupted; /**< calls that returned #C42_IO8_INTERRUPTED */
+    uint64_t errors; /**< calls that returned other errors */
+    uint64_t ns_total; /**< sum of latencies */
+    uint64_t ns_max; /**< largest latency */
+    uint64_t hist[C42_IO8STATS_BUCKETS]; /**< latency histogram */
+};
+
+/* c42_io8stats_t ***********************************************************/
+/**
+ *  Instrumented stream wrapper.
+ *  The wrapper exposes exactly the operations the underlying stream
+ *  class implements, and keeps its C42_IO8_CLASS_xxx flags. Counters are
+ *  updated atomically, so positional reads and writes can be issued from
+ *  several threads (for instance by c42_aiopool_t) when the underlying
+ *  class allows it; read them with c42_io8stats_dump() or reset them
+ *  once the stream is idle.
+ *  Check c42_io8stats_init().
+ */
+typedef struct c42_io8stats_s c42_io8stats_t;
+struct c42_io8stats_s
+{
+    c42_io8_t io8; /**< base io8 object */
+    c42_io8_t * io; /**< underlying stream */
+    c42_clock_t * clock; /**< latency clock; NULL to only count */
+    c42_io8_class_t io8_class; /**< class with the wrapped operations */
+    c42_io8stats_op_t op[C42_IO8STATS_OP_COUNT];
+        /**< counters indexed by C42_IO8STATS_xxx */
+};
+
+/* c42_io8stats_init ********************************************************/
+/**
+ *  Inits a statistics wrapper over @a io.
+ *  @param stats [out] wrapper to init
+ *  @param io [in] stream to wrap
+ *  @param clock [in] clock used for latencies; can be NULL
+ *  @returns @a stats casted to c42_io8_t
+ */
+C42_API c42_io8_t * C42_CALL c42_io8stats_init
+(
+    c42_io8stats_t * stats,
+    c42_io8_t * io,
+    c42_clock_t * clock
+);
+
+/* c42_io8stats_reset *******************************************************/
+/**
+ *  Clears all counters.
+ */
+C42_API void C42_CALL c42_io8stats_reset
+(
+    c42_io8stats_t * stats
+);
+
+/* c42_io8stats_dump ********************************************************/
+/**
+ *  Writes the counters and the non-empty histogram buckets as text.
+ *  @param stats statistics to dump
+ *  @param out stream to write to
+ *  @param name label printed on each line; can be NULL
+ *  @returns 0 or C42_IO8_xxx error from writing
+ */
+C42_API uint_fast8_t C42_CALL c42_io8stats_dump
+(
+    c42_io8stats_t const * stats,
+    c42_io8_t * out,
+    char const * name
+);
+
+/** @} */
+
+/* Event Polling ************************************************************/
+/** @defgroup poll Event Polling
+ *  Readiness notification for non-blocking streams.
+ *  A poller (c42_poller_t) is opened through the service layer (see
+ *  c42_svc_t#poll) and watches streams created by the same provider, like
+ *  pipes or local sockets opened in non-blocking mode; on Linux this maps
+ *  to an epoll instance. Readiness is level-triggered: a stream is reported
+ *  again on each wait while it stays readable or writable.
+ *  @{
+ */
+
+#define C42_POLL_OK 0 /**< ok */
+#define C42_POLL_NO_MEM 1 /**< not enough memory */
+#define C42_POLL_BAD_STREAM 2
+    /**< stream cannot be polled (not created by this provider, or not a
+     *  pipe, socket or similar) */
+#define C42_POLL_EXISTS 3 /**< stream already registered */
+#define C42_POLL_NOT_FOUND 4 /**< stream not registered */
+#define C42_POLL_INTERRUPTED 5 /**< wait interrupted by a signal */
+#define C42_POLL_OTHER_ERROR 127 /**< other error */
+
+#define C42_POLL_IN 1 /**< stream can be read without blocking */
+#define C42_POLL_OUT 2 /**< stream can be written without blocking */
+#define C42_POLL_ERR 4 /**< error condition; always reported */
+#define C42_POLL_HUP 8 /**< other end closed; always reported */
+
+#define C42_POLL_INFINITE UINT64_MAX /**< wait timeout: no timeout */
+
+/* c42_poll_event_t *********************************************************/
+/**
+ *  Readiness event returned by a poller.
+ */
+typedef struct c42_poll_event_s c42_poll_event_t;
+struct c42_poll_event_s
+{
+    uintptr_t tag; /**< value given when registering the stream */
+    unsigned int events; /**< C42_POLL_xxx bits */
+};
+
+/* c42_poller_t *************************************************************/
+/**
+ *  Poller instance interface.
+ *  A poller is used by one thread at a time.
+ */
+typedef struct c42_poller_s c42_poller_t;
+struct c42_poller_s
+{
+    /** Registers a stream for the C42_POLL_IN / C42_POLL_OUT bits in
+     *  @a events; @a tag is returned with its events. */
+    uint_fast8_t (C42_CALL * add)
+        (
+            c42_poller_t * poller,
+            c42_io8_t * io,
+            unsigned int events,
+            uintptr_t tag
+        );
+
+    /** Changes the events and tag of a registered stream. */
+    uint_fast8_t (C42_CALL * modify)
+        (
+            c42_poller_t * poller,
+            c42_io8_t * io,
+            unsigned int events,
+            uintptr_t tag
+        );
+
+    /** Unregisters a stream; must be called before closing it. */
+    uint_fast8_t (C42_CALL * remove)
+        (
+            c42_poller_t * poller,
+            c42_io8_t * io
+        );
+
+    /** Waits up to @a timeout_ns nanoseconds for at least one event and
+     *  stores up to @a ev_max of them; *@a ev_n is 0 on timeout. */
+    uint_fast8_t (C42_CALL * wait)
+        (
+            c42_poller_t * poller,
+            c42_poll_event_t * ev_a,
+            size_t ev_max,
+            uint64_t timeout_ns,
+            size_t * ev_n
+        );
+
+    /** Frees the poller. */
+    uint_fast8_t (C42_CALL * close)
+        (
+            c42_poller_t * poller
+        );
+
+    void * context; /**< implementation specific context data */
+};
+
+/* c42_poll_t ***************************************************************/
+/**
+ *  Poller provider interface.
+ */
+typedef struct c42_poll_s c42_poll_t;
+struct c42_poll_s
+{
+    /** Inits @a poller; NULL when the provider has no event polling. */
+    uint_fast8_t (C42_CALL * open)
+        (
+            c42_poller_t * poller,
+            void * context
+        );
+
+    void * context; /**< implementation specific context data */
+};
+
+/* c42_poller_open **********************************************************/
+/**
+ *  Opens a poller.
+ *  @returns 0 or C42_POLL_xxx error; C42_POLL_OTHER_ERROR if the provider
+ *      has no event polling
+ */
+C42_INLINE uint_fast8_t c42_poller_open
+(
+    c42_poll_t * poll_p,
+    c42_poller_t * poller
+)
+{
+    if (!poll_p->open) return C42_POLL_OTHER_ERROR;
+    return poll_p->open(poller, poll_p->context);
+}
+
+/* c42_poller_close *********************************************************/
+/**
+ *  Closes a poller.
+ */
+C42_INLINE uint_fast8_t c42_poller_close
+(
+    c42_poller_t * poller
+)
+{
+    return poller->close(poller);
+}
+
+/** @} */
+
+/* Reactor ******************************************************************/
+/** @defgroup reactor Reactor
+ *  Single-threaded event loop: dispatches stream readiness reported by a
+ *  c42_poller_t and expires timers kept on a hashed timer wheel.
+ *  Watches and timers are owned by the caller and linked into the reactor
+ *  while active, so the reactor itself never allocates. Starting and
+ *  stopping a timer costs O(1) regardless of how many are active.
+ *  All functions must be called from the thread running the reactor,
+ *  including from within callbacks.
+ *  @{
+ */
+
+#define C42_REACTOR_WHEEL_SIZE 256 /**< timer wheel slots (power of 2) */
+#define C42_REACTOR_BATCH 64 /**< max events handled per poller wait */
+#define C42_REACTOR_DEFAULT_TICK_NS 1000000 /**< default timer resolution */
+
+typedef struct c42_reactor_s c42_reactor_t;
+typedef struct c42_reactor_watch_s c42_reactor_watch_t;
+typedef struct c42_reactor_timer_s c42_reactor_timer_t;
+
+/* c42_reactor_watch_f ******************************************************/
+/**
+ *  Stream readiness callback.
+ *  @param events C42_POLL_xxx bits
+ */
+typedef void (C42_CALL * c42_reactor_watch_f)
+    (
+        c42_reactor_t * reactor,
+        c42_reactor_watch_t * watch,
+        unsigned int events
+    );
+
+/* c42_reactor_timer_f ******************************************************/
+/**
+ *  Timer expiry callback; the timer is inactive again when this is called
+ *  and can be restarted.
+ */
+typedef void (C42_CALL * c42_reactor_timer_f)
+    (
+        c42_reactor_t * reactor,
+        c42_reactor_timer_t * timer
+    );
+
+/* c42_reactor_watch_t ******************************************************/
+/**
+ *  Stream registered with a reactor.
+ */
+struct c42_reactor_watch_s
+{
+    c42_io8_t * io; /**< watched stream */
+    c42_reactor_watch_f func; /**< readiness callback */
+    void * context; /**< for use by the callback */
+    unsigned int events; /**< C42_POLL_IN / C42_POLL_OUT bits watched */
+};
+
+/* c42_reactor_timer_t ******************************************************/
+/**
+ *  Reactor timer.
+ *  Only c42_reactor_timer_t#context is meant to be accessed directly.
+ */
+struct c42_reactor_timer_s
+{
+    c42_np_t links;
+    uint64_t tick; /**< wheel tick when the timer expires */
+    c42_reactor_timer_f func;
+    void * context; /**< for use by the callback */
+    uint8_t active;
+};
+
+/* c42_reactor_t ************************************************************/
+/**
+ *  Reactor; all fields are internal.
+ */
+struct c42_reactor_s
+{
+    c42_poller_t * poller;
+    c42_clock_t * clock;
+    uint64_t start_ns;
+    uint64_t tick_ns;
+    uint64_t tick; /**< last tick whose timers were expired */
+    size_t watch_n;
+    size_t timer_n;
+    size_t ev_pos;
+    size_t ev_n;
+    c42_poll_event_t ev_a[C42_REACTOR_BATCH];
+    c42_np_t wheel[C42_REACTOR_WHEEL_SIZE];
+    uint8_t stop;
+};
+
+/* c42_reactor_init *********************************************************/
+/**
+ *  Inits a reactor.
+ *  @param reactor [out] reactor to init
+ *  @param poller [in] opened poller; stays owned by the caller
+ *  @param clock [in] monotonic clock used for timers
+ *  @param tick_ns [in] timer resolution in nanoseconds, or 0 for
+ *      #C42_REACTOR_DEFAULT_TICK_NS; timers fire at most one tick late and
+ *      the wheel covers C42_REACTOR_WHEEL_SIZE ticks per revolution
+ */
+C42_API void C42_CALL c42_reactor_init
+(
+    c42_reactor_t * reactor,
+    c42_poller_t * poller,
+    c42_clock_t * clock,
+    uint64_t tick_ns
+);
+
+/* c42_reactor_watch ********************************************************/
+/**
+ *  Starts watching a stream.
+ *  @param watch [out] watch to register; must stay valid until
+ *      c42_reactor_unwatch()
+ *  @param io [in] non-blocking stream
+ *  @param events [in] C42_POLL_IN / C42_POLL_OUT bits
+ *  @param func [in] callback
+ *  @param context [in] stored in c42_reactor_watch_t#context
+ *  @returns 0 or C42_POLL_xxx error from the poller
+ */
+C42_API uint_fast8_t C42_CALL c42_reactor_watch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch,
+    c42_io8_t * io,
+    unsigned int events,
+    c42_reactor_watch_f func,
+    void * context
+);
+
+/* c42_reactor_rewatch ******************************************************/
+/**
+ *  Changes the events watched for a registered stream.
+ */
+C42_API uint_fast8_t C42_CALL c42_reactor_rewatch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch,
+    unsigned int events
+);
+
+/* c42_reactor_unwatch ******************************************************/
+/**
+ *  Stops watching a stream; events already collected for it are dropped,
+ *  so @a watch can be reused or freed right away, even from a callback.
+ */
+C42_API uint_fast8_t C42_CALL c42_reactor_unwatch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch
+);
+
+/* c42_reactor_timer_start **************************************************/
+/**
+ *  Starts (or restarts) a timer.
+ *  @param timer [out] timer; must stay valid while active
+ *  @param delay_ns [in] delay from now
+ *  @param func [in] callback
+ *  @param context [in] stored in c42_reactor_timer_t#context
+ */
+C42_API void C42_CALL c42_reactor_timer_start
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer,
+    uint64_t delay_ns,
+    c42_reactor_timer_f func,
+    void * context
+);
+
+/* c42_reactor_timer_stop ***************************************************/
+/**
+ *  Stops a timer; does nothing if it is not active.
+ */
+C42_API void C42_CALL c42_reactor_timer_stop
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer
+);
+
+/* c42_reactor_run_once *****************************************************/
+/**
+ *  Waits for events for up to @a max_wait_ns (less if a timer is due
+ *  sooner), then runs the callbacks of ready streams and expired timers.
+ *  @returns 0 or C42_POLL_xxx error from the poller
+ */
+C42_API uint_fast8_t C42_CALL c42_reactor_run_once
+(
+    c42_reactor_t * reactor,
+    uint64_t max_wait_ns
+);
+
+/* c42_reactor_run **********************************************************/
+/**
+ *  Runs the event loop until c42_reactor_stop() is called or there are no
+ *  watches and timers left.
+ *  @returns 0 or C42_POLL_xxx error from the poller
+ */
+C42_API uint_fast8_t C42_CALL c42_reactor_run
+(
+    c42_reactor_t * reactor
+);
+
+/* c42_reactor_stop *********************************************************/
+/**
+ *  Makes c42_reactor_run() return after the current callbacks.
+ */
+C42_INLINE void c42_reactor_stop
+(
+    c42_reactor_t * reactor
+)
+{
+    reactor->stop = 1;
+}
+
+/** @} */
+
+/* Record Log ***************************************************************/
+/** @defgroup rlog Record Log
+ *  Append-only log of length-prefixed, checksummed records, split into
+ *  segment files.
+ *
+ *  Records are numbered with consecutive 64-bit sequence numbers. Each
+ *  segment is named after the sequence number of its first record, as
+ *  @a prefix followed by 16 lowercase hex digits and ".rlog", and starts
+ *  with a 16-byte header: the magic "C42RLOG1" and the first sequence
+ *  number (little endian). Each record is stored as its payload size
+ *  (u32 LE), the CRC-32C of those 4 size bytes followed by the payload
+ *  (u32 LE), then the payload itself.
+ *
+ *  Appending only copies the record to memory; c42_rlog_commit() makes it
+ *  durable. Concurrent committers share the work: one of them writes
+ *  everything appended so far and syncs it once, while the others wait
+ *  for its result (group commit).
+ *  @{
+ */
+
+#define C42_RLOG_OK 0 /**< ok */
+#define C42_RLOG_NO_MEM 1 /**< not enough memory */
+#define C42_RLOG_SMT_ERROR 2 /**< multithreading error */
+#define C42_RLOG_FSA_ERROR 3 /**< could not open a segment file */
+#define C42_RLOG_IO_ERROR 4
+    /**< write or sync failed; the log is unusable afterwards and
+     *  c42_rlog_t#io_error holds the C42_IO8_xxx cause */
+#define C42_RLOG_TOO_BIG 5 /**< record of 2 GiB or more */
+#define C42_RLOG_END 6 /**< reader: no more records */
+#define C42_RLOG_TORN 7
+    /**< reader: the last segment ends with a partial or corrupt record, as
+     *  left by a crash during a write */
+#define C42_RLOG_BAD_SEGMENT 8 /**< reader: bad segment header */
+
+#define C42_RLOG_NO_SYNC 1
+    /**< c42_rlog_open() flag: commits write records without syncing them */
+
+#define C42_RLOG_SEG_HDR_SIZE 16 /**< size of the segment header */
+#define C42_RLOG_REC_HDR_SIZE 8 /**< size of the record header */
+#define C42_RLOG_NAME_SIZE 22
+    /**< size of a segment file name without prefix, including NUL */
+
+/* c42_rlog_t ***************************************************************/
+/**
+ *  Record log writer.
+ *  Appending and committing are thread-safe; opening and closing are not.
+ *  Fields other than #io_error are internal.
+ */
+typedef struct c42_rlog_s c42_rlog_t;
+struct c42_rlog_s
+{
+    c42_io8_t io; /**< current segment */
+    c42_fsa_t * fsa;
+    c42_smt_t * smt;
+    c42_ma_t * ma;
+    c42_smt_mutex_t * mutex;
+    c42_smt_cond_t * cond;
+    uint8_t * path;
+    size_t prefix_len;
+    uint8_t * buf; /**< records appended but not written yet */
+    size_t buf_len;
+    size_t buf_size;
+    uint8_t * spare; /**< buffer being written by the commit leader */
+    size_t spare_size;
+    uint64_t seg_size;
+    uint64_t seg_limit;
+    uint64_t buf_seq; /**< sequence number of the first record in buf */
+    uint64_t next_seq; /**< sequence number for the next append */
+    uint64_t durable_seq; /**< records below this one are committed */
+    size_t waiter_n;
+    unsigned int flags;
+    uint8_t leader;
+    uint8_t seg_open; /**< io holds an open segment */
+    uint8_t error;
+    uint8_t io_error; /**< C42_IO8_xxx error behind C42_RLOG_IO_ERROR */
+};
+
+/* c42_rlog_segment_name ****************************************************/
+/**
+ *  Formats the file name of the segment starting at @a first_seq.
+ *  @param name [out] buffer of #C42_RLOG_NAME_SIZE bytes; gets a
+ *      NUL-terminated name
+ */
+C42_API void C42_CALL c42_rlog_segment_name
+(
+    uint8_t * name,
+    uint64_t first_seq
+);
+
+/* c42_rlog_open ************************************************************/
+/**
+ *  Opens a log for appending.
+ *  Appending always starts a new segment; to continue an existing log,
+ *  replay it and pass the sequence number following its last valid
+ *  record (a segment with that name is overwritten).
+ *  @param log [out] writer to init
+ *  @param fsa [in] file system used for segments
+ *  @param smt [in] multithreading interface
+ *  @param ma [in] allocator
+ *  @param prefix [in] NUL-terminated path prefix of segment files, usually
+ *      a directory name with a trailing separator
+ *  @param first_seq [in] sequence number of the first appended record
+ *  @param seg_limit [in] size at which segments are rotated; a record
+ *      never spans segments, so only a segment holding a single record can
+ *      get larger
+ *  @param flags [in] 0 or #C42_RLOG_NO_SYNC
+ *  @returns 0 or C42_RLOG_xxx error
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_open
+(
+    c42_rlog_t * log,
+    c42_fsa_t * fsa,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    uint8_t const * prefix,
+    uint64_t first_seq,
+    uint64_t seg_limit,
+    unsigned int flags
+);
+
+/* c42_rlog_append **********************************************************/
+/**
+ *  Appends a record.
+ *  @param seq [out] receives the sequence number of the record; can be NULL
+ *  @returns 0, C42_RLOG_NO_MEM, C42_RLOG_TOO_BIG or the error that made the
+ *      log unusable
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_append
+(
+    c42_rlog_t * log,
+    void const * data,
+    size_t size,
+    uint64_t * seq
+);
+
+/* c42_rlog_commit **********************************************************/
+/**
+ *  Returns once the record @a seq and all records before it are written
+ *  and synced.
+ *  @returns 0 or the error that made the log unusable
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_commit
+(
+    c42_rlog_t * log,
+    uint64_t seq
+);
+
+/* c42_rlog_close ***********************************************************/
+/**
+ *  Commits all appended records and frees the writer.
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_close
+(
+    c42_rlog_t * log
+);
+
+/* c42_rlog_reader_t ********************************************************/
+/**
+ *  Record log reader; all fields are internal.
+ *  Segments are mapped in memory, so records are returned without copying.
+ */
+typedef struct c42_rlog_reader_s c42_rlog_reader_t;
+struct c42_rlog_reader_s
+{
+    c42_fsa_t * fsa;
+    c42_ma_t * ma;
+    c42_fsa_map_t map;
+    uint8_t * path;
+    size_t prefix_len;
+    uint8_t const * pos;
+    uint8_t const * end;
+    uint64_t seq;
+    uint8_t mapped;
+};
+
+/* c42_rlog_reader_open *****************************************************/
+/**
+ *  Opens a reader at the segment starting with record @a first_seq;
+ *  following segments are opened as the reader reaches them.
+ *  @returns 0, C42_RLOG_NO_MEM, C42_RLOG_FSA_ERROR (segment missing or
+ *      cannot be mapped) or C42_RLOG_BAD_SEGMENT
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_reader_open
+(
+    c42_rlog_reader_t * rd,
+    c42_fsa_t * fsa,
+    c42_ma_t * ma,
+    uint8_t const * prefix,
+    uint64_t first_seq
+);
+
+/* c42_rlog_read ************************************************************/
+/**
+ *  Reads the next record.
+ *  A partial or corrupt record ends a segment only if a segment starting
+ *  with its sequence number exists (the writer was reopened after a
+ *  crash); otherwise C42_RLOG_TORN is returned.
+ *  @param data [out] payload; valid until the reader moves to another
+ *      segment or is closed
+ *  @param size [out] payload size
+ *  @param seq [out] sequence number of the record; can be NULL
+ *  @returns 0, C42_RLOG_END, C42_RLOG_TORN or another C42_RLOG_xxx error
+ */
+C42_API uint_fast8_t C42_CALL c42_rlog_read
+(
+    c42_rlog_reader_t * rd,
+    uint8_t const * * data,
+    size_t * size,
+    uint64_t * seq
+);
+
+/* c42_rlog_reader_close ****************************************************/
+/**
+ *  Unmaps the current segment and frees the reader.
+ */
+C42_API void C42_CALL c42_rlog_reader_close
+(
+    c42_rlog_reader_t * rd
+);
+
+/** @} */
+
+/* Sockets ******************************************************************/
+/** @defgroup net Sockets
+ *  Stream sockets (TCP and local Unix-domain) exposed as io8 streams.
+ *  Sockets are created through the service layer (see c42_svc_t#net).
+ *  A connected socket is a regular stream: reads return 0 bytes when the
+ *  peer closed its side, c42_io8_close() with only C42_IO8_OP_WRITE shuts
+ *  down the sending direction, and c42_io8_copy() from a file opened by
+ *  the same provider sends the file without a user-space copy (sendfile).
+ *  Sockets opened with C42_NET_NONBLOCK return C42_IO8_WOULD_BLOCK instead
+ *  of waiting and can be watched with a poller from the same provider.
+ *  Listening sockets are streams too; they cannot be read or written but
+ *  can be polled for C42_POLL_IN, meaning a connection is ready to accept.
+ *
+ *  Addresses are NUL-terminated strings: "host:port" for C42_NET_TCP
+ *  (IPv6 hosts in brackets, like "[::1]:80"; port 0 picks a free port)
+ *  and the socket path for C42_NET_UNIX.
+ *  @{
+ */
+
+#define C42_NET_OK 0 /**< ok */
+#define C42_NET_NO_MEM 1 /**< not enough memory */
+#define C42_NET_BAD_ADDR 2 /**< malformed or unresolvable address */
+#define C42_NET_ADDR_IN_USE 3 /**< listen address already in use */
+#define C42_NET_REFUSED 4 /**< connection refused */
+#define C42_NET_IN_PROGRESS 5
+    /**< non-blocking connect started; the stream becomes writable
+     *  (C42_POLL_OUT) once it completes, and a failed connect is reported
+     *  by the first read or write */
+#define C42_NET_WOULD_BLOCK 6
+    /**< non-blocking accept with no pending connection */
+#define C42_NET_BAD_STREAM 7
+    /**< stream is not a socket of this provider, or not of the right kind */
+#define C42_NET_NOT_SUPPORTED 8 /**< family or option not supported */
+#define C42_NET_OTHER_ERROR 127 /**< other error */
+
+#define C42_NET_TCP 1 /**< TCP over IPv4 or IPv6 */
+#define C42_NET_UNIX 2 /**< Unix-domain stream socket */
+
+#define C42_NET_NONBLOCK 1 /**< non-blocking mode */
+#define C42_NET_NODELAY 2
+    /**< send small writes right away (TCP_NODELAY); TCP only */
+#define C42_NET_CORK 4
+    /**< hold partial frames until uncorked, so that a header written
+     *  before c42_io8_copy() goes out with the file data (TCP_CORK);
+     *  clearing the option flushes what was held; TCP only */
+
+/* c42_net_t ****************************************************************/
+/**
+ *  Socket provider interface.
+ *  Any function pointer can be NULL if the provider has no sockets.
+ */
+typedef struct c42_net_s c42_net_t;
+struct c42_net_s
+{
+    /** Inits @a lsn as a socket listening on @a addr.
+     *  @param [out] lsn
+     *      gets the listening stream
+     *  @param [in] family
+     *      C42_NET_TCP or C42_NET_UNIX
+     *  @param [in] addr
+     *      address to bind to; for C42_NET_UNIX an existing socket file at
+     *      that path is not replaced
+     *  @param [in] backlog
+     *      maximum number of pending connections; 0 for the system default
+     *  @param [in] flags
+     *      0 or C42_NET_NONBLOCK
+     *  @param context
+     *      value stored in c42_net_t#context
+     */
+    uint_fast8_t (C42_CALL * listen)
+        (
+            c42_io8_t * lsn,
+            int family,
+            uint8_t const * addr,
+            unsigned int backlog,
+            unsigned int flags,
+            void * context
+        );
+
+    /** Accepts a connection from @a lsn and inits @a io with it;
+     *  @a flags are C42_NET_xxx options to set on the new stream. */
+    uint_fast8_t (C42_CALL * accept)
+        (
+            c42_io8_t * lsn,
+            c42_io8_t * io,
+            unsigned int flags,
+            void * context
+        );
+
+    /** Connects to @a addr and inits @a io with the new stream;
+     *  @a flags are C42_NET_xxx options set before connecting. */
+    uint_fast8_t (C42_CALL * connect)
+        (
+            c42_io8_t * io,
+            int family,
+            uint8_t const * addr,
+            unsigned int flags,
+            void * context
+        );
+
+    /** Sets the C42_NET_xxx options in @a mask to the values of the
+     *  same bits in @a values. */
+    uint_fast8_t (C42_CALL * set_options)
+        (
+            c42_io8_t * io,
+            unsigned int mask,
+            unsigned int values,
+            void * context
+        );
+
+    /** Writes the local address of a socket as a NUL-terminated string;
+     *  returns C42_NET_NO_MEM if it does not fit in @a size bytes. */
+    uint_fast8_t (C42_CALL * local_addr)
+        (
+            c42_io8_t * io,
+            uint8_t * addr,
+            size_t size,
+            void * context
+        );
+
+    void * context; /**< implementation specific context data */
+};
+
+/* c42_net_listen ***********************************************************/
+/**
+ *  Opens a listening socket.
+ *  @returns 0 or C42_NET_xxx error
+ */
+C42_INLINE uint_fast8_t c42_net_listen
+(
+    c42_net_t * net,
+    c42_io8_t * lsn,
+    int family,
+    uint8_t const * addr,
+    unsigned int backlog,
+    unsigned int flags
+)
+{
+    if (!net->listen) return C42_NET_NOT_SUPPORTED;
+    return net->listen(lsn, family, addr, backlog, flags, net->context);
+}
+
+/* c42_net_accept ***********************************************************/
+/**
+ *  Accepts a connection.
+ *  @returns 0 or C42_NET_xxx error
+ */
+C42_INLINE uint_fast8_t c42_net_accept
+(
+    c42_net_t * net,
+    c42_io8_t * lsn,
+    c42_io8_t * io,
+    unsigned int flags
+)
+{
+    if (!net->accept) return C42_NET_NOT_SUPPORTED;
+    return net->accept(lsn, io, flags, net->context);
+}
+
+/* c42_net_connect **********************************************************/
+/**
+ *  Opens a connection.
+ *  @returns 0, C42_NET_IN_PROGRESS or C42_NET_xxx error
+ */
+C42_INLINE uint_fast8_t c42_net_connect
+(
+    c42_net_t * net,
+    c42_io8_t * io,
+    int family,
+    uint8_t const * addr,
+    unsigned int flags
+)
+{
+    if (!net->connect) return C42_NET_NOT_SUPPORTED;
+    return net->connect(io, family, addr, flags, net->context);
+}
+
+/* c42_net_set_options ******************************************************/
+/**
+ *  Changes socket options.
+ *  @returns 0 or C42_NET_xxx error
+ */
+C42_INLINE uint_fast8_t c42_net_set_options
+(
+    c42_net_t * net,
+    c42_io8_t * io,
+    unsigned int mask,
+    unsigned int values
+)
+{
+    if (!net->set_options) return C42_NET_NOT_SUPPORTED;
+    return net->set_options(io, mask, values, net->context);
+}
+
+/* c42_net_local_addr *******************************************************/
+/**
+ *  Gets the local address of a socket, like the port picked for a
+ *  listening socket bound to port 0.
+ *  @returns 0 or C42_NET_xxx error
+ */
+C42_INLINE uint_fast8_t c42_net_local_addr
+(
+    c42_net_t * net,
+    c42_io8_t * io,
+    uint8_t * addr,
+    size_t size
+)
+{
+    if (!net->local_addr) return C42_NET_NOT_SUPPORTED;
+    return net->local_addr(io, addr, size, net->context);
+}
+
+/** @} */
+
 /* Miscellaneous ************************************************************/
 /** @defgroup misc Miscellaneous
  *  @{
@@ -2522,6 +5835,9 @@ struct c42_svc_s
     c42_ma_t ma; /**< mem allocator */
     c42_smt_t smt; /**< simple multithreading interface */
     c42_fsa_t fsa; /**< file system interface */
+    c42_clock_t clock; /**< clock interface */
+    c42_poll_t poll; /**< event polling interface */
+    c42_net_t net; /**< socket interface */
 };
 
 /* c42_io8_std_t ************************************************************/
@@ -158,6 +158,38 @@ C42_API int C42_CALL c42_u8a_cmp
     return 0;
 }
 
+/* c42_u8a_scan *************************************************************/
+#if __GNUC__
+typedef size_t __attribute__((may_alias)) scan_word_t;
+#endif
+C42_API size_t C42_CALL c42_u8a_scan
+(
+    uint8_t const * a,
+    size_t len,
+    uint_fast8_t value
+)
+{
+    size_t i = 0;
+#if __GNUC__
+    size_t const ones = (size_t) -1 / 0xFF;
+    size_t const highs = ones << 7;
+    size_t const pat = ones * (uint8_t) value;
+    size_t w;
+
+    for (; i < len && ((uintptr_t) (a + i) & (sizeof(size_t) - 1)); ++i)
+        if (a[i] == value) return i;
+    /* stop at the first word that has a zero byte after xor-ing */
+    for (; len - i >= sizeof(size_t); i += sizeof(size_t))
+    {
+        w = *(scan_word_t const *) (a + i) ^ pat;
+        if ((w - ones) & ~w & highs) break;
+    }
+#endif
+    for (; i < len; ++i)
+        if (a[i] == value) return i;
+    return len;
+}
+
 /* c42_u16a_cmp *************************************************************/
 C42_API int C42_CALL c42_u16a_cmp
 (
@@ -671,6 +703,69 @@ C42_API int32_t C42_CALL c42_utf8_term_width
     return w;
 }
 
+/* c42_utf8_ansi_term_width *************************************************/
+C42_API int32_t C42_CALL c42_utf8_ansi_term_width
+(
+    uint8_t const * data,
+    size_t len,
+    void * ctx
+)
+{
+    int32_t w = 0;
+    uint8_t const * end = data + len;
+    (void) ctx;
+    while (data != end)
+    {
+        uint32_t ucp;
+        int cw;
+
+        if (*data >= 0x20 && *data < 0x7F)
+        {
+            /* fast path for printable ASCII */
+            ++data;
+            if (++w < 0) return -2;
+            continue;
+        }
+        if (*data == 0x1B)
+        {
+            if (++data == end) return -1;
+            if (*data == '[')
+            {
+                /* CSI: parameter bytes, intermediate bytes, final byte */
+                for (++data; data != end && *data >= 0x30 && *data < 0x40;
+                     ++data);
+                for (; data != end && *data >= 0x20 && *data < 0x30; ++data);
+                if (data == end || *data < 0x40 || *data > 0x7E) return -1;
+                ++data;
+            }
+            else if (*data == ']')
+            {
+                /* OSC: terminated by BEL or ST (ESC \) */
+                for (++data; ; ++data)
+                {
+                    if (data == end) return -1;
+                    if (*data == 0x07) break;
+                    if (*data == 0x1B)
+                    {
+                        if (++data == end || *data != '\\') return -1;
+                        break;
+                    }
+                }
+                ++data;
+            }
+            else if (*data >= 0x40 && *data <= 0x5F) ++data;
+            else return -1;
+            continue;
+        }
+        ucp = c42_ucp_from_valid_utf8(&data);
+        cw = c42_ucp_term_width(ucp);
+        if (cw < 0) return -1;
+        w += cw;
+        if (w < 0) return -2;
+    }
+    return w;
+}
+
 /* c42_utf16le_to_utf8_len **************************************************/
 C42_API ptrdiff_t C42_CALL c42_utf16le_to_utf8_len
 (
@@ -782,7 +877,251 @@ C42_API size_t C42_CALL c42_sbw_write
     return len;
 }
 
-/* c42_write_vfmt ***********************************************************/
+/* c42_sbw_writev ***********************************************************/
+C42_API size_t C42_CALL c42_sbw_writev
+(
+    c42_u8an_t const * seg,
+    size_t count,
+    void * sbw
+)
+{
+    size_t i, len;
+    for (len = 0, i = 0; i < count; ++i)
+    {
+        if (c42_sbw_write(seg[i].a, seg[i].n, sbw) != seg[i].n) break;
+        len += seg[i].n;
+    }
+    return len;
+}
+
+/* fmt_sink_t ***************************************************************/
+#define FMT_SEG_MAX 0x20
+#define FMT_SCRATCH_SIZE 0x400
+#define FMT_CONV_MIN 0x40
+#define FMT_NUM_MAX 0x200
+typedef struct fmt_sink_s fmt_sink_t;
+struct fmt_sink_s
+{
+    c42_utf8_writer_f writer; /* used when vwriter is NULL */
+    c42_utf8_vwriter_f vwriter;
+    void * ctx;
+    size_t seg_count; /* number of pending segments */
+    size_t seg_size; /* total size of pending segments */
+    size_t scratch_used; /* scratch bytes referenced by pending segments */
+    c42_u8an_t seg[FMT_SEG_MAX];
+    uint8_t scratch[FMT_SCRATCH_SIZE];
+};
+
+/* fmt_flush ****************************************************************/
+static uint_fast8_t fmt_flush
+(
+    fmt_sink_t * s
+)
+{
+    size_t n = s->seg_count;
+    size_t z = s->seg_size;
+
+    s->seg_count = 0;
+    s->seg_size = 0;
+    s->scratch_used = 0;
+    if (n && s->vwriter(s->seg, n, s->ctx) != z) return C42_FMT_WRITE_ERROR;
+    return 0;
+}
+
+/* fmt_put ******************************************************************/
+/**
+ *  Queues data that stays valid until the end of formatting (format string
+ *  literals, string arguments, padding); with a plain writer the data is
+ *  written right away.
+ */
+static uint_fast8_t fmt_put
+(
+    fmt_sink_t * s,
+    uint8_t const * data,
+    size_t len
+)
+{
+    c42_u8an_t * g;
+    uint_fast8_t e;
+
+    if (len == 0) return 0;
+    if (!s->vwriter)
+        return s->writer(data, len, s->ctx) == len ? 0 : C42_FMT_WRITE_ERROR;
+    if (s->seg_count)
+    {
+        g = &s->seg[s->seg_count - 1];
+        if (g->a + g->n == data)
+        {
+            g->n += len;
+            s->seg_size += len;
+            return 0;
+        }
+        if (s->seg_count == FMT_SEG_MAX)
+        {
+            e = fmt_flush(s);
+            if (e) return e;
+        }
+    }
+    g = &s->seg[s->seg_count++];
+    g->a = (uint8_t *) data;
+    g->n = len;
+    s->seg_size += len;
+    return 0;
+}
+
+/* fmt_reserve **************************************************************/
+/**
+ *  Provides a scratch area of at least @a size bytes that stays untouched
+ *  until fmt_commit() is called for it.
+ */
+static uint_fast8_t fmt_reserve
+(
+    fmt_sink_t * s,
+    size_t size,
+    uint8_t * * p
+)
+{
+    uint_fast8_t e;
+    if (s->seg_count == FMT_SEG_MAX
+        || s->scratch_used + size > FMT_SCRATCH_SIZE)
+    {
+        e = fmt_flush(s);
+        if (e) return e;
+    }
+    *p = s->scratch + s->scratch_used;
+    return 0;
+}
+
+/* fmt_commit ***************************************************************/
+/**
+ *  Queues @a len bytes produced in an area obtained with fmt_reserve().
+ */
+static uint_fast8_t fmt_commit
+(
+    fmt_sink_t * s,
+    uint8_t * p,
+    size_t len
+)
+{
+    uint_fast8_t e;
+    e = fmt_put(s, p, len);
+    if (s->vwriter && !e) s->scratch_used = (p + len) - s->scratch;
+    return e;
+}
+
+/* fmt_pad ******************************************************************/
+static uint_fast8_t fmt_pad
+(
+    fmt_sink_t * s,
+    size_t pad_width
+)
+{
+    static uint8_t const empty_spaces[] =  // what are we living for?
+        "                                                                ";
+    size_t clen;
+    uint_fast8_t e;
+
+    for (; pad_width; pad_width -= clen)
+    {
+        clen = pad_width;
+        if (clen > sizeof(empty_spaces) - 1)
+            clen = sizeof(empty_spaces) - 1;
+        e = fmt_put(s, empty_spaces, clen);
+        if (e) return e;
+    }
+    return 0;
+}
+
+/* fmt_conv_ahead ***********************************************************/
+/**
+ *  Converts the entire input into the free scratch space so that it can be
+ *  measured and then replayed without converting it again.
+ *  Sets *out_len_p to SIZE_MAX if the output does not fit.
+ */
+static uint_fast8_t fmt_conv_ahead
+(
+    fmt_sink_t * s,
+    c42_clconv_f conv,
+    void * conv_ctx,
+    uint8_t const * str,
+    size_t len,
+    uint8_t * * out_p,
+    size_t * out_len_p
+)
+{
+    uint8_t * buf;
+    uint8_t * end = s->scratch + FMT_SCRATCH_SIZE;
+    size_t ofs, o, in_len, out_len;
+    uint_fast8_t cc, e;
+
+    e = fmt_reserve(s, FMT_CONV_MIN, &buf);
+    if (e) return e;
+    *out_p = buf;
+    *out_len_p = SIZE_MAX;
+    for (o = 0, ofs = 0; ofs < len; ofs += in_len, o += out_len)
+    {
+        cc = conv(str + ofs, len - ofs, &in_len,
+                  buf + o, end - buf - o, &out_len, conv_ctx);
+        if (cc && cc != C42_CLCONV_FULL) return C42_FMT_CONV_ERROR;
+        if (in_len == 0 && out_len == 0) return 0; // scratch space is full
+    }
+    cc = conv(NULL, 0, &in_len, buf + o, end - buf - o, &out_len, conv_ctx);
+    if (cc == C42_CLCONV_FULL) return 0;
+    if (cc) return C42_FMT_CONV_ERROR;
+    *out_len_p = o + out_len;
+    return 0;
+}
+
+/* fmt_args_t ***************************************************************/
+typedef struct fmt_args_s fmt_args_t;
+struct fmt_args_s
+{
+    va_list va; /* arguments for untyped calls */
+    c42_fmt_arg_t const * a; /* next typed argument */
+    size_t n; /* number of typed arguments left */
+};
+
+/* fmt_int_arg **************************************************************/
+/**
+ *  Fetches the next typed argument for an int field of the given size and
+ *  signedness.
+ *  Strings and ints wider than the field are rejected, and so are values
+ *  the field cannot represent: negative numbers for unsigned fields and
+ *  unsigned numbers above the maximum of signed fields.
+ */
+static uint_fast8_t fmt_int_arg
+(
+    fmt_args_t * args,
+    size_t size,
+    int is_signed,
+    int64_t * value
+)
+{
+    c42_fmt_arg_t const * a = args->a;
+    if (!args->n || a->type == C42_FMT_ARG_STR || a->size > size)
+        return C42_FMT_ARG_MISMATCH;
+    if (is_signed ? a->type == C42_FMT_ARG_UINT
+        && a->v.u > (UINT64_MAX >> (65 - size * 8))
+        : a->type == C42_FMT_ARG_SINT && a->v.i < 0)
+        return C42_FMT_ARG_MISMATCH;
+    *value = a->v.i;
+    args->a++;
+    args->n--;
+    return 0;
+}
+
+/* fmt_engine ***************************************************************/
+/**
+ *  Formatter shared by the va_list and the typed entry points.
+ *  It is expanded once for each with a constant @a typed, so the argument
+ *  fetches compile to a plain va_arg or a plain array access and the
+ *  va_list path pays nothing for the typed one.
+ */
+#if __GNUC__
+#define FMT_ENGINE_INLINE static __inline __attribute__((always_inline))
+#else
+#define FMT_ENGINE_INLINE static __inline
+#endif
 #define CMD_NONE 0
 #define CMD_BUF 1
 #define CMD_STR 2
@@ -793,23 +1132,27 @@ C42_API size_t C42_CALL c42_sbw_write
 #define STR_ESC_NONE 0
 #define STR_ESC_C 1
 #define STR_ESC_HEX 2
-C42_API uint_fast8_t C42_CALL c42_write_vfmt
+#define FMT_ARG_INT(_var, _type, _va_type) \
+    if (!typed) (_var) = (_type) va_arg(args->va, _va_type); \
+    else if ((e = fmt_int_arg(args, sizeof(_type), \
+                              (_type) -1 < (_type) 1, &i64))) return e; \
+    else (_var) = (_type) i64
+#define FMT_CONV_INIT(_esc_mode, _cectx) \
+    ((_esc_mode) == STR_ESC_C ? c42_clconv_c_escape_init(&(_cectx)) : NULL)
+FMT_ENGINE_INLINE uint_fast8_t fmt_engine
 (
-    c42_utf8_writer_f writer,
-    void * writer_context,
+    fmt_sink_t * s,
     c42_utf8_width_f width_func,
     void * width_context,
     char const * fmt,
-    va_list va
+    fmt_args_t * args,
+    int typed
 )
 {
-    //static uint8_t const nul = 0;
-    static uint8_t const empty_spaces[] =  // what are we living for?
-        "                                                                ";
-    uint8_t buffer[0x400];
     uint8_t const * f = (uint8_t const *) fmt;
     uint8_t const * str = NULL;
     uint8_t const * num_pfx;
+    uint8_t * buf = NULL;
     c42_clconv_f conv = NULL;
     void * conv_ctx;
     uint_fast8_t sep;
@@ -825,7 +1168,7 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
     char cmd;
     char esc_mode;
     size_t ofs, in_len, out_len;
-    uint_fast8_t cc;
+    uint_fast8_t cc, e;
     c42_clconv_c_escape_t cectx;
 
     for (;;)
@@ -834,8 +1177,8 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
 
         while (*f && *f != '$') f++;
         z = f - sfmt;
-        if (z && writer(sfmt, z, writer_context) != z)
-            return C42_FMT_WRITE_ERROR;
+        e = fmt_put(s, sfmt, z);
+        if (e) return e;
         if (*f == 0) break;
         zero_fill = 0;
         req_width = 0;
@@ -864,83 +1207,92 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
                 --f;
                 break;
             case 'c':
-                ucp = va_arg(va, uint32_t);
-                arg_len = c42_ucp_to_utf8(buffer, ucp);
-                arg_width = width_func(buffer, arg_len, width_context);
+                FMT_ARG_INT(ucp, uint32_t, uint32_t);
+                e = fmt_reserve(s, 4, &buf);
+                if (e) return e;
+                arg_len = c42_ucp_to_utf8(buf, ucp);
+                arg_width = width_func(buf, arg_len, width_context);
                 if (arg_width < 0) return C42_FMT_WIDTH_ERROR;
                 cmd = CMD_BUF;
                 if (align_mode == ALIGN_DEFAULT) align_mode = ALIGN_LEFT;
                 break;
             case 'b':
                 sign_mode = C42_NO_SIGN;
-                i64 = (uint8_t) va_arg(va, int);
+                FMT_ARG_INT(i64, uint8_t, int);
             l_int:
                 if (radix == 0) radix = 10;
-                arg_len = c42_i64_to_str(buffer, i64, sign_mode, radix, num_pfx,
+                /* zero-filled output takes the width plus a trailing
+                 * separator and the terminator */
+                if (zero_fill && req_width > FMT_SCRATCH_SIZE - 2)
+                    return C42_FMT_MALFORMED;
+                e = fmt_reserve(s, zero_fill && req_width + 2 > FMT_NUM_MAX
+                                ? req_width + 2 : FMT_NUM_MAX, &buf);
+                if (e) return e;
+                arg_len = c42_i64_to_str(buf, i64, sign_mode, radix, num_pfx,
                                 zero_fill ? req_width : 1, group_len, sep);
-                arg_width = width_func(buffer, arg_len, width_context);
+                arg_width = width_func(buf, arg_len, width_context);
                 if (arg_width < 0) return C42_FMT_WIDTH_ERROR;
                 cmd = CMD_BUF;
                 if (align_mode == ALIGN_DEFAULT) align_mode = ALIGN_RIGHT;
                 break;
             case 'B':
-                i64 = (int8_t) va_arg(va, int);
+                FMT_ARG_INT(i64, int8_t, int);
                 goto l_int;
             case 'w':
                 sign_mode = C42_NO_SIGN;
-                i64 = (uint16_t) va_arg(va, int);
+                FMT_ARG_INT(i64, uint16_t, int);
                 goto l_int;
             case 'W':
-                i64 = (int16_t) va_arg(va, int);
+                FMT_ARG_INT(i64, int16_t, int);
                 goto l_int;
             case 'd':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, uint32_t);
+                FMT_ARG_INT(i64, uint32_t, uint32_t);
                 goto l_int;
             case 'D':
-                i64 = va_arg(va, int32_t);
+                FMT_ARG_INT(i64, int32_t, int32_t);
                 goto l_int;
             case 'q':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, uint64_t);
+                FMT_ARG_INT(i64, uint64_t, uint64_t);
                 goto l_int;
             case 'Q':
-                i64 = va_arg(va, int64_t);
+                FMT_ARG_INT(i64, int64_t, int64_t);
                 goto l_int;
             case 'i':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, unsigned int);
+                FMT_ARG_INT(i64, unsigned int, unsigned int);
                 goto l_int;
             case 'I':
-                i64 = va_arg(va, signed int);
+                FMT_ARG_INT(i64, signed int, signed int);
                 goto l_int;
             case 'l':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, unsigned long int);
+                FMT_ARG_INT(i64, unsigned long int, unsigned long int);
                 goto l_int;
             case 'L':
-                i64 = va_arg(va, signed long int);
+                FMT_ARG_INT(i64, signed long int, signed long int);
                 goto l_int;
             case 'h':
                 sign_mode = C42_NO_SIGN;
-                i64 = (unsigned short int) va_arg(va, int);
+                FMT_ARG_INT(i64, unsigned short int, int);
                 goto l_int;
             case 'H':
-                i64 = (signed short int) va_arg(va, int);
+                FMT_ARG_INT(i64, signed short int, int);
                 goto l_int;
             case 'z':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, size_t);
+                FMT_ARG_INT(i64, size_t, size_t);
                 goto l_int;
             case 'Z':
-                i64 = va_arg(va, ptrdiff_t);
+                FMT_ARG_INT(i64, ptrdiff_t, ptrdiff_t);
                 goto l_int;
             case 'p':
                 sign_mode = C42_NO_SIGN;
-                i64 = va_arg(va, uintptr_t);
+                FMT_ARG_INT(i64, uintptr_t, uintptr_t);
                 goto l_int;
             case 'P':
-                i64 = va_arg(va, intptr_t);
+                FMT_ARG_INT(i64, intptr_t, intptr_t);
                 if (radix == 0) radix = 16;
                 goto l_int;
             case 'y':
@@ -965,7 +1317,15 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
                 radix = 16;
                 break;
             case 's':
-                str = va_arg(va, uint8_t const *);
+                if (!typed) str = va_arg(args->va, uint8_t const *);
+                else
+                {
+                    if (!args->n || args->a->type != C42_FMT_ARG_STR)
+                        return C42_FMT_ARG_MISMATCH;
+                    str = args->a->v.s;
+                    args->a++;
+                    args->n--;
+                }
                 if (prec == SIZE_MAX) arg_len = c42_u8z_len(str);
                 else arg_len = prec;
                 switch (esc_mode)
@@ -978,12 +1338,10 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
                 case STR_ESC_HEX:
                     cmd = CMD_CONV;
                     conv = c42_clconv_bin_to_hex_line;
-                    conv_ctx = NULL;
                     break;
                 case STR_ESC_C:
                     cmd = CMD_CONV;
                     conv = c42_clconv_c_escape;
-                    conv_ctx = c42_clconv_c_escape_init(&cectx);
                     break;
                 default:
                     return C42_FMT_NO_CODE;
@@ -991,19 +1349,50 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
                 if (cmd == CMD_CONV && req_width)
                 {
                     int32_t width;
+                    size_t buf_len;
+                    /* convert once in the scratch space, then measure it
+                     * and replay it after the padding */
+                    conv_ctx = FMT_CONV_INIT(esc_mode, cectx);
+                    e = fmt_conv_ahead(s, conv, conv_ctx, str, arg_len,
+                                       &buf, &out_len);
+                    if (e) return e;
+                    if (out_len == SIZE_MAX && s->scratch_used)
+                    {
+                        /* retry with the entire scratch space */
+                        e = fmt_flush(s);
+                        if (e) return e;
+                        conv_ctx = FMT_CONV_INIT(esc_mode, cectx);
+                        e = fmt_conv_ahead(s, conv, conv_ctx, str, arg_len,
+                                           &buf, &out_len);
+                        if (e) return e;
+                    }
+                    if (out_len != SIZE_MAX)
+                    {
+                        arg_width = width_func(buf, out_len, width_context);
+                        if (arg_width < 0) return C42_FMT_WIDTH_ERROR;
+                        arg_len = out_len;
+                        cmd = CMD_BUF;
+                        break;
+                    }
+                    /* output too large for the scratch space: measure it in
+                     * a separate pass without committing anything */
+                    conv_ctx = FMT_CONV_INIT(esc_mode, cectx);
+                    e = fmt_reserve(s, FMT_CONV_MIN, &buf);
+                    if (e) return e;
+                    buf_len = s->scratch + FMT_SCRATCH_SIZE - buf;
                     for (arg_width = 0, ofs = 0; ofs < arg_len; ofs += in_len)
                     {
                         cc = conv(str + ofs, arg_len - ofs, &in_len,
-                                  buffer, sizeof buffer, &out_len, conv_ctx);
+                                  buf, buf_len, &out_len, conv_ctx);
                         if (cc && cc != C42_CLCONV_FULL)
                             return C42_FMT_CONV_ERROR;
-                        width = width_func(buffer, out_len, width_context);
+                        width = width_func(buf, out_len, width_context);
                         if (width < 0) return C42_FMT_WIDTH_ERROR;
                         arg_width += width;
                     }
-                    cc = conv(NULL, 0, &in_len, buffer, sizeof buffer,
+                    cc = conv(NULL, 0, &in_len, buf, buf_len,
                               &out_len, conv_ctx);
-                    width = width_func(buffer, out_len, width_context);
+                    width = width_func(buf, out_len, width_context);
                     if (width < 0) return C42_FMT_WIDTH_ERROR;
                     arg_width += width;
                 }
@@ -1012,7 +1401,7 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
                 ++f;
                 if (*f == '*')
                 {
-                    prec = va_arg(va, size_t);
+                    FMT_ARG_INT(prec, size_t, size_t);
                 }
                 else
                 {
@@ -1044,71 +1433,80 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
 
         if ((size_t) arg_width < req_width && align_mode == ALIGN_RIGHT)
         {
-            size_t pad_width = req_width - arg_width;
-            size_t clen;
-            for (; pad_width; pad_width -= clen)
-            {
-                clen = pad_width;
-                if (clen > sizeof(empty_spaces) - 1)
-                    clen = sizeof(empty_spaces) - 1;
-                if (writer(empty_spaces, clen, writer_context) != clen)
-                    return C42_FMT_WRITE_ERROR;
-            }
+            e = fmt_pad(s, req_width - arg_width);
+            if (e) return e;
         }
 
         switch (cmd)
         {
         case CMD_BUF:
-            z = writer(buffer, arg_len, writer_context);
-            if (z != arg_len) return C42_FMT_WRITE_ERROR;
+            e = fmt_commit(s, buf, arg_len);
+            if (e) return e;
             break;
         case CMD_STR:
-            z = writer(str, arg_len, writer_context);
-            if (z != arg_len) return C42_FMT_WRITE_ERROR;
+            e = fmt_put(s, str, arg_len);
+            if (e) return e;
             break;
         case CMD_CONV:
-            switch (esc_mode)
-            {
-            case STR_ESC_C:
-                conv_ctx = c42_clconv_c_escape_init(&cectx);
-                break;
-            default:
-                conv_ctx = NULL;
-            }
-
+            conv_ctx = FMT_CONV_INIT(esc_mode, cectx);
             for (ofs = 0; ofs < arg_len; ofs += in_len)
             {
+                e = fmt_reserve(s, FMT_CONV_MIN, &buf);
+                if (e) return e;
                 cc = conv(str + ofs, arg_len - ofs, &in_len,
-                          buffer, sizeof buffer, &out_len, conv_ctx);
+                          buf, s->scratch + FMT_SCRATCH_SIZE - buf,
+                          &out_len, conv_ctx);
                 if (cc && cc != C42_CLCONV_FULL) return C42_FMT_CONV_ERROR;
-                if (writer(buffer, out_len, writer_context) != out_len)
-                    return C42_FMT_WRITE_ERROR;
+                e = fmt_commit(s, buf, out_len);
+                if (e) return e;
             }
+            e = fmt_reserve(s, FMT_CONV_MIN, &buf);
+            if (e) return e;
             cc = conv(NULL, 0, &in_len,
-                      buffer, sizeof buffer, &out_len, conv_ctx);
+                      buf, s->scratch + FMT_SCRATCH_SIZE - buf,
+                      &out_len, conv_ctx);
             if (cc) return C42_FMT_CONV_ERROR;
-            if (writer(buffer, out_len, writer_context) != out_len)
-                return C42_FMT_WRITE_ERROR;
+            e = fmt_commit(s, buf, out_len);
+            if (e) return e;
         }
 
         if ((size_t) arg_width < req_width && align_mode == ALIGN_LEFT)
         {
-            size_t pad_width = req_width - arg_width;
-            size_t clen;
-            for (; pad_width; pad_width -= clen)
-            {
-                clen = pad_width;
-                if (clen > sizeof(empty_spaces) - 1)
-                    clen = sizeof(empty_spaces) - 1;
-                if (writer(empty_spaces, clen, writer_context) != clen)
-                    return C42_FMT_WRITE_ERROR;
-            }
+            e = fmt_pad(s, req_width - arg_width);
+            if (e) return e;
         }
 
     }
-    //if (writer(&nul, 1, writer_context) != 1) return C42_FMT_WRITE_ERROR;
 
-    return 0;
+    e = fmt_flush(s);
+    if (!e && typed && args->n) e = C42_FMT_ARG_MISMATCH;
+    return e;
+}
+
+/* fmt_engine_va ************************************************************/
+static uint_fast8_t fmt_engine_va
+(
+    fmt_sink_t * s,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    fmt_args_t * args
+)
+{
+    return fmt_engine(s, width_func, width_context, fmt, args, 0);
+}
+
+/* fmt_engine_typed *********************************************************/
+static uint_fast8_t fmt_engine_typed
+(
+    fmt_sink_t * s,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    fmt_args_t * args
+)
+{
+    return fmt_engine(s, width_func, width_context, fmt, args, 1);
 }
 #undef CMD_NONE
 #undef CMD_BUF
@@ -1120,6 +1518,35 @@ C42_API uint_fast8_t C42_CALL c42_write_vfmt
 #undef STR_ESC_NONE
 #undef STR_ESC_C
 #undef STR_ESC_HEX
+#undef FMT_CONV_INIT
+#undef FMT_ARG_INT
+#undef FMT_ENGINE_INLINE
+
+/* c42_write_vfmt ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_write_vfmt
+(
+    c42_utf8_writer_f writer,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    va_list va
+)
+{
+    fmt_sink_t s;
+    fmt_args_t args;
+    uint_fast8_t rc;
+    s.writer = writer;
+    s.vwriter = NULL;
+    s.ctx = writer_context;
+    s.seg_count = 0;
+    s.seg_size = 0;
+    s.scratch_used = 0;
+    va_copy(args.va, va);
+    rc = fmt_engine_va(&s, width_func, width_context, fmt, &args);
+    va_end(args.va);
+    return rc;
+}
 
 /* c42_write_fmt ************************************************************/
 C42_API uint_fast8_t C42_CALL c42_write_fmt
@@ -1142,6 +1569,103 @@ C42_API uint_fast8_t C42_CALL c42_write_fmt
     return rc;
 }
 
+/* c42_writev_vfmt **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_writev_vfmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    va_list va
+)
+{
+    fmt_sink_t s;
+    fmt_args_t args;
+    uint_fast8_t rc;
+    s.writer = NULL;
+    s.vwriter = vwriter;
+    s.ctx = writer_context;
+    s.seg_count = 0;
+    s.seg_size = 0;
+    s.scratch_used = 0;
+    va_copy(args.va, va);
+    rc = fmt_engine_va(&s, width_func, width_context, fmt, &args);
+    va_end(args.va);
+    return rc;
+}
+
+/* c42_writev_fmt ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_writev_fmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    ...
+)
+{
+    va_list va;
+    uint_fast8_t rc;
+
+    va_start(va, fmt);
+    rc = c42_writev_vfmt(vwriter, writer_context, width_func, width_context,
+                         fmt, va);
+    va_end(va);
+    return rc;
+}
+
+/* c42_write_afmt ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_write_afmt
+(
+    c42_utf8_writer_f writer,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+)
+{
+    fmt_sink_t s;
+    fmt_args_t args;
+    s.writer = writer;
+    s.vwriter = NULL;
+    s.ctx = writer_context;
+    s.seg_count = 0;
+    s.seg_size = 0;
+    s.scratch_used = 0;
+    args.a = arg_a;
+    args.n = arg_n;
+    return fmt_engine_typed(&s, width_func, width_context, fmt, &args);
+}
+
+/* c42_writev_afmt **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_writev_afmt
+(
+    c42_utf8_vwriter_f vwriter,
+    void * writer_context,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+)
+{
+    fmt_sink_t s;
+    fmt_args_t args;
+    s.writer = NULL;
+    s.vwriter = vwriter;
+    s.ctx = writer_context;
+    s.seg_count = 0;
+    s.seg_size = 0;
+    s.scratch_used = 0;
+    args.a = arg_a;
+    args.n = arg_n;
+    return fmt_engine_typed(&s, width_func, width_context, fmt, &args);
+}
+
 /* c42_io8_read *************************************************************/
 C42_API uint_fast8_t C42_CALL c42_io8_read
 (
@@ -1187,7 +1711,7 @@ C42_API uint_fast8_t C42_CALL c42_io8_read_full
             }
             r = 0;
         }
-        else
+        else if (r == 0)
         {
             if (rsize) *rsize = rdata - data;
             return C42_IO8_EOF;
@@ -1198,13 +1722,236 @@ C42_API uint_fast8_t C42_CALL c42_io8_read_full
     return 0;
 }
 
-/* c42_io8_write ************************************************************/
-C42_API uint_fast8_t C42_CALL c42_io8_write
+/* c42_io8_readv ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_readv
 (
     c42_io8_t * io,
-    uint8_t const * data,
-    size_t size,
-    size_t * wsize
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * rsize
+)
+{
+    size_t tmp, i, size, r;
+    uint_fast8_t ioe;
+
+    if (rsize == NULL) rsize = &tmp;
+    for (size = 0, i = 0; i < count; ++i)
+    {
+        size += seg[i].n;
+        if (size < seg[i].n || size > (SIZE_MAX >> 1)) return C42_IO8_BAD_SIZE;
+    }
+    if (size == 0) { *rsize = 0; return 0; }
+    if (io->io8_class->readv)
+        return io->io8_class->readv(io->context, seg, count, rsize);
+#if _DEBUG
+    if (io->io8_class->read == NULL) return C42_IO8_NOT_IMPLEMENTED;
+#endif
+    for (size = 0, i = 0; i < count; ++i)
+    {
+        if (seg[i].n == 0) continue;
+        ioe = io->io8_class->read(io->context, seg[i].a, seg[i].n, &r);
+        if (ioe)
+        {
+            *rsize = size;
+            return size ? 0 : ioe;
+        }
+        size += r;
+        if (r < seg[i].n) break;
+    }
+    *rsize = size;
+    return 0;
+}
+
+/* c42_io8_readv_full *******************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_readv_full
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * rsize
+)
+{
+    size_t r, ofs, total;
+    uint_fast8_t ioe;
+
+    for (total = 0, ofs = 0; count; )
+    {
+        if (ofs)
+        {
+            /* finish the partially filled segment by itself */
+            ioe = c42_io8_read_full(io, seg->a + ofs, seg->n - ofs, &r);
+            total += r;
+            if (ioe)
+            {
+                if (rsize) *rsize = total;
+                return ioe;
+            }
+            ofs = 0;
+            ++seg;
+            --count;
+            continue;
+        }
+        for (; count && seg->n == 0; ++seg, --count);
+        if (!count) break;
+        ioe = c42_io8_readv(io, seg, count, &r);
+        if (ioe != 0)
+        {
+            if (ioe != C42_IO8_INTERRUPTED)
+            {
+                if (rsize) *rsize = total;
+                return ioe;
+            }
+            continue;
+        }
+        if (r == 0)
+        {
+            if (rsize) *rsize = total;
+            return C42_IO8_EOF;
+        }
+        total += r;
+        for (; count && r >= seg->n; ++seg, --count) r -= seg->n;
+        ofs = r;
+    }
+
+    if (rsize) *rsize = total;
+    return 0;
+}
+
+/* c42_io8_pread ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_pread
+(
+    c42_io8_t * io,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
+)
+{
+    size_t tmp;
+    if (rsize == NULL) rsize = &tmp;
+    *rsize = 0;
+    if (size > (SIZE_MAX >> 1)) return C42_IO8_BAD_SIZE;
+    if (io->io8_class->pread == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    if (size == 0) return 0;
+    return io->io8_class->pread(io->context, data, size, offset, rsize);
+}
+
+/* c42_io8_pread_full *******************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_pread_full
+(
+    c42_io8_t * io,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
+)
+{
+    size_t r, done;
+    uint_fast8_t ioe;
+
+    for (done = 0; done < size; done += r)
+    {
+        ioe = c42_io8_pread(io, data + done, size - done, offset + done, &r);
+        if (ioe != 0)
+        {
+            if (ioe != C42_IO8_INTERRUPTED)
+            {
+                if (rsize) *rsize = done;
+                return ioe;
+            }
+            r = 0;
+        }
+        else if (r == 0)
+        {
+            if (rsize) *rsize = done;
+            return C42_IO8_EOF;
+        }
+    }
+
+    if (rsize) *rsize = done;
+    return 0;
+}
+
+/* c42_io8_stat *************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_stat
+(
+    c42_io8_t * io,
+    c42_fsa_stat_t * st
+)
+{
+    if (io->io8_class->stat == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    return io->io8_class->stat(io->context, st);
+}
+
+/* c42_io8_preallocate ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_preallocate
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size
+)
+{
+    if (io->io8_class->allocate == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    if (offset + size < offset) return C42_IO8_BAD_SIZE;
+    return io->io8_class->allocate(io->context, offset, size);
+}
+
+/* c42_io8_sync *************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_sync
+(
+    c42_io8_t * io,
+    int flags
+)
+{
+    if (io->io8_class->sync == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    return io->io8_class->sync(io->context, flags);
+}
+
+/* c42_io8_advise ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_advise
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    int advice
+)
+{
+    if (io->io8_class->advise == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    return io->io8_class->advise(io->context, offset, size, advice);
+}
+
+/* c42_io8_peek *************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_peek
+(
+    c42_io8_t * io,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    if (io->io8_class->peek == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    if (min_size == 0) min_size = 1;
+    return io->io8_class->peek(io->context, min_size, ptr, avail);
+}
+
+/* c42_io8_consume **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_consume
+(
+    c42_io8_t * io,
+    size_t size
+)
+{
+    if (io->io8_class->consume == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    return io->io8_class->consume(io->context, size);
+}
+
+/* c42_io8_write ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_write
+(
+    c42_io8_t * io,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
 )
 {
     size_t tmp;
@@ -1249,6 +1996,251 @@ C42_API uint_fast8_t C42_CALL c42_io8_write_full
     return 0;
 }
 
+/* c42_io8_pwrite ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_pwrite
+(
+    c42_io8_t * io,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+)
+{
+    size_t tmp;
+    if (wsize == NULL) wsize = &tmp;
+    *wsize = 0;
+    if (size > (SIZE_MAX >> 1)) return C42_IO8_BAD_SIZE;
+    if (io->io8_class->pwrite == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    if (size == 0) return 0;
+    return io->io8_class->pwrite(io->context, data, size, offset, wsize);
+}
+
+/* c42_io8_pwrite_full ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_pwrite_full
+(
+    c42_io8_t * io,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+)
+{
+    size_t w, done;
+    uint_fast8_t ioe;
+
+    for (done = 0; done < size; done += w)
+    {
+        ioe = c42_io8_pwrite(io, data + done, size - done, offset + done, &w);
+        if (ioe != 0)
+        {
+            if (ioe != C42_IO8_INTERRUPTED)
+            {
+                if (wsize) *wsize = done;
+                return ioe;
+            }
+            w = 0;
+        }
+    }
+
+    if (wsize) *wsize = done;
+    return 0;
+}
+
+/* c42_io8_writev ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_writev
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+)
+{
+    size_t tmp, i, size, w;
+    uint_fast8_t ioe;
+
+    if (wsize == NULL) wsize = &tmp;
+    for (size = 0, i = 0; i < count; ++i)
+    {
+        size += seg[i].n;
+        if (size < seg[i].n || size > (SIZE_MAX >> 1)) return C42_IO8_BAD_SIZE;
+    }
+    if (size == 0) { *wsize = 0; return 0; }
+    if (io->io8_class->writev)
+        return io->io8_class->writev(io->context, seg, count, wsize);
+#if _DEBUG
+    if (io->io8_class->write == NULL) return C42_IO8_NOT_IMPLEMENTED;
+#endif
+    for (size = 0, i = 0; i < count; ++i)
+    {
+        if (seg[i].n == 0) continue;
+        ioe = io->io8_class->write(io->context, seg[i].a, seg[i].n, &w);
+        if (ioe)
+        {
+            *wsize = size;
+            return size ? 0 : ioe;
+        }
+        size += w;
+        if (w < seg[i].n) break;
+    }
+    *wsize = size;
+    return 0;
+}
+
+/* c42_io8_writev_full ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_writev_full
+(
+    c42_io8_t * io,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+)
+{
+    size_t w, ofs, total;
+    uint_fast8_t ioe;
+
+    for (total = 0, ofs = 0; count; )
+    {
+        if (ofs)
+        {
+            /* finish the partially written segment by itself */
+            ioe = c42_io8_write_full(io, seg->a + ofs, seg->n - ofs, &w);
+            total += w;
+            if (ioe)
+            {
+                if (wsize) *wsize = total;
+                return ioe;
+            }
+            ofs = 0;
+            ++seg;
+            --count;
+            continue;
+        }
+        ioe = c42_io8_writev(io, seg, count, &w);
+        if (ioe != 0)
+        {
+            if (ioe != C42_IO8_INTERRUPTED)
+            {
+                if (wsize) *wsize = total;
+                return ioe;
+            }
+            continue;
+        }
+        total += w;
+        for (; count && w >= seg->n; ++seg, --count) w -= seg->n;
+        ofs = w;
+    }
+
+    if (wsize) *wsize = total;
+    return 0;
+}
+
+/* c42_io8_seek64 ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_seek64
+(
+    c42_io8_t * io,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
+{
+    uint64_t tmp;
+    if (pos == NULL) pos = &tmp;
+    if (io->io8_class->seek64 == NULL) return C42_IO8_NO_SEEK;
+    return io->io8_class->seek64(io->context, offset, anchor, pos);
+}
+
+/* c42_io8_truncate *********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_truncate
+(
+    c42_io8_t * io
+)
+{
+    if (io->io8_class->truncate == NULL) return C42_IO8_NOT_IMPLEMENTED;
+    return io->io8_class->truncate(io->context);
+}
+
+/* c42_io8_close ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_close
+(
+    c42_io8_t * io,
+    int mode
+)
+{
+    if (io->io8_class->close == NULL) return 0;
+    return io->io8_class->close(io->context, mode);
+}
+
+/* c42_io8_copy *************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_copy
+(
+    c42_io8_t * dst,
+    c42_io8_t * src,
+    uint64_t max_size,
+    uint8_t * buf,
+    size_t buf_size,
+    uint64_t * csize
+)
+{
+    uint64_t tmp, total;
+    uint8_t const * p;
+    size_t n, w;
+    uint_fast8_t ioe;
+
+    if (csize == NULL) csize = &tmp;
+    if (src->io8_class->copy_to)
+    {
+        ioe = src->io8_class->copy_to(src->context, dst, max_size, csize);
+        if (ioe != C42_IO8_NA) return ioe;
+    }
+    if (dst->io8_class->copy_from)
+    {
+        ioe = dst->io8_class->copy_from(dst->context, src, max_size, csize);
+        if (ioe != C42_IO8_NA) return ioe;
+    }
+
+    total = 0;
+    ioe = 0;
+    if (src->io8_class->peek)
+    {
+        while (total < max_size)
+        {
+            ioe = src->io8_class->peek(src->context, 1, &p, &n);
+            if (ioe == C42_IO8_INTERRUPTED) continue;
+            /* nothing to expose (e.g. io8buf without a read buffer) */
+            if (total == 0 && (ioe == C42_IO8_TOO_BIG
+                               || ioe == C42_IO8_NOT_IMPLEMENTED))
+                goto l_bounce;
+            if (ioe || n == 0) break;
+            if (n > max_size - total) n = (size_t) (max_size - total);
+            if (n > (SIZE_MAX >> 1)) n = SIZE_MAX >> 1;
+            ioe = c42_io8_write_full(dst, p, n, &w);
+            src->io8_class->consume(src->context, w);
+            total += w;
+            if (ioe) break;
+        }
+        *csize = total;
+        return ioe;
+    }
+
+l_bounce:
+    ioe = 0;
+    if (buf_size == 0) { *csize = 0; return C42_IO8_NOT_IMPLEMENTED; }
+    if (buf_size > (SIZE_MAX >> 1)) buf_size = SIZE_MAX >> 1;
+    while (total < max_size)
+    {
+        n = buf_size;
+        if (n > max_size - total) n = (size_t) (max_size - total);
+        ioe = c42_io8_read(src, buf, n, &n);
+        if (ioe == C42_IO8_INTERRUPTED) { ioe = 0; continue; }
+        if (ioe || n == 0) break;
+        ioe = c42_io8_write_full(dst, buf, n, &w);
+        total += w;
+        if (ioe) break;
+    }
+    *csize = total;
+    return ioe;
+}
+
 /* c42_io8_write_u8z ********************************************************/
 C42_API uint_fast8_t C42_CALL c42_io8_write_u8z
 (
@@ -1269,11 +2261,11 @@ typedef struct io8_utf8_writer_ctx_s
     uint8_t ioe;
 } io8_utf8_writer_ctx_t;
 
-/* io8_utf8_writer **********************************************************/
-static size_t C42_CALL io8_utf8_writer
+/* io8_utf8_vwriter *********************************************************/
+static size_t C42_CALL io8_utf8_vwriter
 (
-    uint8_t const * data,
-    size_t len,
+    c42_u8an_t const * seg,
+    size_t count,
     void * ctx
 )
 {
@@ -1281,11 +2273,23 @@ static size_t C42_CALL io8_utf8_writer
     uint_fast8_t e;
     size_t w;
 
-    e = c42_io8_write_full(x->io, data, len, &w);
+    e = c42_io8_writev_full(x->io, seg, count, &w);
     if (e) x->ioe = e;
     return w;
 }
 
+/* io8_fmt_error ************************************************************/
+static uint_fast8_t io8_fmt_error
+(
+    io8_utf8_writer_ctx_t * c,
+    uint_fast8_t e
+)
+{
+    if (c->ioe) return c->ioe;
+    if (e == C42_FMT_ARG_MISMATCH) return C42_IO8_FMT_ARG_MISMATCH;
+    return C42_IO8_FMT_MALFORMED - C42_FMT_MALFORMED + e;
+}
+
 /* c42_io8_wvfmt ************************************************************/
 C42_API uint_fast8_t C42_CALL c42_io8_wvfmt
 (
@@ -1296,22 +2300,33 @@ C42_API uint_fast8_t C42_CALL c42_io8_wvfmt
     va_list va
 )
 {
-    (void) io;
-    (void) width_func;
-    (void) width_context;
-    (void) fmt;
-    (void) va;
     io8_utf8_writer_ctx_t c;
     uint_fast8_t e;
     c.io = io;
     c.ioe = 0;
-    e = c42_write_vfmt(io8_utf8_writer, &c, width_func, width_context, fmt, va);
-    if (e)
-    {
-        if (c.ioe) return c.ioe;
-        return C42_IO8_FMT_MALFORMED - C42_FMT_MALFORMED + e;
-    }
-    return 0;
+    e = c42_writev_vfmt(io8_utf8_vwriter, &c, width_func, width_context,
+                        fmt, va);
+    return e ? io8_fmt_error(&c, e) : 0;
+}
+
+/* c42_io8_wafmt ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_wafmt
+(
+    c42_io8_t * io,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+)
+{
+    io8_utf8_writer_ctx_t c;
+    uint_fast8_t e;
+    c.io = io;
+    c.ioe = 0;
+    e = c42_writev_afmt(io8_utf8_vwriter, &c, width_func, width_context,
+                        fmt, arg_a, arg_n);
+    return e ? io8_fmt_error(&c, e) : 0;
 }
 
 /* c42_io8_wfmt *************************************************************/
@@ -1333,6 +2348,61 @@ C42_API uint_fast8_t C42_CALL c42_io8_wfmt
 }
 
 
+/* io8bc_peek ***************************************************************/
+static uint_fast8_t C42_CALL io8bc_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_io8bc_t * a = (c42_io8bc_t *) ctx;
+    (void) min_size;
+    if (a->offset >= a->size) *avail = 0;
+    else if (a->offset >= a->limit) return C42_IO8_IO_ERROR;
+    else *avail = (a->size < a->limit ? a->size : a->limit) - a->offset;
+    *ptr = a->data + a->offset;
+    return 0;
+}
+
+/* io8bc_consume ************************************************************/
+static uint_fast8_t C42_CALL io8bc_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_io8bc_t * a = (c42_io8bc_t *) ctx;
+    if (a->offset > a->size || size > a->size - a->offset)
+        return C42_IO8_BAD_SIZE;
+    a->offset += size;
+    return 0;
+}
+
+/* io8bc_read ***************************************************************/
+static uint_fast8_t C42_CALL io8bc_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8bc_t * a = (c42_io8bc_t *) ctx;
+    uint8_t const * p;
+    size_t n;
+    uint_fast8_t ioe;
+
+    ioe = io8bc_peek(ctx, size, &p, &n);
+    if (ioe) { *rsize = 0; return ioe; }
+    if (n > size) n = size;
+    c42_u8a_copy(data, p, n);
+    a->offset += n;
+    *rsize = n;
+    return 0;
+}
+
 /* io8bc_write **************************************************************/
 static uint_fast8_t C42_CALL io8bc_write
 (
@@ -1360,15 +2430,80 @@ static uint_fast8_t C42_CALL io8bc_write
     return 0;
 }
 
+/* io8bc_seek64 *************************************************************/
+static uint_fast8_t C42_CALL io8bc_seek64
+(
+    uintptr_t ctx,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
+{
+    c42_io8bc_t * a = (c42_io8bc_t *) ctx;
+    uint64_t base;
+    switch (anchor)
+    {
+    case C42_IO8_SEEK_SET: base = 0; break;
+    case C42_IO8_SEEK_CUR: base = a->offset; break;
+    case C42_IO8_SEEK_END: base = a->size; break;
+    default: return C42_IO8_BAD_OP;
+    }
+    if (offset < 0 ? (uint64_t) 0 - (uint64_t) offset > base
+        : (uint64_t) offset > (SIZE_MAX >> 1) - base) return C42_IO8_BAD_POS;
+    a->offset = (size_t) (base + offset);
+    *pos = a->offset;
+    return 0;
+}
+
+/* io8bc_seek ***************************************************************/
+static uint_fast8_t C42_CALL io8bc_seek
+(
+    uintptr_t ctx,
+    ptrdiff_t offset,
+    int anchor,
+    size_t * pos
+)
+{
+    uint64_t p;
+    uint_fast8_t ioe;
+    ioe = io8bc_seek64(ctx, offset, anchor, &p);
+    if (!ioe) *pos = (size_t) p;
+    return ioe;
+}
+
+/* io8bc_truncate ***********************************************************/
+static uint_fast8_t C42_CALL io8bc_truncate
+(
+    uintptr_t ctx
+)
+{
+    c42_io8bc_t * a = (c42_io8bc_t *) ctx;
+    a->size = a->offset;
+    return 0;
+}
+
 /* io8bc_class **************************************************************/
 static c42_io8_class_t io8bc_class =
 {
-    NULL,
+    io8bc_read,
     io8bc_write,
+    io8bc_seek,
+    io8bc_seek64,
+    io8bc_truncate,
+    NULL,
+    NULL,
+    NULL,
+    io8bc_peek,
+    io8bc_consume,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
     NULL,
     NULL,
     NULL,
-    NULL
+    NULL,
+    0
 };
 
 /* c42_io8bc_init ***********************************************************/
@@ -1388,645 +2523,5915 @@ C42_API c42_io8_t * C42_CALL c42_io8bc_init
     return &io8bc->io8;
 }
 
-/* c42_clconv_bin_to_hex_line ***********************************************/
-C42_API uint_fast8_t C42_CALL c42_clconv_bin_to_hex_line
+/* io8mem_reserve ***********************************************************/
+/**
+ *  Makes sure chunks covering the first @a size bytes are allocated.
+ *  @returns number of bytes covered, which can be less than @a size if
+ *      allocation failed
+ */
+static size_t io8mem_reserve
 (
-    uint8_t const * in,
-    size_t in_len,
-    size_t * in_used_len,
-    uint8_t * out,
-    size_t out_len,
-    size_t * out_used_len,
-    void * ctx
+    c42_io8mem_t * m,
+    size_t size
 )
 {
-    size_t i, o, ol;
-    (void) ctx;
-    ol = out_len & -2;
-    for (i = o = 0; i < in_len && o < ol; i++)
+    size_t need, cap;
+
+    need = (size + m->chunk_size - 1) >> m->chunk_shift;
+    if (need > m->chunk_m)
     {
-        out[o++] = digit_char_table[in[i] >> 4];
-        out[o++] = digit_char_table[in[i] & 15];
+        for (cap = m->chunk_m ? m->chunk_m : 8; cap < need; cap <<= 1);
+        if (C42_MA_ARRAY_REALLOC(m->ma, m->chunk_a, m->chunk_m, cap))
+            return m->chunk_n << m->chunk_shift;
+        m->chunk_m = cap;
     }
-    *in_used_len = i;
-    *out_used_len = o;
-    return (i == in_len) ? C42_CLCONV_OK : C42_CLCONV_FULL;
+    for (; m->chunk_n < need; m->chunk_n++)
+    {
+        m->chunk_a[m->chunk_n] = NULL;
+        if (C42_MA_ARRAY_ALLOC(m->ma, m->chunk_a[m->chunk_n], m->chunk_size))
+            break;
+    }
+    if (m->chunk_n < need) return m->chunk_n << m->chunk_shift;
+    return size;
 }
 
-/* c42_clconv_hex_to_bin ****************************************************/
-C42_API uint_fast8_t C42_CALL c42_clconv_hex_to_bin
+/* io8mem_copy **************************************************************/
+/**
+ *  Copies between a flat buffer and the chunks.
+ *  If @a src is NULL the chunks are filled with zeroes.
+ */
+static void io8mem_copy
 (
-    uint8_t const * in,
-    size_t in_len,
-    size_t * in_used_len,
-    uint8_t * out,
-    size_t out_len,
-    size_t * out_used_len,
-    void * ctx
+    c42_io8mem_t * m,
+    size_t offset,
+    uint8_t * dest,
+    uint8_t const * src,
+    size_t size
 )
 {
-    uint8_t const * skip_list = ctx;
-    size_t i, o;
-    uint_fast8_t r;
+    size_t ci, co, n;
+    uint8_t * c;
 
-    for (r = 0, i = o = 0; i < in_len; i++)
+    while (size)
     {
-        int lo, hi = c42_digit_from_char(in[i], 16);
-        if (hi < 0)
-        {
-            if (skip_list && c42_u8z_scan(skip_list, in[i])) continue;
-            r = C42_CLCONV_MALFORMED;
-            break;
-        }
-        if (++i == in_len)
-        {
-            r = C42_CLCONV_INCOMPLETE;
-            --i;
-            break;
-        }
-        lo = c42_digit_from_char(in[i], 16);
-        if (lo < 0)
+        ci = offset >> m->chunk_shift;
+        co = offset & (m->chunk_size - 1);
+        n = m->chunk_size - co;
+        if (n > size) n = size;
+        c = m->chunk_a[ci] + co;
+        if (dest)
         {
-            r = C42_CLCONV_MALFORMED;
-            break;
+            c42_u8a_copy(dest, c, n);
+            dest += n;
         }
-        if (o == out_len)
+        else if (src)
         {
-            r = C42_CLCONV_FULL;
-            --i;
-            break;
+            c42_u8a_copy(c, src, n);
+            src += n;
         }
-        out[o++] = (hi << 4) | lo;
+        else c42_u8a_set(c, 0, n);
+        offset += n;
+        size -= n;
     }
-    *in_used_len = i;
-    *out_used_len = o;
-    return r;
 }
 
-/* c42_clconv_c_escape_force_hex ********************************************/
-C42_API uint_fast8_t C42_CALL c42_clconv_c_escape_force_hex
+/* io8mem_pread *************************************************************/
+static uint_fast8_t C42_CALL io8mem_pread
 (
-    uint8_t const * in,
-    size_t in_len,
-    size_t * in_used_len,
-    uint8_t * out,
-    size_t out_len,
-    size_t * out_used_len,
-    void * ctx
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
 )
 {
-    size_t i, o;
-    uint_fast8_t r;
-    (void) ctx;
-    for (r = C42_CLCONV_OK, i = o = 0; i < in_len; ++i)
-    {
-        uint8_t v = in[i];
-        unsigned int cl = byte_c_escape_len(v);
-        if (o + cl > out_len) { r = C42_CLCONV_FULL; break; }
-        if (cl == 1) out[o++] = v;
-        else
-        {
-            out[o++] = '\\';
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    size_t n = offset < m->size ? m->size - (size_t) offset : 0;
+    if (n > size) n = size;
+    io8mem_copy(m, (size_t) offset, data, NULL, n);
+    *rsize = n;
+    return 0;
+}
 
-            if (cl == 4)
-            {
-                out[o++] = 'x';
-                out[o++] = digit_char_table[v >> 4];
-                out[o++] = digit_char_table[v & 15];
-            }
-            else if (v >= 7 && v <= 13) out[o++] = ec[v - 7];
-            else out[o++] = v;
-        }
+/* io8mem_read **************************************************************/
+static uint_fast8_t C42_CALL io8mem_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    io8mem_pread(ctx, data, size, m->offset, rsize);
+    m->offset += *rsize;
+    return 0;
+}
+
+/* io8mem_pwrite ************************************************************/
+static uint_fast8_t C42_CALL io8mem_pwrite
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    size_t ofs, end, avail;
+
+    *wsize = 0;
+    if (offset >= m->limit) return C42_IO8_NO_SPACE;
+    ofs = (size_t) offset;
+    end = m->limit - ofs < size ? m->limit : ofs + size;
+    avail = io8mem_reserve(m, end);
+    if (avail <= ofs) return C42_IO8_NO_SPACE;
+    if (ofs > m->size) io8mem_copy(m, m->size, NULL, NULL, ofs - m->size);
+    if (end > avail) end = avail;
+    io8mem_copy(m, ofs, NULL, data, end - ofs);
+    *wsize = end - ofs;
+    if (end > m->size) m->size = end;
+    return 0;
+}
+
+/* io8mem_write *************************************************************/
+static uint_fast8_t C42_CALL io8mem_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    uint_fast8_t ioe;
+    ioe = io8mem_pwrite(ctx, data, size, m->offset, wsize);
+    m->offset += *wsize;
+    return ioe;
+}
+
+/* io8mem_seek64 ************************************************************/
+static uint_fast8_t C42_CALL io8mem_seek64
+(
+    uintptr_t ctx,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    uint64_t base;
+    switch (anchor)
+    {
+    case C42_IO8_SEEK_SET: base = 0; break;
+    case C42_IO8_SEEK_CUR: base = m->offset; break;
+    case C42_IO8_SEEK_END: base = m->size; break;
+    default: return C42_IO8_BAD_OP;
     }
-    *in_used_len = i;
-    *out_used_len = o;
-    return r;
+    if (offset < 0 ? (uint64_t) 0 - (uint64_t) offset > base
+        : (uint64_t) offset > m->limit - base) return C42_IO8_BAD_POS;
+    m->offset = (size_t) (base + offset);
+    *pos = m->offset;
+    return 0;
 }
 
-/* c42_clconv_c_escape_init *************************************************/
-C42_API void * C42_CALL c42_clconv_c_escape_init
+/* io8mem_seek **************************************************************/
+static uint_fast8_t C42_CALL io8mem_seek
 (
-    c42_clconv_c_escape_t * ctx
+    uintptr_t ctx,
+    ptrdiff_t offset,
+    int anchor,
+    size_t * pos
 )
 {
-    ctx->crt_byte = -1;
-    return ctx;
+    uint64_t p;
+    uint_fast8_t ioe;
+    ioe = io8mem_seek64(ctx, offset, anchor, &p);
+    if (!ioe) *pos = (size_t) p;
+    return ioe;
 }
 
-/* c42_clconv_c_escape ******************************************************/
-C42_API uint_fast8_t C42_CALL c42_clconv_c_escape
+/* io8mem_truncate **********************************************************/
+static uint_fast8_t C42_CALL io8mem_truncate
 (
-    uint8_t const * in,
-    size_t in_len,
-    size_t * in_used_len,
-    uint8_t * out,
-    size_t out_len,
-    size_t * out_used_len,
-    void * ctx
+    uintptr_t ctx
 )
 {
-    c42_clconv_c_escape_t * cectx = ctx;
-    int v = cectx->crt_byte;
-    size_t i, o;
-    uint_fast8_t r;
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    size_t keep;
 
-    if (in)
+    if (m->offset >= m->size)
     {
-        if (in_len == 0) return 0;
-        i = o = 0;
-        if (v < 0) v = in[i++];
-        for (r = 0;; v = in[i++])
-        {
-            if (cet[v >> 5] & (1 << (v & 31)))
-            {
-                // escaping needed
-                if (v < 7 || (v >= 14 && v < 32) || v >= 0x7F)
-                {
-                    // should escape with hex or octal form
-                    if (o + 4 > out_len) { r = C42_CLCONV_FULL; break; }
-                    if (i == in_len) { r = C42_CLCONV_OK; break; }
-                    out[o++] = '\\';
-                    if (c42_digit_from_char(in[i], 16) < 0)
-                    {
-                        out[o++] = 'x';
-                        out[o++] = digit_char_table[v >> 4];
-                        out[o++] = digit_char_table[v & 15];
-                    }
-                    else
-                    {
-                        out[o++] = digit_char_table[v >> 6];
-                        out[o++] = digit_char_table[(v >> 3) & 7];
-                        out[o++] = digit_char_table[v & 7];
-                    }
-                }
-                else
-                {
-                    // short escape
-                    if (o + 2 > out_len) { r = C42_CLCONV_FULL; break; }
-                    out[o++] = '\\';
-                    out[o++] = v < 32 ? ec[v - 7] : v;
-                    if (i == in_len) { v = -1; r = C42_CLCONV_FULL; break; }
-                }
-            }
-            else
-            {
-                // non-escaped char
-                if (o == out_len) { r = C42_CLCONV_FULL; break; }
-                out[o++] = v;
-                if (i == in_len) { v = -1; r = C42_CLCONV_FULL; break; }
-            }
-        }
-        cectx->crt_byte = v;
-        *in_used_len = i;
-        *out_used_len = o;
-        return r;
+        if (io8mem_reserve(m, m->offset) < m->offset) return C42_IO8_NO_SPACE;
+        io8mem_copy(m, m->size, NULL, NULL, m->offset - m->size);
     }
-    else
+    m->size = m->offset;
+    keep = (m->size + m->chunk_size - 1) >> m->chunk_shift;
+    while (m->chunk_n > keep)
     {
-        if (v == -1)
-        {
-            *out_used_len = 0;
-            return 0;
-        }
-        if (out_len < 4) return C42_CLCONV_FULL;
-        out[0] = '\\';
-        out[1] = 'x';
-        out[2] = digit_char_table[v >> 4];
-        out[3] = digit_char_table[v & 15];
-        *out_used_len = 4;
+        --m->chunk_n;
+        C42_MA_ARRAY_FREE(m->ma, m->chunk_a[m->chunk_n], m->chunk_size);
+    }
+    return 0;
+}
+
+/* io8mem_peek **************************************************************/
+static uint_fast8_t C42_CALL io8mem_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    size_t co, n;
+
+    if (m->offset >= m->size)
+    {
+        *ptr = NULL;
+        *avail = 0;
         return 0;
     }
+    co = m->offset & (m->chunk_size - 1);
+    n = m->chunk_size - co;
+    if (n > m->size - m->offset) n = m->size - m->offset;
+    if (n < min_size && n < m->size - m->offset) return C42_IO8_TOO_BIG;
+    *ptr = m->chunk_a[m->offset >> m->chunk_shift] + co;
+    *avail = n;
+    return 0;
 }
 
-#define OTHER_SIDE(_s) ((_s) ^ 1)
-#define IS_RED(_n) ((_n) && (_n)->red)
-#define IS_BLACK(_n) (!(IS_RED(_n)))
-/* c42_rbtree_init **********************************************************/
-/**
- *  Inits a red/black tree.
- */
-C42_API void C42_CALL c42_rbtree_init
+/* io8mem_consume ***********************************************************/
+static uint_fast8_t C42_CALL io8mem_consume
 (
-    c42_rbtree_t * restrict tree,
-    c42_rbtree_cmp_f cmp,
-    void * ctx
+    uintptr_t ctx,
+    size_t size
 )
 {
-    tree->cmp = cmp;
-    tree->ctx = ctx;
-    C42_VAR_CLEAR(tree->guard);
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    if (m->offset > m->size || size > m->size - m->offset)
+        return C42_IO8_BAD_SIZE;
+    m->offset += size;
+    return 0;
 }
 
+/* io8mem_stat **************************************************************/
+static uint_fast8_t C42_CALL io8mem_stat
+(
+    uintptr_t ctx,
+    c42_fsa_stat_t * st
+)
+{
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    C42_VAR_CLEAR(*st);
+    st->size = m->size;
+    st->nlink = 1;
+    st->block_size = (uint32_t) m->chunk_size;
+    st->type = C42_FSA_T_FILE;
+    return 0;
+}
 
-/* c42_rbtree_find **********************************************************/
-C42_API uint_fast8_t C42_CALL c42_rbtree_find
+/* io8mem_allocate **********************************************************/
+static uint_fast8_t C42_CALL io8mem_allocate
 (
-    c42_rbtree_path_t * restrict path,
-    c42_rbtree_t * restrict tree,
-    uintptr_t key
+    uintptr_t ctx,
+    uint64_t offset,
+    uint64_t size
 )
 {
-    c42_rbtree_cmp_f cmp = tree->cmp;
-    void * ctx = tree->ctx;
-    c42_rbtree_node_t * n;
-    unsigned int i;
-    int cr;
+    c42_io8mem_t * m = (c42_io8mem_t *) ctx;
+    if (offset + size > m->limit) return C42_IO8_NO_SPACE;
+    if (io8mem_reserve(m, (size_t) (offset + size)) < offset + size)
+        return C42_IO8_NO_SPACE;
+    return 0;
+}
 
-    path->nodes[0] = &tree->guard;
-    path->sides[0] = 0;
-    for (i = 0, n = tree->guard.links[0]; n;)
-    {
-        path->nodes[++i] = n;
-        cr = cmp(key, n, ctx);
-        switch (cr)
-        {
-        case C42_RBTREE_LESS:
-        case C42_RBTREE_MORE:
-            path->sides[i] = cr;
-            n = n->links[cr];
-            break;
-        case C42_RBTREE_EQUAL:
-            path->sides[i] = cr;
-            path->last = i;
-            return C42_RBTREE_FOUND;
-        default:
-            path->last = i;
-            return C42_RBTREE_ERROR;
-        }
-    }
-    path->last = i;
-    return C42_RBTREE_NOT_FOUND;
+/* io8mem_sync **************************************************************/
+static uint_fast8_t C42_CALL io8mem_sync
+(
+    uintptr_t ctx,
+    int flags
+)
+{
+    (void) ctx;
+    (void) flags;
+    return 0;
 }
 
-/* c42_rbtree_first *********************************************************/
-C42_API c42_rbtree_node_t * C42_CALL c42_rbtree_first
+/* io8mem_class *************************************************************/
+static c42_io8_class_t io8mem_class =
+{
+    io8mem_read,
+    io8mem_write,
+    io8mem_seek,
+    io8mem_seek64,
+    io8mem_truncate,
+    NULL,
+    NULL,
+    NULL,
+    io8mem_peek,
+    io8mem_consume,
+    NULL,
+    NULL,
+    io8mem_pread,
+    io8mem_pwrite,
+    io8mem_stat,
+    io8mem_allocate,
+    io8mem_sync,
+    NULL,
+    0
+};
+
+/* c42_io8mem_init **********************************************************/
+C42_API c42_io8_t * C42_CALL c42_io8mem_init
 (
-    c42_rbtree_path_t * restrict path,
-    c42_rbtree_t * restrict tree
+    c42_io8mem_t * io8mem,
+    c42_ma_t * ma,
+    size_t chunk_size,
+    size_t limit
 )
 {
-    c42_rbtree_node_t * n;
-    c42_rbtree_node_t * m;
-    unsigned int i;
+    uint8_t shift;
 
-    path->nodes[0] = &tree->guard;
-    path->sides[0] = 0;
-    for (m = NULL, n = tree->guard.links[i = 0]; n; n = n->links[0])
+    if (chunk_size == 0) chunk_size = C42_IO8MEM_CHUNK_SIZE;
+    for (shift = 8; shift < sizeof(size_t) * 8 - 2
+         && ((size_t) 1 << shift) < chunk_size; ++shift);
+    io8mem->io8.io8_class = &io8mem_class;
+    io8mem->io8.context = (uintptr_t) io8mem;
+    io8mem->ma = ma;
+    io8mem->chunk_a = NULL;
+    io8mem->chunk_n = 0;
+    io8mem->chunk_m = 0;
+    io8mem->chunk_shift = shift;
+    io8mem->chunk_size = (size_t) 1 << shift;
+    io8mem->size = 0;
+    io8mem->offset = 0;
+    io8mem->limit = limit && limit < (SIZE_MAX >> 1) ? limit : SIZE_MAX >> 1;
+    return &io8mem->io8;
+}
+
+/* c42_io8mem_finish ********************************************************/
+C42_API void C42_CALL c42_io8mem_finish
+(
+    c42_io8mem_t * io8mem
+)
+{
+    while (io8mem->chunk_n)
     {
-        path->nodes[++i] = m = n;
-        path->sides[i] = C42_RBTREE_LESS;
+        --io8mem->chunk_n;
+        C42_MA_ARRAY_FREE(io8mem->ma, io8mem->chunk_a[io8mem->chunk_n],
+                          io8mem->chunk_size);
     }
-    path->sides[path->last = i] = C42_RBTREE_EQUAL;
-    return m;
+    if (io8mem->chunk_m)
+        C42_MA_ARRAY_FREE(io8mem->ma, io8mem->chunk_a, io8mem->chunk_m);
+    io8mem->chunk_a = NULL;
+    io8mem->chunk_m = 0;
+    io8mem->size = io8mem->offset = 0;
 }
 
-/* c42_rbtree_np ************************************************************/
-/**
- *  Moves to next/previous node.
- */
-C42_API c42_rbtree_node_t * C42_CALL c42_rbtree_np
+/* io8mr_pread **************************************************************/
+static uint_fast8_t C42_CALL io8mr_pread
 (
-  c42_rbtree_path_t * restrict path,
-  uint8_t side
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
 )
 {
-  c42_rbtree_node_t * n;
-  c42_rbtree_node_t * m;
-  unsigned int d;
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    size_t n = offset < m->size ? m->size - (size_t) offset : 0;
+    if (n > size) n = size;
+    if (n) c42_u8a_copy(data, m->data + (size_t) offset, n);
+    *rsize = n;
+    return 0;
+}
 
-  d = path->last;
-  n = path->nodes[d];
-  m = n->links[side];
-  //if (!m) return NULL;
-  if (m)
-  {
-      path->sides[d] = side;
-      side = OTHER_SIDE(side);
-      for (; m; m = m->links[side])
-      {
-        ++d;
-        path->nodes[d] = m;
-        path->sides[d] = side;
-      }
-  }
-  else
-  {
-      do { --d; } while (d && path->sides[d] == side);
-      if (!d) return NULL;
-  }
+/* io8mr_read ***************************************************************/
+static uint_fast8_t C42_CALL io8mr_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    io8mr_pread(ctx, data, size, m->offset, rsize);
+    m->offset += *rsize;
+    return 0;
+}
 
+/* io8mr_pwrite *************************************************************/
+static uint_fast8_t C42_CALL io8mr_pwrite
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    size_t n;
+    *wsize = 0;
+    if (!m->writable) return C42_IO8_BAD_OP;
+    if (offset >= m->size) return C42_IO8_NO_SPACE;
+    n = m->size - (size_t) offset;
+    if (n > size) n = size;
+    c42_u8a_copy(m->data + (size_t) offset, data, n);
+    *wsize = n;
+    return 0;
+}
 
-  path->sides[d] = C42_RBTREE_EQUAL;
-  path->last = d;
-  return path->nodes[d];
+/* io8mr_write **************************************************************/
+static uint_fast8_t C42_CALL io8mr_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    uint_fast8_t ioe;
+    ioe = io8mr_pwrite(ctx, data, size, m->offset, wsize);
+    m->offset += *wsize;
+    return ioe;
 }
 
-#if _DEBUG
-void rbtree_dump (c42_rbtree_node_t * n, int depth, char * pfx)
+/* io8mr_seek64 *************************************************************/
+static uint_fast8_t C42_CALL io8mr_seek64
+(
+    uintptr_t ctx,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
 {
-    int i;
-    if (!n) return;
-    for (i = 0; i < depth; ++i)
-        printf("  ");
-    printf("- %s: %p (%s)\n", pfx, n, n->red ? "red" : "black");
-    if (n->links[0]) rbtree_dump(n->links[0], depth + 1, "left");
-    if (n->links[1]) rbtree_dump(n->links[1], depth + 1, "right");
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    uint64_t base;
+    switch (anchor)
+    {
+    case C42_IO8_SEEK_SET: base = 0; break;
+    case C42_IO8_SEEK_CUR: base = m->offset; break;
+    case C42_IO8_SEEK_END: base = m->size; break;
+    default: return C42_IO8_BAD_OP;
+    }
+    if (offset < 0 ? (uint64_t) 0 - (uint64_t) offset > base
+        : (uint64_t) offset > m->size - base) return C42_IO8_BAD_POS;
+    m->offset = (size_t) (base + offset);
+    *pos = m->offset;
+    return 0;
 }
 
-//#define RBTREE_DUMP(_n) rbtree_dump((_n), 0, "root")
-#define RBTREE_DUMP(_n) ((void) 0)
-#else
-#define RBTREE_DUMP(_n) ((void) 0)
-#endif
+/* io8mr_seek ***************************************************************/
+static uint_fast8_t C42_CALL io8mr_seek
+(
+    uintptr_t ctx,
+    ptrdiff_t offset,
+    int anchor,
+    size_t * pos
+)
+{
+    uint64_t p;
+    uint_fast8_t ioe;
+    ioe = io8mr_seek64(ctx, offset, anchor, &p);
+    if (!ioe) *pos = (size_t) p;
+    return ioe;
+}
 
-/* c42_rbtree_insert ********************************************************/
-/**
- *  Inserts a node in the tree using a given path.
- *  The path must be populated by calling c42_rbtree_find().
- */
-C42_API void C42_CALL c42_rbtree_insert
+/* io8mr_peek ***************************************************************/
+static uint_fast8_t C42_CALL io8mr_peek
 (
-    c42_rbtree_path_t * restrict path,
-    c42_rbtree_node_t * restrict node
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
 )
 {
-  unsigned int i, gs, ps, ts;
-  c42_rbtree_node_t * parent;
-  c42_rbtree_node_t * grandpa;
-  c42_rbtree_node_t * uncle;
-  c42_rbtree_node_t * tmp;
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    (void) min_size;
+    *ptr = m->data + m->offset;
+    *avail = m->size - m->offset;
+    return 0;
+}
 
-  //L("c42_rbtree_insert(%p). tree before:\n", node);
-  //RBTREE_DUMP(path->nodes[0]->links[0]);
-  i = path->last;
-  node->links[0] = node->links[1] = NULL;
-  node->red = 1;
-  ts = path->sides[i];
-  path->nodes[i]->links[ts] = node;
+/* io8mr_consume ************************************************************/
+static uint_fast8_t C42_CALL io8mr_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    if (size > m->size - m->offset) return C42_IO8_BAD_SIZE;
+    m->offset += size;
+    return 0;
+}
 
-  while (i)
-  {
-    parent = path->nodes[i];
-    if (!parent->red) return; // 0;
-    // parent is red (thus it is not the root)
-    grandpa = path->nodes[--i];
-    uncle = grandpa->links[OTHER_SIDE(path->sides[i])];
-    if (uncle && uncle->red)
+/* io8mr_copy_from **********************************************************/
+static uint_fast8_t C42_CALL io8mr_copy_from
+(
+    uintptr_t ctx,
+    c42_io8_t * src,
+    uint64_t size,
+    uint64_t * csize
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    size_t n, r;
+    uint_fast8_t ioe;
+
+    *csize = 0;
+    if (!m->writable) return C42_IO8_BAD_OP;
+    n = m->offset < m->size ? m->size - m->offset : 0;
+    if (n > size) n = (size_t) size;
+    /* read straight into the region */
+    ioe = c42_io8_read_full(src, m->data + m->offset, n, &r);
+    m->offset += r;
+    *csize = r;
+    if (ioe == C42_IO8_EOF) return 0;
+    if (!ioe && r < size) return C42_IO8_NO_SPACE;
+    return ioe;
+}
+
+/* io8mr_stat ***************************************************************/
+static uint_fast8_t C42_CALL io8mr_stat
+(
+    uintptr_t ctx,
+    c42_fsa_stat_t * st
+)
+{
+    c42_io8mr_t * m = (c42_io8mr_t *) ctx;
+    C42_VAR_CLEAR(*st);
+    st->size = m->size;
+    st->type = C42_FSA_T_FILE;
+    return 0;
+}
+
+/* io8mr_class **************************************************************/
+static c42_io8_class_t io8mr_class =
+{
+    io8mr_read,
+    io8mr_write,
+    io8mr_seek,
+    io8mr_seek64,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    io8mr_peek,
+    io8mr_consume,
+    NULL,
+    io8mr_copy_from,
+    io8mr_pread,
+    io8mr_pwrite,
+    io8mr_stat,
+    NULL,
+    NULL,
+    NULL,
+    C42_IO8_CLASS_MT_PIO
+};
+
+/* c42_io8mr_init ***********************************************************/
+C42_API c42_io8_t * C42_CALL c42_io8mr_init
+(
+    c42_io8mr_t * io8mr,
+    uint8_t * data,
+    size_t size,
+    int writable
+)
+{
+    io8mr->io8.io8_class = &io8mr_class;
+    io8mr->io8.context = (uintptr_t) io8mr;
+    io8mr->data = data;
+    io8mr->size = size;
+    io8mr->offset = 0;
+    io8mr->writable = (uint8_t) (writable != 0);
+    return &io8mr->io8;
+}
+
+/* c42_io8buf_flush *********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8buf_flush
+(
+    c42_io8buf_t * io8buf
+)
+{
+    size_t w, i;
+    uint_fast8_t ioe;
+
+    if (io8buf->wlen == 0) return 0;
+    ioe = c42_io8_write_full(io8buf->io, io8buf->wbuf, io8buf->wlen, &w);
+    io8buf->upos += w;
+    /* keep what was not written at the start of the buffer */
+    for (i = w; i < io8buf->wlen; ++i) io8buf->wbuf[i - w] = io8buf->wbuf[i];
+    io8buf->wlen -= w;
+    return ioe;
+}
+
+/* io8buf_drop_read *********************************************************/
+/**
+ *  Discards data read ahead, moving the underlying position back to the
+ *  position seen by the user of the buffered stream.
+ *  Non-seekable streams keep their read-ahead data.
+ */
+static uint_fast8_t io8buf_drop_read
+(
+    c42_io8buf_t * b
+)
+{
+    uint_fast8_t ioe;
+
+    if (b->rpos != b->rlen)
     {
-      grandpa->red = 1;
-      parent->red = 0;
-      uncle->red = 0;
-      node = grandpa;
-      --i;
-      continue;
+        if (b->io->io8_class->seek64 == NULL) return 0;
+        ioe = c42_io8_seek64(b->io, -(int64_t) (b->rlen - b->rpos),
+                             C42_IO8_SEEK_CUR, &b->upos);
+        b->upos_valid = !ioe;
+        if (ioe) return ioe;
     }
-    // parent is red, uncle is black or NULL
-    if ((gs = path->sides[i]) != (ps = path->sides[i + 1]))
+    b->rpos = b->rlen = 0;
+    return 0;
+}
+
+/* io8buf_hint **************************************************************/
+/**
+ *  Passes an access pattern hint to the underlying stream, if it takes
+ *  them. #C42_FSA_ADV_WILLNEED covers the window following the tracked
+ *  underlying position, which is queried only when not known yet; other
+ *  hints cover the whole stream and are given only when they change.
+ */
+static void io8buf_hint
+(
+    c42_io8buf_t * b,
+    int advice
+)
+{
+    if (b->io->io8_class->advise == NULL) return;
+    if (advice == C42_FSA_ADV_WILLNEED)
     {
-      // node and parent are on different sides
-      grandpa->links[gs] = node;
-      parent->links[ps] = tmp = node->links[gs];
-      node->links[gs] = parent;
+        if (!b->upos_valid)
+        {
+            if (c42_io8_seek64(b->io, 0, C42_IO8_SEEK_CUR, &b->upos)) return;
+            b->upos_valid = 1;
+        }
+        c42_io8_advise(b->io, b->upos, b->ra, advice);
+        return;
+    }
+    if (b->ra_advice == advice) return;
+    b->ra_advice = (uint8_t) advice;
+    c42_io8_advise(b->io, 0, 0, advice);
+}
 
-      tmp = node;
-      node = parent;
-      parent = tmp;
+/* io8buf_ra_refill *********************************************************/
+/**
+ *  Returns how much to read ahead on a refill serving a read of @a size,
+ *  or 0 when the read is at least that large and should bypass the buffer.
+ *  The window grows when there was no seek since the previous read, but
+ *  only once a refill actually goes through the buffer.
+ */
+static size_t io8buf_ra_refill
+(
+    c42_io8buf_t * b,
+    size_t size
+)
+{
+    size_t ra;
+
+    if (b->io->io8_class->seek64 == NULL)
+        return size < b->rsize ? b->rsize : 0;
+    ra = b->ra;
+    if (b->ra_seq && ra < b->rsize) ra = ra < b->rsize / 2 ? ra * 2 : b->rsize;
+    b->ra_seq = 1;
+    if (size >= ra) return 0;
+    if (ra != b->ra)
+    {
+        b->ra = ra;
+        if (ra == b->rsize) io8buf_hint(b, C42_FSA_ADV_SEQUENTIAL);
     }
-    else ps = OTHER_SIDE(gs);
-    // node and parent are on same side: gs; ps is set to the 'other' side
-    tmp = parent->links[ps];
-    parent->links[ps] = grandpa;
-    parent->red = 0;
-    grandpa->links[gs] = tmp;
-    grandpa->red = 1;
-    tmp = path->nodes[i - 1];
-    ts = path->sides[i - 1];
-    tmp->links[ts] = parent;
-    return;
-  }
-  // if we processed 'til the top of the path then root is changed
-  node->red = 0;
-  return;
+    return ra;
 }
 
-/* c42_rbtree_delete ********************************************************/
+/* io8buf_ra_seek ***********************************************************/
 /**
- *  Deletes from the tree the last node in the given path.
+ *  Accounts for a seek: data read ahead and never used shrinks the window.
  */
-C42_API void C42_CALL c42_rbtree_delete
+static void io8buf_ra_seek
 (
-    c42_rbtree_path_t * restrict path
+    c42_io8buf_t * b
 )
 {
-  c42_rbtree_node_t * o;
-  c42_rbtree_node_t * d;
-  c42_rbtree_node_t * p;
-  c42_rbtree_node_t * c;
-  c42_rbtree_node_t * n;
-  c42_rbtree_node_t * s;
-  c42_rbtree_node_t * sl;
-  c42_rbtree_node_t * sr;
-  c42_rbtree_node_t * t;
-  c42_rbtree_node_t tmp;
-  unsigned int cs, ds, od, dd, ns, pd, ps, ss, os;
+    size_t min = b->rsize < C42_IO8BUF_RA_MIN ? b->rsize : C42_IO8BUF_RA_MIN;
 
-  // L("c42_rbtree_delete. tree before deletion:\n");
-  // RBTREE_DUMP(path->nodes[0]->links[0]);
-  od = path->last;
-  o = path->nodes[od]; // the node we want to delete
-  if (o->links[0] && o->links[1])
-  {
-    ds = path->sides[od - 1];
-    d = c42_rbtree_np(path, (uint8_t) ds);
-    // now must delete d which has at most 1 non-null child
-    dd = path->last;
-    tmp = *o;
-    *o = *d;
-    *d = tmp;
-    path->nodes[od] = d;
-    t = path->nodes[od - 1];
-    os = path->sides[od - 1];
-    t->links[os] = d;
-  }
-  else { dd = od; }
+    b->ra_seq = 0;
+    if (b->rpos == b->rlen) return;
+    b->ra = b->ra / 2 > min ? b->ra / 2 : min;
+    if (b->ra == min) io8buf_hint(b, C42_FSA_ADV_RANDOM);
+}
 
-  d = o;
+/* io8buf_read **************************************************************/
+static uint_fast8_t C42_CALL io8buf_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+    size_t n, ra;
 
-  cs = d->links[0] ? C42_RBTREE_LESS : C42_RBTREE_MORE;
-  c = d->links[cs]; // c is the only child of d or NULL
+    if (b->wlen && b->io->io8_class->seek64)
+    {
+        ioe = c42_io8buf_flush(b);
+        if (ioe) { *rsize = 0; return ioe; }
+    }
+    if (b->rpos == b->rlen)
+    {
+        b->rpos = b->rlen = 0;
+        ra = io8buf_ra_refill(b, size);
+        if (ra == 0)
+        {
+            ioe = c42_io8_read(b->io, data, size, rsize);
+            if (ioe) b->upos_valid = 0;
+            else b->upos += *rsize;
+            return ioe;
+        }
+        ioe = c42_io8_read(b->io, b->rbuf, ra, &n);
+        if (ioe) { b->upos_valid = 0; *rsize = 0; return ioe; }
+        b->upos += n;
+        b->rlen = n;
+        if (ra == b->rsize && b->ra_advice == C42_FSA_ADV_SEQUENTIAL)
+            io8buf_hint(b, C42_FSA_ADV_WILLNEED);
+    }
+    n = b->rlen - b->rpos;
+    if (n > size) n = size;
+    c42_u8a_copy(data, b->rbuf + b->rpos, n);
+    b->rpos += n;
+    *rsize = n;
+    return 0;
+}
 
-  ds = path->sides[dd - 1];
-  p = path->nodes[dd - 1];
-  if (d->red)
-  {
-    // d has no children since it has at most 1 non-null child and
-    // both paths must have same ammount of black nodes
-    p->links[ds] = NULL;
-//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
-    return;
-  }
-  // d is black; it has either no children, or a single red child with no
-  // children of its own
+/* io8buf_write *************************************************************/
+static uint_fast8_t C42_CALL io8buf_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
 
-  if (c) // same as: (c && c->red)
-  {
-    p->links[ds] = c;
-    c->red = 0;
-//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
-    return;
-  }
+    if (b->rlen)
+    {
+        ioe = io8buf_drop_read(b);
+        if (ioe) { *wsize = 0; return ioe; }
+    }
+    if (b->wlen + size > b->wsize)
+    {
+        ioe = c42_io8buf_flush(b);
+        if (ioe) { *wsize = 0; return ioe; }
+        if (size >= b->wsize)
+        {
+            ioe = c42_io8_write(b->io, data, size, wsize);
+            if (ioe) b->upos_valid = 0;
+            else b->upos += *wsize;
+            return ioe;
+        }
+    }
+    c42_u8a_copy(b->wbuf + b->wlen, data, size);
+    b->wlen += size;
+    *wsize = size;
+    return 0;
+}
+
+/* io8buf_writev ************************************************************/
+static uint_fast8_t C42_CALL io8buf_writev
+(
+    uintptr_t ctx,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+    size_t size, i;
+
+    if (b->rlen)
+    {
+        ioe = io8buf_drop_read(b);
+        if (ioe) { *wsize = 0; return ioe; }
+    }
+    /* total size was already validated by c42_io8_writev() */
+    for (size = 0, i = 0; i < count; ++i) size += seg[i].n;
+    if (b->wlen + size > b->wsize)
+    {
+        ioe = c42_io8buf_flush(b);
+        if (ioe) { *wsize = 0; return ioe; }
+        if (size >= b->wsize)
+        {
+            ioe = c42_io8_writev(b->io, seg, count, wsize);
+            if (ioe) b->upos_valid = 0;
+            else b->upos += *wsize;
+            return ioe;
+        }
+    }
+    for (i = 0; i < count; ++i)
+    {
+        c42_u8a_copy(b->wbuf + b->wlen, seg[i].a, seg[i].n);
+        b->wlen += seg[i].n;
+    }
+    *wsize = size;
+    return 0;
+}
+
+/* io8buf_seek **************************************************************/
+static uint_fast8_t C42_CALL io8buf_seek
+(
+    uintptr_t ctx,
+    ptrdiff_t offset,
+    int anchor,
+    size_t * pos
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+    size_t p;
+
+    if (b->io->io8_class->seek == NULL) return C42_IO8_NO_SEEK;
+    ioe = c42_io8buf_flush(b);
+    if (ioe) return ioe;
+    if (anchor == C42_IO8_SEEK_CUR && !offset)
+    {
+        /* position query: keep the data read ahead */
+        ioe = b->io->io8_class->seek(b->io->context, 0, anchor, &p);
+        if (!ioe) b->upos = p;
+        b->upos_valid = !ioe;
+        if (!ioe && pos) *pos = p - (b->rlen - b->rpos);
+        return ioe;
+    }
+    io8buf_ra_seek(b);
+    if (anchor == C42_IO8_SEEK_CUR) offset -= (ptrdiff_t) (b->rlen - b->rpos);
+    b->rpos = b->rlen = 0;
+    ioe = b->io->io8_class->seek(b->io->context, offset, anchor, &p);
+    if (!ioe) b->upos = p;
+    b->upos_valid = !ioe;
+    if (!ioe && pos) *pos = p;
+    return ioe;
+}
+
+/* io8buf_seek64 ************************************************************/
+static uint_fast8_t C42_CALL io8buf_seek64
+(
+    uintptr_t ctx,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+
+    if (b->io->io8_class->seek64 == NULL) return C42_IO8_NO_SEEK;
+    ioe = c42_io8buf_flush(b);
+    if (ioe) return ioe;
+    if (anchor == C42_IO8_SEEK_CUR && !offset)
+    {
+        ioe = c42_io8_seek64(b->io, 0, anchor, &b->upos);
+        b->upos_valid = !ioe;
+        if (!ioe && pos) *pos = b->upos - (b->rlen - b->rpos);
+        return ioe;
+    }
+    io8buf_ra_seek(b);
+    if (anchor == C42_IO8_SEEK_CUR) offset -= (int64_t) (b->rlen - b->rpos);
+    b->rpos = b->rlen = 0;
+    ioe = c42_io8_seek64(b->io, offset, anchor, &b->upos);
+    b->upos_valid = !ioe;
+    if (!ioe && pos) *pos = b->upos;
+    return ioe;
+}
+
+/* io8buf_truncate **********************************************************/
+static uint_fast8_t C42_CALL io8buf_truncate
+(
+    uintptr_t ctx
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+
+    ioe = c42_io8buf_flush(b);
+    if (!ioe) ioe = io8buf_drop_read(b);
+    if (ioe) return ioe;
+    return c42_io8_truncate(b->io);
+}
+
+/* io8buf_close *************************************************************/
+static uint_fast8_t C42_CALL io8buf_close
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe = 0, cioe;
+
+    if ((mode & C42_IO8_OP_WRITE)) ioe = c42_io8buf_flush(b);
+    if ((mode & C42_IO8_OP_READ)) b->rpos = b->rlen = 0;
+    cioe = c42_io8_close(b->io, mode);
+    return ioe ? ioe : cioe;
+}
+
+/* io8buf_peek **************************************************************/
+static uint_fast8_t C42_CALL io8buf_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+    size_t n, i;
+
+    if (b->wlen && b->io->io8_class->seek64)
+    {
+        ioe = c42_io8buf_flush(b);
+        if (ioe) return ioe;
+    }
+    if (min_size > b->rsize) return C42_IO8_TOO_BIG;
+    if (b->rlen - b->rpos < min_size)
+    {
+        /* move the leftover to the start and fill the rest */
+        for (i = b->rpos; i < b->rlen; ++i) b->rbuf[i - b->rpos] = b->rbuf[i];
+        b->rlen -= b->rpos;
+        b->rpos = 0;
+        while (b->rlen < min_size)
+        {
+            ioe = c42_io8_read(b->io, b->rbuf + b->rlen, b->rsize - b->rlen, &n);
+            if (ioe == C42_IO8_INTERRUPTED) continue;
+            if (ioe) { b->upos_valid = 0; return ioe; }
+            if (n == 0) break;
+            b->rlen += n;
+            b->upos += n;
+        }
+    }
+    *ptr = b->rbuf + b->rpos;
+    *avail = b->rlen - b->rpos;
+    return 0;
+}
+
+/* io8buf_consume ***********************************************************/
+static uint_fast8_t C42_CALL io8buf_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    if (size > b->rlen - b->rpos) return C42_IO8_BAD_SIZE;
+    b->rpos += size;
+    return 0;
+}
+
+/* io8buf_stat **************************************************************/
+static uint_fast8_t C42_CALL io8buf_stat
+(
+    uintptr_t ctx,
+    c42_fsa_stat_t * st
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+
+    /* buffered writes count towards the size */
+    ioe = c42_io8buf_flush(b);
+    if (ioe) return ioe;
+    return c42_io8_stat(b->io, st);
+}
+
+/* io8buf_allocate **********************************************************/
+static uint_fast8_t C42_CALL io8buf_allocate
+(
+    uintptr_t ctx,
+    uint64_t offset,
+    uint64_t size
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    return c42_io8_preallocate(b->io, offset, size);
+}
+
+/* io8buf_sync **************************************************************/
+static uint_fast8_t C42_CALL io8buf_sync
+(
+    uintptr_t ctx,
+    int flags
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    uint_fast8_t ioe;
+
+    ioe = c42_io8buf_flush(b);
+    if (ioe) return ioe;
+    return c42_io8_sync(b->io, flags);
+}
+
+/* io8buf_advise ************************************************************/
+static uint_fast8_t C42_CALL io8buf_advise
+(
+    uintptr_t ctx,
+    uint64_t offset,
+    uint64_t size,
+    int advice
+)
+{
+    c42_io8buf_t * b = (c42_io8buf_t *) ctx;
+    return c42_io8_advise(b->io, offset, size, advice);
+}
+
+/* io8buf_class *************************************************************/
+static c42_io8_class_t io8buf_class =
+{
+    io8buf_read,
+    io8buf_write,
+    io8buf_seek,
+    io8buf_seek64,
+    io8buf_truncate,
+    io8buf_close,
+    io8buf_writev,
+    NULL,
+    io8buf_peek,
+    io8buf_consume,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    io8buf_stat,
+    io8buf_allocate,
+    io8buf_sync,
+    io8buf_advise,
+    0
+};
+
+/* c42_io8buf_init **********************************************************/
+C42_API c42_io8_t * C42_CALL c42_io8buf_init
+(
+    c42_io8buf_t * io8buf,
+    c42_io8_t * io,
+    uint8_t * rbuf,
+    size_t rsize,
+    uint8_t * wbuf,
+    size_t wsize
+)
+{
+    io8buf->io8.io8_class = &io8buf_class;
+    io8buf->io8.context = (uintptr_t) io8buf;
+    io8buf->io = io;
+    io8buf->rbuf = rbuf;
+    io8buf->rsize = rsize;
+    io8buf->rpos = 0;
+    io8buf->rlen = 0;
+    io8buf->ra = rsize < C42_IO8BUF_RA_MIN ? rsize : C42_IO8BUF_RA_MIN;
+    io8buf->ra_seq = 0;
+    io8buf->ra_advice = C42_FSA_ADV_NORMAL;
+    io8buf->upos = 0;
+    io8buf->upos_valid = 0;
+    io8buf->wbuf = wbuf;
+    io8buf->wsize = wsize;
+    io8buf->wlen = 0;
+    return &io8buf->io8;
+}
+
+/* c42_clconv_bin_to_hex_line ***********************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_bin_to_hex_line
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    size_t i, o, ol;
+    (void) ctx;
+    ol = out_len & -2;
+    for (i = o = 0; i < in_len && o < ol; i++)
+    {
+        out[o++] = digit_char_table[in[i] >> 4];
+        out[o++] = digit_char_table[in[i] & 15];
+    }
+    *in_used_len = i;
+    *out_used_len = o;
+    return (i == in_len) ? C42_CLCONV_OK : C42_CLCONV_FULL;
+}
+
+/* c42_clconv_hex_to_bin ****************************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_hex_to_bin
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    uint8_t const * skip_list = ctx;
+    size_t i, o;
+    uint_fast8_t r;
+
+    for (r = 0, i = o = 0; i < in_len; i++)
+    {
+        int lo, hi = c42_digit_from_char(in[i], 16);
+        if (hi < 0)
+        {
+            if (skip_list && c42_u8z_scan(skip_list, in[i])) continue;
+            r = C42_CLCONV_MALFORMED;
+            break;
+        }
+        if (++i == in_len)
+        {
+            r = C42_CLCONV_INCOMPLETE;
+            --i;
+            break;
+        }
+        lo = c42_digit_from_char(in[i], 16);
+        if (lo < 0)
+        {
+            r = C42_CLCONV_MALFORMED;
+            break;
+        }
+        if (o == out_len)
+        {
+            r = C42_CLCONV_FULL;
+            --i;
+            break;
+        }
+        out[o++] = (hi << 4) | lo;
+    }
+    *in_used_len = i;
+    *out_used_len = o;
+    return r;
+}
+
+/* c42_clconv_c_escape_force_hex ********************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_c_escape_force_hex
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    size_t i, o;
+    uint_fast8_t r;
+    (void) ctx;
+    for (r = C42_CLCONV_OK, i = o = 0; i < in_len; ++i)
+    {
+        uint8_t v = in[i];
+        unsigned int cl = byte_c_escape_len(v);
+        if (o + cl > out_len) { r = C42_CLCONV_FULL; break; }
+        if (cl == 1) out[o++] = v;
+        else
+        {
+            out[o++] = '\\';
+
+            if (cl == 4)
+            {
+                out[o++] = 'x';
+                out[o++] = digit_char_table[v >> 4];
+                out[o++] = digit_char_table[v & 15];
+            }
+            else if (v >= 7 && v <= 13) out[o++] = ec[v - 7];
+            else out[o++] = v;
+        }
+    }
+    *in_used_len = i;
+    *out_used_len = o;
+    return r;
+}
+
+/* c42_clconv_c_escape_init *************************************************/
+C42_API void * C42_CALL c42_clconv_c_escape_init
+(
+    c42_clconv_c_escape_t * ctx
+)
+{
+    ctx->crt_byte = -1;
+    return ctx;
+}
+
+/* c42_clconv_c_escape ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_c_escape
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    c42_clconv_c_escape_t * cectx = ctx;
+    int v = cectx->crt_byte;
+    size_t i, o;
+    uint_fast8_t r;
+
+    if (in)
+    {
+        if (in_len == 0) return 0;
+        i = o = 0;
+        if (v < 0) v = in[i++];
+        for (r = 0;; v = in[i++])
+        {
+            if (cet[v >> 5] & (1 << (v & 31)))
+            {
+                // escaping needed
+                if (v < 7 || (v >= 14 && v < 32) || v >= 0x7F)
+                {
+                    // should escape with hex or octal form
+                    if (o + 4 > out_len) { r = C42_CLCONV_FULL; break; }
+                    if (i == in_len) { r = C42_CLCONV_OK; break; }
+                    out[o++] = '\\';
+                    if (c42_digit_from_char(in[i], 16) < 0)
+                    {
+                        out[o++] = 'x';
+                        out[o++] = digit_char_table[v >> 4];
+                        out[o++] = digit_char_table[v & 15];
+                    }
+                    else
+                    {
+                        out[o++] = digit_char_table[v >> 6];
+                        out[o++] = digit_char_table[(v >> 3) & 7];
+                        out[o++] = digit_char_table[v & 7];
+                    }
+                }
+                else
+                {
+                    // short escape
+                    if (o + 2 > out_len) { r = C42_CLCONV_FULL; break; }
+                    out[o++] = '\\';
+                    out[o++] = v < 32 ? ec[v - 7] : v;
+                    if (i == in_len) { v = -1; r = C42_CLCONV_FULL; break; }
+                }
+            }
+            else
+            {
+                // non-escaped char
+                if (o == out_len) { r = C42_CLCONV_FULL; break; }
+                out[o++] = v;
+                if (i == in_len) { v = -1; r = C42_CLCONV_FULL; break; }
+            }
+        }
+        cectx->crt_byte = v;
+        *in_used_len = i;
+        *out_used_len = o;
+        return r;
+    }
+    else
+    {
+        if (v == -1)
+        {
+            *out_used_len = 0;
+            return 0;
+        }
+        if (out_len < 4) return C42_CLCONV_FULL;
+        out[0] = '\\';
+        out[1] = 'x';
+        out[2] = digit_char_table[v >> 4];
+        out[3] = digit_char_table[v & 15];
+        *out_used_len = 4;
+        return 0;
+    }
+}
+
+#define OTHER_SIDE(_s) ((_s) ^ 1)
+#define IS_RED(_n) ((_n) && (_n)->red)
+#define IS_BLACK(_n) (!(IS_RED(_n)))
+/* c42_rbtree_init **********************************************************/
+/**
+ *  Inits a red/black tree.
+ */
+C42_API void C42_CALL c42_rbtree_init
+(
+    c42_rbtree_t * restrict tree,
+    c42_rbtree_cmp_f cmp,
+    void * ctx
+)
+{
+    tree->cmp = cmp;
+    tree->ctx = ctx;
+    C42_VAR_CLEAR(tree->guard);
+}
+
+
+/* c42_rbtree_find **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_rbtree_find
+(
+    c42_rbtree_path_t * restrict path,
+    c42_rbtree_t * restrict tree,
+    uintptr_t key
+)
+{
+    c42_rbtree_cmp_f cmp = tree->cmp;
+    void * ctx = tree->ctx;
+    c42_rbtree_node_t * n;
+    unsigned int i;
+    int cr;
+
+    path->nodes[0] = &tree->guard;
+    path->sides[0] = 0;
+    for (i = 0, n = tree->guard.links[0]; n;)
+    {
+        path->nodes[++i] = n;
+        cr = cmp(key, n, ctx);
+        switch (cr)
+        {
+        case C42_RBTREE_LESS:
+        case C42_RBTREE_MORE:
+            path->sides[i] = cr;
+            n = n->links[cr];
+            break;
+        case C42_RBTREE_EQUAL:
+            path->sides[i] = cr;
+            path->last = i;
+            return C42_RBTREE_FOUND;
+        default:
+            path->last = i;
+            return C42_RBTREE_ERROR;
+        }
+    }
+    path->last = i;
+    return C42_RBTREE_NOT_FOUND;
+}
+
+/* c42_rbtree_first *********************************************************/
+C42_API c42_rbtree_node_t * C42_CALL c42_rbtree_first
+(
+    c42_rbtree_path_t * restrict path,
+    c42_rbtree_t * restrict tree
+)
+{
+    c42_rbtree_node_t * n;
+    c42_rbtree_node_t * m;
+    unsigned int i;
+
+    path->nodes[0] = &tree->guard;
+    path->sides[0] = 0;
+    for (m = NULL, n = tree->guard.links[i = 0]; n; n = n->links[0])
+    {
+        path->nodes[++i] = m = n;
+        path->sides[i] = C42_RBTREE_LESS;
+    }
+    path->sides[path->last = i] = C42_RBTREE_EQUAL;
+    return m;
+}
+
+/* c42_rbtree_np ************************************************************/
+/**
+ *  Moves to next/previous node.
+ */
+C42_API c42_rbtree_node_t * C42_CALL c42_rbtree_np
+(
+  c42_rbtree_path_t * restrict path,
+  uint8_t side
+)
+{
+  c42_rbtree_node_t * n;
+  c42_rbtree_node_t * m;
+  unsigned int d;
+
+  d = path->last;
+  n = path->nodes[d];
+  m = n->links[side];
+  //if (!m) return NULL;
+  if (m)
+  {
+      path->sides[d] = side;
+      side = OTHER_SIDE(side);
+      for (; m; m = m->links[side])
+      {
+        ++d;
+        path->nodes[d] = m;
+        path->sides[d] = side;
+      }
+  }
+  else
+  {
+      do { --d; } while (d && path->sides[d] == side);
+      if (!d) return NULL;
+  }
+
+
+  path->sides[d] = C42_RBTREE_EQUAL;
+  path->last = d;
+  return path->nodes[d];
+}
+
+#if _DEBUG
+void rbtree_dump (c42_rbtree_node_t * n, int depth, char * pfx)
+{
+    int i;
+    if (!n) return;
+    for (i = 0; i < depth; ++i)
+        printf("  ");
+    printf("- %s: %p (%s)\n", pfx, n, n->red ? "red" : "black");
+    if (n->links[0]) rbtree_dump(n->links[0], depth + 1, "left");
+    if (n->links[1]) rbtree_dump(n->links[1], depth + 1, "right");
+}
+
+//#define RBTREE_DUMP(_n) rbtree_dump((_n), 0, "root")
+#define RBTREE_DUMP(_n) ((void) 0)
+#else
+#define RBTREE_DUMP(_n) ((void) 0)
+#endif
+
+/* c42_rbtree_insert ********************************************************/
+/**
+ *  Inserts a node in the tree using a given path.
+ *  The path must be populated by calling c42_rbtree_find().
+ */
+C42_API void C42_CALL c42_rbtree_insert
+(
+    c42_rbtree_path_t * restrict path,
+    c42_rbtree_node_t * restrict node
+)
+{
+  unsigned int i, gs, ps, ts;
+  c42_rbtree_node_t * parent;
+  c42_rbtree_node_t * grandpa;
+  c42_rbtree_node_t * uncle;
+  c42_rbtree_node_t * tmp;
+
+  //L("c42_rbtree_insert(%p). tree before:\n", node);
+  //RBTREE_DUMP(path->nodes[0]->links[0]);
+  i = path->last;
+  node->links[0] = node->links[1] = NULL;
+  node->red = 1;
+  ts = path->sides[i];
+  path->nodes[i]->links[ts] = node;
+
+  while (i)
+  {
+    parent = path->nodes[i];
+    if (!parent->red) return; // 0;
+    // parent is red (thus it is not the root)
+    grandpa = path->nodes[--i];
+    uncle = grandpa->links[OTHER_SIDE(path->sides[i])];
+    if (uncle && uncle->red)
+    {
+      grandpa->red = 1;
+      parent->red = 0;
+      uncle->red = 0;
+      node = grandpa;
+      --i;
+      continue;
+    }
+    // parent is red, uncle is black or NULL
+    if ((gs = path->sides[i]) != (ps = path->sides[i + 1]))
+    {
+      // node and parent are on different sides
+      grandpa->links[gs] = node;
+      parent->links[ps] = tmp = node->links[gs];
+      node->links[gs] = parent;
+
+      tmp = node;
+      node = parent;
+      parent = tmp;
+    }
+    else ps = OTHER_SIDE(gs);
+    // node and parent are on same side: gs; ps is set to the 'other' side
+    tmp = parent->links[ps];
+    parent->links[ps] = grandpa;
+    parent->red = 0;
+    grandpa->links[gs] = tmp;
+    grandpa->red = 1;
+    tmp = path->nodes[i - 1];
+    ts = path->sides[i - 1];
+    tmp->links[ts] = parent;
+    return;
+  }
+  // if we processed 'til the top of the path then root is changed
+  node->red = 0;
+  return;
+}
+
+/* c42_rbtree_delete ********************************************************/
+/**
+ *  Deletes from the tree the last node in the given path.
+ */
+C42_API void C42_CALL c42_rbtree_delete
+(
+    c42_rbtree_path_t * restrict path
+)
+{
+  c42_rbtree_node_t * o;
+  c42_rbtree_node_t * d;
+  c42_rbtree_node_t * p;
+  c42_rbtree_node_t * c;
+  c42_rbtree_node_t * n;
+  c42_rbtree_node_t * s;
+  c42_rbtree_node_t * sl;
+  c42_rbtree_node_t * sr;
+  c42_rbtree_node_t * t;
+  c42_rbtree_node_t tmp;
+  unsigned int cs, ds, od, dd, ns, pd, ps, ss, os;
+
+  // L("c42_rbtree_delete. tree before deletion:\n");
+  // RBTREE_DUMP(path->nodes[0]->links[0]);
+  od = path->last;
+  o = path->nodes[od]; // the node we want to delete
+  if (o->links[0] && o->links[1])
+  {
+    ds = path->sides[od - 1];
+    d = c42_rbtree_np(path, (uint8_t) ds);
+    // now must delete d which has at most 1 non-null child
+    dd = path->last;
+    tmp = *o;
+    *o = *d;
+    *d = tmp;
+    path->nodes[od] = d;
+    t = path->nodes[od - 1];
+    os = path->sides[od - 1];
+    t->links[os] = d;
+  }
+  else { dd = od; }
+
+  d = o;
+
+  cs = d->links[0] ? C42_RBTREE_LESS : C42_RBTREE_MORE;
+  c = d->links[cs]; // c is the only child of d or NULL
+
+  ds = path->sides[dd - 1];
+  p = path->nodes[dd - 1];
+  if (d->red)
+  {
+    // d has no children since it has at most 1 non-null child and
+    // both paths must have same ammount of black nodes
+    p->links[ds] = NULL;
+//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
+    return;
+  }
+  // d is black; it has either no children, or a single red child with no
+  // children of its own
+
+  if (c) // same as: (c && c->red)
+  {
+    p->links[ds] = c;
+    c->red = 0;
+//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
+    return;
+  }
+
+  // d is black and has no children (if c is black and its sibling is NULL then
+  // it must be NULL itself)
+
+  p->links[ds] = n = NULL;
+
+  for (pd = dd - 1; pd; p = path->nodes[--pd])
+  {
+    // n is always black (in first iteration it is NULL)
+    ns = path->sides[pd];
+    ss = OTHER_SIDE(ns);
+    s = p->links[ss]; // this is a non-NULL node
+    //M("p: %p, s: %p\n", p, s);
+    if (s->red) // implies p is black
+    {
+      /* del case 2 */
+      t = path->nodes[pd - 1];
+      ps = path->sides[pd - 1];
+      t->links[ps] = s;
+      p->links[ss] = sl = s->links[ns];
+      p->red = 1;
+      s->links[ns] = p;
+      s->red = 0;
+      path->nodes[pd] = s;
+      ++pd;
+      s = sl; /* new s is black */
+    }
+    else
+    {
+    //M("p: %p, s: %p, sl: %p, sr: %p\n", p, s, s->links[0], s->links[1]);
+      // s is black
+      if (!p->red && IS_BLACK(s->links[0]) && IS_BLACK(s->links[1]))
+      {
+        /* del case 3 */
+        s->red = 1;
+        continue;
+      }
+    }
+    // s must be black
+    sl = s->links[ns];
+    sr = s->links[ss];
+    if (p->red && IS_BLACK(sl) && IS_BLACK(sr))
+    {
+      /* del case 4 */
+      p->red = 0;
+      s->red = 1;
+      break;
+    }
+    if (IS_RED(sl) && IS_BLACK(sr))
+    {
+      p->links[ss] = sl;
+      s->links[ns] = sl->links[ss];
+      s->red = 1;
+      sl->links[ss] = s;
+      sl->red = 0;
+      s = sl; // again new s is black
+      sl = s->links[ns];
+      sr = s->links[ss];
+    }
+    if (IS_RED(sr))
+    {
+      t = path->nodes[pd - 1];
+      ps = path->sides[pd - 1];
+      t->links[ps] = s;
+      p->links[ss] = sl;
+      s->red = p->red;
+      p->red = 0;
+      sr->red = 0;
+      s->links[ns] = p;
+    }
+    break;
+  }
+
+//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
+  return;
+}
+#undef OTHER_SIDE
+#undef IS_RED
+#undef IS_BLACK
+
+/* c42_u32_bit_width ********************************************************/
+C42_API uint_fast8_t C42_CALL c42_u32_bit_width (uint32_t n)
+{
+    uint_fast8_t i;
+    for (i = 0x1F; i; --i)
+        if (n >> i) return i + 1;
+    /* n is 0 or 1 */
+    return (uint_fast8_t) n;
+}
+
+/* malim_handler ************************************************************/
+static uint_fast8_t C42_CALL malim_handler
+(
+    void * * ptr_p,
+    size_t old_size,
+    size_t new_size,
+    void * ctx
+)
+{
+    size_t nb, ts;
+    c42_malim_ctx_t * q = ctx;
+    uint_fast8_t mae;
+    if (new_size > q->bs_lim) return C42_MA_LIMIT;
+    if (new_size > old_size)
+    {
+        nb = q->nb;
+        if (old_size == 0)
+        {
+            if (nb == q->nb_lim) return C42_MA_LIMIT;
+            ++nb;
+        }
+        ts = new_size - old_size;
+        if (ts + q->ts < ts) return C42_MA_LIMIT;
+        ts += q->ts;
+        if (ts > q->ts_lim) return C42_MA_LIMIT;
+    }
+    else
+    {
+        if (new_size == old_size) return 0;
+        ts = old_size - new_size;
+#if _DEBUG
+        if (q->ts < ts) return C42_MA_CORRUPT;
+        if (new_size == 0 && q->nb == 0) return C42_MA_CORRUPT;
+#endif
+        nb = q->nb - (new_size == 0);
+        ts = q->ts - ts;
+    }
+    mae = q->worker.handler(ptr_p, old_size, new_size, q->worker.context);
+    if (mae) return mae;
+    q->nb = nb;
+    q->ts = ts;
+    return 0;
+};
+
+/* c42_ma_aligned_alloc *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_ma_aligned_alloc
+(
+    c42_ma_t * ma,
+    void * * ptr_p,
+    size_t size,
+    size_t align
+)
+{
+    size_t total;
+    void * raw;
+    uintptr_t a;
+    uint_fast8_t mae;
+
+    if (align < sizeof(void *)) align = sizeof(void *);
+    if (align & (align - 1)) return C42_MA_BAD_ITEM_SIZE;
+    /* room for the alignment gap plus the original pointer before it */
+    total = size + align - 1 + sizeof(void *);
+    if (total < size || (ptrdiff_t) total < 0) return C42_MA_SIZE_OVERFLOW;
+    mae = c42_ma_alloc(ma, &raw, total, 1);
+    if (mae) return mae;
+    a = ((uintptr_t) raw + sizeof(void *) + align - 1)
+        & ~(uintptr_t) (align - 1);
+    ((void * *) a)[-1] = raw;
+    *ptr_p = (void *) a;
+    return 0;
+}
+
+/* c42_ma_aligned_free ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_ma_aligned_free
+(
+    c42_ma_t * ma,
+    void * ptr,
+    size_t size,
+    size_t align
+)
+{
+    if (!ptr) return 0;
+    if (align < sizeof(void *)) align = sizeof(void *);
+    return c42_ma_free(ma, ((void * *) ptr)[-1],
+                       size + align - 1 + sizeof(void *), 1);
+}
+
+/* c42_malim_init ***********************************************************/
+C42_API void C42_CALL c42_malim_init
+(
+    c42_ma_t * restrict malim,
+    c42_malim_ctx_t * restrict ctx,
+    c42_ma_t const * restrict worker_ma,
+    size_t ts_lim,
+    size_t bs_lim,
+    size_t nb_lim
+)
+{
+    malim->handler = malim_handler;
+    malim->context = ctx;
+    ctx->worker = *worker_ma;
+    ctx->nb = 0;
+    ctx->ts = 0;
+    ctx->ts_lim = ts_lim;
+    ctx->bs_lim = bs_lim;
+    ctx->nb_lim = nb_lim;
+}
+
+
+/* c42_smt_mutex_create *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_smt_mutex_create
+(
+    c42_smt_mutex_t * * mutex_pp,
+    c42_smt_t * smt_p,
+    c42_ma_t * ma_p
+)
+{
+    void * p = NULL;
+    uint_fast8_t r;
+
+    if (c42_ma_alloc(ma_p, &p, smt_p->mutex_size, 1)) return C42_SMT_NO_MEM;
+    r = c42_smt_mutex_init(smt_p, p);
+    if (r)
+    {
+        c42_ma_free(ma_p, p, smt_p->mutex_size, 1);
+        return r;
+    }
+    *mutex_pp = p;
+    return 0;
+}
+
+/* c42_smt_mutex_destroy ****************************************************/
+C42_API uint_fast8_t C42_CALL c42_smt_mutex_destroy
+(
+    c42_smt_mutex_t * mutex_p,
+    c42_smt_t * smt_p,
+    c42_ma_t * ma_p
+)
+{
+    uint_fast8_t r;
+    r = c42_smt_mutex_finish(smt_p, mutex_p);
+    c42_ma_free(ma_p, mutex_p, smt_p->mutex_size, 1);
+    return r;
+}
+
+/* c42_smt_cond_create ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_smt_cond_create
+(
+    c42_smt_cond_t * * cond_pp,
+    c42_smt_t * smt_p,
+    c42_ma_t * ma_p
+)
+{
+    void * p = NULL;
+    uint_fast8_t r;
+
+    if (c42_ma_alloc(ma_p, &p, smt_p->cond_size, 1)) return C42_SMT_NO_MEM;
+    r = c42_smt_cond_init(smt_p, p);
+    if (r)
+    {
+        c42_ma_free(ma_p, p, smt_p->cond_size, 1);
+        return r;
+    }
+    *cond_pp = p;
+    return 0;
+}
+
+/* c42_smt_cond_destroy *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_smt_cond_destroy
+(
+    c42_smt_cond_t * cond_p,
+    c42_smt_t * smt_p,
+    c42_ma_t * ma_p
+)
+{
+    uint_fast8_t r;
+    r = c42_smt_cond_finish(smt_p, cond_p);
+    c42_ma_free(ma_p, cond_p, smt_p->cond_size, 1);
+    return r;
+}
+
+/* atomic operations ********************************************************/
+#if __GNUC__
+#define ATOMIC_LOAD_ACQ(_p) (__atomic_load_n((_p), __ATOMIC_ACQUIRE))
+#define ATOMIC_STORE_REL(_p, _v) (__atomic_store_n((_p), (_v), __ATOMIC_RELEASE))
+#define ATOMIC_LOAD_RLX(_p) (__atomic_load_n((_p), __ATOMIC_RELAXED))
+#define ATOMIC_STORE_RLX(_p, _v) (__atomic_store_n((_p), (_v), __ATOMIC_RELAXED))
+#define ATOMIC_FENCE() (__atomic_thread_fence(__ATOMIC_SEQ_CST))
+#define ATOMIC_ADD_RLX(_p, _v) (__atomic_fetch_add((_p), (_v), __ATOMIC_RELAXED))
+#define ATOMIC_CAS_RLX(_p, _e, _v) \
+    (__atomic_compare_exchange_n((_p), (_e), (_v), 1, \
+                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+#elif defined(_MSC_VER)
+/* Interlocked intrinsics are full barriers so the acquire/release/relaxed
+ * flavours all map onto the same helpers; the operand width is dispatched
+ * on sizeof and 64-bit operations go through a cas loop as 32-bit targets
+ * lack the 64-bit exchange/add intrinsics */
+#include <intrin.h>
+
+static __forceinline uint64_t msvc_atomic_load (void volatile * p, size_t n)
+{
+    switch (n)
+    {
+    case 1:
+        return (uint8_t) _InterlockedCompareExchange8(
+            (char volatile *) p, 0, 0);
+    case 4:
+        return (uint32_t) _InterlockedCompareExchange(
+            (long volatile *) p, 0, 0);
+    default:
+        return (uint64_t) _InterlockedCompareExchange64(
+            (__int64 volatile *) p, 0, 0);
+    }
+}
+
+static __forceinline int msvc_atomic_cas64
+(
+    uint64_t volatile * p,
+    uint64_t * e,
+    uint64_t v
+)
+{
+    uint64_t o = (uint64_t) _InterlockedCompareExchange64(
+        (__int64 volatile *) p, (__int64) v, (__int64) *e);
+    if (o == *e) return 1;
+    *e = o;
+    return 0;
+}
+
+static __forceinline uint64_t msvc_atomic_add64
+(
+    uint64_t volatile * p,
+    uint64_t v
+)
+{
+    uint64_t o = *p;
+    while (!msvc_atomic_cas64(p, &o, o + v));
+    return o;
+}
+
+static __forceinline void msvc_atomic_store
+(
+    void volatile * p,
+    size_t n,
+    uint64_t v
+)
+{
+    uint64_t o;
+    switch (n)
+    {
+    case 1: _InterlockedExchange8((char volatile *) p, (char) v); break;
+    case 4: _InterlockedExchange((long volatile *) p, (long) v); break;
+    default:
+        o = *(uint64_t volatile *) p;
+        while (!msvc_atomic_cas64((uint64_t volatile *) p, &o, v));
+    }
+}
+
+static __forceinline void msvc_atomic_fence (void)
+{
+    long volatile f = 0;
+    _InterlockedExchange(&f, 1);
+}
+
+#define ATOMIC_LOAD_ACQ(_p) (msvc_atomic_load((_p), sizeof(*(_p))))
+#define ATOMIC_STORE_REL(_p, _v) \
+    (msvc_atomic_store((_p), sizeof(*(_p)), (uint64_t) (_v)))
+#define ATOMIC_LOAD_RLX(_p) ATOMIC_LOAD_ACQ(_p)
+#define ATOMIC_STORE_RLX(_p, _v) ATOMIC_STORE_REL(_p, _v)
+#define ATOMIC_FENCE() (msvc_atomic_fence())
+/* add/cas are only used on 64-bit counters */
+#define ATOMIC_ADD_RLX(_p, _v) (msvc_atomic_add64((_p), (uint64_t) (_v)))
+#define ATOMIC_CAS_RLX(_p, _e, _v) (msvc_atomic_cas64((_p), (_e), (_v)))
+#else
+#error atomic operations not implemented for this compiler
+#endif
+
+/* dlog_rec_t ***************************************************************/
+typedef struct dlog_rec_s dlog_rec_t;
+struct dlog_rec_s
+{
+    uint32_t size; /* record size; 0 marks unused space up to the ring end */
+    uint32_t argc; /* number of args following the header */
+    char const * fmt;
+};
+#define DLOG_ALIGN(_n) (((_n) + 7) & ~(size_t) 7)
+#define DLOG_REC_HDR DLOG_ALIGN(sizeof(dlog_rec_t))
+#define DLOG_MIN_RING 0x100
+#define DLOG_MAGIC "C42DLOG1"
+#define DLOG_ENT_FMT 1 /* format definition: id, length, bytes */
+#define DLOG_ENT_REC 2 /* record: format id, arg count, args */
+
+/* dlog_fmt_node_t **********************************************************/
+typedef struct dlog_fmt_node_s dlog_fmt_node_t;
+struct dlog_fmt_node_s
+{
+    c42_rbtree_node_t rbn;
+    dlog_fmt_node_t * next;
+    char const * fmt;
+    uint32_t id;
+};
+
+/* dlog_fmt_cmp *************************************************************/
+static uint_fast8_t C42_CALL dlog_fmt_cmp
+(
+    uintptr_t key,
+    c42_rbtree_node_t * node,
+    void * restrict ctx
+)
+{
+    uintptr_t k;
+    (void) ctx;
+    k = (uintptr_t) C42_STRUCT_FROM_FIELD_PTR(dlog_fmt_node_t, rbn, node)->fmt;
+    if (key < k) return C42_RBTREE_LESS;
+    if (key > k) return C42_RBTREE_MORE;
+    return C42_RBTREE_EQUAL;
+}
+
+/* dlog_put_u32 *************************************************************/
+static void dlog_put_u32 (uint8_t * p, uint32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+/* dlog_put_u64 *************************************************************/
+static void dlog_put_u64 (uint8_t * p, uint64_t v)
+{
+    dlog_put_u32(p, (uint32_t) v);
+    dlog_put_u32(p + 4, (uint32_t) (v >> 32));
+}
+
+/* dlog_get_u32 *************************************************************/
+static uint32_t dlog_get_u32 (uint8_t const * p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8)
+        | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* dlog_get_u64 *************************************************************/
+static uint64_t dlog_get_u64 (uint8_t const * p)
+{
+    return dlog_get_u32(p) | ((uint64_t) dlog_get_u32(p + 4) << 32);
+}
+
+/* dlog_dump ****************************************************************/
+/**
+ *  Writes a record in binary form, preceded by the definition of its format
+ *  string the first time that string is seen.
+ */
+static uint_fast8_t dlog_dump
+(
+    c42_dlog_t * dlog,
+    char const * fmt,
+    c42_fmt_arg_t const * a,
+    size_t n
+)
+{
+    c42_rbtree_path_t path;
+    dlog_fmt_node_t * fn;
+    uint8_t enc[6 + C42_DLOG_ARG_MAX * 10];
+    c42_u8an_t seg[2 + C42_DLOG_ARG_MAX * 2];
+    uint8_t * start;
+    uint8_t * q;
+    size_t i, k, slen;
+
+    if (c42_rbtree_find(&path, &dlog->fmt_tree, (uintptr_t) fmt)
+        == C42_RBTREE_FOUND)
+        fn = C42_STRUCT_FROM_FIELD_PTR(dlog_fmt_node_t, rbn,
+                                       path.nodes[path.last]);
+    else
+    {
+        if (C42_MA_VAR_ALLOC(dlog->ma, fn)) return C42_DLOG_NO_MEM;
+        fn->fmt = fmt;
+        fn->id = dlog->fmt_count++;
+        fn->next = dlog->fmt_list;
+        dlog->fmt_list = fn;
+        c42_rbtree_insert(&path, &fn->rbn);
+        slen = c42_u8z_len((uint8_t const *) fmt);
+        enc[0] = DLOG_ENT_FMT;
+        dlog_put_u32(enc + 1, fn->id);
+        dlog_put_u32(enc + 5, (uint32_t) slen);
+        seg[0].a = enc;
+        seg[0].n = 9;
+        seg[1].a = (uint8_t *) fmt;
+        seg[1].n = slen;
+        if (c42_io8_writev_full(dlog->out, seg, slen ? 2 : 1, NULL))
+            return C42_DLOG_IO_ERROR;
+    }
+
+    enc[0] = DLOG_ENT_REC;
+    dlog_put_u32(enc + 1, fn->id);
+    enc[5] = (uint8_t) n;
+    start = enc;
+    q = enc + 6;
+    for (k = 0, i = 0; i < n; ++i)
+    {
+        q[0] = a[i].type;
+        q[1] = a[i].size;
+        if (a[i].type != C42_FMT_ARG_STR)
+        {
+            dlog_put_u64(q + 2, a[i].v.u);
+            q += 10;
+            continue;
+        }
+        slen = c42_u8z_len(a[i].v.s);
+        dlog_put_u32(q + 2, (uint32_t) slen);
+        q += 6;
+        seg[k].a = start;
+        seg[k++].n = q - start;
+        start = q;
+        if (slen)
+        {
+            seg[k].a = (uint8_t *) a[i].v.s;
+            seg[k++].n = slen;
+        }
+    }
+    if (q != start)
+    {
+        seg[k].a = start;
+        seg[k++].n = q - start;
+    }
+    if (c42_io8_writev_full(dlog->out, seg, k, NULL)) return C42_DLOG_IO_ERROR;
+    return 0;
+}
+
+/* dlog_process *************************************************************/
+static void dlog_process
+(
+    c42_dlog_t * dlog,
+    dlog_rec_t const * rec
+)
+{
+    c42_fmt_arg_t a[C42_DLOG_ARG_MAX];
+    c42_fmt_arg_t const * ra;
+    uint8_t const * base = (uint8_t const *) rec;
+    uint32_t i;
+    uint_fast8_t r;
+
+    ra = (c42_fmt_arg_t const *) (base + DLOG_REC_HDR);
+    for (i = 0; i < rec->argc; ++i)
+    {
+        a[i] = ra[i];
+        if (a[i].type == C42_FMT_ARG_STR) a[i].v.s = base + ra[i].v.u;
+    }
+    if (dlog->mode == C42_DLOG_BINARY)
+    {
+        r = dlog_dump(dlog, rec->fmt, a, rec->argc);
+        if (r && !dlog->ioe) dlog->ioe = C42_IO8_IO_ERROR;
+        return;
+    }
+    r = c42_io8_wafmt(dlog->out, dlog->width_func, dlog->width_context,
+                      rec->fmt, a, rec->argc);
+    if (!r) return;
+    if ((r >= C42_IO8_FMT_MALFORMED && r <= C42_IO8_FMT_NO_CODE)
+        || r == C42_IO8_FMT_ARG_MISMATCH)
+    {
+        if (!dlog->fmte) dlog->fmte = r;
+    }
+    else if (!dlog->ioe) dlog->ioe = r;
+}
+
+/* dlog_drain ***************************************************************/
+/**
+ *  Processes all records available in the ring.
+ *  @returns number of records processed
+ */
+static size_t dlog_drain
+(
+    c42_dlog_ring_t * ring
+)
+{
+    size_t head = ring->head;
+    size_t tail = ATOMIC_LOAD_ACQ(&ring->tail);
+    size_t mask = ring->size - 1;
+    size_t pos, n;
+    dlog_rec_t const * rec;
+
+    for (n = 0; head != tail; )
+    {
+        pos = head & mask;
+        rec = (dlog_rec_t const *) (ring->data + pos);
+        if (rec->size == 0) head += ring->size - pos;
+        else
+        {
+            dlog_process(ring->dlog, rec);
+            head += rec->size;
+            ++n;
+        }
+        ATOMIC_STORE_REL(&ring->head, head);
+    }
+    return n;
+}
+
+/* dlog_pending *************************************************************/
+static int dlog_pending
+(
+    c42_dlog_t * dlog
+)
+{
+    c42_np_t * np;
+    for (np = dlog->rings.next; np != &dlog->rings; np = np->next)
+    {
+        c42_dlog_ring_t * ring = (c42_dlog_ring_t *) np;
+        if (ATOMIC_LOAD_ACQ(&ring->tail) != ring->head) return 1;
+    }
+    return 0;
+}
+
+/* dlog_thread **************************************************************/
+static uint8_t C42_CALL dlog_thread
+(
+    void * arg
+)
+{
+    c42_dlog_t * dlog = arg;
+    c42_np_t * np;
+    size_t n;
+
+    int pending;
+
+    c42_smt_mutex_lock(dlog->smt, dlog->mutex);
+    for (;;)
+    {
+        for (n = 0, np = dlog->rings.next; np != &dlog->rings; np = np->next)
+            n += dlog_drain((c42_dlog_ring_t *) np);
+        if (n) continue;
+        /* writers only ever take wake_mutex so they are not held up while
+         * records are formatted and written out above */
+        c42_smt_mutex_lock(dlog->smt, dlog->wake_mutex);
+        if (dlog->stop)
+        {
+            c42_smt_mutex_unlock(dlog->smt, dlog->wake_mutex);
+            break;
+        }
+        ATOMIC_STORE_RLX(&dlog->sleeping, 1);
+        ATOMIC_FENCE();
+        pending = dlog_pending(dlog);
+        c42_smt_mutex_unlock(dlog->smt, dlog->mutex);
+        if (!pending)
+            c42_smt_cond_wait(dlog->smt, dlog->cond, dlog->wake_mutex);
+        ATOMIC_STORE_RLX(&dlog->sleeping, 0);
+        c42_smt_mutex_unlock(dlog->smt, dlog->wake_mutex);
+        c42_smt_mutex_lock(dlog->smt, dlog->mutex);
+    }
+    c42_smt_mutex_unlock(dlog->smt, dlog->mutex);
+    return 0;
+}
+
+/* c42_dlog_init ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_init
+(
+    c42_dlog_t * dlog,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    c42_io8_t * out,
+    uint_fast8_t mode,
+    c42_utf8_width_f width_func,
+    void * width_context
+)
+{
+    uint_fast8_t r;
+
+    c42_dlist_init(&dlog->rings);
+    c42_rbtree_init(&dlog->fmt_tree, dlog_fmt_cmp, NULL);
+    dlog->smt = smt;
+    dlog->ma = ma;
+    dlog->out = out;
+    dlog->width_func = width_func;
+    dlog->width_context = width_context;
+    dlog->fmt_list = NULL;
+    dlog->fmt_count = 0;
+    dlog->mode = mode;
+    dlog->sleeping = 0;
+    dlog->stop = 0;
+    dlog->ioe = 0;
+    dlog->fmte = 0;
+
+    if (mode == C42_DLOG_BINARY && C42_IO8_WRITE_LIT(out, DLOG_MAGIC))
+        return C42_DLOG_IO_ERROR;
+    r = c42_smt_mutex_create(&dlog->mutex, smt, ma);
+    if (r) return r == C42_SMT_NO_MEM ? C42_DLOG_NO_MEM : C42_DLOG_SMT_ERROR;
+    r = c42_smt_mutex_create(&dlog->wake_mutex, smt, ma);
+    if (r)
+    {
+        c42_smt_mutex_destroy(dlog->mutex, smt, ma);
+        return r == C42_SMT_NO_MEM ? C42_DLOG_NO_MEM : C42_DLOG_SMT_ERROR;
+    }
+    r = c42_smt_cond_create(&dlog->cond, smt, ma);
+    if (r)
+    {
+        c42_smt_mutex_destroy(dlog->wake_mutex, smt, ma);
+        c42_smt_mutex_destroy(dlog->mutex, smt, ma);
+        return r == C42_SMT_NO_MEM ? C42_DLOG_NO_MEM : C42_DLOG_SMT_ERROR;
+    }
+    if (c42_smt_thread_create(smt, &dlog->tid, dlog_thread, dlog))
+    {
+        c42_smt_cond_destroy(dlog->cond, smt, ma);
+        c42_smt_mutex_destroy(dlog->wake_mutex, smt, ma);
+        c42_smt_mutex_destroy(dlog->mutex, smt, ma);
+        return C42_DLOG_SMT_ERROR;
+    }
+    return 0;
+}
+
+/* c42_dlog_finish **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_finish
+(
+    c42_dlog_t * dlog
+)
+{
+    dlog_fmt_node_t * fn;
+    uint_fast8_t r = 0;
+
+    c42_smt_mutex_lock(dlog->smt, dlog->wake_mutex);
+    dlog->stop = 1;
+    c42_smt_cond_signal(dlog->smt, dlog->cond);
+    c42_smt_mutex_unlock(dlog->smt, dlog->wake_mutex);
+    if (c42_smt_thread_join(dlog->smt, dlog->tid, NULL))
+        r = C42_DLOG_SMT_ERROR;
+    if (c42_smt_cond_destroy(dlog->cond, dlog->smt, dlog->ma))
+        r = C42_DLOG_SMT_ERROR;
+    if (c42_smt_mutex_destroy(dlog->wake_mutex, dlog->smt, dlog->ma))
+        r = C42_DLOG_SMT_ERROR;
+    if (c42_smt_mutex_destroy(dlog->mutex, dlog->smt, dlog->ma))
+        r = C42_DLOG_SMT_ERROR;
+    while ((fn = dlog->fmt_list))
+    {
+        dlog->fmt_list = fn->next;
+        C42_MA_VAR_FREE(dlog->ma, fn);
+    }
+    if (r) return r;
+    if (dlog->ioe) return C42_DLOG_IO_ERROR;
+    if (dlog->fmte) return C42_DLOG_FMT_ERROR;
+    return 0;
+}
+
+/* c42_dlog_ring_attach *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_ring_attach
+(
+    c42_dlog_ring_t * ring,
+    c42_dlog_t * dlog,
+    size_t size
+)
+{
+    size_t sz;
+
+    for (sz = DLOG_MIN_RING; sz < size; sz <<= 1)
+        if ((sz << 1) == 0) return C42_DLOG_TOO_BIG;
+    ring->data = NULL;
+    if (C42_MA_ARRAY_ALLOC(dlog->ma, ring->data, sz)) return C42_DLOG_NO_MEM;
+    ring->dlog = dlog;
+    ring->size = sz;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->lost = 0;
+    c42_smt_mutex_lock(dlog->smt, dlog->mutex);
+    C42_DLIST_APPEND(dlog->rings, ring, links);
+    c42_smt_mutex_unlock(dlog->smt, dlog->mutex);
+    return 0;
+}
+
+/* c42_dlog_ring_detach *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_ring_detach
+(
+    c42_dlog_ring_t * ring
+)
+{
+    c42_dlog_t * dlog = ring->dlog;
+
+    c42_smt_mutex_lock(dlog->smt, dlog->mutex);
+    dlog_drain(ring);
+    c42_dlist_del(&ring->links);
+    c42_smt_mutex_unlock(dlog->smt, dlog->mutex);
+    C42_MA_ARRAY_FREE(dlog->ma, ring->data, ring->size);
+    ring->data = NULL;
+    return 0;
+}
+
+/* c42_dlog_write ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_write
+(
+    c42_dlog_ring_t * ring,
+    char const * fmt,
+    c42_fmt_arg_t const * arg_a,
+    size_t arg_n
+)
+{
+    c42_dlog_t * dlog = ring->dlog;
+    dlog_rec_t * rec;
+    c42_fmt_arg_t * ra;
+    uint8_t * p;
+    size_t need, head, tail, pos, till_end, i;
+
+    if (arg_n > C42_DLOG_ARG_MAX) return C42_DLOG_TOO_BIG;
+    need = DLOG_REC_HDR + arg_n * sizeof(c42_fmt_arg_t);
+    for (i = 0; i < arg_n; ++i)
+        if (arg_a[i].type == C42_FMT_ARG_STR)
+            need += c42_u8z_len(arg_a[i].v.s) + 1;
+    need = DLOG_ALIGN(need);
+    /* at most half the ring so that it fits even after skipping the end */
+    if (need > (ring->size >> 1) || need > UINT32_MAX)
+        return C42_DLOG_TOO_BIG;
+
+    tail = ring->tail;
+    head = ATOMIC_LOAD_ACQ(&ring->head);
+    pos = tail & (ring->size - 1);
+    till_end = ring->size - pos;
+    if (till_end < need)
+    {
+        if (ring->size - (tail - head) < till_end + need)
+        {
+            ring->lost++;
+            return C42_DLOG_FULL;
+        }
+        ((dlog_rec_t *) (ring->data + pos))->size = 0;
+        tail += till_end;
+        pos = 0;
+    }
+    else if (ring->size - (tail - head) < need)
+    {
+        ring->lost++;
+        return C42_DLOG_FULL;
+    }
+
+    rec = (dlog_rec_t *) (ring->data + pos);
+    rec->size = (uint32_t) need;
+    rec->argc = (uint32_t) arg_n;
+    rec->fmt = fmt;
+    ra = (c42_fmt_arg_t *) ((uint8_t *) rec + DLOG_REC_HDR);
+    p = (uint8_t *) (ra + arg_n);
+    for (i = 0; i < arg_n; ++i)
+    {
+        ra[i] = arg_a[i];
+        if (arg_a[i].type != C42_FMT_ARG_STR) continue;
+        ra[i].v.u = p - (uint8_t *) rec;
+        p = c42_u8z_copy(p, arg_a[i].v.s) + 1;
+    }
+    ATOMIC_STORE_REL(&ring->tail, tail + need);
+
+    ATOMIC_FENCE();
+    if (ATOMIC_LOAD_RLX(&dlog->sleeping))
+    {
+        c42_smt_mutex_lock(dlog->smt, dlog->wake_mutex);
+        c42_smt_cond_signal(dlog->smt, dlog->cond);
+        c42_smt_mutex_unlock(dlog->smt, dlog->wake_mutex);
+    }
+    return 0;
+}
+
+/* dlog_read ****************************************************************/
+static uint_fast8_t dlog_read
+(
+    c42_io8_t * in,
+    uint8_t * data,
+    size_t size
+)
+{
+    uint_fast8_t ioe;
+    ioe = c42_io8_read_full(in, data, size, NULL);
+    if (ioe == C42_IO8_EOF) return C42_DLOG_MALFORMED;
+    return ioe ? C42_DLOG_IO_ERROR : 0;
+}
+
+/* c42_dlog_decode **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_dlog_decode
+(
+    c42_io8_t * in,
+    c42_io8_t * out,
+    c42_utf8_width_f width_func,
+    void * width_context,
+    c42_ma_t * ma
+)
+{
+    c42_fmt_arg_t a[C42_DLOG_ARG_MAX];
+    c42_u8an_t str[C42_DLOG_ARG_MAX];
+    c42_u8an_t * fmt_a = NULL;
+    size_t fmt_n = 0, fmt_m = 0, str_n = 0, i, z;
+    uint8_t hdr[10];
+    uint32_t id, len, argc;
+    uint_fast8_t r, ioe;
+
+    r = dlog_read(in, hdr, sizeof(DLOG_MAGIC) - 1);
+    if (r) return r;
+    if (!C42_U8A_EQLIT(hdr, DLOG_MAGIC)) return C42_DLOG_MALFORMED;
+
+    for (;;)
+    {
+        ioe = c42_io8_read_full(in, hdr, 1, &z);
+        if (ioe == C42_IO8_EOF && z == 0) break;
+        if (ioe) { r = C42_DLOG_IO_ERROR; break; }
+        if (hdr[0] == DLOG_ENT_FMT)
+        {
+            r = dlog_read(in, hdr, 8);
+            if (r) break;
+            id = dlog_get_u32(hdr);
+            len = dlog_get_u32(hdr + 4);
+            if (id != fmt_n || len == UINT32_MAX)
+            {
+                r = C42_DLOG_MALFORMED;
+                break;
+            }
+            if (fmt_n == fmt_m)
+            {
+                z = fmt_m ? fmt_m << 1 : 0x10;
+                if (C42_MA_ARRAY_REALLOC(ma, fmt_a, fmt_m, z))
+                {
+                    r = C42_DLOG_NO_MEM;
+                    break;
+                }
+                fmt_m = z;
+            }
+            fmt_a[fmt_n].a = NULL;
+            if (C42_MA_ARRAY_ALLOC(ma, fmt_a[fmt_n].a, len + 1))
+            {
+                r = C42_DLOG_NO_MEM;
+                break;
+            }
+            fmt_a[fmt_n].n = len + 1;
+            fmt_a[fmt_n].a[len] = 0;
+            ++fmt_n;
+            r = dlog_read(in, fmt_a[fmt_n - 1].a, len);
+            if (r) break;
+            continue;
+        }
+        if (hdr[0] != DLOG_ENT_REC)
+        {
+            r = C42_DLOG_MALFORMED;
+            break;
+        }
+        r = dlog_read(in, hdr, 5);
+        if (r) break;
+        id = dlog_get_u32(hdr);
+        argc = hdr[4];
+        if (id >= fmt_n || argc > C42_DLOG_ARG_MAX)
+        {
+            r = C42_DLOG_MALFORMED;
+            break;
+        }
+        for (i = 0; i < argc; ++i)
+        {
+            r = dlog_read(in, hdr, 2);
+            if (r) break;
+            if (hdr[0] == C42_FMT_ARG_STR)
+            {
+                r = dlog_read(in, hdr + 2, 4);
+                if (r) break;
+                len = dlog_get_u32(hdr + 2);
+                if (len == UINT32_MAX) { r = C42_DLOG_MALFORMED; break; }
+                str[str_n].a = NULL;
+                if (C42_MA_ARRAY_ALLOC(ma, str[str_n].a, len + 1))
+                {
+                    r = C42_DLOG_NO_MEM;
+                    break;
+                }
+                str[str_n].n = len + 1;
+                str[str_n].a[len] = 0;
+                a[i] = c42_fmt_arg_str(str[str_n++].a, 0);
+                r = dlog_read(in, str[str_n - 1].a, len);
+                if (r) break;
+                continue;
+            }
+            r = dlog_read(in, hdr + 2, 8);
+            if (r) break;
+            if (hdr[0] == C42_FMT_ARG_UINT)
+                a[i] = c42_fmt_arg_uint(dlog_get_u64(hdr + 2), hdr[1]);
+            else if (hdr[0] == C42_FMT_ARG_SINT)
+                a[i] = c42_fmt_arg_sint((int64_t) dlog_get_u64(hdr + 2),
+                                        hdr[1]);
+            else { r = C42_DLOG_MALFORMED; break; }
+        }
+        if (!r)
+        {
+            ioe = c42_io8_wafmt(out, width_func, width_context,
+                                (char const *) fmt_a[id].a, a, argc);
+            if (ioe)
+                r = ((ioe >= C42_IO8_FMT_MALFORMED && ioe <= C42_IO8_FMT_NO_CODE)
+                     || ioe == C42_IO8_FMT_ARG_MISMATCH)
+                    ? C42_DLOG_FMT_ERROR : C42_DLOG_IO_ERROR;
+        }
+        while (str_n)
+        {
+            --str_n;
+            C42_MA_ARRAY_FREE(ma, str[str_n].a, str[str_n].n);
+        }
+        if (r) break;
+    }
+
+    for (i = 0; i < fmt_n; ++i)
+        C42_MA_ARRAY_FREE(ma, fmt_a[i].a, fmt_a[i].n);
+    if (fmt_m) C42_MA_ARRAY_FREE(ma, fmt_a, fmt_m);
+    return r;
+}
+
+/* aiopool_pio **************************************************************/
+static uint_fast8_t aiopool_pio
+(
+    c42_aio_req_t * req
+)
+{
+    if (req->op == C42_AIO_READ)
+        return c42_io8_pread_full(req->io, req->data, req->size, req->offset,
+                                  &req->done);
+    return c42_io8_pwrite_full(req->io, req->data, req->size, req->offset,
+                               &req->done);
+}
+
+/* aiopool_exec *************************************************************/
+static uint_fast8_t aiopool_exec
+(
+    c42_aiopool_t * pool,
+    c42_aio_req_t * req
+)
+{
+    uint_fast8_t ioe;
+    int pio;
+
+    req->done = 0;
+    if (req->op == C42_AIO_SYNC)
+    {
+        c42_smt_mutex_lock(pool->smt, pool->io_mutex);
+        ioe = c42_io8_sync(req->io, 0);
+        c42_smt_mutex_unlock(pool->smt, pool->io_mutex);
+        return ioe;
+    }
+    if (req->op != C42_AIO_READ && req->op != C42_AIO_WRITE)
+        return C42_IO8_BAD_OP;
+    pio = req->op == C42_AIO_READ ? req->io->io8_class->pread != NULL
+        : req->io->io8_class->pwrite != NULL;
+    if (pio && (req->io->io8_class->flags & C42_IO8_CLASS_MT_PIO))
+        return aiopool_pio(req);
+    c42_smt_mutex_lock(pool->smt, pool->io_mutex);
+    if (pio) ioe = aiopool_pio(req);
+    else ioe = c42_io8_seek64(req->io, (int64_t) req->offset,
+                              C42_IO8_SEEK_SET, NULL);
+    if (!ioe && !pio)
+    {
+        if (req->op == C42_AIO_READ)
+            ioe = c42_io8_read_full(req->io, req->data, req->size, &req->done);
+        else
+            ioe = c42_io8_write_full(req->io, req->data, req->size,
+                                     &req->done);
+    }
+    c42_smt_mutex_unlock(pool->smt, pool->io_mutex);
+    return ioe;
+}
+
+/* aiopool_worker ***********************************************************/
+static uint8_t C42_CALL aiopool_worker
+(
+    void * arg
+)
+{
+    c42_aiopool_t * pool = arg;
+    c42_aio_req_t * req;
+
+    c42_smt_mutex_lock(pool->smt, pool->mutex);
+    for (;;)
+    {
+        while (c42_dlist_is_empty(&pool->pending) && !pool->stop)
+            c42_smt_cond_wait(pool->smt, pool->work_cond, pool->mutex);
+        if (c42_dlist_is_empty(&pool->pending)) break;
+        req = C42_STRUCT_FROM_FIELD_PTR(c42_aio_req_t, links,
+                                        pool->pending.next);
+        c42_dlist_del(&req->links);
+        c42_smt_mutex_unlock(pool->smt, pool->mutex);
+        req->ioe = aiopool_exec(pool, req);
+        c42_smt_mutex_lock(pool->smt, pool->mutex);
+        C42_DLIST_APPEND(pool->done, req, links);
+        c42_smt_cond_signal(pool->smt, pool->done_cond);
+    }
+    /* pass the stop request on to the next idle worker */
+    c42_smt_cond_signal(pool->smt, pool->work_cond);
+    c42_smt_mutex_unlock(pool->smt, pool->mutex);
+    return 0;
+}
+
+/* aiopool_submit ***********************************************************/
+static uint_fast8_t C42_CALL aiopool_submit
+(
+    c42_aio_t * aio,
+    c42_aio_req_t * const * req_a,
+    size_t req_n,
+    size_t * accepted
+)
+{
+    c42_aiopool_t * pool = (c42_aiopool_t *) aio;
+    size_t i;
+
+    c42_smt_mutex_lock(pool->smt, pool->mutex);
+    for (i = 0; i < req_n; ++i)
+    {
+        C42_DLIST_APPEND(pool->pending, req_a[i], links);
+        c42_smt_cond_signal(pool->smt, pool->work_cond);
+    }
+    pool->in_flight += req_n;
+    c42_smt_mutex_unlock(pool->smt, pool->mutex);
+    *accepted = req_n;
+    return 0;
+}
+
+/* aiopool_reap *************************************************************/
+static uint_fast8_t C42_CALL aiopool_reap
+(
+    c42_aio_t * aio,
+    c42_aio_req_t * * req_a,
+    size_t min_n,
+    size_t max_n,
+    size_t * reaped
+)
+{
+    c42_aiopool_t * pool = (c42_aiopool_t *) aio;
+    size_t n;
+
+    if (min_n > max_n) min_n = max_n;
+    c42_smt_mutex_lock(pool->smt, pool->mutex);
+    for (n = 0; n < max_n; )
+    {
+        if (c42_dlist_is_empty(&pool->done))
+        {
+            if (n >= min_n || !pool->in_flight) break;
+            c42_smt_cond_wait(pool->smt, pool->done_cond, pool->mutex);
+            continue;
+        }
+        req_a[n] = C42_STRUCT_FROM_FIELD_PTR(c42_aio_req_t, links,
+                                             pool->done.next);
+        c42_dlist_del(&req_a[n]->links);
+        pool->in_flight--;
+        ++n;
+    }
+    c42_smt_mutex_unlock(pool->smt, pool->mutex);
+    *reaped = n;
+    return 0;
+}
+
+/* aiopool_destroy_sync *****************************************************/
+static uint_fast8_t aiopool_destroy_sync
+(
+    c42_aiopool_t * pool
+)
+{
+    uint_fast8_t r = 0;
+    if (pool->done_cond
+        && c42_smt_cond_destroy(pool->done_cond, pool->smt, pool->ma))
+        r = C42_AIO_SMT_ERROR;
+    if (pool->work_cond
+        && c42_smt_cond_destroy(pool->work_cond, pool->smt, pool->ma))
+        r = C42_AIO_SMT_ERROR;
+    if (pool->io_mutex
+        && c42_smt_mutex_destroy(pool->io_mutex, pool->smt, pool->ma))
+        r = C42_AIO_SMT_ERROR;
+    if (pool->mutex
+        && c42_smt_mutex_destroy(pool->mutex, pool->smt, pool->ma))
+        r = C42_AIO_SMT_ERROR;
+    return r;
+}
+
+/* aiopool_stop *************************************************************/
+static uint_fast8_t aiopool_stop
+(
+    c42_aiopool_t * pool
+)
+{
+    uint_fast8_t r = 0;
+    size_t i;
+
+    c42_smt_mutex_lock(pool->smt, pool->mutex);
+    pool->stop = 1;
+    c42_smt_cond_signal(pool->smt, pool->work_cond);
+    c42_smt_mutex_unlock(pool->smt, pool->mutex);
+    for (i = 0; i < pool->thread_n; ++i)
+        if (c42_smt_thread_join(pool->smt, pool->tid_a[i], NULL))
+            r = C42_AIO_SMT_ERROR;
+    C42_MA_ARRAY_FREE(pool->ma, pool->tid_a, pool->thread_n);
+    return r;
+}
+
+/* c42_aiopool_init *********************************************************/
+C42_API uint_fast8_t C42_CALL c42_aiopool_init
+(
+    c42_aiopool_t * pool,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    size_t thread_n
+)
+{
+    size_t n;
+
+    pool->aio.submit = aiopool_submit;
+    pool->aio.reap = aiopool_reap;
+    pool->smt = smt;
+    pool->ma = ma;
+    pool->mutex = pool->io_mutex = NULL;
+    pool->work_cond = pool->done_cond = NULL;
+    c42_dlist_init(&pool->pending);
+    c42_dlist_init(&pool->done);
+    pool->in_flight = 0;
+    pool->stop = 0;
+    if (thread_n == 0) thread_n = 1;
+
+    if (c42_smt_mutex_create(&pool->mutex, smt, ma)
+        || c42_smt_mutex_create(&pool->io_mutex, smt, ma)
+        || c42_smt_cond_create(&pool->work_cond, smt, ma)
+        || c42_smt_cond_create(&pool->done_cond, smt, ma))
+    {
+        aiopool_destroy_sync(pool);
+        return C42_AIO_SMT_ERROR;
+    }
+    pool->tid_a = NULL;
+    if (C42_MA_ARRAY_ALLOC(ma, pool->tid_a, thread_n))
+    {
+        aiopool_destroy_sync(pool);
+        return C42_AIO_NO_MEM;
+    }
+    for (n = 0; n < thread_n; ++n)
+    {
+        if (c42_smt_thread_create(smt, &pool->tid_a[n], aiopool_worker, pool))
+        {
+            pool->thread_n = n;
+            aiopool_stop(pool);
+            aiopool_destroy_sync(pool);
+            return C42_AIO_SMT_ERROR;
+        }
+    }
+    pool->thread_n = thread_n;
+    return 0;
+}
+
+/* c42_aiopool_finish *******************************************************/
+C42_API uint_fast8_t C42_CALL c42_aiopool_finish
+(
+    c42_aiopool_t * pool
+)
+{
+    uint_fast8_t r, rs;
+    r = aiopool_stop(pool);
+    rs = aiopool_destroy_sync(pool);
+    return r ? r : rs;
+}
+
+/* aio_range_prep ***********************************************************/
+/**
+ *  Sets up @a r to read the next chunk of the range, if any is left.
+ */
+static int aio_range_prep
+(
+    c42_aio_req_t * r,
+    size_t chunk_size,
+    uint64_t * next,
+    uint64_t end
+)
+{
+    if (*next >= end) return 0;
+    r->op = C42_AIO_READ;
+    r->offset = *next;
+    r->size = end - *next < chunk_size ? (size_t) (end - *next) : chunk_size;
+    *next += r->size;
+    return 1;
+}
+
+/* c42_aio_read_range *******************************************************/
+C42_API uint_fast8_t C42_CALL c42_aio_read_range
+(
+    c42_aio_t * aio,
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    size_t chunk_size,
+    size_t depth,
+    c42_ma_t * ma,
+    unsigned int flags,
+    c42_aio_chunk_f chunk_func,
+    void * chunk_ctx
+)
+{
+    c42_aio_req_t * req_a = NULL;
+    c42_aio_req_t * * ptr_a = NULL;
+    uint8_t * buf = NULL;
+    c42_aio_req_t * r;
+    uint64_t next, end;
+    size_t i, n, k, q0, queued, in_flight, slot;
+    uint_fast8_t ioe;
+
+    if (!chunk_size || !depth) return C42_IO8_BAD_SIZE;
+    end = offset + size;
+    if (end < offset) end = UINT64_MAX;
+    if (C42_MA_ARRAY_ALLOC(ma, req_a, depth)
+        || C42_MA_ARRAY_ALLOC(ma, ptr_a, depth)
+        || c42_ma_alloc(ma, (void * *) &buf, chunk_size, depth))
+    {
+        ioe = C42_IO8_NO_MEM;
+        goto l_free;
+    }
+
+    /* slot i always reads chunks i, i + depth, i + 2 * depth...; ordered
+     * delivery just walks the slots round-robin */
+    next = offset;
+    for (i = queued = 0; i < depth; ++i)
+    {
+        r = &req_a[i];
+        r->io = io;
+        r->data = buf + i * chunk_size;
+        r->user = 0;
+        if (aio_range_prep(r, chunk_size, &next, end)) ptr_a[queued++] = r;
+    }
+    ioe = 0;
+    in_flight = 0;
+    slot = 0;
+    for (;;)
+    {
+        if (ioe) queued = 0;
+        if (queued)
+        {
+            if (c42_aio_submit(aio, ptr_a, queued, &k)
+                || (!k && !in_flight))
+            {
+                ioe = C42_IO8_OTHER_ERROR;
+                queued = k = 0;
+            }
+            in_flight += k;
+            queued -= k;
+            for (i = 0; i < queued; ++i) ptr_a[i] = ptr_a[k + i];
+        }
+        if (!in_flight) break;
+        if (c42_aio_reap(aio, ptr_a + queued, 1, depth - queued, &n))
+        {
+            /* requests may still use the buffers; leaking them is the only
+             * safe option */
+            return C42_IO8_OTHER_ERROR;
+        }
+        in_flight -= n;
+        q0 = queued;
+        for (k = 0; ; )
+        {
+            if (flags & C42_AIO_ORDERED)
+            {
+                /* req->user marks completed requests not delivered yet */
+                for (; k < n; ++k) ptr_a[q0 + k]->user = 1;
+                r = &req_a[slot];
+                if (!r->user) break;
+                r->user = 0;
+                slot = slot + 1 < depth ? slot + 1 : 0;
+            }
+            else
+            {
+                if (k == n) break;
+                r = ptr_a[q0 + k++];
+            }
+            if (!ioe && r->offset < end)
+            {
+                if (r->ioe == C42_IO8_EOF) end = r->offset + r->done;
+                else ioe = r->ioe;
+                if (!ioe && r->done)
+                    ioe = chunk_func(r->data, r->done, r->offset, chunk_ctx);
+            }
+            /* refills never overtake unread completions at ptr_a + q0 */
+            if (!ioe && aio_range_prep(r, chunk_size, &next, end))
+                ptr_a[queued++] = r;
+        }
+    }
+
+l_free:
+    if (buf) c42_ma_free(ma, buf, chunk_size, depth);
+    if (ptr_a) C42_MA_ARRAY_FREE(ma, ptr_a, depth);
+    if (req_a) C42_MA_ARRAY_FREE(ma, req_a, depth);
+    return ioe;
+}
+
+/* c42_io8_parallel_read ****************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_parallel_read
+(
+    c42_io8_t * io,
+    uint64_t offset,
+    uint64_t size,
+    size_t chunk_size,
+    size_t thread_n,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    unsigned int flags,
+    c42_aio_chunk_f chunk_func,
+    void * chunk_ctx
+)
+{
+    c42_aiopool_t pool;
+    uint_fast8_t ioe, ae;
+
+    if (!thread_n) thread_n = 1;
+    ae = c42_aiopool_init(&pool, smt, ma, thread_n);
+    if (ae) return ae == C42_AIO_NO_MEM ? C42_IO8_NO_MEM : C42_IO8_OTHER_ERROR;
+    ioe = c42_aio_read_range(&pool.aio, io, offset, size, chunk_size,
+                             thread_n * 2, ma, flags, chunk_func, chunk_ctx);
+    ae = c42_aiopool_finish(&pool);
+    if (!ioe && ae) ioe = C42_IO8_OTHER_ERROR;
+    return ioe;
+}
+
+/* pipe_can_read ************************************************************/
+static int pipe_can_read
+(
+    c42_pipe_t * p,
+    size_t need
+)
+{
+    return ATOMIC_LOAD_ACQ(&p->tail) - p->head >= need
+        || ATOMIC_LOAD_ACQ(&p->w_closed);
+}
+
+/* pipe_can_write ***********************************************************/
+static int pipe_can_write
+(
+    c42_pipe_t * p,
+    size_t need
+)
+{
+    return p->size - (p->tail - ATOMIC_LOAD_ACQ(&p->head)) >= need
+        || ATOMIC_LOAD_ACQ(&p->r_closed);
+}
+
+/* pipe_wait ****************************************************************/
+/**
+ *  Blocks the calling side until @a ready returns non-zero.
+ *  The flag is raised before re-checking, so the other side either sees it
+ *  and signals or has already made progress visible to the re-check.
+ */
+static void pipe_wait
+(
+    c42_pipe_t * p,
+    uint8_t volatile * flag,
+    int (* ready) (c42_pipe_t * p, size_t need),
+    size_t need
+)
+{
+    c42_smt_mutex_lock(p->smt, p->mutex);
+    ATOMIC_STORE_RLX(flag, 1);
+    ATOMIC_FENCE();
+    while (!ready(p, need)) c42_smt_cond_wait(p->smt, p->cond, p->mutex);
+    ATOMIC_STORE_RLX(flag, 0);
+    c42_smt_mutex_unlock(p->smt, p->mutex);
+}
+
+/* pipe_wake ****************************************************************/
+static void pipe_wake
+(
+    c42_pipe_t * p,
+    uint8_t volatile * flag
+)
+{
+    ATOMIC_FENCE();
+    if (ATOMIC_LOAD_RLX(flag))
+    {
+        c42_smt_mutex_lock(p->smt, p->mutex);
+        c42_smt_cond_signal(p->smt, p->cond);
+        c42_smt_mutex_unlock(p->smt, p->mutex);
+    }
+}
+
+/* c42_pipe_reserve *********************************************************/
+C42_API uint_fast8_t C42_CALL c42_pipe_reserve
+(
+    c42_pipe_t * p,
+    uint8_t * * ptr,
+    size_t * avail
+)
+{
+    size_t free, pos;
+
+    if (!pipe_can_write(p, 1)) pipe_wait(p, &p->w_wait, pipe_can_write, 1);
+    if (ATOMIC_LOAD_ACQ(&p->r_closed)) return C42_IO8_BROKEN_PIPE;
+    free = p->size - (p->tail - ATOMIC_LOAD_ACQ(&p->head));
+    pos = p->tail & (p->size - 1);
+    if (free > p->size - pos) free = p->size - pos;
+    *ptr = p->data + pos;
+    *avail = free;
+    return 0;
+}
+
+/* c42_pipe_commit **********************************************************/
+C42_API void C42_CALL c42_pipe_commit
+(
+    c42_pipe_t * p,
+    size_t size
+)
+{
+    ATOMIC_STORE_REL(&p->tail, p->tail + size);
+    pipe_wake(p, &p->r_wait);
+}
+
+/* pipe_write ***************************************************************/
+static uint_fast8_t C42_CALL pipe_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_pipe_t * p = (c42_pipe_t *) ctx;
+    uint8_t * ptr;
+    size_t n, w;
+    uint_fast8_t ioe;
+
+    for (w = 0; w < size; w += n)
+    {
+        /* after the first chunk only continue without blocking; this covers
+         * the part that wraps around the ring end */
+        if (w && !pipe_can_write(p, 1)) break;
+        ioe = c42_pipe_reserve(p, &ptr, &n);
+        if (ioe)
+        {
+            *wsize = w;
+            return w ? 0 : ioe;
+        }
+        if (n > size - w) n = size - w;
+        c42_u8a_copy(ptr, data + w, n);
+        c42_pipe_commit(p, n);
+    }
+    *wsize = w;
+    return 0;
+}
+
+/* pipe_peek ****************************************************************/
+static uint_fast8_t C42_CALL pipe_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_pipe_t * p = (c42_pipe_t *) ctx;
+    size_t n, pos, contig, total;
+
+    pos = p->head & (p->size - 1);
+    contig = p->size - pos;
+    /* never wait for more than can be exposed contiguously */
+    n = min_size < contig ? min_size : contig;
+    if (!pipe_can_read(p, n)) pipe_wait(p, &p->r_wait, pipe_can_read, n);
+    total = ATOMIC_LOAD_ACQ(&p->tail) - p->head;
+    n = total < contig ? total : contig;
+    if (n < min_size && (total > n || !ATOMIC_LOAD_ACQ(&p->w_closed)))
+        return C42_IO8_TOO_BIG;
+    *ptr = p->data + pos;
+    *avail = n;
+    return 0;
+}
+
+/* pipe_consume *************************************************************/
+static uint_fast8_t C42_CALL pipe_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_pipe_t * p = (c42_pipe_t *) ctx;
+    if (size > ATOMIC_LOAD_ACQ(&p->tail) - p->head) return C42_IO8_BAD_SIZE;
+    ATOMIC_STORE_REL(&p->head, p->head + size);
+    pipe_wake(p, &p->w_wait);
+    return 0;
+}
+
+/* pipe_read ****************************************************************/
+static uint_fast8_t C42_CALL pipe_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_pipe_t * p = (c42_pipe_t *) ctx;
+    uint8_t const * ptr;
+    size_t n, r;
+
+    for (r = 0; r < size; r += n)
+    {
+        if (r && ATOMIC_LOAD_ACQ(&p->tail) == p->head) break;
+        pipe_peek(ctx, 1, &ptr, &n);
+        if (n == 0) break;
+        if (n > size - r) n = size - r;
+        c42_u8a_copy(data + r, ptr, n);
+        pipe_consume(ctx, n);
+    }
+    *rsize = r;
+    return 0;
+}
+
+/* pipe_close ***************************************************************/
+static uint_fast8_t C42_CALL pipe_close
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_pipe_t * p = (c42_pipe_t *) ctx;
+    c42_smt_mutex_lock(p->smt, p->mutex);
+    if ((mode & C42_IO8_OP_READ)) ATOMIC_STORE_REL(&p->r_closed, 1);
+    if ((mode & C42_IO8_OP_WRITE)) ATOMIC_STORE_REL(&p->w_closed, 1);
+    c42_smt_cond_signal(p->smt, p->cond);
+    c42_smt_mutex_unlock(p->smt, p->mutex);
+    return 0;
+}
+
+/* pipe_rclose **************************************************************/
+static uint_fast8_t C42_CALL pipe_rclose
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    return pipe_close(ctx, mode & C42_IO8_OP_READ);
+}
+
+/* pipe_wclose **************************************************************/
+static uint_fast8_t C42_CALL pipe_wclose
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    return pipe_close(ctx, mode & C42_IO8_OP_WRITE);
+}
+
+/* pipe_reader_class ********************************************************/
+static c42_io8_class_t pipe_reader_class =
+{
+    pipe_read,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    pipe_rclose,
+    NULL,
+    NULL,
+    pipe_peek,
+    pipe_consume,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0
+};
+
+/* pipe_writer_class ********************************************************/
+static c42_io8_class_t pipe_writer_class =
+{
+    NULL,
+    pipe_write,
+    NULL,
+    NULL,
+    NULL,
+    pipe_wclose,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0
+};
+
+/* c42_pipe_init ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_pipe_init
+(
+    c42_pipe_t * pipe,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    size_t size
+)
+{
+    size_t sz;
+
+    for (sz = 0x100; sz < size; sz <<= 1)
+        if ((sz << 1) == 0) return C42_PIPE_TOO_BIG;
+    pipe->reader.io8_class = &pipe_reader_class;
+    pipe->reader.context = (uintptr_t) pipe;
+    pipe->writer.io8_class = &pipe_writer_class;
+    pipe->writer.context = (uintptr_t) pipe;
+    pipe->smt = smt;
+    pipe->ma = ma;
+    pipe->size = sz;
+    pipe->head = pipe->tail = 0;
+    pipe->r_wait = pipe->w_wait = 0;
+    pipe->r_closed = pipe->w_closed = 0;
+    pipe->data = NULL;
+    if (C42_MA_ARRAY_ALLOC(ma, pipe->data, sz)) return C42_PIPE_NO_MEM;
+    if (c42_smt_mutex_create(&pipe->mutex, smt, ma))
+    {
+        C42_MA_ARRAY_FREE(ma, pipe->data, sz);
+        return C42_PIPE_SMT_ERROR;
+    }
+    if (c42_smt_cond_create(&pipe->cond, smt, ma))
+    {
+        c42_smt_mutex_destroy(pipe->mutex, smt, ma);
+        C42_MA_ARRAY_FREE(ma, pipe->data, sz);
+        return C42_PIPE_SMT_ERROR;
+    }
+    return 0;
+}
+
+/* c42_pipe_finish **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_pipe_finish
+(
+    c42_pipe_t * pipe
+)
+{
+    uint_fast8_t r = 0;
+    if (c42_smt_cond_destroy(pipe->cond, pipe->smt, pipe->ma))
+        r = C42_PIPE_SMT_ERROR;
+    if (c42_smt_mutex_destroy(pipe->mutex, pipe->smt, pipe->ma))
+        r = C42_PIPE_SMT_ERROR;
+    C42_MA_ARRAY_FREE(pipe->ma, pipe->data, pipe->size);
+    return r;
+}
+
+/* lz_get32 *****************************************************************/
+static uint32_t lz_get32
+(
+    uint8_t const * p
+)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8)
+        | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* lz_put32 *****************************************************************/
+static void lz_put32
+(
+    uint8_t * p,
+    uint32_t v
+)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+/* lz_hash ******************************************************************/
+static uint32_t lz_hash
+(
+    uint32_t v
+)
+{
+    return (v * 2654435761U) >> (32 - C42_LZ_HASH_LOG);
+}
+
+/* lz_put_len ***************************************************************/
+static uint8_t * lz_put_len
+(
+    uint8_t * op,
+    size_t n
+)
+{
+    for (; n >= 255; n -= 255) *op++ = 255;
+    *op++ = (uint8_t) n;
+    return op;
+}
+
+/* lz_put_seq ***************************************************************/
+/**
+ *  Writes one sequence: literals followed by a match.
+ *  A match length of 0 writes a literal-only (last) sequence.
+ *  Returns NULL if the output does not fit.
+ */
+static uint8_t * lz_put_seq
+(
+    uint8_t * op,
+    uint8_t * oend,
+    uint8_t const * lit,
+    size_t lit_len,
+    size_t offset,
+    size_t match_len
+)
+{
+    uint8_t * tok;
+    size_t ml;
+
+    /* token + literal len ext + literals + offset + match len ext */
+    if ((size_t) (oend - op) < lit_len + lit_len / 255 + match_len / 255 + 5)
+        return NULL;
+    tok = op++;
+    if (lit_len >= 15)
+    {
+        *tok = 0xF0;
+        op = lz_put_len(op, lit_len - 15);
+    }
+    else *tok = (uint8_t) (lit_len << 4);
+    c42_u8a_copy(op, lit, lit_len);
+    op += lit_len;
+    if (!match_len) return op;
+    *op++ = (uint8_t) offset;
+    *op++ = (uint8_t) (offset >> 8);
+    ml = match_len - 4;
+    if (ml >= 15)
+    {
+        *tok |= 15;
+        op = lz_put_len(op, ml - 15);
+    }
+    else *tok |= (uint8_t) ml;
+    return op;
+}
+
+/* c42_lz_compress_block ****************************************************/
+C42_API size_t C42_CALL c42_lz_compress_block
+(
+    uint8_t const * src,
+    size_t len,
+    uint8_t * dst,
+    size_t cap,
+    uint32_t * table
+)
+{
+    uint8_t const * ip = src;
+    uint8_t const * anchor = src;
+    uint8_t const * end = src + len;
+    uint8_t const * ref;
+    uint8_t const * m;
+    uint8_t * op = dst;
+    uint8_t * oend = dst + cap;
+    size_t i, miss;
+    uint32_t v, h;
+
+    /* matches start at least 12 bytes before the end and leave the last
+     * 5 bytes as literals, so 4-byte reads never pass the end */
+    if (len > 12)
+    {
+        uint8_t const * mflimit = end - 12;
+        uint8_t const * mlimit = end - 5;
+
+        for (i = 0; i < (1 << C42_LZ_HASH_LOG); ++i) table[i] = 0;
+        for (miss = 0; ip < mflimit; )
+        {
+            v = lz_get32(ip);
+            h = lz_hash(v);
+            ref = src + table[h];
+            table[h] = (uint32_t) (ip - src);
+            if (ref >= ip || ip - ref > 0xFFFF || lz_get32(ref) != v)
+            {
+                /* skip faster through incompressible data */
+                ip += 1 + (miss++ >> 6);
+                continue;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                --ip;
+                --ref;
+            }
+            for (m = ip + 4, ref += 4; m < mlimit && *m == *ref; ++m, ++ref);
+            op = lz_put_seq(op, oend, anchor, (size_t) (ip - anchor),
+                            (size_t) (m - ref), (size_t) (m - ip));
+            if (!op) return 0;
+            anchor = ip = m;
+            miss = 0;
+            if (ip < mflimit)
+                table[lz_hash(lz_get32(ip - 2))] = (uint32_t) (ip - 2 - src);
+        }
+    }
+    op = lz_put_seq(op, oend, anchor, (size_t) (end - anchor), 0, 0);
+    return op ? (size_t) (op - dst) : 0;
+}
+
+/* lz_get_len ***************************************************************/
+static uint_fast8_t lz_get_len
+(
+    uint8_t const * * ipp,
+    uint8_t const * iend,
+    size_t * len
+)
+{
+    uint8_t const * ip = *ipp;
+    uint8_t b;
+    do
+    {
+        if (ip == iend) return C42_CLCONV_MALFORMED;
+        b = *ip++;
+        *len += b;
+    }
+    while (b == 255);
+    *ipp = ip;
+    return 0;
+}
+
+/* c42_lz_decompress_block **************************************************/
+C42_API uint_fast8_t C42_CALL c42_lz_decompress_block
+(
+    uint8_t const * src,
+    size_t len,
+    uint8_t * dst,
+    size_t cap,
+    size_t * out_len
+)
+{
+    uint8_t const * ip = src;
+    uint8_t const * iend = src + len;
+    uint8_t const * ref;
+    uint8_t * op = dst;
+    uint8_t * oend = dst + cap;
+    size_t lit, ml, offset, i;
+    uint8_t tok;
+
+    for (;;)
+    {
+        if (ip == iend) return C42_CLCONV_MALFORMED;
+        tok = *ip++;
+        lit = tok >> 4;
+        if (lit == 15 && lz_get_len(&ip, iend, &lit))
+            return C42_CLCONV_MALFORMED;
+        if (lit > (size_t) (iend - ip) || lit > (size_t) (oend - op))
+            return C42_CLCONV_MALFORMED;
+        c42_u8a_copy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) break;
+        if (iend - ip < 2) return C42_CLCONV_MALFORMED;
+        offset = ip[0] | ((size_t) ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - dst))
+            return C42_CLCONV_MALFORMED;
+        ml = tok & 15;
+        if (ml == 15 && lz_get_len(&ip, iend, &ml))
+            return C42_CLCONV_MALFORMED;
+        ml += 4;
+        if (ml > (size_t) (oend - op)) return C42_CLCONV_MALFORMED;
+        ref = op - offset;
+        if (offset >= ml) c42_u8a_copy(op, ref, ml);
+        else for (i = 0; i < ml; ++i) op[i] = ref[i];
+        op += ml;
+    }
+    *out_len = (size_t) (op - dst);
+    return 0;
+}
+
+/* c42_lz_enc_init **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_lz_enc_init
+(
+    c42_lz_enc_t * enc,
+    c42_ma_t * ma,
+    unsigned int block_log
+)
+{
+    size_t bs;
+
+    if (block_log < C42_LZ_BLOCK_LOG_MIN || block_log > C42_LZ_BLOCK_LOG_MAX)
+        return C42_LZ_BAD_BLOCK_LOG;
+    bs = (size_t) 1 << block_log;
+    enc->ma = ma;
+    enc->block_size = bs;
+    enc->in = enc->out = NULL;
+    enc->table = NULL;
+    if (C42_MA_ARRAY_ALLOC(ma, enc->in, bs)) return C42_LZ_NO_MEM;
+    if (C42_MA_ARRAY_ALLOC(ma, enc->out, bs + C42_LZ_BLOCK_HEADER_SIZE))
+    {
+        C42_MA_ARRAY_FREE(ma, enc->in, bs);
+        return C42_LZ_NO_MEM;
+    }
+    if (C42_MA_ARRAY_ALLOC(ma, enc->table, 1 << C42_LZ_HASH_LOG))
+    {
+        C42_MA_ARRAY_FREE(ma, enc->out, bs + C42_LZ_BLOCK_HEADER_SIZE);
+        C42_MA_ARRAY_FREE(ma, enc->in, bs);
+        return C42_LZ_NO_MEM;
+    }
+    c42_u8a_copy(enc->out, (uint8_t const *) "C42LZ", 5);
+    enc->out[5] = (uint8_t) block_log;
+    enc->out_pos = 0;
+    enc->out_len = C42_LZ_STREAM_HEADER_SIZE;
+    enc->in_len = 0;
+    enc->ended = 0;
+    return 0;
+}
+
+/* c42_lz_enc_finish ********************************************************/
+C42_API void C42_CALL c42_lz_enc_finish
+(
+    c42_lz_enc_t * enc
+)
+{
+    C42_MA_ARRAY_FREE(enc->ma, enc->table, 1 << C42_LZ_HASH_LOG);
+    C42_MA_ARRAY_FREE(enc->ma, enc->out,
+                      enc->block_size + C42_LZ_BLOCK_HEADER_SIZE);
+    C42_MA_ARRAY_FREE(enc->ma, enc->in, enc->block_size);
+}
+
+/* lz_enc_block *************************************************************/
+static void lz_enc_block
+(
+    c42_lz_enc_t * enc
+)
+{
+    size_t n = enc->in_len;
+    uint8_t * body = enc->out + C42_LZ_BLOCK_HEADER_SIZE;
+    size_t z;
+
+    /* store the block raw unless compression saves at least one byte */
+    z = c42_lz_compress_block(enc->in, n, body, n - 1, enc->table);
+    if (z) lz_put32(enc->out, (uint32_t) z);
+    else
+    {
+        c42_u8a_copy(body, enc->in, n);
+        z = n;
+        lz_put32(enc->out, (uint32_t) z | C42_LZ_RAW_FLAG);
+    }
+    lz_put32(enc->out + 4, (uint32_t) n);
+    enc->out_pos = 0;
+    enc->out_len = z + C42_LZ_BLOCK_HEADER_SIZE;
+    enc->in_len = 0;
+}
+
+/* c42_clconv_lz_encode *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_lz_encode
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    c42_lz_enc_t * enc = ctx;
+    uint_fast8_t r = C42_CLCONV_OK;
+    size_t i = 0, o = 0, n;
+
+    for (;;)
+    {
+        if (enc->out_pos < enc->out_len)
+        {
+            n = enc->out_len - enc->out_pos;
+            if (n > out_len - o) n = out_len - o;
+            c42_u8a_copy(out + o, enc->out + enc->out_pos, n);
+            o += n;
+            enc->out_pos += n;
+            if (enc->out_pos < enc->out_len) { r = C42_CLCONV_FULL; break; }
+        }
+        if (in)
+        {
+            if (i == in_len) break;
+            n = enc->block_size - enc->in_len;
+            if (n > in_len - i) n = in_len - i;
+            c42_u8a_copy(enc->in + enc->in_len, in + i, n);
+            i += n;
+            enc->in_len += n;
+            if (enc->in_len == enc->block_size) lz_enc_block(enc);
+        }
+        else
+        {
+            if (enc->ended) break;
+            if (enc->in_len) lz_enc_block(enc);
+            else
+            {
+                lz_put32(enc->out, 0);
+                enc->out_pos = 0;
+                enc->out_len = 4;
+                enc->ended = 1;
+            }
+        }
+    }
+    *in_used_len = i;
+    *out_used_len = o;
+    return r;
+}
+
+#define LZ_DEC_MAGIC 0
+#define LZ_DEC_BHDR 1
+#define LZ_DEC_BODY 2
+#define LZ_DEC_END 3
+#define LZ_DEC_BAD 4
+
+/* c42_lz_dec_init **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_lz_dec_init
+(
+    c42_lz_dec_t * dec,
+    c42_ma_t * ma,
+    unsigned int max_block_log
+)
+{
+    size_t bs;
+
+    if (max_block_log < C42_LZ_BLOCK_LOG_MIN
+        || max_block_log > C42_LZ_BLOCK_LOG_MAX)
+        return C42_LZ_BAD_BLOCK_LOG;
+    bs = (size_t) 1 << max_block_log;
+    dec->ma = ma;
+    dec->buf_size = bs;
+    dec->in = dec->out = NULL;
+    if (C42_MA_ARRAY_ALLOC(ma, dec->in, bs)) return C42_LZ_NO_MEM;
+    if (C42_MA_ARRAY_ALLOC(ma, dec->out, bs))
+    {
+        C42_MA_ARRAY_FREE(ma, dec->in, bs);
+        return C42_LZ_NO_MEM;
+    }
+    dec->block_size = 0;
+    dec->state = LZ_DEC_MAGIC;
+    dec->need = C42_LZ_STREAM_HEADER_SIZE;
+    dec->have = 0;
+    dec->out_pos = dec->out_len = 0;
+    dec->stored = dec->raw_len = 0;
+    return 0;
+}
+
+/* c42_lz_dec_finish ********************************************************/
+C42_API void C42_CALL c42_lz_dec_finish
+(
+    c42_lz_dec_t * dec
+)
+{
+    C42_MA_ARRAY_FREE(dec->ma, dec->out, dec->buf_size);
+    C42_MA_ARRAY_FREE(dec->ma, dec->in, dec->buf_size);
+}
+
+/* lz_dec_step **************************************************************/
+/**
+ *  Processes the item collected for the current state.
+ */
+static uint_fast8_t lz_dec_step
+(
+    c42_lz_dec_t * dec
+)
+{
+    uint32_t z;
+    size_t n;
+
+    switch (dec->state)
+    {
+    case LZ_DEC_MAGIC:
+        if (!C42_U8A_EQLIT(dec->hdr, "C42LZ")
+            || dec->hdr[5] < C42_LZ_BLOCK_LOG_MIN
+            || ((size_t) 1 << dec->hdr[5]) > dec->buf_size)
+            return C42_CLCONV_MALFORMED;
+        dec->block_size = (size_t) 1 << dec->hdr[5];
+        dec->state = LZ_DEC_BHDR;
+        dec->need = 4;
+        break;
+    case LZ_DEC_BHDR:
+        if (dec->need == 4)
+        {
+            dec->stored = lz_get32(dec->hdr);
+            if (dec->stored) dec->need = C42_LZ_BLOCK_HEADER_SIZE;
+            else dec->state = LZ_DEC_END;
+            return 0;
+        }
+        dec->raw_len = lz_get32(dec->hdr + 4);
+        z = dec->stored & ~(uint32_t) C42_LZ_RAW_FLAG;
+        if (dec->raw_len == 0 || dec->raw_len > dec->block_size || z == 0
+            || ((dec->stored & C42_LZ_RAW_FLAG) ? z != dec->raw_len
+                                                : z >= dec->raw_len))
+            return C42_CLCONV_MALFORMED;
+        dec->state = LZ_DEC_BODY;
+        dec->need = z;
+        break;
+    case LZ_DEC_BODY:
+        if ((dec->stored & C42_LZ_RAW_FLAG)) n = dec->need;
+        else if (c42_lz_decompress_block(dec->in, dec->need,
+                                         dec->out, dec->raw_len, &n)
+                 || n != dec->raw_len)
+            return C42_CLCONV_MALFORMED;
+        dec->out_pos = 0;
+        dec->out_len = n;
+        dec->state = LZ_DEC_BHDR;
+        dec->need = 4;
+        break;
+    }
+    dec->have = 0;
+    return 0;
+}
+
+/* c42_clconv_lz_decode *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_clconv_lz_decode
+(
+    uint8_t const * in,
+    size_t in_len,
+    size_t * in_used_len,
+    uint8_t * out,
+    size_t out_len,
+    size_t * out_used_len,
+    void * ctx
+)
+{
+    c42_lz_dec_t * dec = ctx;
+    uint_fast8_t r = C42_CLCONV_OK;
+    size_t i = 0, o = 0, n;
+    uint8_t * dst;
+
+    for (;;)
+    {
+        if (dec->out_pos < dec->out_len)
+        {
+            n = dec->out_len - dec->out_pos;
+            if (n > out_len - o) n = out_len - o;
+            c42_u8a_copy(out + o, dec->out + dec->out_pos, n);
+            o += n;
+            dec->out_pos += n;
+            if (dec->out_pos < dec->out_len) { r = C42_CLCONV_FULL; break; }
+        }
+        if (dec->state == LZ_DEC_BAD) { r = C42_CLCONV_MALFORMED; break; }
+        if (!in)
+        {
+            if (dec->state != LZ_DEC_END) r = C42_CLCONV_INCOMPLETE;
+            break;
+        }
+        if (i == in_len) break;
+        if (dec->state == LZ_DEC_END) { r = C42_CLCONV_MALFORMED; break; }
+        if (dec->state != LZ_DEC_BODY) dst = dec->hdr;
+        else if ((dec->stored & C42_LZ_RAW_FLAG)) dst = dec->out;
+        else dst = dec->in;
+        n = dec->need - dec->have;
+        if (n > in_len - i) n = in_len - i;
+        c42_u8a_copy(dst + dec->have, in + i, n);
+        i += n;
+        dec->have += n;
+        if (dec->have == dec->need && lz_dec_step(dec))
+            dec->state = LZ_DEC_BAD;
+    }
+    *in_used_len = i;
+    *out_used_len = o;
+    return r;
+}
+
+/* io8lz_write **************************************************************/
+static uint_fast8_t C42_CALL io8lz_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8lz_t * lz = (c42_io8lz_t *) ctx;
+    size_t w, iu, ou, n;
+    uint_fast8_t r, ioe;
+
+    for (w = 0;; )
+    {
+        r = c42_clconv_lz_encode(data + w, size - w, &iu,
+                                 lz->buf, sizeof(lz->buf), &ou, &lz->lz.enc);
+        w += iu;
+        if (ou)
+        {
+            ioe = c42_io8_write_full(lz->io, lz->buf, ou, &n);
+            if (ioe) { *wsize = w; return ioe; }
+        }
+        if (r == C42_CLCONV_OK) break;
+    }
+    *wsize = w;
+    return 0;
+}
+
+/* io8lz_wclose *************************************************************/
+static uint_fast8_t C42_CALL io8lz_wclose
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_io8lz_t * lz = (c42_io8lz_t *) ctx;
+    size_t iu, ou, n;
+    uint_fast8_t r, ioe;
+
+    if ((mode & C42_IO8_OP_WRITE))
+    {
+        do
+        {
+            r = c42_clconv_lz_encode(NULL, 0, &iu, lz->buf, sizeof(lz->buf),
+                                     &ou, &lz->lz.enc);
+            if (ou)
+            {
+                ioe = c42_io8_write_full(lz->io, lz->buf, ou, &n);
+                if (ioe) return ioe;
+            }
+        }
+        while (r != C42_CLCONV_OK);
+    }
+    return c42_io8_close(lz->io, mode);
+}
+
+/* io8lz_read ***************************************************************/
+static uint_fast8_t C42_CALL io8lz_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8lz_t * lz = (c42_io8lz_t *) ctx;
+    size_t o = 0, iu, ou, n;
+    uint_fast8_t r, ioe;
+
+    while (o < size)
+    {
+        if (lz->buf_pos == lz->buf_len && !lz->eof)
+        {
+            ioe = c42_io8_read(lz->io, lz->buf, sizeof(lz->buf), &n);
+            if (ioe)
+            {
+                if (o) break;
+                return ioe;
+            }
+            lz->buf_pos = 0;
+            lz->buf_len = n;
+            lz->eof = (n == 0);
+        }
+        r = c42_clconv_lz_decode(lz->eof ? NULL : lz->buf + lz->buf_pos,
+                                 lz->buf_len - lz->buf_pos, &iu,
+                                 data + o, size - o, &ou, &lz->lz.dec);
+        lz->buf_pos += iu;
+        o += ou;
+        if (r == C42_CLCONV_MALFORMED || r == C42_CLCONV_INCOMPLETE)
+        {
+            if (o) break;
+            return C42_IO8_BAD_DATA;
+        }
+        /* do not block on the underlying stream once something is decoded */
+        if (lz->eof || (o && lz->buf_pos == lz->buf_len)) break;
+    }
+    *rsize = o;
+    return 0;
+}
+
+/* io8lz_rclose *************************************************************/
+static uint_fast8_t C42_CALL io8lz_rclose
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_io8lz_t * lz = (c42_io8lz_t *) ctx;
+    return c42_io8_close(lz->io, mode);
+}
+
+/* io8lz_writer_class *******************************************************/
+static c42_io8_class_t io8lz_writer_class =
+{
+    NULL,
+    io8lz_write,
+    NULL,
+    NULL,
+    NULL,
+    io8lz_wclose,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0
+};
+
+/* io8lz_reader_class *******************************************************/
+static c42_io8_class_t io8lz_reader_class =
+{
+    io8lz_read,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    io8lz_rclose,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0
+};
+
+/* c42_io8lz_writer_init ****************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8lz_writer_init
+(
+    c42_io8lz_t * lz,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int block_log
+)
+{
+    lz->io8.io8_class = &io8lz_writer_class;
+    lz->io8.context = (uintptr_t) lz;
+    lz->io = io;
+    lz->buf_pos = lz->buf_len = 0;
+    lz->eof = 0;
+    return c42_lz_enc_init(&lz->lz.enc, ma, block_log);
+}
+
+/* c42_io8lz_reader_init ****************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8lz_reader_init
+(
+    c42_io8lz_t * lz,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int max_block_log
+)
+{
+    lz->io8.io8_class = &io8lz_reader_class;
+    lz->io8.context = (uintptr_t) lz;
+    lz->io = io;
+    lz->buf_pos = lz->buf_len = 0;
+    lz->eof = 0;
+    return c42_lz_dec_init(&lz->lz.dec, ma, max_block_log);
+}
+
+/* c42_io8lz_finish *********************************************************/
+C42_API void C42_CALL c42_io8lz_finish
+(
+    c42_io8lz_t * lz
+)
+{
+    if (lz->io8.io8_class == &io8lz_writer_class)
+        c42_lz_enc_finish(&lz->lz.enc);
+    else c42_lz_dec_finish(&lz->lz.dec);
+}
+
+/* c42_io8_line_reader_init *************************************************/
+C42_API void C42_CALL c42_io8_line_reader_init
+(
+    c42_io8_line_reader_t * lr,
+    c42_io8_t * io,
+    c42_ma_t * ma,
+    unsigned int flags,
+    size_t max_len
+)
+{
+    lr->io = io;
+    lr->ma = ma;
+    lr->buf = NULL;
+    lr->buf_size = 0;
+    lr->pending = 0;
+    lr->max_len = max_len;
+    lr->flags = flags;
+    lr->skip = 0;
+}
+
+/* c42_io8_line_reader_finish ***********************************************/
+C42_API void C42_CALL c42_io8_line_reader_finish
+(
+    c42_io8_line_reader_t * lr
+)
+{
+    if (lr->buf_size) C42_MA_ARRAY_FREE(lr->ma, lr->buf, lr->buf_size);
+    lr->buf = NULL;
+    lr->buf_size = 0;
+}
+
+/* c42_io8_line_read ********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8_line_read
+(
+    c42_io8_line_reader_t * lr,
+    c42_u8an_t * line
+)
+{
+    uint8_t const * p;
+    uint8_t const * q;
+    size_t n, m, i, len, cap;
+    uint_fast8_t ioe, eol;
+
+    if (lr->pending)
+    {
+        ioe = c42_io8_consume(lr->io, lr->pending);
+        if (ioe) return ioe;
+        lr->pending = 0;
+    }
+    for (len = 0;; )
+    {
+        ioe = c42_io8_peek(lr->io, 1, &p, &n);
+        if (ioe) return ioe;
+        if (n == 0)
+        {
+            lr->skip = 0;
+            if (len == 0) return C42_IO8_EOF;
+            line->a = lr->buf;
+            break;
+        }
+        i = c42_u8a_scan(p, n, '\n');
+        eol = i < n;
+        while (!eol && !lr->skip && len == 0)
+        {
+            /* try to widen the window before copying anything */
+            ioe = c42_io8_peek(lr->io, n + 1, &q, &m);
+            if (ioe == C42_IO8_TOO_BIG)
+            {
+                ioe = c42_io8_peek(lr->io, 1, &p, &n);
+                if (ioe) return ioe;
+                i = c42_u8a_scan(p, n, '\n');
+                eol = i < n;
+                break;
+            }
+            if (ioe) return ioe;
+            p = q;
+            eol = (m == n); /* end of file */
+            if (eol) break;
+            i = n + c42_u8a_scan(p + n, m - n, '\n');
+            n = m;
+            eol = i < n;
+        }
+        if (lr->skip)
+        {
+            /* drop the rest of a line that was too long */
+            if (i < n) lr->skip = 0;
+            ioe = c42_io8_consume(lr->io, i < n ? i + 1 : n);
+            if (ioe) return ioe;
+            continue;
+        }
+        if (lr->max_len && i > lr->max_len - len)
+        {
+            lr->skip = 1;
+            return C42_IO8_TOO_BIG;
+        }
+        if (eol && len == 0)
+        {
+            /* whole line inside the window: return it in place */
+            line->a = (uint8_t *) p;
+            len = i;
+            lr->pending = i < n ? i + 1 : i;
+            break;
+        }
+        if (len + i > lr->buf_size)
+        {
+            for (cap = lr->buf_size ? lr->buf_size : 0x100; cap < len + i;
+                 cap <<= 1);
+            if (C42_MA_ARRAY_REALLOC(lr->ma, lr->buf, lr->buf_size, cap))
+            {
+                lr->skip = 1;
+                return C42_IO8_NO_MEM;
+            }
+            lr->buf_size = cap;
+        }
+        c42_u8a_copy(lr->buf + len, p, i);
+        len += i;
+        ioe = c42_io8_consume(lr->io, i < n ? i + 1 : n);
+        if (ioe) return ioe;
+        if (eol)
+        {
+            line->a = lr->buf;
+            break;
+        }
+    }
+    if ((lr->flags & C42_LINE_STRIP_CR) && len && line->a[len - 1] == '\r')
+        --len;
+    line->n = len;
+    return 0;
+}
+
+#if __SSE4_2__ && __x86_64__
+#define CRC32C_HW 1
+#else
+#define CRC32C_HW 0
+
+/* crc32c_table *************************************************************/
+/* slice-by-8 tables for the reflected Castagnoli polynomial 0x82F63B78 */
+static uint32_t const crc32c_table[8][256] =
+{
+    {
+        0x00000000, 0xF26B8303, 0xE13B70F7, 0x1350F3F4, 0xC79A971F, 0x35F1141C,
+        0x26A1E7E8, 0xD4CA64EB, 0x8AD958CF, 0x78B2DBCC, 0x6BE22838, 0x9989AB3B,
+        0x4D43CFD0, 0xBF284CD3, 0xAC78BF27, 0x5E133C24, 0x105EC76F, 0xE235446C,
+        0xF165B798, 0x030E349B, 0xD7C45070, 0x25AFD373, 0x36FF2087, 0xC494A384,
+        0x9A879FA0, 0x68EC1CA3, 0x7BBCEF57, 0x89D76C54, 0x5D1D08BF, 0xAF768BBC,
+        0xBC267848, 0x4E4DFB4B, 0x20BD8EDE, 0xD2D60DDD, 0xC186FE29, 0x33ED7D2A,
+        0xE72719C1, 0x154C9AC2, 0x061C6936, 0xF477EA35, 0xAA64D611, 0x580F5512,
+        0x4B5FA6E6, 0xB93425E5, 0x6DFE410E, 0x9F95C20D, 0x8CC531F9, 0x7EAEB2FA,
+        0x30E349B1, 0xC288CAB2, 0xD1D83946, 0x23B3BA45, 0xF779DEAE, 0x05125DAD,
+        0x1642AE59, 0xE4292D5A, 0xBA3A117E, 0x4851927D, 0x5B016189, 0xA96AE28A,
+        0x7DA08661, 0x8FCB0562, 0x9C9BF696, 0x6EF07595, 0x417B1DBC, 0xB3109EBF,
+        0xA0406D4B, 0x522BEE48, 0x86E18AA3, 0x748A09A0, 0x67DAFA54, 0x95B17957,
+        0xCBA24573, 0x39C9C670, 0x2A993584, 0xD8F2B687, 0x0C38D26C, 0xFE53516F,
+        0xED03A29B, 0x1F682198, 0x5125DAD3, 0xA34E59D0, 0xB01EAA24, 0x42752927,
+        0x96BF4DCC, 0x64D4CECF, 0x77843D3B, 0x85EFBE38, 0xDBFC821C, 0x2997011F,
+        0x3AC7F2EB, 0xC8AC71E8, 0x1C661503, 0xEE0D9600, 0xFD5D65F4, 0x0F36E6F7,
+        0x61C69362, 0x93AD1061, 0x80FDE395, 0x72966096, 0xA65C047D, 0x5437877E,
+        0x4767748A, 0xB50CF789, 0xEB1FCBAD, 0x197448AE, 0x0A24BB5A, 0xF84F3859,
+        0x2C855CB2, 0xDEEEDFB1, 0xCDBE2C45, 0x3FD5AF46, 0x7198540D, 0x83F3D70E,
+        0x90A324FA, 0x62C8A7F9, 0xB602C312, 0x44694011, 0x5739B3E5, 0xA55230E6,
+        0xFB410CC2, 0x092A8FC1, 0x1A7A7C35, 0xE811FF36, 0x3CDB9BDD, 0xCEB018DE,
+        0xDDE0EB2A, 0x2F8B6829, 0x82F63B78, 0x709DB87B, 0x63CD4B8F, 0x91A6C88C,
+        0x456CAC67, 0xB7072F64, 0xA457DC90, 0x563C5F93, 0x082F63B7, 0xFA44E0B4,
+        0xE9141340, 0x1B7F9043, 0xCFB5F4A8, 0x3DDE77AB, 0x2E8E845F, 0xDCE5075C,
+        0x92A8FC17, 0x60C37F14, 0x73938CE0, 0x81F80FE3, 0x55326B08, 0xA759E80B,
+        0xB4091BFF, 0x466298FC, 0x1871A4D8, 0xEA1A27DB, 0xF94AD42F, 0x0B21572C,
+        0xDFEB33C7, 0x2D80B0C4, 0x3ED04330, 0xCCBBC033, 0xA24BB5A6, 0x502036A5,
+        0x4370C551, 0xB11B4652, 0x65D122B9, 0x97BAA1BA, 0x84EA524E, 0x7681D14D,
+        0x2892ED69, 0xDAF96E6A, 0xC9A99D9E, 0x3BC21E9D, 0xEF087A76, 0x1D63F975,
+        0x0E330A81, 0xFC588982, 0xB21572C9, 0x407EF1CA, 0x532E023E, 0xA145813D,
+        0x758FE5D6, 0x87E466D5, 0x94B49521, 0x66DF1622, 0x38CC2A06, 0xCAA7A905,
+        0xD9F75AF1, 0x2B9CD9F2, 0xFF56BD19, 0x0D3D3E1A, 0x1E6DCDEE, 0xEC064EED,
+        0xC38D26C4, 0x31E6A5C7, 0x22B65633, 0xD0DDD530, 0x0417B1DB, 0xF67C32D8,
+        0xE52CC12C, 0x1747422F, 0x49547E0B, 0xBB3FFD08, 0xA86F0EFC, 0x5A048DFF,
+        0x8ECEE914, 0x7CA56A17, 0x6FF599E3, 0x9D9E1AE0, 0xD3D3E1AB, 0x21B862A8,
+        0x32E8915C, 0xC083125F, 0x144976B4, 0xE622F5B7, 0xF5720643, 0x07198540,
+        0x590AB964, 0xAB613A67, 0xB831C993, 0x4A5A4A90, 0x9E902E7B, 0x6CFBAD78,
+        0x7FAB5E8C, 0x8DC0DD8F, 0xE330A81A, 0x115B2B19, 0x020BD8ED, 0xF0605BEE,
+        0x24AA3F05, 0xD6C1BC06, 0xC5914FF2, 0x37FACCF1, 0x69E9F0D5, 0x9B8273D6,
+        0x88D28022, 0x7AB90321, 0xAE7367CA, 0x5C18E4C9, 0x4F48173D, 0xBD23943E,
+        0xF36E6F75, 0x0105EC76, 0x12551F82, 0xE03E9C81, 0x34F4F86A, 0xC69F7B69,
+        0xD5CF889D, 0x27A40B9E, 0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
+        0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351
+    },
+    {
+        0x00000000, 0x13A29877, 0x274530EE, 0x34E7A899, 0x4E8A61DC, 0x5D28F9AB,
+        0x69CF5132, 0x7A6DC945, 0x9D14C3B8, 0x8EB65BCF, 0xBA51F356, 0xA9F36B21,
+        0xD39EA264, 0xC03C3A13, 0xF4DB928A, 0xE7790AFD, 0x3FC5F181, 0x2C6769F6,
+        0x1880C16F, 0x0B225918, 0x714F905D, 0x62ED082A, 0x560AA0B3, 0x45A838C4,
+        0xA2D13239, 0xB173AA4E, 0x859402D7, 0x96369AA0, 0xEC5B53E5, 0xFFF9CB92,
+        0xCB1E630B, 0xD8BCFB7C, 0x7F8BE302, 0x6C297B75, 0x58CED3EC, 0x4B6C4B9B,
+        0x310182DE, 0x22A31AA9, 0x1644B230, 0x05E62A47, 0xE29F20BA, 0xF13DB8CD,
+        0xC5DA1054, 0xD6788823, 0xAC154166, 0xBFB7D911, 0x8B507188, 0x98F2E9FF,
+        0x404E1283, 0x53EC8AF4, 0x670B226D, 0x74A9BA1A, 0x0EC4735F, 0x1D66EB28,
+        0x298143B1, 0x3A23DBC6, 0xDD5AD13B, 0xCEF8494C, 0xFA1FE1D5, 0xE9BD79A2,
+        0x93D0B0E7, 0x80722890, 0xB4958009, 0xA737187E, 0xFF17C604, 0xECB55E73,
+        0xD852F6EA, 0xCBF06E9D, 0xB19DA7D8, 0xA23F3FAF, 0x96D89736, 0x857A0F41,
+        0x620305BC, 0x71A19DCB, 0x45463552, 0x56E4AD25, 0x2C896460, 0x3F2BFC17,
+        0x0BCC548E, 0x186ECCF9, 0xC0D23785, 0xD370AFF2, 0xE797076B, 0xF4359F1C,
+        0x8E585659, 0x9DFACE2E, 0xA91D66B7, 0xBABFFEC0, 0x5DC6F43D, 0x4E646C4A,
+        0x7A83C4D3, 0x69215CA4, 0x134C95E1, 0x00EE0D96, 0x3409A50F, 0x27AB3D78,
+        0x809C2506, 0x933EBD71, 0xA7D915E8, 0xB47B8D9F, 0xCE1644DA, 0xDDB4DCAD,
+        0xE9537434, 0xFAF1EC43, 0x1D88E6BE, 0x0E2A7EC9, 0x3ACDD650, 0x296F4E27,
+        0x53028762, 0x40A01F15, 0x7447B78C, 0x67E52FFB, 0xBF59D487, 0xACFB4CF0,
+        0x981CE469, 0x8BBE7C1E, 0xF1D3B55B, 0xE2712D2C, 0xD69685B5, 0xC5341DC2,
+        0x224D173F, 0x31EF8F48, 0x050827D1, 0x16AABFA6, 0x6CC776E3, 0x7F65EE94,
+        0x4B82460D, 0x5820DE7A, 0xFBC3FAF9, 0xE861628E, 0xDC86CA17, 0xCF245260,
+        0xB5499B25, 0xA6EB0352, 0x920CABCB, 0x81AE33BC, 0x66D73941, 0x7575A136,
+        0x419209AF, 0x523091D8, 0x285D589D, 0x3BFFC0EA, 0x0F186873, 0x1CBAF004,
+        0xC4060B78, 0xD7A4930F, 0xE3433B96, 0xF0E1A3E1, 0x8A8C6AA4, 0x992EF2D3,
+        0xADC95A4A, 0xBE6BC23D, 0x5912C8C0, 0x4AB050B7, 0x7E57F82E, 0x6DF56059,
+        0x1798A91C, 0x043A316B, 0x30DD99F2, 0x237F0185, 0x844819FB, 0x97EA818C,
+        0xA30D2915, 0xB0AFB162, 0xCAC27827, 0xD960E050, 0xED8748C9, 0xFE25D0BE,
+        0x195CDA43, 0x0AFE4234, 0x3E19EAAD, 0x2DBB72DA, 0x57D6BB9F, 0x447423E8,
+        0x70938B71, 0x63311306, 0xBB8DE87A, 0xA82F700D, 0x9CC8D894, 0x8F6A40E3,
+        0xF50789A6, 0xE6A511D1, 0xD242B948, 0xC1E0213F, 0x26992BC2, 0x353BB3B5,
+        0x01DC1B2C, 0x127E835B, 0x68134A1E, 0x7BB1D269, 0x4F567AF0, 0x5CF4E287,
+        0x04D43CFD, 0x1776A48A, 0x23910C13, 0x30339464, 0x4A5E5D21, 0x59FCC556,
+        0x6D1B6DCF, 0x7EB9F5B8, 0x99C0FF45, 0x8A626732, 0xBE85CFAB, 0xAD2757DC,
+        0xD74A9E99, 0xC4E806EE, 0xF00FAE77, 0xE3AD3600, 0x3B11CD7C, 0x28B3550B,
+        0x1C54FD92, 0x0FF665E5, 0x759BACA0, 0x663934D7, 0x52DE9C4E, 0x417C0439,
+        0xA6050EC4, 0xB5A796B3, 0x81403E2A, 0x92E2A65D, 0xE88F6F18, 0xFB2DF76F,
+        0xCFCA5FF6, 0xDC68C781, 0x7B5FDFFF, 0x68FD4788, 0x5C1AEF11, 0x4FB87766,
+        0x35D5BE23, 0x26772654, 0x12908ECD, 0x013216BA, 0xE64B1C47, 0xF5E98430,
+        0xC10E2CA9, 0xD2ACB4DE, 0xA8C17D9B, 0xBB63E5EC, 0x8F844D75, 0x9C26D502,
+        0x449A2E7E, 0x5738B609, 0x63DF1E90, 0x707D86E7, 0x0A104FA2, 0x19B2D7D5,
+        0x2D557F4C, 0x3EF7E73B, 0xD98EEDC6, 0xCA2C75B1, 0xFECBDD28, 0xED69455F,
+        0x97048C1A, 0x84A6146D, 0xB041BCF4, 0xA3E32483
+    },
+    {
+        0x00000000, 0xA541927E, 0x4F6F520D, 0xEA2EC073, 0x9EDEA41A, 0x3B9F3664,
+        0xD1B1F617, 0x74F06469, 0x38513EC5, 0x9D10ACBB, 0x773E6CC8, 0xD27FFEB6,
+        0xA68F9ADF, 0x03CE08A1, 0xE9E0C8D2, 0x4CA15AAC, 0x70A27D8A, 0xD5E3EFF4,
+        0x3FCD2F87, 0x9A8CBDF9, 0xEE7CD990, 0x4B3D4BEE, 0xA1138B9D, 0x045219E3,
+        0x48F3434F, 0xEDB2D131, 0x079C1142, 0xA2DD833C, 0xD62DE755, 0x736C752B,
+        0x9942B558, 0x3C032726, 0xE144FB14, 0x4405696A, 0xAE2BA919, 0x0B6A3B67,
+        0x7F9A5F0E, 0xDADBCD70, 0x30F50D03, 0x95B49F7D, 0xD915C5D1, 0x7C5457AF,
+        0x967A97DC, 0x333B05A2, 0x47CB61CB, 0xE28AF3B5, 0x08A433C6, 0xADE5A1B8,
+        0x91E6869E, 0x34A714E0, 0xDE89D493, 0x7BC846ED, 0x0F382284, 0xAA79B0FA,
+        0x40577089, 0xE516E2F7, 0xA9B7B85B, 0x0CF62A25, 0xE6D8EA56, 0x43997828,
+        0x37691C41, 0x92288E3F, 0x78064E4C, 0xDD47DC32, 0xC76580D9, 0x622412A7,
+        0x880AD2D4, 0x2D4B40AA, 0x59BB24C3, 0xFCFAB6BD, 0x16D476CE, 0xB395E4B0,
+        0xFF34BE1C, 0x5A752C62, 0xB05BEC11, 0x151A7E6F, 0x61EA1A06, 0xC4AB8878,
+        0x2E85480B, 0x8BC4DA75, 0xB7C7FD53, 0x12866F2D, 0xF8A8AF5E, 0x5DE93D20,
+        0x29195949, 0x8C58CB37, 0x66760B44, 0xC337993A, 0x8F96C396, 0x2AD751E8,
+        0xC0F9919B, 0x65B803E5, 0x1148678C, 0xB409F5F2, 0x5E273581, 0xFB66A7FF,
+        0x26217BCD, 0x8360E9B3, 0x694E29C0, 0xCC0FBBBE, 0xB8FFDFD7, 0x1DBE4DA9,
+        0xF7908DDA, 0x52D11FA4, 0x1E704508, 0xBB31D776, 0x511F1705, 0xF45E857B,
+        0x80AEE112, 0x25EF736C, 0xCFC1B31F, 0x6A802161, 0x56830647, 0xF3C29439,
+        0x19EC544A, 0xBCADC634, 0xC85DA25D, 0x6D1C3023, 0x8732F050, 0x2273622E,
+        0x6ED23882, 0xCB93AAFC, 0x21BD6A8F, 0x84FCF8F1, 0xF00C9C98, 0x554D0EE6,
+        0xBF63CE95, 0x1A225CEB, 0x8B277743, 0x2E66E53D, 0xC448254E, 0x6109B730,
+        0x15F9D359, 0xB0B84127, 0x5A968154, 0xFFD7132A, 0xB3764986, 0x1637DBF8,
+        0xFC191B8B, 0x595889F5, 0x2DA8ED9C, 0x88E97FE2, 0x62C7BF91, 0xC7862DEF,
+        0xFB850AC9, 0x5EC498B7, 0xB4EA58C4, 0x11ABCABA, 0x655BAED3, 0xC01A3CAD,
+        0x2A34FCDE, 0x8F756EA0, 0xC3D4340C, 0x6695A672, 0x8CBB6601, 0x29FAF47F,
+        0x5D0A9016, 0xF84B0268, 0x1265C21B, 0xB7245065, 0x6A638C57, 0xCF221E29,
+        0x250CDE5A, 0x804D4C24, 0xF4BD284D, 0x51FCBA33, 0xBBD27A40, 0x1E93E83E,
+        0x5232B292, 0xF77320EC, 0x1D5DE09F, 0xB81C72E1, 0xCCEC1688, 0x69AD84F6,
+        0x83834485, 0x26C2D6FB, 0x1AC1F1DD, 0xBF8063A3, 0x55AEA3D0, 0xF0EF31AE,
+        0x841F55C7, 0x215EC7B9, 0xCB7007CA, 0x6E3195B4, 0x2290CF18, 0x87D15D66,
+        0x6DFF9D15, 0xC8BE0F6B, 0xBC4E6B02, 0x190FF97C, 0xF321390F, 0x5660AB71,
+        0x4C42F79A, 0xE90365E4, 0x032DA597, 0xA66C37E9, 0xD29C5380, 0x77DDC1FE,
+        0x9DF3018D, 0x38B293F3, 0x7413C95F, 0xD1525B21, 0x3B7C9B52, 0x9E3D092C,
+        0xEACD6D45, 0x4F8CFF3B, 0xA5A23F48, 0x00E3AD36, 0x3CE08A10, 0x99A1186E,
+        0x738FD81D, 0xD6CE4A63, 0xA23E2E0A, 0x077FBC74, 0xED517C07, 0x4810EE79,
+        0x04B1B4D5, 0xA1F026AB, 0x4BDEE6D8, 0xEE9F74A6, 0x9A6F10CF, 0x3F2E82B1,
+        0xD50042C2, 0x7041D0BC, 0xAD060C8E, 0x08479EF0, 0xE2695E83, 0x4728CCFD,
+        0x33D8A894, 0x96993AEA, 0x7CB7FA99, 0xD9F668E7, 0x9557324B, 0x3016A035,
+        0xDA386046, 0x7F79F238, 0x0B899651, 0xAEC8042F, 0x44E6C45C, 0xE1A75622,
+        0xDDA47104, 0x78E5E37A, 0x92CB2309, 0x378AB177, 0x437AD51E, 0xE63B4760,
+        0x0C158713, 0xA954156D, 0xE5F54FC1, 0x40B4DDBF, 0xAA9A1DCC, 0x0FDB8FB2,
+        0x7B2BEBDB, 0xDE6A79A5, 0x3444B9D6, 0x91052BA8
+    },
+    {
+        0x00000000, 0xDD45AAB8, 0xBF672381, 0x62228939, 0x7B2231F3, 0xA6679B4B,
+        0xC4451272, 0x1900B8CA, 0xF64463E6, 0x2B01C95E, 0x49234067, 0x9466EADF,
+        0x8D665215, 0x5023F8AD, 0x32017194, 0xEF44DB2C, 0xE964B13D, 0x34211B85,
+        0x560392BC, 0x8B463804, 0x924680CE, 0x4F032A76, 0x2D21A34F, 0xF06409F7,
+        0x1F20D2DB, 0xC2657863, 0xA047F15A, 0x7D025BE2, 0x6402E328, 0xB9474990,
+        0xDB65C0A9, 0x06206A11, 0xD725148B, 0x0A60BE33, 0x6842370A, 0xB5079DB2,
+        0xAC072578, 0x71428FC0, 0x136006F9, 0xCE25AC41, 0x2161776D, 0xFC24DDD5,
+        0x9E0654EC, 0x4343FE54, 0x5A43469E, 0x8706EC26, 0xE524651F, 0x3861CFA7,
+        0x3E41A5B6, 0xE3040F0E, 0x81268637, 0x5C632C8F, 0x45639445, 0x98263EFD,
+        0xFA04B7C4, 0x27411D7C, 0xC805C650, 0x15406CE8, 0x7762E5D1, 0xAA274F69,
+        0xB327F7A3, 0x6E625D1B, 0x0C40D422, 0xD1057E9A, 0xABA65FE7, 0x76E3F55F,
+        0x14C17C66, 0xC984D6DE, 0xD0846E14, 0x0DC1C4AC, 0x6FE34D95, 0xB2A6E72D,
+        0x5DE23C01, 0x80A796B9, 0xE2851F80, 0x3FC0B538, 0x26C00DF2, 0xFB85A74A,
+        0x99A72E73, 0x44E284CB, 0x42C2EEDA, 0x9F874462, 0xFDA5CD5B, 0x20E067E3,
+        0x39E0DF29, 0xE4A57591, 0x8687FCA8, 0x5BC25610, 0xB4868D3C, 0x69C32784,
+        0x0BE1AEBD, 0xD6A40405, 0xCFA4BCCF, 0x12E11677, 0x70C39F4E, 0xAD8635F6,
+        0x7C834B6C, 0xA1C6E1D4, 0xC3E468ED, 0x1EA1C255, 0x07A17A9F, 0xDAE4D027,
+        0xB8C6591E, 0x6583F3A6, 0x8AC7288A, 0x57828232, 0x35A00B0B, 0xE8E5A1B3,
+        0xF1E51979, 0x2CA0B3C1, 0x4E823AF8, 0x93C79040, 0x95E7FA51, 0x48A250E9,
+        0x2A80D9D0, 0xF7C57368, 0xEEC5CBA2, 0x3380611A, 0x51A2E823, 0x8CE7429B,
+        0x63A399B7, 0xBEE6330F, 0xDCC4BA36, 0x0181108E, 0x1881A844, 0xC5C402FC,
+        0xA7E68BC5, 0x7AA3217D, 0x52A0C93F, 0x8FE56387, 0xEDC7EABE, 0x30824006,
+        0x2982F8CC, 0xF4C75274, 0x96E5DB4D, 0x4BA071F5, 0xA4E4AAD9, 0x79A10061,
+        0x1B838958, 0xC6C623E0, 0xDFC69B2A, 0x02833192, 0x60A1B8AB, 0xBDE41213,
+        0xBBC47802, 0x6681D2BA, 0x04A35B83, 0xD9E6F13B, 0xC0E649F1, 0x1DA3E349,
+        0x7F816A70, 0xA2C4C0C8, 0x4D801BE4, 0x90C5B15C, 0xF2E73865, 0x2FA292DD,
+        0x36A22A17, 0xEBE780AF, 0x89C50996, 0x5480A32E, 0x8585DDB4, 0x58C0770C,
+        0x3AE2FE35, 0xE7A7548D, 0xFEA7EC47, 0x23E246FF, 0x41C0CFC6, 0x9C85657E,
+        0x73C1BE52, 0xAE8414EA, 0xCCA69DD3, 0x11E3376B, 0x08E38FA1, 0xD5A62519,
+        0xB784AC20, 0x6AC10698, 0x6CE16C89, 0xB1A4C631, 0xD3864F08, 0x0EC3E5B0,
+        0x17C35D7A, 0xCA86F7C2, 0xA8A47EFB, 0x75E1D443, 0x9AA50F6F, 0x47E0A5D7,
+        0x25C22CEE, 0xF8878656, 0xE1873E9C, 0x3CC29424, 0x5EE01D1D, 0x83A5B7A5,
+        0xF90696D8, 0x24433C60, 0x4661B559, 0x9B241FE1, 0x8224A72B, 0x5F610D93,
+        0x3D4384AA, 0xE0062E12, 0x0F42F53E, 0xD2075F86, 0xB025D6BF, 0x6D607C07,
+        0x7460C4CD, 0xA9256E75, 0xCB07E74C, 0x16424DF4, 0x106227E5, 0xCD278D5D,
+        0xAF050464, 0x7240AEDC, 0x6B401616, 0xB605BCAE, 0xD4273597, 0x09629F2F,
+        0xE6264403, 0x3B63EEBB, 0x59416782, 0x8404CD3A, 0x9D0475F0, 0x4041DF48,
+        0x22635671, 0xFF26FCC9, 0x2E238253, 0xF36628EB, 0x9144A1D2, 0x4C010B6A,
+        0x5501B3A0, 0x88441918, 0xEA669021, 0x37233A99, 0xD867E1B5, 0x05224B0D,
+        0x6700C234, 0xBA45688C, 0xA345D046, 0x7E007AFE, 0x1C22F3C7, 0xC167597F,
+        0xC747336E, 0x1A0299D6, 0x782010EF, 0xA565BA57, 0xBC65029D, 0x6120A825,
+        0x0302211C, 0xDE478BA4, 0x31035088, 0xEC46FA30, 0x8E647309, 0x5321D9B1,
+        0x4A21617B, 0x9764CBC3, 0xF54642FA, 0x2803E842
+    },
+    {
+        0x00000000, 0x38116FAC, 0x7022DF58, 0x4833B0F4, 0xE045BEB0, 0xD854D11C,
+        0x906761E8, 0xA8760E44, 0xC5670B91, 0xFD76643D, 0xB545D4C9, 0x8D54BB65,
+        0x2522B521, 0x1D33DA8D, 0x55006A79, 0x6D1105D5, 0x8F2261D3, 0xB7330E7F,
+        0xFF00BE8B, 0xC711D127, 0x6F67DF63, 0x5776B0CF, 0x1F45003B, 0x27546F97,
+        0x4A456A42, 0x725405EE, 0x3A67B51A, 0x0276DAB6, 0xAA00D4F2, 0x9211BB5E,
+        0xDA220BAA, 0xE2336406, 0x1BA8B557, 0x23B9DAFB, 0x6B8A6A0F, 0x539B05A3,
+        0xFBED0BE7, 0xC3FC644B, 0x8BCFD4BF, 0xB3DEBB13, 0xDECFBEC6, 0xE6DED16A,
+        0xAEED619E, 0x96FC0E32, 0x3E8A0076, 0x069B6FDA, 0x4EA8DF2E, 0x76B9B082,
+        0x948AD484, 0xAC9BBB28, 0xE4A80BDC, 0xDCB96470, 0x74CF6A34, 0x4CDE0598,
+        0x04EDB56C, 0x3CFCDAC0, 0x51EDDF15, 0x69FCB0B9, 0x21CF004D, 0x19DE6FE1,
+        0xB1A861A5, 0x89B90E09, 0xC18ABEFD, 0xF99BD151, 0x37516AAE, 0x0F400502,
+        0x4773B5F6, 0x7F62DA5A, 0xD714D41E, 0xEF05BBB2, 0xA7360B46, 0x9F2764EA,
+        0xF236613F, 0xCA270E93, 0x8214BE67, 0xBA05D1CB, 0x1273DF8F, 0x2A62B023,
+        0x625100D7, 0x5A406F7B, 0xB8730B7D, 0x806264D1, 0xC851D425, 0xF040BB89,
+        0x5836B5CD, 0x6027DA61, 0x28146A95, 0x10050539, 0x7D1400EC, 0x45056F40,
+        0x0D36DFB4, 0x3527B018, 0x9D51BE5C, 0xA540D1F0, 0xED736104, 0xD5620EA8,
+        0x2CF9DFF9, 0x14E8B055, 0x5CDB00A1, 0x64CA6F0D, 0xCCBC6149, 0xF4AD0EE5,
+        0xBC9EBE11, 0x848FD1BD, 0xE99ED468, 0xD18FBBC4, 0x99BC0B30, 0xA1AD649C,
+        0x09DB6AD8, 0x31CA0574, 0x79F9B580, 0x41E8DA2C, 0xA3DBBE2A, 0x9BCAD186,
+        0xD3F96172, 0xEBE80EDE, 0x439E009A, 0x7B8F6F36, 0x33BCDFC2, 0x0BADB06E,
+        0x66BCB5BB, 0x5EADDA17, 0x169E6AE3, 0x2E8F054F, 0x86F90B0B, 0xBEE864A7,
+        0xF6DBD453, 0xCECABBFF, 0x6EA2D55C, 0x56B3BAF0, 0x1E800A04, 0x269165A8,
+        0x8EE76BEC, 0xB6F60440, 0xFEC5B4B4, 0xC6D4DB18, 0xABC5DECD, 0x93D4B161,
+        0xDBE70195, 0xE3F66E39, 0x4B80607D, 0x73910FD1, 0x3BA2BF25, 0x03B3D089,
+        0xE180B48F, 0xD991DB23, 0x91A26BD7, 0xA9B3047B, 0x01C50A3F, 0x39D46593,
+        0x71E7D567, 0x49F6BACB, 0x24E7BF1E, 0x1CF6D0B2, 0x54C56046, 0x6CD40FEA,
+        0xC4A201AE, 0xFCB36E02, 0xB480DEF6, 0x8C91B15A, 0x750A600B, 0x4D1B0FA7,
+        0x0528BF53, 0x3D39D0FF, 0x954FDEBB, 0xAD5EB117, 0xE56D01E3, 0xDD7C6E4F,
+        0xB06D6B9A, 0x887C0436, 0xC04FB4C2, 0xF85EDB6E, 0x5028D52A, 0x6839BA86,
+        0x200A0A72, 0x181B65DE, 0xFA2801D8, 0xC2396E74, 0x8A0ADE80, 0xB21BB12C,
+        0x1A6DBF68, 0x227CD0C4, 0x6A4F6030, 0x525E0F9C, 0x3F4F0A49, 0x075E65E5,
+        0x4F6DD511, 0x777CBABD, 0xDF0AB4F9, 0xE71BDB55, 0xAF286BA1, 0x9739040D,
+        0x59F3BFF2, 0x61E2D05E, 0x29D160AA, 0x11C00F06, 0xB9B60142, 0x81A76EEE,
+        0xC994DE1A, 0xF185B1B6, 0x9C94B463, 0xA485DBCF, 0xECB66B3B, 0xD4A70497,
+        0x7CD10AD3, 0x44C0657F, 0x0CF3D58B, 0x34E2BA27, 0xD6D1DE21, 0xEEC0B18D,
+        0xA6F30179, 0x9EE26ED5, 0x36946091, 0x0E850F3D, 0x46B6BFC9, 0x7EA7D065,
+        0x13B6D5B0, 0x2BA7BA1C, 0x63940AE8, 0x5B856544, 0xF3F36B00, 0xCBE204AC,
+        0x83D1B458, 0xBBC0DBF4, 0x425B0AA5, 0x7A4A6509, 0x3279D5FD, 0x0A68BA51,
+        0xA21EB415, 0x9A0FDBB9, 0xD23C6B4D, 0xEA2D04E1, 0x873C0134, 0xBF2D6E98,
+        0xF71EDE6C, 0xCF0FB1C0, 0x6779BF84, 0x5F68D028, 0x175B60DC, 0x2F4A0F70,
+        0xCD796B76, 0xF56804DA, 0xBD5BB42E, 0x854ADB82, 0x2D3CD5C6, 0x152DBA6A,
+        0x5D1E0A9E, 0x650F6532, 0x081E60E7, 0x300F0F4B, 0x783CBFBF, 0x402DD013,
+        0xE85BDE57, 0xD04AB1FB, 0x9879010F, 0xA0686EA3
+    },
+    {
+        0x00000000, 0xEF306B19, 0xDB8CA0C3, 0x34BCCBDA, 0xB2F53777, 0x5DC55C6E,
+        0x697997B4, 0x8649FCAD, 0x6006181F, 0x8F367306, 0xBB8AB8DC, 0x54BAD3C5,
+        0xD2F32F68, 0x3DC34471, 0x097F8FAB, 0xE64FE4B2, 0xC00C303E, 0x2F3C5B27,
+        0x1B8090FD, 0xF4B0FBE4, 0x72F90749, 0x9DC96C50, 0xA975A78A, 0x4645CC93,
+        0xA00A2821, 0x4F3A4338, 0x7B8688E2, 0x94B6E3FB, 0x12FF1F56, 0xFDCF744F,
+        0xC973BF95, 0x2643D48C, 0x85F4168D, 0x6AC47D94, 0x5E78B64E, 0xB148DD57,
+        0x370121FA, 0xD8314AE3, 0xEC8D8139, 0x03BDEA20, 0xE5F20E92, 0x0AC2658B,
+        0x3E7EAE51, 0xD14EC548, 0x570739E5, 0xB83752FC, 0x8C8B9926, 0x63BBF23F,
+        0x45F826B3, 0xAAC84DAA, 0x9E748670, 0x7144ED69, 0xF70D11C4, 0x183D7ADD,
+        0x2C81B107, 0xC3B1DA1E, 0x25FE3EAC, 0xCACE55B5, 0xFE729E6F, 0x1142F576,
+        0x970B09DB, 0x783B62C2, 0x4C87A918, 0xA3B7C201, 0x0E045BEB, 0xE13430F2,
+        0xD588FB28, 0x3AB89031, 0xBCF16C9C, 0x53C10785, 0x677DCC5F, 0x884DA746,
+        0x6E0243F4, 0x813228ED, 0xB58EE337, 0x5ABE882E, 0xDCF77483, 0x33C71F9A,
+        0x077BD440, 0xE84BBF59, 0xCE086BD5, 0x213800CC, 0x1584CB16, 0xFAB4A00F,
+        0x7CFD5CA2, 0x93CD37BB, 0xA771FC61, 0x48419778, 0xAE0E73CA, 0x413E18D3,
+        0x7582D309, 0x9AB2B810, 0x1CFB44BD, 0xF3CB2FA4, 0xC777E47E, 0x28478F67,
+        0x8BF04D66, 0x64C0267F, 0x507CEDA5, 0xBF4C86BC, 0x39057A11, 0xD6351108,
+        0xE289DAD2, 0x0DB9B1CB, 0xEBF65579, 0x04C63E60, 0x307AF5BA, 0xDF4A9EA3,
+        0x5903620E, 0xB6330917, 0x828FC2CD, 0x6DBFA9D4, 0x4BFC7D58, 0xA4CC1641,
+        0x9070DD9B, 0x7F40B682, 0xF9094A2F, 0x16392136, 0x2285EAEC, 0xCDB581F5,
+        0x2BFA6547, 0xC4CA0E5E, 0xF076C584, 0x1F46AE9D, 0x990F5230, 0x763F3929,
+        0x4283F2F3, 0xADB399EA, 0x1C08B7D6, 0xF338DCCF, 0xC7841715, 0x28B47C0C,
+        0xAEFD80A1, 0x41CDEBB8, 0x75712062, 0x9A414B7B, 0x7C0EAFC9, 0x933EC4D0,
+        0xA7820F0A, 0x48B26413, 0xCEFB98BE, 0x21CBF3A7, 0x1577387D, 0xFA475364,
+        0xDC0487E8, 0x3334ECF1, 0x0788272B, 0xE8B84C32, 0x6EF1B09F, 0x81C1DB86,
+        0xB57D105C, 0x5A4D7B45, 0xBC029FF7, 0x5332F4EE, 0x678E3F34, 0x88BE542D,
+        0x0EF7A880, 0xE1C7C399, 0xD57B0843, 0x3A4B635A, 0x99FCA15B, 0x76CCCA42,
+        0x42700198, 0xAD406A81, 0x2B09962C, 0xC439FD35, 0xF08536EF, 0x1FB55DF6,
+        0xF9FAB944, 0x16CAD25D, 0x22761987, 0xCD46729E, 0x4B0F8E33, 0xA43FE52A,
+        0x90832EF0, 0x7FB345E9, 0x59F09165, 0xB6C0FA7C, 0x827C31A6, 0x6D4C5ABF,
+        0xEB05A612, 0x0435CD0B, 0x308906D1, 0xDFB96DC8, 0x39F6897A, 0xD6C6E263,
+        0xE27A29B9, 0x0D4A42A0, 0x8B03BE0D, 0x6433D514, 0x508F1ECE, 0xBFBF75D7,
+        0x120CEC3D, 0xFD3C8724, 0xC9804CFE, 0x26B027E7, 0xA0F9DB4A, 0x4FC9B053,
+        0x7B757B89, 0x94451090, 0x720AF422, 0x9D3A9F3B, 0xA98654E1, 0x46B63FF8,
+        0xC0FFC355, 0x2FCFA84C, 0x1B736396, 0xF443088F, 0xD200DC03, 0x3D30B71A,
+        0x098C7CC0, 0xE6BC17D9, 0x60F5EB74, 0x8FC5806D, 0xBB794BB7, 0x544920AE,
+        0xB206C41C, 0x5D36AF05, 0x698A64DF, 0x86BA0FC6, 0x00F3F36B, 0xEFC39872,
+        0xDB7F53A8, 0x344F38B1, 0x97F8FAB0, 0x78C891A9, 0x4C745A73, 0xA344316A,
+        0x250DCDC7, 0xCA3DA6DE, 0xFE816D04, 0x11B1061D, 0xF7FEE2AF, 0x18CE89B6,
+        0x2C72426C, 0xC3422975, 0x450BD5D8, 0xAA3BBEC1, 0x9E87751B, 0x71B71E02,
+        0x57F4CA8E, 0xB8C4A197, 0x8C786A4D, 0x63480154, 0xE501FDF9, 0x0A3196E0,
+        0x3E8D5D3A, 0xD1BD3623, 0x37F2D291, 0xD8C2B988, 0xEC7E7252, 0x034E194B,
+        0x8507E5E6, 0x6A378EFF, 0x5E8B4525, 0xB1BB2E3C
+    },
+    {
+        0x00000000, 0x68032CC8, 0xD0065990, 0xB8057558, 0xA5E0C5D1, 0xCDE3E919,
+        0x75E69C41, 0x1DE5B089, 0x4E2DFD53, 0x262ED19B, 0x9E2BA4C3, 0xF628880B,
+        0xEBCD3882, 0x83CE144A, 0x3BCB6112, 0x53C84DDA, 0x9C5BFAA6, 0xF458D66E,
+        0x4C5DA336, 0x245E8FFE, 0x39BB3F77, 0x51B813BF, 0xE9BD66E7, 0x81BE4A2F,
+        0xD27607F5, 0xBA752B3D, 0x02705E65, 0x6A7372AD, 0x7796C224, 0x1F95EEEC,
+        0xA7909BB4, 0xCF93B77C, 0x3D5B83BD, 0x5558AF75, 0xED5DDA2D, 0x855EF6E5,
+        0x98BB466C, 0xF0B86AA4, 0x48BD1FFC, 0x20BE3334, 0x73767EEE, 0x1B755226,
+        0xA370277E, 0xCB730BB6, 0xD696BB3F, 0xBE9597F7, 0x0690E2AF, 0x6E93CE67,
+        0xA100791B, 0xC90355D3, 0x7106208B, 0x19050C43, 0x04E0BCCA, 0x6CE39002,
+        0xD4E6E55A, 0xBCE5C992, 0xEF2D8448, 0x872EA880, 0x3F2BDDD8, 0x5728F110,
+        0x4ACD4199, 0x22CE6D51, 0x9ACB1809, 0xF2C834C1, 0x7AB7077A, 0x12B42BB2,
+        0xAAB15EEA, 0xC2B27222, 0xDF57C2AB, 0xB754EE63, 0x0F519B3B, 0x6752B7F3,
+        0x349AFA29, 0x5C99D6E1, 0xE49CA3B9, 0x8C9F8F71, 0x917A3FF8, 0xF9791330,
+        0x417C6668, 0x297F4AA0, 0xE6ECFDDC, 0x8EEFD114, 0x36EAA44C, 0x5EE98884,
+        0x430C380D, 0x2B0F14C5, 0x930A619D, 0xFB094D55, 0xA8C1008F, 0xC0C22C47,
+        0x78C7591F, 0x10C475D7, 0x0D21C55E, 0x6522E996, 0xDD279CCE, 0xB524B006,
+        0x47EC84C7, 0x2FEFA80F, 0x97EADD57, 0xFFE9F19F, 0xE20C4116, 0x8A0F6DDE,
+        0x320A1886, 0x5A09344E, 0x09C17994, 0x61C2555C, 0xD9C72004, 0xB1C40CCC,
+        0xAC21BC45, 0xC422908D, 0x7C27E5D5, 0x1424C91D, 0xDBB77E61, 0xB3B452A9,
+        0x0BB127F1, 0x63B20B39, 0x7E57BBB0, 0x16549778, 0xAE51E220, 0xC652CEE8,
+        0x959A8332, 0xFD99AFFA, 0x459CDAA2, 0x2D9FF66A, 0x307A46E3, 0x58796A2B,
+        0xE07C1F73, 0x887F33BB, 0xF56E0EF4, 0x9D6D223C, 0x25685764, 0x4D6B7BAC,
+        0x508ECB25, 0x388DE7ED, 0x808892B5, 0xE88BBE7D, 0xBB43F3A7, 0xD340DF6F,
+        0x6B45AA37, 0x034686FF, 0x1EA33676, 0x76A01ABE, 0xCEA56FE6, 0xA6A6432E,
+        0x6935F452, 0x0136D89A, 0xB933ADC2, 0xD130810A, 0xCCD53183, 0xA4D61D4B,
+        0x1CD36813, 0x74D044DB, 0x27180901, 0x4F1B25C9, 0xF71E5091, 0x9F1D7C59,
+        0x82F8CCD0, 0xEAFBE018, 0x52FE9540, 0x3AFDB988, 0xC8358D49, 0xA036A181,
+        0x1833D4D9, 0x7030F811, 0x6DD54898, 0x05D66450, 0xBDD31108, 0xD5D03DC0,
+        0x8618701A, 0xEE1B5CD2, 0x561E298A, 0x3E1D0542, 0x23F8B5CB, 0x4BFB9903,
+        0xF3FEEC5B, 0x9BFDC093, 0x546E77EF, 0x3C6D5B27, 0x84682E7F, 0xEC6B02B7,
+        0xF18EB23E, 0x998D9EF6, 0x2188EBAE, 0x498BC766, 0x1A438ABC, 0x7240A674,
+        0xCA45D32C, 0xA246FFE4, 0xBFA34F6D, 0xD7A063A5, 0x6FA516FD, 0x07A63A35,
+        0x8FD9098E, 0xE7DA2546, 0x5FDF501E, 0x37DC7CD6, 0x2A39CC5F, 0x423AE097,
+        0xFA3F95CF, 0x923CB907, 0xC1F4F4DD, 0xA9F7D815, 0x11F2AD4D, 0x79F18185,
+        0x6414310C, 0x0C171DC4, 0xB412689C, 0xDC114454, 0x1382F328, 0x7B81DFE0,
+        0xC384AAB8, 0xAB878670, 0xB66236F9, 0xDE611A31, 0x66646F69, 0x0E6743A1,
+        0x5DAF0E7B, 0x35AC22B3, 0x8DA957EB, 0xE5AA7B23, 0xF84FCBAA, 0x904CE762,
+        0x2849923A, 0x404ABEF2, 0xB2828A33, 0xDA81A6FB, 0x6284D3A3, 0x0A87FF6B,
+        0x17624FE2, 0x7F61632A, 0xC7641672, 0xAF673ABA, 0xFCAF7760, 0x94AC5BA8,
+        0x2CA92EF0, 0x44AA0238, 0x594FB2B1, 0x314C9E79, 0x8949EB21, 0xE14AC7E9,
+        0x2ED97095, 0x46DA5C5D, 0xFEDF2905, 0x96DC05CD, 0x8B39B544, 0xE33A998C,
+        0x5B3FECD4, 0x333CC01C, 0x60F48DC6, 0x08F7A10E, 0xB0F2D456, 0xD8F1F89E,
+        0xC5144817, 0xAD1764DF, 0x15121187, 0x7D113D4F
+    },
+    {
+        0x00000000, 0x493C7D27, 0x9278FA4E, 0xDB448769, 0x211D826D, 0x6821FF4A,
+        0xB3657823, 0xFA590504, 0x423B04DA, 0x0B0779FD, 0xD043FE94, 0x997F83B3,
+        0x632686B7, 0x2A1AFB90, 0xF15E7CF9, 0xB86201DE, 0x847609B4, 0xCD4A7493,
+        0x160EF3FA, 0x5F328EDD, 0xA56B8BD9, 0xEC57F6FE, 0x37137197, 0x7E2F0CB0,
+        0xC64D0D6E, 0x8F717049, 0x5435F720, 0x1D098A07, 0xE7508F03, 0xAE6CF224,
+        0x7528754D, 0x3C14086A, 0x0D006599, 0x443C18BE, 0x9F789FD7, 0xD644E2F0,
+        0x2C1DE7F4, 0x65219AD3, 0xBE651DBA, 0xF759609D, 0x4F3B6143, 0x06071C64,
+        0xDD439B0D, 0x947FE62A, 0x6E26E32E, 0x271A9E09, 0xFC5E1960, 0xB5626447,
+        0x89766C2D, 0xC04A110A, 0x1B0E9663, 0x5232EB44, 0xA86BEE40, 0xE1579367,
+        0x3A13140E, 0x732F6929, 0xCB4D68F7, 0x827115D0, 0x593592B9, 0x1009EF9E,
+        0xEA50EA9A, 0xA36C97BD, 0x782810D4, 0x31146DF3, 0x1A00CB32, 0x533CB615,
+        0x8878317C, 0xC1444C5B, 0x3B1D495F, 0x72213478, 0xA965B311, 0xE059CE36,
+        0x583BCFE8, 0x1107B2CF, 0xCA4335A6, 0x837F4881, 0x79264D85, 0x301A30A2,
+        0xEB5EB7CB, 0xA262CAEC, 0x9E76C286, 0xD74ABFA1, 0x0C0E38C8, 0x453245EF,
+        0xBF6B40EB, 0xF6573DCC, 0x2D13BAA5, 0x642FC782, 0xDC4DC65C, 0x9571BB7B,
+        0x4E353C12, 0x07094135, 0xFD504431, 0xB46C3916, 0x6F28BE7F, 0x2614C358,
+        0x1700AEAB, 0x5E3CD38C, 0x857854E5, 0xCC4429C2, 0x361D2CC6, 0x7F2151E1,
+        0xA465D688, 0xED59ABAF, 0x553BAA71, 0x1C07D756, 0xC743503F, 0x8E7F2D18,
+        0x7426281C, 0x3D1A553B, 0xE65ED252, 0xAF62AF75, 0x9376A71F, 0xDA4ADA38,
+        0x010E5D51, 0x48322076, 0xB26B2572, 0xFB575855, 0x2013DF3C, 0x692FA21B,
+        0xD14DA3C5, 0x9871DEE2, 0x4335598B, 0x0A0924AC, 0xF05021A8, 0xB96C5C8F,
+        0x6228DBE6, 0x2B14A6C1, 0x34019664, 0x7D3DEB43, 0xA6796C2A, 0xEF45110D,
+        0x151C1409, 0x5C20692E, 0x8764EE47, 0xCE589360, 0x763A92BE, 0x3F06EF99,
+        0xE44268F0, 0xAD7E15D7, 0x572710D3, 0x1E1B6DF4, 0xC55FEA9D, 0x8C6397BA,
+        0xB0779FD0, 0xF94BE2F7, 0x220F659E, 0x6B3318B9, 0x916A1DBD, 0xD856609A,
+        0x0312E7F3, 0x4A2E9AD4, 0xF24C9B0A, 0xBB70E62D, 0x60346144, 0x29081C63,
+        0xD3511967, 0x9A6D6440, 0x4129E329, 0x08159E0E, 0x3901F3FD, 0x703D8EDA,
+        0xAB7909B3, 0xE2457494, 0x181C7190, 0x51200CB7, 0x8A648BDE, 0xC358F6F9,
+        0x7B3AF727, 0x32068A00, 0xE9420D69, 0xA07E704E, 0x5A27754A, 0x131B086D,
+        0xC85F8F04, 0x8163F223, 0xBD77FA49, 0xF44B876E, 0x2F0F0007, 0x66337D20,
+        0x9C6A7824, 0xD5560503, 0x0E12826A, 0x472EFF4D, 0xFF4CFE93, 0xB67083B4,
+        0x6D3404DD, 0x240879FA, 0xDE517CFE, 0x976D01D9, 0x4C2986B0, 0x0515FB97,
+        0x2E015D56, 0x673D2071, 0xBC79A718, 0xF545DA3F, 0x0F1CDF3B, 0x4620A21C,
+        0x9D642575, 0xD4585852, 0x6C3A598C, 0x250624AB, 0xFE42A3C2, 0xB77EDEE5,
+        0x4D27DBE1, 0x041BA6C6, 0xDF5F21AF, 0x96635C88, 0xAA7754E2, 0xE34B29C5,
+        0x380FAEAC, 0x7133D38B, 0x8B6AD68F, 0xC256ABA8, 0x19122CC1, 0x502E51E6,
+        0xE84C5038, 0xA1702D1F, 0x7A34AA76, 0x3308D751, 0xC951D255, 0x806DAF72,
+        0x5B29281B, 0x1215553C, 0x230138CF, 0x6A3D45E8, 0xB179C281, 0xF845BFA6,
+        0x021CBAA2, 0x4B20C785, 0x906440EC, 0xD9583DCB, 0x613A3C15, 0x28064132,
+        0xF342C65B, 0xBA7EBB7C, 0x4027BE78, 0x091BC35F, 0xD25F4436, 0x9B633911,
+        0xA777317B, 0xEE4B4C5C, 0x350FCB35, 0x7C33B612, 0x866AB316, 0xCF56CE31,
+        0x14124958, 0x5D2E347F, 0xE54C35A1, 0xAC704886, 0x7734CFEF, 0x3E08B2C8,
+        0xC451B7CC, 0x8D6DCAEB, 0x56294D82, 0x1F1530A5
+    }
+};
+#endif
+
+/* le64_get *****************************************************************/
+static uint64_t le64_get
+(
+    uint8_t const * p
+)
+{
+    return (uint64_t) p[0] | ((uint64_t) p[1] << 8)
+        | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24)
+        | ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40)
+        | ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+}
+
+/* c42_crc32c ***************************************************************/
+C42_API uint32_t C42_CALL c42_crc32c
+(
+    uint32_t crc,
+    uint8_t const * data,
+    size_t len
+)
+{
+    uint32_t c = ~crc;
+#if CRC32C_HW
+    uint64_t c64;
+    for (c64 = c; len >= 8; data += 8, len -= 8)
+        c64 = __builtin_ia32_crc32di(c64, le64_get(data));
+    c = (uint32_t) c64;
+    for (; len; ++data, --len) c = __builtin_ia32_crc32qi(c, *data);
+#else
+    uint32_t const (* t)[256] = crc32c_table;
+    uint64_t w;
+
+    for (; len >= 8; data += 8, len -= 8)
+    {
+        w = le64_get(data) ^ c;
+        c = t[7][w & 0xFF] ^ t[6][(w >> 8) & 0xFF]
+            ^ t[5][(w >> 16) & 0xFF] ^ t[4][(w >> 24) & 0xFF]
+            ^ t[3][(w >> 32) & 0xFF] ^ t[2][(w >> 40) & 0xFF]
+            ^ t[1][(w >> 48) & 0xFF] ^ t[0][w >> 56];
+    }
+    for (; len; ++data, --len) c = (c >> 8) ^ t[0][(c ^ *data) & 0xFF];
+#endif
+    return ~c;
+}
+
+#define H64_P1 UINT64_C(0x9E3779B185EBCA87)
+#define H64_P2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define H64_P3 UINT64_C(0x165667B19E3779F9)
+#define H64_P4 UINT64_C(0x85EBCA77C2B2AE63)
+#define H64_P5 UINT64_C(0x27D4EB2F165667C5)
+#define H64_ROTL(_x, _r) (((_x) << (_r)) | ((_x) >> (64 - (_r))))
+
+/* h64_round ****************************************************************/
+static uint64_t h64_round
+(
+    uint64_t acc,
+    uint64_t input
+)
+{
+    acc += input * H64_P2;
+    acc = H64_ROTL(acc, 31);
+    return acc * H64_P1;
+}
+
+/* h64_merge ****************************************************************/
+static uint64_t h64_merge
+(
+    uint64_t acc,
+    uint64_t v
+)
+{
+    acc ^= h64_round(0, v);
+    return acc * H64_P1 + H64_P4;
+}
+
+/* c42_h64_init *************************************************************/
+C42_API void C42_CALL c42_h64_init
+(
+    c42_h64_t * h,
+    uint64_t seed
+)
+{
+    h->v[0] = seed + H64_P1 + H64_P2;
+    h->v[1] = seed + H64_P2;
+    h->v[2] = seed;
+    h->v[3] = seed - H64_P1;
+    h->total = 0;
+    h->seed = seed;
+    h->buf_len = 0;
+}
+
+/* h64_stripes **************************************************************/
+/**
+ *  Processes whole 32-byte stripes; returns the number of bytes used.
+ */
+static size_t h64_stripes
+(
+    uint64_t * v,
+    uint8_t const * p,
+    size_t len
+)
+{
+    size_t i;
+    for (i = 0; len - i >= 32; i += 32)
+    {
+        v[0] = h64_round(v[0], le64_get(p + i));
+        v[1] = h64_round(v[1], le64_get(p + i + 8));
+        v[2] = h64_round(v[2], le64_get(p + i + 16));
+        v[3] = h64_round(v[3], le64_get(p + i + 24));
+    }
+    return i;
+}
+
+/* c42_h64_update ***********************************************************/
+C42_API void C42_CALL c42_h64_update
+(
+    c42_h64_t * h,
+    uint8_t const * data,
+    size_t len
+)
+{
+    size_t n;
+
+    h->total += len;
+    if (h->buf_len)
+    {
+        n = 32 - h->buf_len;
+        if (n > len) n = len;
+        c42_u8a_copy(h->buf + h->buf_len, data, n);
+        h->buf_len += (uint32_t) n;
+        data += n;
+        len -= n;
+        if (h->buf_len < 32) return;
+        h64_stripes(h->v, h->buf, 32);
+        h->buf_len = 0;
+    }
+    n = h64_stripes(h->v, data, len);
+    c42_u8a_copy(h->buf, data + n, len - n);
+    h->buf_len = (uint32_t) (len - n);
+}
+
+/* c42_h64_digest ***********************************************************/
+C42_API uint64_t C42_CALL c42_h64_digest
+(
+    c42_h64_t const * h
+)
+{
+    uint8_t const * p = h->buf;
+    size_t len = h->buf_len;
+    uint64_t r;
+
+    if (h->total >= 32)
+    {
+        r = H64_ROTL(h->v[0], 1) + H64_ROTL(h->v[1], 7)
+            + H64_ROTL(h->v[2], 12) + H64_ROTL(h->v[3], 18);
+        r = h64_merge(r, h->v[0]);
+        r = h64_merge(r, h->v[1]);
+        r = h64_merge(r, h->v[2]);
+        r = h64_merge(r, h->v[3]);
+    }
+    else r = h->seed + H64_P5;
+    r += h->total;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        r ^= h64_round(0, le64_get(p));
+        r = H64_ROTL(r, 27) * H64_P1 + H64_P4;
+    }
+    if (len >= 4)
+    {
+        r ^= (uint64_t) lz_get32(p) * H64_P1;
+        r = H64_ROTL(r, 23) * H64_P2 + H64_P3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len; ++p, --len)
+    {
+        r ^= *p * H64_P5;
+        r = H64_ROTL(r, 11) * H64_P1;
+    }
+    r ^= r >> 33;
+    r *= H64_P2;
+    r ^= r >> 29;
+    r *= H64_P3;
+    r ^= r >> 32;
+    return r;
+}
+
+/* c42_h64 ******************************************************************/
+C42_API uint64_t C42_CALL c42_h64
+(
+    uint8_t const * data,
+    size_t len,
+    uint64_t seed
+)
+{
+    c42_h64_t h;
+    c42_h64_init(&h, seed);
+    c42_h64_update(&h, data, len);
+    return c42_h64_digest(&h);
+}
+
+/* io8sum_add ***************************************************************/
+static void io8sum_add
+(
+    c42_io8sum_t * sum,
+    uint8_t const * data,
+    size_t len
+)
+{
+    if ((sum->algos & C42_IO8SUM_CRC32C))
+        sum->crc32c = c42_crc32c(sum->crc32c, data, len);
+    if ((sum->algos & C42_IO8SUM_H64)) c42_h64_update(&sum->h64, data, len);
+    sum->size += len;
+}
+
+/* io8sum_read **************************************************************/
+static uint_fast8_t C42_CALL io8sum_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8sum_t * sum = (c42_io8sum_t *) ctx;
+    uint_fast8_t ioe;
+    *rsize = 0;
+    ioe = c42_io8_read(sum->io, data, size, rsize);
+    io8sum_add(sum, data, *rsize);
+    return ioe;
+}
+
+/* io8sum_write *************************************************************/
+static uint_fast8_t C42_CALL io8sum_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8sum_t * sum = (c42_io8sum_t *) ctx;
+    uint_fast8_t ioe;
+    *wsize = 0;
+    ioe = c42_io8_write(sum->io, data, size, wsize);
+    io8sum_add(sum, data, *wsize);
+    return ioe;
+}
+
+/* io8sum_close *************************************************************/
+static uint_fast8_t C42_CALL io8sum_close
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_io8sum_t * sum = (c42_io8sum_t *) ctx;
+    return c42_io8_close(sum->io, mode);
+}
+
+/* io8sum_peek **************************************************************/
+static uint_fast8_t C42_CALL io8sum_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_io8sum_t * sum = (c42_io8sum_t *) ctx;
+    uint_fast8_t ioe;
+    ioe = c42_io8_peek(sum->io, min_size, ptr, avail);
+    sum->peek_ptr = ioe ? NULL : *ptr;
+    return ioe;
+}
+
+/* io8sum_consume ***********************************************************/
+static uint_fast8_t C42_CALL io8sum_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_io8sum_t * sum = (c42_io8sum_t *) ctx;
+    uint_fast8_t ioe;
+    if (!size) return c42_io8_consume(sum->io, 0);
+    if (!sum->peek_ptr) return C42_IO8_BAD_SIZE;
+    ioe = c42_io8_consume(sum->io, size);
+    if (ioe) return ioe;
+    io8sum_add(sum, sum->peek_ptr, size);
+    sum->peek_ptr += size;
+    return 0;
+}
+
+/* io8sum_class *************************************************************/
+static c42_io8_class_t io8sum_class =
+{
+    io8sum_read,
+    io8sum_write,
+    NULL,
+    NULL,
+    NULL,
+    io8sum_close,
+    NULL,
+    NULL,
+    io8sum_peek,
+    io8sum_consume,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0
+};
+
+/* c42_io8sum_init **********************************************************/
+C42_API c42_io8_t * C42_CALL c42_io8sum_init
+(
+    c42_io8sum_t * sum,
+    c42_io8_t * io,
+    unsigned int algos,
+    uint64_t seed
+)
+{
+    sum->io8.io8_class = &io8sum_class;
+    sum->io8.context = (uintptr_t) sum;
+    sum->io = io;
+    sum->peek_ptr = NULL;
+    sum->size = 0;
+    sum->crc32c = 0;
+    sum->algos = algos;
+    c42_h64_init(&sum->h64, seed);
+    return &sum->io8;
+}
+
+/* io8stats_now *************************************************************/
+static uint64_t io8stats_now
+(
+    c42_io8stats_t * s
+)
+{
+    return s->clock ? c42_clock_monotonic_ns(s->clock) : 0;
+}
+
+/* io8stats_record **********************************************************/
+static void io8stats_record
+(
+    c42_io8stats_t * s,
+    unsigned int kind,
+    uint64_t t0,
+    uint_fast8_t ioe,
+    size_t req,
+    size_t done
+)
+{
+    c42_io8stats_op_t * op = &s->op[kind];
+    uint64_t ns, max;
+    unsigned int b;
+
+    /* pread/pwrite can run concurrently (see C42_IO8_CLASS_MT_PIO) */
+    ATOMIC_ADD_RLX(&op->count, 1);
+    ATOMIC_ADD_RLX(&op->bytes, (uint64_t) done);
+    if (ioe == C42_IO8_INTERRUPTED) ATOMIC_ADD_RLX(&op->interrupted, 1);
+    else if (ioe) ATOMIC_ADD_RLX(&op->errors, 1);
+    else if (done < req) ATOMIC_ADD_RLX(&op->short_count, 1);
+    if (!s->clock) return;
+    ns = c42_clock_monotonic_ns(s->clock) - t0;
+    ATOMIC_ADD_RLX(&op->ns_total, ns);
+    max = ATOMIC_LOAD_RLX(&op->ns_max);
+    while (ns > max && !ATOMIC_CAS_RLX(&op->ns_max, &max, ns));
+    for (b = 0; b < C42_IO8STATS_BUCKETS - 1 && (ns >> b); ++b);
+    ATOMIC_ADD_RLX(&op->hist[b], 1);
+}
+
+/* io8stats_read ************************************************************/
+static uint_fast8_t C42_CALL io8stats_read
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    size_t * rsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *rsize = 0;
+    ioe = s->io->io8_class->read(s->io->context, data, size, rsize);
+    io8stats_record(s, C42_IO8STATS_READ, t0, ioe, size, *rsize);
+    return ioe;
+}
+
+/* io8stats_write ***********************************************************/
+static uint_fast8_t C42_CALL io8stats_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *wsize = 0;
+    ioe = s->io->io8_class->write(s->io->context, data, size, wsize);
+    io8stats_record(s, C42_IO8STATS_WRITE, t0, ioe, size, *wsize);
+    return ioe;
+}
+
+/* io8stats_seek ************************************************************/
+static uint_fast8_t C42_CALL io8stats_seek
+(
+    uintptr_t ctx,
+    ptrdiff_t offset,
+    int anchor,
+    size_t * pos
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->seek(s->io->context, offset, anchor, pos);
+    io8stats_record(s, C42_IO8STATS_SEEK, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_seek64 **********************************************************/
+static uint_fast8_t C42_CALL io8stats_seek64
+(
+    uintptr_t ctx,
+    int64_t offset,
+    int anchor,
+    uint64_t * pos
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->seek64(s->io->context, offset, anchor, pos);
+    io8stats_record(s, C42_IO8STATS_SEEK, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_truncate ********************************************************/
+static uint_fast8_t C42_CALL io8stats_truncate
+(
+    uintptr_t ctx
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->truncate(s->io->context);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_close ***********************************************************/
+static uint_fast8_t C42_CALL io8stats_close
+(
+    uintptr_t ctx,
+    int mode
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->close(s->io->context, mode);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_seg_size ********************************************************/
+static size_t io8stats_seg_size
+(
+    c42_u8an_t const * seg,
+    size_t count
+)
+{
+    size_t i, n;
+    for (n = 0, i = 0; i < count; ++i) n += seg[i].n;
+    return n;
+}
+
+/* io8stats_writev **********************************************************/
+static uint_fast8_t C42_CALL io8stats_writev
+(
+    uintptr_t ctx,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * wsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *wsize = 0;
+    ioe = s->io->io8_class->writev(s->io->context, seg, count, wsize);
+    io8stats_record(s, C42_IO8STATS_WRITE, t0, ioe,
+                    io8stats_seg_size(seg, count), *wsize);
+    return ioe;
+}
+
+/* io8stats_readv ***********************************************************/
+static uint_fast8_t C42_CALL io8stats_readv
+(
+    uintptr_t ctx,
+    c42_u8an_t const * seg,
+    size_t count,
+    size_t * rsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *rsize = 0;
+    ioe = s->io->io8_class->readv(s->io->context, seg, count, rsize);
+    io8stats_record(s, C42_IO8STATS_READ, t0, ioe,
+                    io8stats_seg_size(seg, count), *rsize);
+    return ioe;
+}
+
+/* io8stats_peek ************************************************************/
+static uint_fast8_t C42_CALL io8stats_peek
+(
+    uintptr_t ctx,
+    size_t min_size,
+    uint8_t const * * ptr,
+    size_t * avail
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->peek(s->io->context, min_size, ptr, avail);
+    /* bytes are counted when consumed */
+    io8stats_record(s, C42_IO8STATS_READ, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_consume *********************************************************/
+static uint_fast8_t C42_CALL io8stats_consume
+(
+    uintptr_t ctx,
+    size_t size
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->consume(s->io->context, size);
+    if (!ioe) ATOMIC_ADD_RLX(&s->op[C42_IO8STATS_READ].bytes, (uint64_t) size);
+    return ioe;
+}
+
+/* io8stats_pread ***********************************************************/
+static uint_fast8_t C42_CALL io8stats_pread
+(
+    uintptr_t ctx,
+    uint8_t * data,
+    size_t size,
+    uint64_t offset,
+    size_t * rsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *rsize = 0;
+    ioe = s->io->io8_class->pread(s->io->context, data, size, offset, rsize);
+    io8stats_record(s, C42_IO8STATS_READ, t0, ioe, size, *rsize);
+    return ioe;
+}
+
+/* io8stats_pwrite **********************************************************/
+static uint_fast8_t C42_CALL io8stats_pwrite
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    size_t * wsize
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    *wsize = 0;
+    ioe = s->io->io8_class->pwrite(s->io->context, data, size, offset, wsize);
+    io8stats_record(s, C42_IO8STATS_WRITE, t0, ioe, size, *wsize);
+    return ioe;
+}
+
+/* io8stats_stat ************************************************************/
+static uint_fast8_t C42_CALL io8stats_stat
+(
+    uintptr_t ctx,
+    c42_fsa_stat_t * st
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->stat(s->io->context, st);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_allocate ********************************************************/
+static uint_fast8_t C42_CALL io8stats_allocate
+(
+    uintptr_t ctx,
+    uint64_t offset,
+    uint64_t size
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->allocate(s->io->context, offset, size);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_sync ************************************************************/
+static uint_fast8_t C42_CALL io8stats_sync
+(
+    uintptr_t ctx,
+    int flags
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->sync(s->io->context, flags);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* io8stats_advise **********************************************************/
+static uint_fast8_t C42_CALL io8stats_advise
+(
+    uintptr_t ctx,
+    uint64_t offset,
+    uint64_t size,
+    int advice
+)
+{
+    c42_io8stats_t * s = (c42_io8stats_t *) ctx;
+    uint64_t t0 = io8stats_now(s);
+    uint_fast8_t ioe;
+    ioe = s->io->io8_class->advise(s->io->context, offset, size, advice);
+    io8stats_record(s, C42_IO8STATS_OTHER, t0, ioe, 0, 0);
+    return ioe;
+}
+
+/* c42_io8stats_init ********************************************************/
+C42_API c42_io8_t * C42_CALL c42_io8stats_init
+(
+    c42_io8stats_t * stats,
+    c42_io8_t * io,
+    c42_clock_t * clock
+)
+{
+    c42_io8_class_t const * u = io->io8_class;
+    c42_io8_class_t * c = &stats->io8_class;
+
+    /* only wrap what the stream implements so emulations still apply */
+    c->read = u->read ? io8stats_read : NULL;
+    c->write = u->write ? io8stats_write : NULL;
+    c->seek = u->seek ? io8stats_seek : NULL;
+    c->seek64 = u->seek64 ? io8stats_seek64 : NULL;
+    c->truncate = u->truncate ? io8stats_truncate : NULL;
+    c->close = u->close ? io8stats_close : NULL;
+    c->writev = u->writev ? io8stats_writev : NULL;
+    c->readv = u->readv ? io8stats_readv : NULL;
+    c->peek = u->peek ? io8stats_peek : NULL;
+    c->consume = u->consume ? io8stats_consume : NULL;
+    c->copy_to = NULL;
+    c->copy_from = NULL;
+    c->pread = u->pread ? io8stats_pread : NULL;
+    c->pwrite = u->pwrite ? io8stats_pwrite : NULL;
+    c->stat = u->stat ? io8stats_stat : NULL;
+    c->allocate = u->allocate ? io8stats_allocate : NULL;
+    c->sync = u->sync ? io8stats_sync : NULL;
+    c->advise = u->advise ? io8stats_advise : NULL;
+    c->flags = u->flags;
+    stats->io8.io8_class = c;
+    stats->io8.context = (uintptr_t) stats;
+    stats->io = io;
+    stats->clock = clock;
+    c42_io8stats_reset(stats);
+    return &stats->io8;
+}
+
+/* c42_io8stats_reset *******************************************************/
+C42_API void C42_CALL c42_io8stats_reset
+(
+    c42_io8stats_t * stats
+)
+{
+    C42_VAR_CLEAR(stats->op);
+}
+
+/* c42_io8stats_dump ********************************************************/
+C42_API uint_fast8_t C42_CALL c42_io8stats_dump
+(
+    c42_io8stats_t const * stats,
+    c42_io8_t * out,
+    char const * name
+)
+{
+    static char const * const op_name[C42_IO8STATS_OP_COUNT] =
+        { "read", "write", "seek", "other" };
+    c42_io8stats_op_t const * op;
+    unsigned int k, b;
+    uint_fast8_t ioe;
+
+    if (!name) name = "io8";
+    for (k = 0; k < C42_IO8STATS_OP_COUNT; ++k)
+    {
+        op = &stats->op[k];
+        if (!op->count) continue;
+        ioe = c42_io8_fmt(out, "$s $s: calls=$q bytes=$q short=$q intr=$q "
+                          "err=$q avg_ns=$q max_ns=$q\n", name, op_name[k],
+                          op->count, op->bytes, op->short_count,
+                          op->interrupted, op->errors,
+                          op->ns_total / op->count, op->ns_max);
+        if (ioe) return ioe;
+        if (!stats->clock) continue;
+        ioe = c42_io8_fmt(out, "$s $s: ns_hist", name, op_name[k]);
+        for (b = 0; !ioe && b < C42_IO8STATS_BUCKETS; ++b)
+        {
+            if (!op->hist[b]) continue;
+            /* bucket b holds latencies below 2^b ns */
+            if (b < C42_IO8STATS_BUCKETS - 1)
+                ioe = c42_io8_fmt(out, " <$q:$q", (uint64_t) 1 << b,
+                                  op->hist[b]);
+            else ioe = c42_io8_fmt(out, " >=$q:$q", (uint64_t) 1 << (b - 1),
+                                   op->hist[b]);
+        }
+        if (!ioe) ioe = C42_IO8_WRITE_LIT(out, "\n");
+        if (ioe) return ioe;
+    }
+    return 0;
+}
+
+/* reactor_now_tick *********************************************************/
+static uint64_t reactor_now_tick
+(
+    c42_reactor_t * r
+)
+{
+    return (c42_clock_monotonic_ns(r->clock) - r->start_ns) / r->tick_ns;
+}
+
+/* c42_reactor_init *********************************************************/
+C42_API void C42_CALL c42_reactor_init
+(
+    c42_reactor_t * reactor,
+    c42_poller_t * poller,
+    c42_clock_t * clock,
+    uint64_t tick_ns
+)
+{
+    size_t i;
+
+    reactor->poller = poller;
+    reactor->clock = clock;
+    reactor->start_ns = c42_clock_monotonic_ns(clock);
+    reactor->tick_ns = tick_ns ? tick_ns : C42_REACTOR_DEFAULT_TICK_NS;
+    reactor->tick = 0;
+    reactor->watch_n = reactor->timer_n = 0;
+    reactor->ev_pos = reactor->ev_n = 0;
+    for (i = 0; i < C42_REACTOR_WHEEL_SIZE; ++i)
+        c42_dlist_init(&reactor->wheel[i]);
+    reactor->stop = 0;
+}
+
+/* c42_reactor_watch ********************************************************/
+C42_API uint_fast8_t C42_CALL c42_reactor_watch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch,
+    c42_io8_t * io,
+    unsigned int events,
+    c42_reactor_watch_f func,
+    void * context
+)
+{
+    uint_fast8_t pe;
+
+    watch->io = io;
+    watch->func = func;
+    watch->context = context;
+    watch->events = events;
+    pe = reactor->poller->add(reactor->poller, io, events, (uintptr_t) watch);
+    if (!pe) reactor->watch_n++;
+    return pe;
+}
+
+/* c42_reactor_rewatch ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_reactor_rewatch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch,
+    unsigned int events
+)
+{
+    uint_fast8_t pe;
+
+    pe = reactor->poller->modify(reactor->poller, watch->io, events,
+                                 (uintptr_t) watch);
+    if (!pe) watch->events = events;
+    return pe;
+}
+
+/* c42_reactor_unwatch ******************************************************/
+C42_API uint_fast8_t C42_CALL c42_reactor_unwatch
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch
+)
+{
+    size_t i;
+    uint_fast8_t pe;
+
+    pe = reactor->poller->remove(reactor->poller, watch->io);
+    if (pe) return pe;
+    reactor->watch_n--;
+    /* drop events of this batch not dispatched yet */
+    for (i = reactor->ev_pos; i < reactor->ev_n; ++i)
+        if (reactor->ev_a[i].tag == (uintptr_t) watch)
+            reactor->ev_a[i].tag = 0;
+    return 0;
+}
+
+/* c42_reactor_timer_start **************************************************/
+C42_API void C42_CALL c42_reactor_timer_start
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer,
+    uint64_t delay_ns,
+    c42_reactor_timer_f func,
+    void * context
+)
+{
+    uint64_t t;
+
+    c42_reactor_timer_stop(reactor, timer);
+    /* round up so timers never fire early */
+    t = c42_clock_monotonic_ns(reactor->clock) - reactor->start_ns;
+    t = t + delay_ns < t ? UINT64_MAX : t + delay_ns;
+    t = t / reactor->tick_ns + (t % reactor->tick_ns != 0);
+    if (t <= reactor->tick) t = reactor->tick + 1;
+    timer->tick = t;
+    timer->func = func;
+    timer->context = context;
+    timer->active = 1;
+    C42_DLIST_APPEND(reactor->wheel[t & (C42_REACTOR_WHEEL_SIZE - 1)],
+                     timer, links);
+    reactor->timer_n++;
+}
+
+/* c42_reactor_timer_stop ***************************************************/
+C42_API void C42_CALL c42_reactor_timer_stop
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer
+)
+{
+    if (!timer->active) return;
+    c42_dlist_del(&timer->links);
+    timer->active = 0;
+    reactor->timer_n--;
+}
+
+/* reactor_timeout **********************************************************/
+/**
+ *  Returns how long to wait for events so that the next occupied wheel
+ *  slot is processed in time.
+ */
+static uint64_t reactor_timeout
+(
+    c42_reactor_t * r,
+    uint64_t max_wait_ns
+)
+{
+    uint64_t t, due_ns, now_ns;
+
+    if (!r->timer_n) return max_wait_ns;
+    for (t = r->tick + 1; t <= r->tick + C42_REACTOR_WHEEL_SIZE; ++t)
+        if (!c42_dlist_is_empty(&r->wheel[t & (C42_REACTOR_WHEEL_SIZE - 1)]))
+            break;
+    /* slots can hold timers of later revolutions: waking up for them is
+     * harmless */
+    due_ns = t * r->tick_ns;
+    now_ns = c42_clock_monotonic_ns(r->clock) - r->start_ns;
+    if (due_ns <= now_ns) return 0;
+    return due_ns - now_ns < max_wait_ns ? due_ns - now_ns : max_wait_ns;
+}
+
+/* reactor_expire ***********************************************************/
+static void reactor_expire
+(
+    c42_reactor_t * r
+)
+{
+    c42_np_t due;
+    c42_np_t * slot;
+    c42_reactor_timer_t * timer;
+    uint64_t now;
+
+    now = reactor_now_tick(r);
+    /* after a long stall visit every slot once */
+    if (now > r->tick + C42_REACTOR_WHEEL_SIZE)
+        r->tick = now - C42_REACTOR_WHEEL_SIZE;
+    while (r->tick < now)
+    {
+        r->tick++;
+        slot = &r->wheel[r->tick & (C42_REACTOR_WHEEL_SIZE - 1)];
+        if (c42_dlist_is_empty(slot)) continue;
+        /* detach the slot so callbacks can start timers in it */
+        c42_dlist_init(&due);
+        c42_dlist_extend(&due, slot, C42_NEXT);
+        c42_dlist_init(slot);
+        while (!c42_dlist_is_empty(&due))
+        {
+            timer = C42_STRUCT_FROM_FIELD_PTR(c42_reactor_timer_t, links,
+                                              due.next);
+            c42_dlist_del(&timer->links);
+            if (timer->tick > now)
+            {
+                C42_DLIST_APPEND(*slot, timer, links);
+                continue;
+            }
+            timer->active = 0;
+            r->timer_n--;
+            timer->func(r, timer);
+        }
+    }
+}
 
-  // d is black and has no children (if c is black and its sibling is NULL then
-  // it must be NULL itself)
+/* c42_reactor_run_once *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_reactor_run_once
+(
+    c42_reactor_t * reactor,
+    uint64_t max_wait_ns
+)
+{
+    c42_reactor_watch_t * watch;
+    c42_poll_event_t * ev;
+    size_t n;
+    uint_fast8_t pe;
 
-  p->links[ds] = n = NULL;
+    pe = reactor->poller->wait(reactor->poller, reactor->ev_a,
+                               C42_REACTOR_BATCH,
+                               reactor_timeout(reactor, max_wait_ns), &n);
+    if (pe == C42_POLL_INTERRUPTED) n = 0;
+    else if (pe) return pe;
+    reactor->ev_n = n;
+    for (reactor->ev_pos = 0; reactor->ev_pos < reactor->ev_n; )
+    {
+        ev = &reactor->ev_a[reactor->ev_pos++];
+        if (!ev->tag) continue;
+        watch = (c42_reactor_watch_t *) ev->tag;
+        watch->func(reactor, watch, ev->events);
+    }
+    reactor->ev_pos = reactor->ev_n = 0;
+    reactor_expire(reactor);
+    return 0;
+}
 
-  for (pd = dd - 1; pd; p = path->nodes[--pd])
-  {
-    // n is always black (in first iteration it is NULL)
-    ns = path->sides[pd];
-    ss = OTHER_SIDE(ns);
-    s = p->links[ss]; // this is a non-NULL node
-    //M("p: %p, s: %p\n", p, s);
-    if (s->red) // implies p is black
+/* c42_reactor_run **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_reactor_run
+(
+    c42_reactor_t * reactor
+)
+{
+    uint_fast8_t pe;
+
+    reactor->stop = 0;
+    while (!reactor->stop && (reactor->watch_n || reactor->timer_n))
     {
-      /* del case 2 */
-      t = path->nodes[pd - 1];
-      ps = path->sides[pd - 1];
-      t->links[ps] = s;
-      p->links[ss] = sl = s->links[ns];
-      p->red = 1;
-      s->links[ns] = p;
-      s->red = 0;
-      path->nodes[pd] = s;
-      ++pd;
-      s = sl; /* new s is black */
+        pe = c42_reactor_run_once(reactor, C42_POLL_INFINITE);
+        if (pe) return pe;
     }
-    else
+    return 0;
+}
+
+/* rlog_magic ***************************************************************/
+static uint8_t const rlog_magic[8] =
+{
+    'C', '4', '2', 'R', 'L', 'O', 'G', '1'
+};
+
+/* c42_rlog_segment_name ****************************************************/
+C42_API void C42_CALL c42_rlog_segment_name
+(
+    uint8_t * name,
+    uint64_t first_seq
+)
+{
+    static uint8_t const hex[] = "0123456789abcdef";
+    unsigned int i;
+
+    for (i = 0; i < 16; ++i) name[i] = hex[(first_seq >> (60 - i * 4)) & 15];
+    c42_u8a_copy(name + 16, (uint8_t const *) ".rlog", 6);
+}
+
+/* rlog_path_init ***********************************************************/
+static uint_fast8_t rlog_path_init
+(
+    c42_ma_t * ma,
+    uint8_t const * prefix,
+    uint8_t * * path,
+    size_t * prefix_len
+)
+{
+    *prefix_len = c42_u8z_len(prefix);
+    *path = NULL;
+    if (C42_MA_ARRAY_ALLOC(ma, *path, *prefix_len + C42_RLOG_NAME_SIZE))
+        return C42_RLOG_NO_MEM;
+    c42_u8a_copy(*path, prefix, *prefix_len);
+    return 0;
+}
+
+/* rlog_seg_open ************************************************************/
+/**
+ *  Creates the segment starting at @a seq and writes its header.
+ */
+static uint_fast8_t rlog_seg_open
+(
+    c42_rlog_t * log,
+    uint64_t seq
+)
+{
+    uint8_t hdr[C42_RLOG_SEG_HDR_SIZE];
+    uint_fast8_t ioe;
+
+    c42_rlog_segment_name(log->path + log->prefix_len, seq);
+    if (c42_file_open(log->fsa, &log->io, log->path,
+                      C42_FSA_CREATE_ALWAYS | C42_FSA_WRITE
+                      | C42_FSA_UR | C42_FSA_UW | C42_FSA_GR))
+        return C42_RLOG_FSA_ERROR;
+    c42_u8a_copy(hdr, rlog_magic, 8);
+    lz_put32(hdr + 8, (uint32_t) seq);
+    lz_put32(hdr + 12, (uint32_t) (seq >> 32));
+    ioe = c42_io8_write_full(&log->io, hdr, sizeof(hdr), NULL);
+    if (ioe)
     {
-    //M("p: %p, s: %p, sl: %p, sr: %p\n", p, s, s->links[0], s->links[1]);
-      // s is black
-      if (!p->red && IS_BLACK(s->links[0]) && IS_BLACK(s->links[1]))
-      {
-        /* del case 3 */
-        s->red = 1;
-        continue;
-      }
+        c42_io8_close(&log->io, C42_IO8_OP_WRITE);
+        log->io_error = ioe;
+        return C42_RLOG_IO_ERROR;
     }
-    // s must be black
-    sl = s->links[ns];
-    sr = s->links[ss];
-    if (p->red && IS_BLACK(sl) && IS_BLACK(sr))
+    log->seg_open = 1;
+    log->seg_size = sizeof(hdr);
+    return 0;
+}
+
+/* rlog_sync ****************************************************************/
+static uint_fast8_t rlog_sync
+(
+    c42_rlog_t * log
+)
+{
+    uint_fast8_t ioe;
+
+    if (log->flags & C42_RLOG_NO_SYNC) return 0;
+    ioe = c42_io8_sync(&log->io, C42_IO8_SYNC_DATA);
+    if (!ioe) return 0;
+    log->io_error = ioe;
+    return C42_RLOG_IO_ERROR;
+}
+
+/* rlog_write ***************************************************************/
+/**
+ *  Writes a batch of encoded records, rotating segments as needed, then
+ *  syncs once. Runs without the lock, in the commit leader.
+ */
+static uint_fast8_t rlog_write
+(
+    c42_rlog_t * log,
+    uint8_t const * data,
+    size_t len,
+    uint64_t seq
+)
+{
+    uint8_t const * end = data + len;
+    uint8_t const * q;
+    uint64_t size, rec;
+    uint_fast8_t ioe, r;
+
+    while (data < end)
     {
-      /* del case 4 */
-      p->red = 0;
-      s->red = 1;
-      break;
+        /* longest run of records fitting in the current segment */
+        for (q = data, size = log->seg_size; q < end; q += rec, size += rec)
+        {
+            rec = C42_RLOG_REC_HDR_SIZE + (uint64_t) lz_get32(q);
+            if (size + rec > log->seg_limit
+                && size > C42_RLOG_SEG_HDR_SIZE) break;
+            seq++;
+        }
+        if (q != data)
+        {
+            ioe = c42_io8_write_full(&log->io, data, q - data, NULL);
+            if (ioe)
+            {
+                log->io_error = ioe;
+                return C42_RLOG_IO_ERROR;
+            }
+            log->seg_size = size;
+            data = q;
+        }
+        if (data == end) break;
+        r = rlog_sync(log);
+        if (r) return r;
+        log->seg_open = 0;
+        ioe = c42_io8_close(&log->io, C42_IO8_OP_WRITE);
+        if (ioe)
+        {
+            log->io_error = ioe;
+            return C42_RLOG_IO_ERROR;
+        }
+        r = rlog_seg_open(log, seq);
+        if (r) return r;
     }
-    if (IS_RED(sl) && IS_BLACK(sr))
+    return rlog_sync(log);
+}
+
+/* c42_rlog_open ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_open
+(
+    c42_rlog_t * log,
+    c42_fsa_t * fsa,
+    c42_smt_t * smt,
+    c42_ma_t * ma,
+    uint8_t const * prefix,
+    uint64_t first_seq,
+    uint64_t seg_limit,
+    unsigned int flags
+)
+{
+    uint_fast8_t r;
+
+    C42_VAR_CLEAR(*log);
+    log->fsa = fsa;
+    log->smt = smt;
+    log->ma = ma;
+    log->seg_limit = seg_limit;
+    log->buf_seq = log->next_seq = log->durable_seq = first_seq;
+    log->flags = flags;
+    r = rlog_path_init(ma, prefix, &log->path, &log->prefix_len);
+    if (r) return r;
+    if (c42_smt_mutex_create(&log->mutex, smt, ma))
     {
-      p->links[ss] = sl;
-      s->links[ns] = sl->links[ss];
-      s->red = 1;
-      sl->links[ss] = s;
-      sl->red = 0;
-      s = sl; // again new s is black
-      sl = s->links[ns];
-      sr = s->links[ss];
+        r = C42_RLOG_SMT_ERROR;
+        goto l_path;
     }
-    if (IS_RED(sr))
+    if (c42_smt_cond_create(&log->cond, smt, ma))
     {
-      t = path->nodes[pd - 1];
-      ps = path->sides[pd - 1];
-      t->links[ps] = s;
-      p->links[ss] = sl;
-      s->red = p->red;
-      p->red = 0;
-      sr->red = 0;
-      s->links[ns] = p;
+        r = C42_RLOG_SMT_ERROR;
+        goto l_mutex;
     }
-    break;
-  }
+    r = rlog_seg_open(log, first_seq);
+    if (!r) return 0;
 
-//L("tree after deletion:\n"); RBTREE_DUMP(path->nodes[0]->links[0]);
-  return;
+    c42_smt_cond_destroy(log->cond, smt, ma);
+l_mutex:
+    c42_smt_mutex_destroy(log->mutex, smt, ma);
+l_path:
+    C42_MA_ARRAY_FREE(ma, log->path, log->prefix_len + C42_RLOG_NAME_SIZE);
+    return r;
 }
-#undef OTHER_SIDE
-#undef IS_RED
-#undef IS_BLACK
 
-/* c42_u32_bit_width ********************************************************/
-C42_API uint_fast8_t C42_CALL c42_u32_bit_width (uint32_t n)
+/* c42_rlog_append **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_append
+(
+    c42_rlog_t * log,
+    void const * data,
+    size_t size,
+    uint64_t * seq
+)
 {
-    uint_fast8_t i;
-    for (i = 0x1F; i; --i)
-        if (n >> i) return i + 1;
-    /* n is 0 or 1 */
-    return (uint_fast8_t) n;
+    uint8_t hdr[C42_RLOG_REC_HDR_SIZE];
+    size_t need, cap;
+    uint_fast8_t r;
+
+    if (size > 0x7FFFFFFF) return C42_RLOG_TOO_BIG;
+    lz_put32(hdr, (uint32_t) size);
+    lz_put32(hdr + 4, c42_crc32c(c42_crc32c(0, hdr, 4), data, size));
+
+    c42_smt_mutex_lock(log->smt, log->mutex);
+    r = log->error;
+    if (r) goto l_unlock;
+    need = log->buf_len + sizeof(hdr) + size;
+    if (need > log->buf_size)
+    {
+        for (cap = log->buf_size ? log->buf_size : 0x1000; cap < need;
+             cap <<= 1);
+        if (C42_MA_ARRAY_REALLOC(log->ma, log->buf, log->buf_size, cap))
+        {
+            r = C42_RLOG_NO_MEM;
+            goto l_unlock;
+        }
+        log->buf_size = cap;
+    }
+    c42_u8a_copy(log->buf + log->buf_len, hdr, sizeof(hdr));
+    if (size) c42_u8a_copy(log->buf + log->buf_len + sizeof(hdr), data, size);
+    log->buf_len = need;
+    if (seq) *seq = log->next_seq;
+    log->next_seq++;
+l_unlock:
+    c42_smt_mutex_unlock(log->smt, log->mutex);
+    return r;
 }
 
-/* malim_handler ************************************************************/
-static uint_fast8_t C42_CALL malim_handler
+/* c42_rlog_commit **********************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_commit
 (
-    void * * ptr_p,
-    size_t old_size,
-    size_t new_size,
-    void * ctx
+    c42_rlog_t * log,
+    uint64_t seq
 )
 {
-    size_t nb, ts;
-    c42_malim_ctx_t * q = ctx;
-    uint_fast8_t mae;
-    if (new_size > q->bs_lim) return C42_MA_LIMIT;
-    if (new_size > old_size)
+    uint8_t * data;
+    size_t len, size;
+    uint64_t first, last;
+    uint_fast8_t r;
+
+    c42_smt_mutex_lock(log->smt, log->mutex);
+    if (seq >= log->next_seq) seq = log->next_seq - 1;
+    while (log->durable_seq <= seq && log->durable_seq != log->next_seq
+           && !log->error)
     {
-        nb = q->nb;
-        if (old_size == 0)
+        if (log->leader)
         {
-            if (nb == q->nb_lim) return C42_MA_LIMIT;
-            ++nb;
+            log->waiter_n++;
+            c42_smt_cond_wait(log->smt, log->cond, log->mutex);
+            log->waiter_n--;
+            continue;
         }
-        ts = new_size - old_size;
-        if (ts + q->ts < ts) return C42_MA_LIMIT;
-        ts += q->ts;
-        if (ts > q->ts_lim) return C42_MA_LIMIT;
+        /* become the leader: take everything appended so far, so callers
+         * arriving meanwhile append to the other buffer */
+        log->leader = 1;
+        data = log->buf;
+        len = log->buf_len;
+        size = log->buf_size;
+        first = log->buf_seq;
+        last = log->next_seq;
+        log->buf = log->spare;
+        log->buf_size = log->spare_size;
+        log->buf_len = 0;
+        log->buf_seq = last;
+        c42_smt_mutex_unlock(log->smt, log->mutex);
+
+        r = rlog_write(log, data, len, first);
+
+        c42_smt_mutex_lock(log->smt, log->mutex);
+        log->spare = data;
+        log->spare_size = size;
+        log->leader = 0;
+        if (r) log->error = r;
+        else log->durable_seq = last;
     }
-    else
+    r = log->durable_seq > seq || log->durable_seq == log->next_seq
+        ? 0 : log->error;
+    /* the condition is only signalled: each woken waiter wakes the next */
+    if (log->waiter_n) c42_smt_cond_signal(log->smt, log->cond);
+    c42_smt_mutex_unlock(log->smt, log->mutex);
+    return r;
+}
+
+/* c42_rlog_close ***********************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_close
+(
+    c42_rlog_t * log
+)
+{
+    uint_fast8_t r, ioe;
+
+    r = c42_rlog_commit(log, log->next_seq);
+    /* a failed rotation leaves no segment open */
+    ioe = log->seg_open ? c42_io8_close(&log->io, C42_IO8_OP_WRITE) : 0;
+    if (ioe && !r)
     {
-        if (new_size == old_size) return 0;
-        ts = old_size - new_size;
-#if _DEBUG
-        if (q->ts < ts) return C42_MA_CORRUPT;
-        if (new_size == 0 && q->nb == 0) return C42_MA_CORRUPT;
-#endif
-        nb = q->nb - (new_size == 0);
-        ts = q->ts - ts;
+        log->io_error = ioe;
+        r = C42_RLOG_IO_ERROR;
     }
-    mae = q->worker.handler(ptr_p, old_size, new_size, q->worker.context);
-    if (mae) return mae;
-    q->nb = nb;
-    q->ts = ts;
+    if (log->buf) C42_MA_ARRAY_FREE(log->ma, log->buf, log->buf_size);
+    if (log->spare) C42_MA_ARRAY_FREE(log->ma, log->spare, log->spare_size);
+    C42_MA_ARRAY_FREE(log->ma, log->path,
+                      log->prefix_len + C42_RLOG_NAME_SIZE);
+    if (c42_smt_cond_destroy(log->cond, log->smt, log->ma) && !r)
+        r = C42_RLOG_SMT_ERROR;
+    if (c42_smt_mutex_destroy(log->mutex, log->smt, log->ma) && !r)
+        r = C42_RLOG_SMT_ERROR;
+    return r;
+}
+
+/* rlog_reader_map **********************************************************/
+static uint_fast8_t rlog_reader_map
+(
+    c42_rlog_reader_t * rd,
+    uint64_t seq
+)
+{
+    uint_fast8_t fe;
+
+    c42_rlog_segment_name(rd->path + rd->prefix_len, seq);
+    fe = c42_file_map(rd->fsa, &rd->map, rd->path, 0, 0, C42_FSA_MAP_READ,
+                      C42_FSA_ADV_SEQUENTIAL);
+    if (fe) return fe == C42_FSA_NOT_FOUND ? C42_RLOG_END : C42_RLOG_FSA_ERROR;
+    if (rd->map.size < C42_RLOG_SEG_HDR_SIZE
+        || !C42_U8A_EQUAL(rd->map.data, rlog_magic, 8)
+        || le64_get(rd->map.data + 8) != seq)
+    {
+        c42_file_unmap(rd->fsa, &rd->map);
+        return C42_RLOG_BAD_SEGMENT;
+    }
+    rd->pos = rd->map.data + C42_RLOG_SEG_HDR_SIZE;
+    rd->end = rd->map.data + rd->map.size;
+    rd->seq = seq;
+    rd->mapped = 1;
     return 0;
-};
+}
 
-/* c42_malim_init ***********************************************************/
-C42_API void C42_CALL c42_malim_init
+/* c42_rlog_reader_open *****************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_reader_open
 (
-    c42_ma_t * restrict malim,
-    c42_malim_ctx_t * restrict ctx,
-    c42_ma_t const * restrict worker_ma,
-    size_t ts_lim,
-    size_t bs_lim,
-    size_t nb_lim
+    c42_rlog_reader_t * rd,
+    c42_fsa_t * fsa,
+    c42_ma_t * ma,
+    uint8_t const * prefix,
+    uint64_t first_seq
 )
 {
-    malim->handler = malim_handler;
-    malim->context = ctx;
-    ctx->worker = *worker_ma;
-    ctx->nb = 0;
-    ctx->ts = 0;
-    ctx->ts_lim = ts_lim;
-    ctx->bs_lim = bs_lim;
-    ctx->nb_lim = nb_lim;
+    uint_fast8_t r;
+
+    C42_VAR_CLEAR(*rd);
+    rd->fsa = fsa;
+    rd->ma = ma;
+    r = rlog_path_init(ma, prefix, &rd->path, &rd->prefix_len);
+    if (r) return r;
+    r = rlog_reader_map(rd, first_seq);
+    if (r)
+    {
+        C42_MA_ARRAY_FREE(ma, rd->path, rd->prefix_len + C42_RLOG_NAME_SIZE);
+        if (r == C42_RLOG_END) r = C42_RLOG_FSA_ERROR;
+    }
+    return r;
+}
+
+/* c42_rlog_read ************************************************************/
+C42_API uint_fast8_t C42_CALL c42_rlog_read
+(
+    c42_rlog_reader_t * rd,
+    uint8_t const * * data,
+    size_t * size,
+    uint64_t * seq
+)
+{
+    uint8_t const * p;
+    size_t avail, len;
+    uint_fast8_t r, torn;
+
+    for (;;)
+    {
+        p = rd->pos;
+        avail = rd->end - p;
+        torn = avail != 0;
+        if (avail >= C42_RLOG_REC_HDR_SIZE)
+        {
+            len = lz_get32(p);
+            if (len <= avail - C42_RLOG_REC_HDR_SIZE
+                && c42_crc32c(c42_crc32c(0, p, 4), p + C42_RLOG_REC_HDR_SIZE,
+                              len) == lz_get32(p + 4))
+            {
+                *data = p + C42_RLOG_REC_HDR_SIZE;
+                *size = len;
+                if (seq) *seq = rd->seq;
+                rd->seq++;
+                rd->pos = p + C42_RLOG_REC_HDR_SIZE + len;
+                return 0;
+            }
+        }
+        /* end of this segment: continue with the one starting at the next
+         * sequence number, if any */
+        if (rd->mapped)
+        {
+            c42_file_unmap(rd->fsa, &rd->map);
+            rd->mapped = 0;
+        }
+        rd->pos = rd->end = NULL;
+        r = rlog_reader_map(rd, rd->seq);
+        if (r == C42_RLOG_END && torn) r = C42_RLOG_TORN;
+        if (r) return r;
+    }
 }
 
+/* c42_rlog_reader_close ****************************************************/
+C42_API void C42_CALL c42_rlog_reader_close
+(
+    c42_rlog_reader_t * rd
+)
+{
+    if (rd->mapped) c42_file_unmap(rd->fsa, &rd->map);
+    C42_MA_ARRAY_FREE(rd->ma, rd->path, rd->prefix_len + C42_RLOG_NAME_SIZE);
+}
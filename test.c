@@ -1,4 +1,21 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
 #include <c42.h>
 
 #define T(_cond) \
@@ -6,12 +23,2206 @@
         do { printf("Error: test failed: (%s) - line %u\n", #_cond, __LINE__); \
             return 1; } while (0)
 
+static unsigned int vwriter_calls;
+
+static size_t C42_CALL counting_vwriter
+(
+    c42_u8an_t const * seg,
+    size_t count,
+    void * ctx
+)
+{
+    vwriter_calls++;
+    return c42_sbw_writev(seg, count, ctx);
+}
+
+struct c42_smt_mutex_s { pthread_mutex_t m; };
+struct c42_smt_cond_s { pthread_cond_t c; };
+
+typedef struct thread_start_s thread_start_t;
+struct thread_start_s
+{
+    c42_smt_thread_f func;
+    void * arg;
+};
+
+static void * thread_tramp (void * p)
+{
+    thread_start_t ts = *(thread_start_t *) p;
+    free(p);
+    return (void *) (uintptr_t) ts.func(ts.arg);
+}
+
+static uint_fast8_t C42_CALL pt_thread_create
+    (c42_smt_t * smt, c42_smt_tid_t * tid, c42_smt_thread_f func, void * arg)
+{
+    pthread_t t;
+    thread_start_t * ts = malloc(sizeof(thread_start_t));
+    (void) smt;
+    if (!ts) return 1;
+    ts->func = func;
+    ts->arg = arg;
+    if (pthread_create(&t, NULL, thread_tramp, ts)) { free(ts); return 1; }
+    *tid = (c42_smt_tid_t) t;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL pt_thread_join
+    (c42_smt_t * smt, c42_smt_tid_t tid, uint32_t * exit_code)
+{
+    void * r;
+    (void) smt;
+    if (pthread_join((pthread_t) tid, &r)) return 1;
+    if (exit_code) *exit_code = (uint32_t) (uintptr_t) r;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL pt_mutex_init (c42_smt_t * smt, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_mutex_init(&m->m, NULL) != 0; }
+static uint_fast8_t C42_CALL pt_mutex_finish (c42_smt_t * smt, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_mutex_destroy(&m->m) != 0; }
+static uint_fast8_t C42_CALL pt_mutex_lock (c42_smt_t * smt, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_mutex_lock(&m->m) != 0; }
+static uint_fast8_t C42_CALL pt_mutex_trylock (c42_smt_t * smt, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_mutex_trylock(&m->m) != 0; }
+static uint_fast8_t C42_CALL pt_mutex_unlock (c42_smt_t * smt, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_mutex_unlock(&m->m) != 0; }
+static uint_fast8_t C42_CALL pt_cond_init (c42_smt_t * smt, c42_smt_cond_t * c)
+{ (void) smt; return pthread_cond_init(&c->c, NULL) != 0; }
+static uint_fast8_t C42_CALL pt_cond_finish (c42_smt_t * smt, c42_smt_cond_t * c)
+{ (void) smt; return pthread_cond_destroy(&c->c) != 0; }
+static uint_fast8_t C42_CALL pt_cond_signal (c42_smt_t * smt, c42_smt_cond_t * c)
+{ (void) smt; return pthread_cond_signal(&c->c) != 0; }
+static uint_fast8_t C42_CALL pt_cond_wait
+    (c42_smt_t * smt, c42_smt_cond_t * c, c42_smt_mutex_t * m)
+{ (void) smt; return pthread_cond_wait(&c->c, &m->m) != 0; }
+
+static c42_smt_t pt_smt =
+{
+    pt_thread_create, pt_thread_join,
+    pt_mutex_init, pt_mutex_finish, pt_mutex_lock, pt_mutex_trylock,
+    pt_mutex_unlock,
+    pt_cond_init, pt_cond_finish, pt_cond_signal, pt_cond_wait,
+    sizeof(c42_smt_mutex_t), sizeof(c42_smt_cond_t), NULL, NULL, NULL
+};
+
+static uint_fast8_t C42_CALL std_ma_handler
+    (void * * ptr_p, size_t old_size, size_t new_size, void * ctx)
+{
+    void * p;
+    (void) ctx;
+    if (!new_size)
+    {
+        free(*ptr_p);
+        return 0;
+    }
+    p = realloc(old_size ? *ptr_p : NULL, new_size);
+    if (!p) return C42_MA_NO_MEM;
+    *ptr_p = p;
+    return 0;
+}
+
+static c42_ma_t std_ma = { std_ma_handler, NULL };
+
+static unsigned int bc_calls;
+
+static uint_fast8_t C42_CALL bc_cnt_read
+    (uintptr_t ctx, uint8_t * data, size_t size, size_t * rsize)
+{
+    bc_calls++;
+    return c42_io8_read(&((c42_io8bc_t *) ctx)->io8, data, size, rsize);
+}
+
+static uint_fast8_t C42_CALL bc_cnt_write
+    (uintptr_t ctx, uint8_t const * data, size_t size, size_t * wsize)
+{
+    c42_io8bc_t * bc = (c42_io8bc_t *) ctx;
+    bc_calls++;
+    if (size > bc->limit - bc->offset) size = bc->limit - bc->offset;
+    memcpy(bc->data + bc->offset, data, size);
+    bc->offset += size;
+    if (bc->offset > bc->size) bc->size = bc->offset;
+    *wsize = size;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL bc_cnt_seek64
+    (uintptr_t ctx, int64_t offset, int anchor, uint64_t * pos)
+{
+    c42_io8bc_t * bc = (c42_io8bc_t *) ctx;
+    if (anchor == C42_IO8_SEEK_CUR) offset += bc->offset;
+    else if (anchor == C42_IO8_SEEK_END) offset += bc->size;
+    if (offset < 0) return C42_IO8_BAD_POS;
+    bc->offset = (size_t) offset;
+    *pos = bc->offset;
+    return 0;
+}
+
+static c42_io8_class_t bc_cnt_class;
+
+static int test_io8buf (void)
+{
+    static uint8_t data[0x1000];
+    static uint8_t tmp[0x1000];
+    uint8_t rb[0x100], wb[0x100];
+    c42_io8bc_t bc;
+    c42_io8_t under;
+    c42_io8buf_t iob;
+    c42_io8_t * io;
+    size_t i, z;
+    uint64_t pos;
+
+    bc_cnt_class.read = bc_cnt_read;
+    bc_cnt_class.write = bc_cnt_write;
+    bc_cnt_class.seek64 = bc_cnt_seek64;
+    under.io8_class = &bc_cnt_class;
+    under.context = (uintptr_t) &bc;
+    c42_io8bc_init(&bc, data, sizeof(data));
+    io = c42_io8buf_init(&iob, &under, rb, sizeof(rb), wb, sizeof(wb));
+
+    bc_calls = 0;
+    for (i = 0; i < 1000; ++i)
+        T(c42_io8_fmt(io, "$<3i,", (unsigned int) (i % 1000)) == 0);
+    T(bc_calls < 20 && bc.size < 4000);
+    T(c42_io8_close(io, C42_IO8_OP_WRITE) == 0);
+    T(bc.size == 4000 && C42_U8A_EQLIT(data, "0  ,1  ,2  ,"));
+    T(C42_U8A_EQLIT(data + 3996, "999,"));
+
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0 && pos == 0);
+    bc_calls = 0;
+    for (i = 0; i < 1000; ++i)
+    {
+        T(c42_io8_read_full(io, tmp, 4, &z) == 0);
+        T(tmp[0] == data[i * 4] && tmp[3] == ',');
+    }
+    T(bc_calls < 20);
+    T(c42_io8_read_full(io, tmp, 4, &z) == C42_IO8_EOF && z == 0);
+
+    /* writing after reading ahead lands at the logical position */
+    T(c42_io8_seek64(io, 8, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, tmp, 4, &z) == 0 && C42_U8A_EQLIT(tmp, "2  ,"));
+    T(C42_IO8_WRITE_LIT(io, "xyz;") == 0);
+    T(c42_io8_read_full(io, tmp, 4, &z) == 0 && C42_U8A_EQLIT(tmp, "4  ,"));
+    T(c42_io8_seek64(io, -8, C42_IO8_SEEK_CUR, &pos) == 0 && pos == 12);
+    T(c42_io8_read_full(io, tmp, 8, &z) == 0
+      && C42_U8A_EQLIT(tmp, "xyz;4  ,"));
+
+    /* large transfers bypass the buffers */
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+    bc_calls = 0;
+    T(c42_io8_read_full(io, tmp, 0x800, &z) == 0 && bc_calls == 1);
+    T(c42_io8_write_full(io, tmp, 0x800, &z) == 0 && bc_calls == 2);
+    T(bc.size == 0x1000 && C42_U8A_EQUAL(data + 0x800, tmp, 0x800));
+
+    /* a short read of the buffered tail is completed, not taken for eof */
+    T(c42_io8_seek64(io, 0x20, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, tmp, 4, &z) == 0);
+    T(c42_io8_read_full(io, tmp, 0x200, &z) == 0 && z == 0x200);
+    T(C42_U8A_EQUAL(tmp, data + 0x24, 0x200));
+
+    {
+        c42_u8an_t seg[3];
+        uint8_t h[3], p[5];
+        T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+        seg[0].a = h; seg[0].n = sizeof(h);
+        seg[1].a = NULL; seg[1].n = 0;
+        seg[2].a = p; seg[2].n = sizeof(p);
+        T(c42_io8_readv_full(io, seg, 3, &z) == 0 && z == 8);
+        T(C42_U8A_EQUAL(h, data, 3) && C42_U8A_EQUAL(p, data + 3, 5));
+        T(c42_io8_seek64(io, -5, C42_IO8_SEEK_END, &pos) == 0);
+        T(c42_io8_readv_full(io, seg, 3, &z) == C42_IO8_EOF && z == 5);
+        T(C42_U8A_EQUAL(h, data + 0xFFB, 3));
+    }
+
+    {
+        uint8_t const * p;
+        size_t n;
+        T(c42_io8_seek64(io, 0xFF0, C42_IO8_SEEK_SET, &pos) == 0);
+        T(c42_io8_peek(io, 4, &p, &n) == 0 && n == 0x10);
+        T(C42_U8A_EQUAL(p, data + 0xFF0, n));
+        T(c42_io8_consume(io, 0xC) == 0);
+        T(c42_io8_peek(io, 8, &p, &n) == 0 && n == 4);
+        T(c42_io8_consume(io, 5) == C42_IO8_BAD_SIZE);
+        T(c42_io8_consume(io, 4) == 0);
+        T(c42_io8_peek(io, 1, &p, &n) == 0 && n == 0);
+        T(c42_io8_peek(io, sizeof(rb) + 1, &p, &n) == C42_IO8_TOO_BIG);
+
+        c42_io8bc_init(&bc, data, 0x10);
+        T(C42_IO8_WRITE_LIT(&bc.io8, "a,bc") == 0);
+        T(c42_io8_seek64(&bc.io8, INT64_MIN, C42_IO8_SEEK_END, &pos)
+          == C42_IO8_BAD_POS);
+        bc.offset = 0;
+        T(c42_io8_peek(&bc.io8, 1, &p, &n) == 0 && n == 4 && p == data);
+        T(c42_io8_consume(&bc.io8, 2) == 0);
+        T(c42_io8_read(&bc.io8, tmp, 10, &z) == 0 && z == 2);
+        T(C42_U8A_EQLIT(tmp, "bc"));
+        T(c42_io8_peek(&under, 1, &p, &n) == C42_IO8_NOT_IMPLEMENTED);
+    }
+
+    {
+        c42_io8mr_t mr;
+        c42_io8bc_t dst;
+        uint64_t c;
+        /* peek path: memory region to counter buffer */
+        c42_io8mr_init(&mr, tmp, 0x800, 0);
+        c42_io8bc_init(&dst, data, sizeof(data));
+        T(c42_io8_copy(&dst.io8, &mr.io8, 0x500, NULL, 0, &c) == 0);
+        T(c == 0x500 && dst.size == 0x500 && C42_U8A_EQUAL(data, tmp, 0x500));
+        T(c42_io8_copy(&dst.io8, &mr.io8, UINT64_MAX, NULL, 0, &c) == 0);
+        T(c == 0x300 && dst.size == 0x800);
+        /* copy_from path: counting stream into a memory region */
+        c42_io8bc_init(&bc, data, sizeof(data));
+        bc.size = 0x800;
+        c42_io8mr_init(&mr, tmp, sizeof(tmp), 1);
+        T(c42_io8_copy(&mr.io8, &under, UINT64_MAX, NULL, 0, &c) == 0);
+        T(c == 0x800 && mr.offset == 0x800);
+        /* bounce buffer path */
+        bc.offset = 0;
+        c42_io8bc_init(&dst, tmp, sizeof(tmp));
+        T(c42_io8_copy(&dst.io8, &under, UINT64_MAX, NULL, 0, &c)
+          == C42_IO8_NOT_IMPLEMENTED);
+        bc_calls = 0;
+        T(c42_io8_copy(&dst.io8, &under, 0x7FF, rb, sizeof(rb), &c) == 0);
+        T(c == 0x7FF && dst.size == 0x7FF && bc_calls == 8);
+        T(C42_U8A_EQUAL(tmp, data, 0x7FF));
+        /* a source that cannot peek falls back to the bounce buffer */
+        {
+            c42_io8buf_t nb;
+            c42_io8mr_init(&mr, data, 0x300, 0);
+            c42_io8buf_init(&nb, &mr.io8, NULL, 0, NULL, 0);
+            c42_io8bc_init(&dst, tmp, sizeof(tmp));
+            T(c42_io8_copy(&dst.io8, &nb.io8, UINT64_MAX, rb, sizeof(rb), &c)
+              == 0);
+            T(c == 0x300 && dst.size == 0x300 && C42_U8A_EQUAL(tmp, data, c));
+        }
+    }
+    return 0;
+}
+
+/* underlying stream logging read sizes and hints */
+typedef struct ra_log_s ra_log_t;
+struct ra_log_s
+{
+    c42_io8mr_t mr;
+    size_t read_a[64];
+    size_t read_n;
+    uint64_t adv_ofs[64];
+    int adv_a[64];
+    size_t adv_n;
+    size_t query_n;
+};
+
+static uint_fast8_t C42_CALL ra_log_read
+    (uintptr_t ctx, uint8_t * data, size_t size, size_t * rsize)
+{
+    ra_log_t * l = (ra_log_t *) ctx;
+    if (l->read_n < 64) l->read_a[l->read_n++] = size;
+    return c42_io8_read(&l->mr.io8, data, size, rsize);
+}
+
+static uint_fast8_t C42_CALL ra_log_seek64
+    (uintptr_t ctx, int64_t offset, int anchor, uint64_t * pos)
+{
+    ra_log_t * l = (ra_log_t *) ctx;
+    if (anchor == C42_IO8_SEEK_CUR && offset == 0) l->query_n++;
+    return c42_io8_seek64(&l->mr.io8, offset, anchor, pos);
+}
+
+static uint_fast8_t C42_CALL ra_log_advise
+    (uintptr_t ctx, uint64_t offset, uint64_t size, int advice)
+{
+    ra_log_t * l = (ra_log_t *) ctx;
+    (void) size;
+    if (l->adv_n < 64)
+    {
+        l->adv_ofs[l->adv_n] = offset;
+        l->adv_a[l->adv_n++] = advice;
+    }
+    return 0;
+}
+
+static c42_io8_class_t ra_log_class;
+
+static int test_io8buf_readahead (void)
+{
+    static uint8_t data[0x40000];
+    static uint8_t rb[0x10000];
+    static uint8_t big[0x2000];
+    static ra_log_t l;
+    uint8_t tmp[100];
+    c42_io8_t under;
+    c42_io8buf_t iob;
+    c42_io8_t * io;
+    size_t i, z;
+    uint64_t pos;
+
+    for (i = 0; i < sizeof(data); ++i) data[i] = (uint8_t) (i ^ (i >> 8));
+    ra_log_class.read = ra_log_read;
+    ra_log_class.seek64 = ra_log_seek64;
+    ra_log_class.advise = ra_log_advise;
+    under.io8_class = &ra_log_class;
+    under.context = (uintptr_t) &l;
+    c42_io8mr_init(&l.mr, data, sizeof(data), 0);
+    io = c42_io8buf_init(&iob, &under, rb, sizeof(rb), NULL, 0);
+
+    /* sequential scan: the window doubles up to the buffer size, then each
+     * refill prefetches the next one */
+    for (i = 0; i < 0x28000 / sizeof(tmp); ++i)
+    {
+        T(c42_io8_read_full(io, tmp, sizeof(tmp), &z) == 0);
+        T(C42_U8A_EQUAL(tmp, data + i * sizeof(tmp), sizeof(tmp)));
+    }
+    T(l.read_n == 6 && l.read_a[0] == 0x1000 && l.read_a[1] == 0x2000);
+    T(l.read_a[4] == 0x10000 && l.read_a[5] == 0x10000);
+    T(l.adv_n == 3 && l.adv_a[0] == C42_FSA_ADV_SEQUENTIAL);
+    T(l.adv_a[1] == C42_FSA_ADV_WILLNEED && l.adv_ofs[1] == 0x1F000);
+    T(l.adv_a[2] == C42_FSA_ADV_WILLNEED && l.adv_ofs[2] == 0x2F000);
+    /* prefetch offsets come from the tracked position: one initial query */
+    T(l.query_n == 1);
+
+    /* position queries keep the pattern sequential */
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_CUR, &pos) == 0);
+    T(pos == i * sizeof(tmp) && iob.ra == sizeof(rb));
+
+    /* random lookups waste read-ahead: the window shrinks back */
+    l.read_n = l.adv_n = 0;
+    for (i = 0; i < 8; ++i)
+    {
+        pos = (i * 0x9E37) % (sizeof(data) - sizeof(tmp));
+        T(c42_io8_seek64(io, (int64_t) pos, C42_IO8_SEEK_SET, &pos) == 0);
+        T(c42_io8_read_full(io, tmp, sizeof(tmp), &z) == 0);
+        T(C42_U8A_EQUAL(tmp, data + pos, sizeof(tmp)));
+    }
+    T(iob.ra == C42_IO8BUF_RA_MIN && l.read_a[7] == C42_IO8BUF_RA_MIN);
+    T(l.read_a[0] == 0x8000 && l.read_a[1] == 0x4000);
+    T(l.adv_n == 1 && l.adv_a[0] == C42_FSA_ADV_RANDOM);
+
+    /* reads bypassing the buffer leave the window alone */
+    l.read_n = 0;
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, big, sizeof(big), &z) == 0);
+    T(c42_io8_read_full(io, big, sizeof(big), &z) == 0);
+    T(C42_U8A_EQUAL(big, data + sizeof(big), sizeof(big)));
+    T(l.read_n == 2 && l.read_a[1] == sizeof(big));
+    T(iob.ra == C42_IO8BUF_RA_MIN);
+
+    /* hints go through to the underlying stream */
+    T(c42_io8_advise(io, 5, 6, C42_FSA_ADV_WILLNEED) == 0);
+    T(l.adv_n == 2 && l.adv_ofs[1] == 5);
+    T(c42_io8_advise(&l.mr.io8, 0, 0, 0) == C42_IO8_NOT_IMPLEMENTED);
+    return 0;
+}
+
+static uint8_t dlog_text[0x8000];
+static uint8_t dlog_bin[0x8000];
+static uint8_t dlog_dec[0x8000];
+
+static int test_dlog (void)
+{
+    c42_dlog_t dlog;
+    c42_dlog_ring_t ring;
+    c42_io8bc_t bc, bin, dec;
+    c42_fmt_arg_t a[2];
+    unsigned int i;
+
+    c42_io8bc_init(&bc, dlog_text, sizeof(dlog_text));
+    T(c42_dlog_init(&dlog, &pt_smt, &std_ma, &bc.io8, C42_DLOG_TEXT,
+                    c42_utf8_term_width, NULL) == 0);
+    T(c42_dlog_ring_attach(&ring, &dlog, 0x200) == 0);
+    for (i = 0; i < 1000; ++i)
+    {
+        a[0] = c42_fmt_arg_uint(i, sizeof(i));
+        a[1] = c42_fmt_arg_cstr(i & 1 ? "odd" : "even", 0);
+        while (c42_dlog_write(&ring, "$i:$s\n", a, 2) == C42_DLOG_FULL) ;
+    }
+    T(c42_dlog_write(&ring, "$s", a, C42_DLOG_ARG_MAX + 1)
+      == C42_DLOG_TOO_BIG);
+    T(c42_dlog_ring_detach(&ring) == 0);
+    T(c42_dlog_finish(&dlog) == 0);
+    T(C42_U8A_EQLIT(dlog_text, "0:even\n1:odd\n2:even\n"));
+    T(C42_U8A_EQLIT(dlog_text + bc.size - 8, "999:odd\n"));
+
+    c42_io8bc_init(&bin, dlog_bin, sizeof(dlog_bin));
+    T(c42_dlog_init(&dlog, &pt_smt, &std_ma, &bin.io8, C42_DLOG_BINARY,
+                    c42_utf8_term_width, NULL) == 0);
+    T(c42_dlog_ring_attach(&ring, &dlog, 0x200) == 0);
+    for (i = 0; i < 1000; ++i)
+    {
+        a[0] = c42_fmt_arg_uint(i, sizeof(i));
+        a[1] = c42_fmt_arg_cstr(i & 1 ? "odd" : "even", 0);
+        while (c42_dlog_write(&ring, "$i:$s\n", a, 2) == C42_DLOG_FULL) ;
+    }
+    T(c42_dlog_ring_detach(&ring) == 0);
+    T(c42_dlog_finish(&dlog) == 0);
+
+    bin.offset = 0;
+    c42_io8bc_init(&dec, dlog_dec, sizeof(dlog_dec));
+    T(c42_dlog_decode(&bin.io8, &dec.io8, c42_utf8_term_width, NULL, &std_ma)
+      == 0);
+    T(dec.size == bc.size && C42_U8A_EQUAL(dlog_dec, dlog_text, bc.size));
+    bin.offset = 0;
+    bin.size -= 3;
+    T(c42_dlog_decode(&bin.io8, &dec.io8, c42_utf8_term_width, NULL, &std_ma)
+      == C42_DLOG_MALFORMED);
+    return 0;
+}
+
+static int test_aiopool (void)
+{
+    static uint8_t data[0x1000];
+    static uint8_t out[0x1000];
+    static uint8_t wdata[0x40000];
+    c42_aiopool_t pool;
+    c42_aio_req_t req[17];
+    c42_aio_req_t * ra[17];
+    c42_aio_req_t wreq[64];
+    c42_aio_req_t * wra[64];
+    c42_io8mr_t mr;
+    c42_io8mem_t mem;
+    size_t i, n, k;
+
+    for (i = 0; i < sizeof(data); ++i) data[i] = (uint8_t) (i * 7);
+    for (i = 0; i < sizeof(wdata); ++i)
+        wdata[i] = (uint8_t) (i * 5 + (i >> 12));
+    c42_io8mr_init(&mr, data, sizeof(data), 1);
+    T(c42_aiopool_init(&pool, &pt_smt, &std_ma, 3) == 0);
+    for (i = 0; i < 17; ++i)
+    {
+        req[i].io = &mr.io8;
+        req[i].op = C42_AIO_READ;
+        req[i].data = out + i * 0x100;
+        req[i].size = 0x100;
+        req[i].offset = (15 - i) * 0x100;
+        req[i].user = i;
+        ra[i] = &req[i];
+    }
+    req[16].data = out + 0x800;
+    req[16].offset = 0xF80;
+    T(c42_aio_submit(&pool.aio, ra, 16, &n) == 0 && n == 16);
+    for (k = 0; k < 16; k += n)
+    {
+        T(c42_aio_reap(&pool.aio, ra, 1, 17, &n) == 0 && n > 0);
+        for (i = 0; i < n; ++i)
+            T(ra[i]->ioe == 0 && ra[i]->done == 0x100);
+    }
+    T(c42_aio_reap(&pool.aio, ra, 1, 17, &n) == 0 && n == 0);
+    for (i = 0; i < 16; ++i)
+        T(C42_U8A_EQUAL(out + i * 0x100, data + (15 - i) * 0x100, 0x100));
+
+    ra[0] = &req[16];
+    ra[1] = &req[0];
+    req[0].op = C42_AIO_WRITE;
+    req[0].offset = 0;
+    T(c42_aio_submit(&pool.aio, ra, 2, &n) == 0 && n == 2);
+    T(c42_aio_reap(&pool.aio, ra, 2, 17, &n) == 0 && n == 2);
+    T(req[16].ioe == C42_IO8_EOF && req[16].done == 0x80);
+    T(req[0].ioe == 0 && req[0].done == 0x100);
+    T(mr.offset == 0);
+
+    /* read-only memory streams have nothing to sync */
+    req[0].op = C42_AIO_SYNC;
+    ra[0] = &req[0];
+    T(c42_aio_submit(&pool.aio, ra, 1, &n) == 0 && n == 1);
+    T(c42_aio_reap(&pool.aio, ra, 1, 17, &n) == 0 && n == 1);
+    T(ra[0] == &req[0] && req[0].ioe == C42_IO8_NOT_IMPLEMENTED);
+    T(c42_aiopool_finish(&pool) == 0);
+
+    /* positional writes growing an io8mem must not run concurrently */
+    c42_io8mem_init(&mem, &std_ma, 0x100, 0);
+    T(c42_aiopool_init(&pool, &pt_smt, &std_ma, 8) == 0);
+    for (i = 0; i < 64; ++i)
+    {
+        wreq[i].io = &mem.io8;
+        wreq[i].op = C42_AIO_WRITE;
+        wreq[i].data = wdata + i * 0x1000;
+        wreq[i].size = 0x1000;
+        wreq[i].offset = i * 0x1000;
+        wreq[i].user = i;
+        wra[i] = &wreq[i];
+    }
+    T(c42_aio_submit(&pool.aio, wra, 64, &n) == 0 && n == 64);
+    for (k = 0; k < 64; k += n)
+    {
+        T(c42_aio_reap(&pool.aio, wra, 1, 64, &n) == 0 && n > 0);
+        for (i = 0; i < n; ++i)
+            T(wra[i]->ioe == 0 && wra[i]->done == 0x1000);
+    }
+    T(c42_aiopool_finish(&pool) == 0);
+    T(mem.size == sizeof(wdata));
+    for (i = 0; i < sizeof(wdata); i += n)
+    {
+        T(c42_io8_pread_full(&mem.io8, out, sizeof(out), i, &n) == 0);
+        T(C42_U8A_EQUAL(out, wdata + i, n));
+    }
+    c42_io8mem_finish(&mem);
+    return 0;
+}
+
+static int test_io8mem (void)
+{
+    static uint8_t src[0x1000];
+    static uint8_t dst[0x1000];
+    c42_io8mem_t mem;
+    c42_io8_t * io;
+    c42_fsa_stat_t st;
+    uint8_t const * p;
+    void * a;
+    size_t i, z;
+    uint64_t pos;
+
+    for (i = 0; i < sizeof(src); ++i) src[i] = (uint8_t) (i * 13 + 1);
+    io = c42_io8mem_init(&mem, &std_ma, 0x100, 0);
+    T(mem.chunk_size == 0x100);
+    T(c42_io8_write_full(io, src, 0x333, &z) == 0 && z == 0x333);
+    T(mem.chunk_n == 4 && mem.size == 0x333);
+    T(c42_io8_seek64(io, INT64_MIN, C42_IO8_SEEK_CUR, &pos)
+      == C42_IO8_BAD_POS);
+    T(c42_io8_seek64(io, 0x10, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, dst, 0x300, &z) == 0);
+    T(C42_U8A_EQUAL(dst, src + 0x10, 0x300));
+    T(c42_io8_read_full(io, dst, 0x300, &z) == C42_IO8_EOF && z == 0x23);
+
+    /* write past end leaves a zero-filled gap */
+    T(c42_io8_seek64(io, 0x10, C42_IO8_SEEK_END, &pos) == 0 && pos == 0x343);
+    T(C42_IO8_WRITE_LIT(io, "end") == 0 && mem.size == 0x346);
+    T(c42_io8_seek64(io, 0x330, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, dst, 0x16, &z) == 0);
+    T(C42_U8A_EQUAL(dst, src + 0x330, 3) && dst[3] == 0 && dst[0x12] == 0);
+    T(C42_U8A_EQLIT(dst + 0x13, "end"));
+
+    /* peek windows stop at chunk boundaries */
+    T(c42_io8_seek64(io, 0xF0, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_peek(io, 1, &p, &z) == 0 && z == 0x10);
+    T(c42_io8_peek(io, 0x11, &p, &z) == C42_IO8_TOO_BIG);
+
+    T(c42_io8_seek64(io, 0x80, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_truncate(io) == 0 && mem.size == 0x80 && mem.chunk_n == 1);
+    T(c42_io8_seek64(io, 0x180, C42_IO8_SEEK_SET, &pos) == 0);
+    T(C42_IO8_WRITE_LIT(io, "x") == 0 && mem.size == 0x181);
+    T(c42_io8_seek64(io, 0x7F, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_read_full(io, dst, 2, &z) == 0 && dst[0] == src[0x7F]);
+    T(dst[1] == 0);
+
+    /* positional access leaves the stream position alone */
+    T(c42_io8_pwrite_full(io, src, 0x10, 0x1F8, &z) == 0 && z == 0x10);
+    T(mem.size == 0x208 && mem.offset == 0x81);
+    T(c42_io8_pread(io, dst, 0x100, 0x1F0, &z) == 0 && z == 0x18);
+    T(dst[7] == 0 && C42_U8A_EQUAL(dst + 8, src, 0x10));
+    T(c42_io8_pread(io, dst, 1, 0x208, &z) == 0 && z == 0);
+    T(c42_io8_pread_full(io, dst, 0x10, 0x200, &z) == C42_IO8_EOF && z == 8);
+    T(mem.offset == 0x81);
+
+    /* metadata, preallocation and sync */
+    T(c42_io8_stat(io, &st) == 0 && st.size == 0x208);
+    T(st.type == C42_FSA_T_FILE && st.block_size == 0x100);
+    T(c42_io8_preallocate(io, 0x300, 0x100) == 0);
+    T(mem.chunk_n == 4 && mem.size == 0x208);
+    T(c42_io8_sync(io, C42_IO8_SYNC_DATA) == 0);
+    c42_io8mem_finish(&mem);
+
+    io = c42_io8mem_init(&mem, &std_ma, 0, 0x120);
+    T(c42_io8_write(io, src, 0x200, &z) == 0 && z == 0x120);
+    T(c42_io8_write(io, src, 1, &z) == C42_IO8_NO_SPACE);
+    T(c42_io8_preallocate(io, 0x100, 0x21) == C42_IO8_NO_SPACE);
+    c42_io8mem_finish(&mem);
+
+    for (i = 1; i <= 0x1000; i <<= 1)
+    {
+        T(c42_ma_aligned_alloc(&std_ma, &a, 0x333, i) == 0);
+        T(((uintptr_t) a & (i - 1)) == 0);
+        memset(a, 0xA5, 0x333);
+        T(c42_ma_aligned_free(&std_ma, a, 0x333, i) == 0);
+    }
+    T(c42_ma_aligned_alloc(&std_ma, &a, 0x10, 0x30) == C42_MA_BAD_ITEM_SIZE);
+    return 0;
+}
+
+static uint8_t C42_CALL pipe_producer (void * arg)
+{
+    c42_pipe_t * pipe = arg;
+    uint8_t * p;
+    size_t n, i, k;
+    uint32_t x = 1;
+    /* mix plain writes with reserve/commit */
+    for (k = 0; k < 3000; ++k)
+    {
+        if (k & 1)
+        {
+            uint8_t b[37];
+            for (i = 0; i < sizeof(b); ++i) b[i] = (uint8_t) (x++);
+            if (c42_io8_write_full(&pipe->writer, b, sizeof(b), NULL)) return 1;
+        }
+        else
+        {
+            if (c42_pipe_reserve(pipe, &p, &n)) return 1;
+            if (n > 29) n = 29;
+            for (i = 0; i < n; ++i) p[i] = (uint8_t) (x++);
+            c42_pipe_commit(pipe, n);
+        }
+    }
+    c42_io8_close(&pipe->writer, C42_IO8_OP_WRITE);
+    return 0;
+}
+
+static int test_pipe (void)
+{
+    c42_pipe_t pipe;
+    c42_smt_tid_t tid;
+    uint8_t const * p;
+    uint8_t buf[50];
+    size_t n, i, total = 0;
+    uint32_t x = 1, ec;
+
+    T(c42_pipe_init(&pipe, &pt_smt, &std_ma, 0x100) == 0);
+    T(c42_smt_thread_create(&pt_smt, &tid, pipe_producer, &pipe) == 0);
+    for (;;)
+    {
+        if (total & 1)
+        {
+            T(c42_io8_read(&pipe.reader, buf, sizeof(buf), &n) == 0);
+            p = buf;
+        }
+        else
+        {
+            /* 4 bytes may straddle the ring end */
+            T(c42_io8_peek(&pipe.reader, 4, &p, &n) == 0
+              || c42_io8_peek(&pipe.reader, 1, &p, &n) == 0);
+        }
+        if (n == 0) break;
+        for (i = 0; i < n; ++i) T(p[i] == (uint8_t) (x++));
+        if (p != buf)
+        {
+            T(c42_io8_consume(&pipe.reader, n) == 0);
+        }
+        total += n;
+    }
+    T(c42_smt_thread_join(&pt_smt, tid, &ec) == 0 && ec == 0);
+    T(total == x - 1 && total > 1500 * 37);
+    T(c42_pipe_finish(&pipe) == 0);
+
+    /* closing the read end breaks the pipe for the writer */
+    T(c42_pipe_init(&pipe, &pt_smt, &std_ma, 0) == 0);
+    T(c42_io8_close(&pipe.reader, C42_IO8_OP_READ) == 0);
+    T(C42_IO8_WRITE_LIT(&pipe.writer, "x") == C42_IO8_BROKEN_PIPE);
+    T(c42_pipe_finish(&pipe) == 0);
+    return 0;
+}
+
+static int test_lz (void)
+{
+    static uint8_t src[300000];
+    static uint8_t cmp[320000];
+    static uint8_t dst[300000];
+    static uint32_t table[1 << C42_LZ_HASH_LOG];
+    c42_lz_enc_t enc;
+    c42_lz_dec_t dec;
+    c42_io8mem_t mem;
+    c42_io8lz_t lz;
+    c42_io8_t * io;
+    size_t i, j, k, z, iu, ou, cn;
+    uint32_t x = 1;
+    uint64_t pos;
+    clock_t t0;
+    double dt;
+
+    /* text-like runs interleaved with noise */
+    for (i = 0; i < sizeof(src); )
+    {
+        x = x * 1103515245 + 12345;
+        if ((x >> 16) & 3)
+        {
+            static char const words[] = "the quick brown fox jumps over ";
+            for (j = (x >> 8) % 20, k = 0; k < 40 && i < sizeof(src); ++k)
+                src[i++] = (uint8_t) words[(j + k) % (sizeof(words) - 1)];
+        }
+        else
+            for (k = 0; k < 24 && i < sizeof(src); ++k)
+                x = x * 1103515245 + 12345, src[i++] = (uint8_t) (x >> 16);
+    }
+
+    z = c42_lz_compress_block(src, 0x10000, cmp, sizeof(cmp), table);
+    T(z > 0 && z < 0x8000);
+    T(c42_lz_decompress_block(cmp, z, dst, 0x10000, &k) == 0 && k == 0x10000);
+    T(C42_U8A_EQUAL(dst, src, 0x10000));
+    T(c42_lz_decompress_block(cmp, z, dst, 0xFFFF, &k)
+      == C42_CLCONV_MALFORMED);
+    T(c42_lz_compress_block(src, 0x10000, cmp, z - 1, table) == 0);
+    z = c42_lz_compress_block(src, 3, cmp, sizeof(cmp), table);
+    T(z == 4 && c42_lz_decompress_block(cmp, z, dst, 3, &k) == 0 && k == 3);
+
+    /* converter round trip, fed with small pieces */
+    T(c42_lz_enc_init(&enc, &std_ma, 9) == C42_LZ_BAD_BLOCK_LOG);
+    T(c42_lz_enc_init(&enc, &std_ma, 12) == 0);
+    for (i = cn = 0; i < sizeof(src); i += iu, cn += ou)
+        T(c42_clconv_lz_encode(src + i, sizeof(src) - i < 999
+                               ? sizeof(src) - i : 999, &iu,
+                               cmp + cn, 777, &ou, &enc) != C42_CLCONV_MALFORMED);
+    do T(c42_clconv_lz_encode(NULL, 0, &iu, cmp + cn, 5, &ou, &enc)
+         != C42_CLCONV_MALFORMED);
+    while (cn += ou, ou);
+    c42_lz_enc_finish(&enc);
+    T(cn < sizeof(src) / 2 && C42_U8A_EQLIT(cmp, "C42LZ"));
+
+    T(c42_lz_dec_init(&dec, &std_ma, 12) == 0);
+    for (i = j = 0; i < cn; i += iu, j += ou)
+        T(c42_clconv_lz_decode(cmp + i, cn - i < 555 ? cn - i : 555, &iu,
+                               dst + j, 333, &ou, &dec) != C42_CLCONV_MALFORMED);
+    do T(c42_clconv_lz_decode(NULL, 0, &iu, dst + j, 333, &ou, &dec)
+         != C42_CLCONV_MALFORMED);
+    while (j += ou, ou);
+    T(c42_clconv_lz_decode(NULL, 0, &iu, dst, 1, &ou, &dec) == 0);
+    T(j == sizeof(src) && C42_U8A_EQUAL(dst, src, j));
+    T(c42_clconv_lz_decode(cmp, 1, &iu, dst, 1, &ou, &dec)
+      == C42_CLCONV_MALFORMED);
+    c42_lz_dec_finish(&dec);
+
+    /* truncated stream and blocks larger than the decoder accepts */
+    T(c42_lz_dec_init(&dec, &std_ma, 12) == 0);
+    T(c42_clconv_lz_decode(cmp, cn - 1, &iu, dst, sizeof(dst), &ou, &dec) == 0);
+    T(c42_clconv_lz_decode(NULL, 0, &iu, dst, sizeof(dst), &ou, &dec)
+      == C42_CLCONV_INCOMPLETE);
+    c42_lz_dec_finish(&dec);
+    T(c42_lz_dec_init(&dec, &std_ma, 10) == 0);
+    T(c42_clconv_lz_decode(cmp, cn, &iu, dst, sizeof(dst), &ou, &dec)
+      == C42_CLCONV_MALFORMED);
+    c42_lz_dec_finish(&dec);
+
+    /* io8 filters over an in-memory file */
+    io = c42_io8mem_init(&mem, &std_ma, 0, 0);
+    T(c42_io8lz_writer_init(&lz, io, &std_ma, C42_LZ_BLOCK_LOG_DEFAULT) == 0);
+    t0 = clock();
+    T(c42_io8_write_full(&lz.io8, src, sizeof(src), &z) == 0);
+    T(c42_io8_close(&lz.io8, C42_IO8_OP_WRITE) == 0);
+    dt = (double) (clock() - t0) / CLOCKS_PER_SEC;
+    c42_io8lz_finish(&lz);
+    cn = (size_t) mem.size;
+    printf("lz: %u -> %u bytes, compress %.1f MB/s",
+           (unsigned int) sizeof(src), (unsigned int) cn,
+           dt > 0 ? sizeof(src) / dt / 1e6 : 0.0);
+
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8lz_reader_init(&lz, io, &std_ma, C42_LZ_BLOCK_LOG_DEFAULT) == 0);
+    c42_u8a_set(dst, 0, sizeof(dst));
+    t0 = clock();
+    T(c42_io8_read_full(&lz.io8, dst, sizeof(dst), &z) == 0);
+    dt = (double) (clock() - t0) / CLOCKS_PER_SEC;
+    printf(", decompress %.1f MB/s\n", dt > 0 ? sizeof(src) / dt / 1e6 : 0.0);
+    T(C42_U8A_EQUAL(dst, src, sizeof(src)));
+    T(c42_io8_read(&lz.io8, dst, 1, &z) == 0 && z == 0);
+    c42_io8lz_finish(&lz);
+
+    T(c42_io8_seek64(io, cn - 3, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_truncate(io) == 0);
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8lz_reader_init(&lz, io, &std_ma, C42_LZ_BLOCK_LOG_DEFAULT) == 0);
+    T(c42_io8_read_full(&lz.io8, dst, sizeof(dst), &z) == 0);
+    T(c42_io8_read(&lz.io8, dst, 1, &z) == C42_IO8_BAD_DATA);
+    c42_io8lz_finish(&lz);
+    c42_io8mem_finish(&mem);
+    return 0;
+}
+
+static int test_line_reader (void)
+{
+    static uint8_t text[] =
+        "first\r\nsecond line is longer than the read buffer\n\n"
+        "0123456789abcdefghij\r\nlast";
+    uint8_t rb[0x10];
+    uint8_t scan[40];
+    c42_io8mr_t mr;
+    c42_io8bc_t bc;
+    c42_io8_t under;
+    c42_io8buf_t iob;
+    c42_io8_line_reader_t lr;
+    c42_u8an_t line;
+    size_t i, j;
+
+    for (i = 0; i < sizeof(scan); ++i) scan[i] = (uint8_t) (0x80 + i);
+    for (i = 0; i < 17; ++i)
+        for (j = i; j < sizeof(scan); ++j)
+            T(c42_u8a_scan(scan + i, sizeof(scan) - i, scan[j]) == j - i);
+    T(c42_u8a_scan(scan, sizeof(scan), 0x7F) == sizeof(scan));
+    T(c42_u8a_scan(scan, 0, 0x80) == 0);
+
+    /* whole text visible at once: lines come straight from the region */
+    c42_io8mr_init(&mr, text, sizeof(text) - 1, 0);
+    c42_io8_line_reader_init(&lr, &mr.io8, &std_ma, C42_LINE_STRIP_CR, 0);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 5);
+    T(line.a == text && C42_U8A_EQLIT(line.a, "first"));
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 42);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 0);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 20);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 4);
+    T(C42_U8A_EQLIT(line.a, "last"));
+    T(c42_io8_line_read(&lr, &line) == C42_IO8_EOF);
+    T(lr.buf_size == 0);
+    c42_io8_line_reader_finish(&lr);
+
+    /* small buffer: long lines are assembled; CR kept; length limit */
+    bc_cnt_class.read = bc_cnt_read;
+    under.io8_class = &bc_cnt_class;
+    under.context = (uintptr_t) &bc;
+    c42_io8bc_init(&bc, text, sizeof(text) - 1);
+    bc.size = sizeof(text) - 1;
+    c42_io8buf_init(&iob, &under, rb, sizeof(rb), NULL, 0);
+    c42_io8_line_reader_init(&lr, &iob.io8, &std_ma, 0, 30);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 6);
+    T(C42_U8A_EQLIT(line.a, "first\r"));
+    T(c42_io8_line_read(&lr, &line) == C42_IO8_TOO_BIG);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 0);
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 21);
+    T(C42_U8A_EQLIT(line.a, "0123456789abcdefghij\r"));
+    T(c42_io8_line_read(&lr, &line) == 0 && line.n == 4);
+    T(C42_U8A_EQLIT(line.a, "last"));
+    T(c42_io8_line_read(&lr, &line) == C42_IO8_EOF);
+    c42_io8_line_reader_finish(&lr);
+    return 0;
+}
+
+static int test_checksums (void)
+{
+    static uint8_t data[1000];
+    static uint8_t out[1000];
+    uint8_t const * p;
+    c42_io8mr_t mr;
+    c42_io8bc_t bc;
+    c42_io8sum_t sum;
+    c42_io8_t * io;
+    c42_h64_t h;
+    size_t i, n, z;
+
+    T(c42_crc32c(0, (uint8_t const *) "123456789", 9) == 0xE3069283);
+    T(c42_crc32c(c42_crc32c(0, (uint8_t const *) "1234", 4),
+                 (uint8_t const *) "56789", 5) == 0xE3069283);
+    T(c42_crc32c(0, data, 32) == 0x8A9136AA);
+    T(c42_h64(data, 0, 0) == UINT64_C(0xEF46DB3751D8E999));
+    T(c42_h64((uint8_t const *) "abc", 3, 0) == UINT64_C(0x44BC2CF5AD770999));
+    T(c42_h64((uint8_t const *) "Nobody inspects the spammish repetition",
+              39, 0) == UINT64_C(0xFBCEA83C8A378BF1));
+
+    for (i = 0; i < sizeof(data); ++i) data[i] = (uint8_t) (i * 31 + 7);
+    for (n = 1; n < 70; n += 3)
+    {
+        c42_h64_init(&h, 42);
+        for (i = 0; i < sizeof(data); i += z)
+        {
+            z = sizeof(data) - i < n ? sizeof(data) - i : n;
+            c42_h64_update(&h, data + i, z);
+        }
+        T(c42_h64_digest(&h) == c42_h64(data, sizeof(data), 42));
+    }
+
+    /* write through the filter, then read it back with peek/consume */
+    c42_io8bc_init(&bc, out, sizeof(out));
+    io = c42_io8sum_init(&sum, &bc.io8, C42_IO8SUM_CRC32C | C42_IO8SUM_H64, 1);
+    T(c42_io8_write_full(io, data, 300, &z) == 0);
+    T(c42_io8_write_full(io, data + 300, 700, &z) == 0);
+    T(sum.size == 1000 && C42_U8A_EQUAL(out, data, 1000));
+    T(sum.crc32c == c42_crc32c(0, data, 1000));
+    T(c42_h64_digest(&sum.h64) == c42_h64(data, 1000, 1));
+
+    c42_io8mr_init(&mr, out, sizeof(out), 0);
+    io = c42_io8sum_init(&sum, &mr.io8, C42_IO8SUM_CRC32C, 0);
+    T(c42_io8_read_full(io, data, 10, &z) == 0);
+    T(c42_io8_peek(io, 1, &p, &n) == 0 && n == 990);
+    T(c42_io8_consume(io, 500) == 0);
+    T(c42_io8_peek(io, 1, &p, &n) == 0 && n == 490);
+    T(c42_io8_consume(io, 490) == 0);
+    T(c42_io8_read(io, data, 1, &z) == 0 && z == 0);
+    T(sum.size == 1000 && sum.crc32c == c42_crc32c(0, out, 1000));
+    return 0;
+}
+
+static uint64_t C42_CALL step_clock_ns (c42_clock_t * clock_p)
+{
+    uint64_t * t = clock_p->context;
+    return *t += 100;
+}
+
+static uint_fast8_t C42_CALL stats_chunk
+    (uint8_t const * data, size_t size, uint64_t offset, void * ctx)
+{
+    (void) data;
+    (void) size;
+    (void) offset;
+    (void) ctx;
+    return 0;
+}
+
+static int test_io8stats (void)
+{
+    static uint8_t data[100];
+    static uint8_t big[0x10000];
+    static uint8_t dump[0x400];
+    uint8_t buf[64];
+    uint64_t t = 0;
+    c42_clock_t clk;
+    c42_io8mr_t mr;
+    c42_io8bc_t bc;
+    c42_io8stats_t st;
+    c42_io8_t * io;
+    size_t z;
+    uint64_t pos;
+
+    clk.monotonic_ns = step_clock_ns;
+    clk.context = &t;
+    c42_io8mr_init(&mr, data, sizeof(data), 0);
+    io = c42_io8stats_init(&st, &mr.io8, &clk);
+    T(io->io8_class->read && io->io8_class->pread && !io->io8_class->truncate);
+    T(c42_io8_read_full(io, buf, 64, &z) == 0);
+    T(c42_io8_read_full(io, buf, 64, &z) == C42_IO8_EOF && z == 36);
+    T(c42_io8_seek64(io, 0, C42_IO8_SEEK_SET, &pos) == 0);
+    T(c42_io8_write(io, buf, 1, &z) == C42_IO8_BAD_OP);
+    T(c42_io8_truncate(io) == C42_IO8_NOT_IMPLEMENTED);
+    T(st.op[C42_IO8STATS_READ].count == 3);
+    T(st.op[C42_IO8STATS_READ].bytes == 100);
+    T(st.op[C42_IO8STATS_READ].short_count == 2);
+    T(st.op[C42_IO8STATS_READ].ns_total == 300);
+    T(st.op[C42_IO8STATS_READ].hist[7] == 3);
+    T(st.op[C42_IO8STATS_SEEK].count == 1);
+    T(st.op[C42_IO8STATS_WRITE].errors == 1);
+    T(st.op[C42_IO8STATS_OTHER].count == 0);
+
+    c42_io8bc_init(&bc, dump, sizeof(dump) - 1);
+    T(c42_io8stats_dump(&st, &bc.io8, "mr") == 0);
+    dump[bc.size] = 0;
+    T(strstr((char *) dump, "mr read: calls=3 bytes=100 short=2 intr=0 err=0 "
+             "avg_ns=100 max_ns=100\nmr read: ns_hist <128:3\n") != NULL);
+    T(strstr((char *) dump, "mr write: calls=1 ") != NULL);
+
+    io = c42_io8stats_init(&st, &bc.io8, NULL);
+    T(io->io8_class->pread == NULL);
+    T(C42_IO8_WRITE_LIT(io, "xyz") == 0 && st.op[C42_IO8STATS_WRITE].bytes == 3);
+    T(st.op[C42_IO8STATS_WRITE].ns_total == 0);
+
+    /* positional reads counted from several pool threads */
+    c42_io8mr_init(&mr, big, sizeof(big), 0);
+    io = c42_io8stats_init(&st, &mr.io8, NULL);
+    T(io->io8_class->flags & C42_IO8_CLASS_MT_PIO);
+    T(c42_io8_parallel_read(io, 0, sizeof(big), 0x100, 8, &pt_smt, &std_ma, 0,
+                            stats_chunk, NULL) == 0);
+    T(st.op[C42_IO8STATS_READ].count == 0x100);
+    T(st.op[C42_IO8STATS_READ].bytes == sizeof(big));
+    return 0;
+}
+
+/* in-memory directory provider: hands out at most 3 entries per batch */
+static char const * const fake_dir_names[] =
+    { "a", "bb", "sub", "ccc", "dddd", "link", "eeeee" };
+
+static uint_fast8_t C42_CALL fake_dir_open
+    (c42_fsa_dir_t * dir, uint8_t const * path, void * context)
+{
+    (void) context;
+    if (!C42_U8Z_EQLIT(path, "/x")) return C42_FSA_NOT_FOUND;
+    dir->handle = 0;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_dir_read
+    (c42_fsa_dir_t * dir, c42_fsa_dirent_t * ent_a, size_t ent_m,
+     size_t * ent_n, void * context)
+{
+    size_t n = 0;
+    char const * name;
+    (void) context;
+    for (; n < ent_m && n < 3
+         && dir->handle < C42_ARRAY_LIT_COUNT(fake_dir_names); ++n)
+    {
+        name = fake_dir_names[dir->handle++];
+        ent_a[n].name = (uint8_t const *) name;
+        ent_a[n].name_len = strlen(name);
+        ent_a[n].ino = dir->handle;
+        ent_a[n].type = name[0] == 's' ? C42_FSA_T_DIR
+            : name[0] == 'l' ? C42_FSA_T_UNKNOWN : C42_FSA_T_FILE;
+    }
+    *ent_n = n;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_dir_stat
+    (c42_fsa_dir_t * dir, uint8_t const * name, c42_fsa_stat_t * st,
+     int flags, void * context)
+{
+    size_t i;
+    (void) dir; (void) context;
+    for (i = 0; i < C42_ARRAY_LIT_COUNT(fake_dir_names); ++i)
+        if (!strcmp((char const *) name, fake_dir_names[i])) break;
+    if (i == C42_ARRAY_LIT_COUNT(fake_dir_names)) return C42_FSA_NOT_FOUND;
+    memset(st, 0, sizeof(*st));
+    st->size = strlen(fake_dir_names[i]);
+    st->ino = i + 1;
+    st->type = name[0] != 'l' ? C42_FSA_T_FILE
+        : (flags & C42_FSA_NOFOLLOW) ? C42_FSA_T_LINK : C42_FSA_T_FILE;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_dir_close
+    (c42_fsa_dir_t * dir, void * context)
+{
+    (void) dir; (void) context;
+    return 0;
+}
+
+static int test_dir (void)
+{
+    c42_fsa_t fsa;
+    c42_fsa_dir_t dir;
+    c42_fsa_dirent_t ent[4];
+    c42_fsa_stat_t st;
+    size_t i, n, total, batches;
+    uint64_t bytes;
+
+    memset(&fsa, 0, sizeof(fsa));
+    T(c42_dir_open(&fsa, &dir, (uint8_t const *) "/x")
+      == C42_FSA_NOT_SUPPORTED);
+    fsa.dir_open = fake_dir_open;
+    fsa.dir_read = fake_dir_read;
+    fsa.dir_close = fake_dir_close;
+    T(c42_dir_open(&fsa, &dir, (uint8_t const *) "/x") == 0);
+    T(c42_dir_stat(&fsa, &dir, (uint8_t const *) "a", &st, 0)
+      == C42_FSA_NOT_SUPPORTED);
+    fsa.dir_stat = fake_dir_stat;
+    T(c42_dir_open(&fsa, &dir, (uint8_t const *) "/y") == C42_FSA_NOT_FOUND);
+
+    /* typical scan: only stat entries whose type is not known */
+    for (total = batches = 0, bytes = 0;; ++batches)
+    {
+        T(c42_dir_read(&fsa, &dir, ent, C42_ARRAY_LIT_COUNT(ent), &n) == 0);
+        if (!n) break;
+        for (i = 0; i < n; ++i)
+        {
+            if (ent[i].type == C42_FSA_T_DIR) continue;
+            if (ent[i].type == C42_FSA_T_UNKNOWN)
+            {
+                T(c42_dir_stat(&fsa, &dir, ent[i].name, &st, C42_FSA_NOFOLLOW)
+                  == 0);
+                T(st.type == C42_FSA_T_LINK);
+                continue;
+            }
+            T(c42_dir_stat(&fsa, &dir, ent[i].name, &st, 0) == 0);
+            T(st.size == ent[i].name_len && st.ino == ent[i].ino);
+            bytes += st.size;
+        }
+        total += n;
+    }
+    T(total == 7 && batches == 3 && bytes == 15);
+    T(c42_dir_stat(&fsa, &dir, (uint8_t const *) "zz", &st, 0)
+      == C42_FSA_NOT_FOUND);
+    T(c42_dir_close(&fsa, &dir) == 0);
+    return 0;
+}
+
+typedef struct prange_check_s prange_check_t;
+struct prange_check_s
+{
+    uint8_t const * ref;
+    uint64_t next; /* expected offset when ordered */
+    uint64_t total;
+    size_t calls;
+    size_t fail_at;
+    uint8_t ordered;
+    uint8_t bad;
+};
+
+static uint_fast8_t C42_CALL prange_chunk
+(
+    uint8_t const * data,
+    size_t size,
+    uint64_t offset,
+    void * ctx
+)
+{
+    prange_check_t * c = ctx;
+    if (c->ordered && offset != c->next) c->bad = 1;
+    if (!C42_U8A_EQUAL(data, c->ref + offset, size)) c->bad = 1;
+    c->next = offset + size;
+    c->total += size;
+    if (++c->calls == c->fail_at) return C42_IO8_BAD_DATA;
+    return 0;
+}
+
+static int test_parallel_read (void)
+{
+    static uint8_t data[0x10000 + 123];
+    prange_check_t c;
+    c42_io8mr_t mr;
+    uint64_t rnd = 1;
+    size_t i;
+
+    for (i = 0; i < sizeof(data); ++i)
+    {
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (uint8_t) (rnd >> 56);
+    }
+    c42_io8mr_init(&mr, data, sizeof(data), 1);
+
+    C42_VAR_CLEAR(c);
+    c.ref = data;
+    c.ordered = 1;
+    T(c42_io8_parallel_read(&mr.io8, 0, UINT64_MAX, 0x1000, 4, &pt_smt,
+                            &std_ma, C42_AIO_ORDERED, prange_chunk, &c) == 0);
+    T(!c.bad && c.total == sizeof(data) && c.calls == 17);
+
+    C42_VAR_CLEAR(c);
+    c.ref = data;
+    T(c42_io8_parallel_read(&mr.io8, 0x123, 0x8000, 0x555, 3, &pt_smt,
+                            &std_ma, 0, prange_chunk, &c) == 0);
+    T(!c.bad && c.total == 0x8000 && c.calls == 25);
+
+    /* the consumer can stop the transfer */
+    C42_VAR_CLEAR(c);
+    c.ref = data;
+    c.ordered = 1;
+    c.next = 0x10;
+    c.fail_at = 5;
+    T(c42_io8_parallel_read(&mr.io8, 0x10, UINT64_MAX, 0x100, 2, &pt_smt,
+                            &std_ma, C42_AIO_ORDERED, prange_chunk, &c)
+      == C42_IO8_BAD_DATA);
+    T(!c.bad && c.calls == 5 && c.total == 0x500);
+
+    /* range past end of file */
+    C42_VAR_CLEAR(c);
+    c.ref = data;
+    c.ordered = 1;
+    c.next = sizeof(data) - 10;
+    T(c42_io8_parallel_read(&mr.io8, sizeof(data) - 10, 100, 7, 1, &pt_smt,
+                            &std_ma, C42_AIO_ORDERED, prange_chunk, &c) == 0);
+    T(!c.bad && c.total == 10 && c.calls == 2);
+    T(mr.offset == 0);
+    return 0;
+}
+
+/* in-memory poller: the test marks streams ready and waits "sleep" by
+ * advancing the fake clock */
+typedef struct fake_poll_entry_s fake_poll_entry_t;
+struct fake_poll_entry_s
+{
+    c42_io8_t * io;
+    uintptr_t tag;
+    unsigned int events;
+    unsigned int ready;
+};
+
+typedef struct fake_poller_s fake_poller_t;
+struct fake_poller_s
+{
+    fake_poll_entry_t e[8];
+    uint64_t now;
+    size_t wait_n;
+};
+
+static fake_poll_entry_t * fake_poll_find (fake_poller_t * fp, c42_io8_t * io)
+{
+    size_t i;
+    for (i = 0; i < 8; ++i) if (fp->e[i].io == io) return &fp->e[i];
+    return NULL;
+}
+
+static uint64_t C42_CALL fake_poll_clock_ns (c42_clock_t * clock_p)
+{
+    return ((fake_poller_t *) clock_p->context)->now;
+}
+
+static uint_fast8_t C42_CALL fake_poll_add
+(
+    c42_poller_t * poller,
+    c42_io8_t * io,
+    unsigned int events,
+    uintptr_t tag
+)
+{
+    fake_poll_entry_t * e = fake_poll_find(poller->context, io);
+    if (e) return C42_POLL_EXISTS;
+    e = fake_poll_find(poller->context, NULL);
+    if (!e) return C42_POLL_NO_MEM;
+    e->io = io;
+    e->events = events;
+    e->tag = tag;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_poll_modify
+(
+    c42_poller_t * poller,
+    c42_io8_t * io,
+    unsigned int events,
+    uintptr_t tag
+)
+{
+    fake_poll_entry_t * e = fake_poll_find(poller->context, io);
+    if (!e) return C42_POLL_NOT_FOUND;
+    e->events = events;
+    e->tag = tag;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_poll_remove
+(
+    c42_poller_t * poller,
+    c42_io8_t * io
+)
+{
+    fake_poll_entry_t * e = fake_poll_find(poller->context, io);
+    if (!e) return C42_POLL_NOT_FOUND;
+    memset(e, 0, sizeof(*e));
+    return 0;
+}
+
+static uint_fast8_t C42_CALL fake_poll_wait
+(
+    c42_poller_t * poller,
+    c42_poll_event_t * ev_a,
+    size_t ev_max,
+    uint64_t timeout_ns,
+    size_t * ev_n
+)
+{
+    fake_poller_t * fp = poller->context;
+    unsigned int ev;
+    size_t i, n;
+
+    fp->wait_n++;
+    for (i = n = 0; i < 8 && n < ev_max; ++i)
+    {
+        if (!fp->e[i].io) continue;
+        ev = fp->e[i].ready
+            & (fp->e[i].events | C42_POLL_ERR | C42_POLL_HUP);
+        if (!ev) continue;
+        ev_a[n].tag = fp->e[i].tag;
+        ev_a[n++].events = ev;
+    }
+    *ev_n = n;
+    if (n) return 0;
+    if (timeout_ns == C42_POLL_INFINITE) return C42_POLL_OTHER_ERROR;
+    fp->now += timeout_ns;
+    return 0;
+}
+
+typedef struct reactor_check_s reactor_check_t;
+struct reactor_check_s
+{
+    fake_poller_t * fp;
+    c42_reactor_timer_t timer[1000];
+    uint64_t due[1000];
+    size_t fired;
+    size_t late;
+    c42_reactor_watch_t w[3];
+    unsigned int w_calls[3];
+    size_t repeat;
+};
+
+static void C42_CALL reactor_timer_cb
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer
+)
+{
+    reactor_check_t * c = timer->context;
+    size_t i = timer - c->timer;
+    (void) reactor;
+    if (c->fp->now < c->due[i] || c->fp->now > c->due[i] + 1000000) c->late++;
+    c->due[i] = 0;
+    c->fired++;
+}
+
+static void C42_CALL reactor_repeat_cb
+(
+    c42_reactor_t * reactor,
+    c42_reactor_timer_t * timer
+)
+{
+    reactor_check_t * c = timer->context;
+    if (++c->repeat < 3)
+        c42_reactor_timer_start(reactor, timer, 0, reactor_repeat_cb, c);
+}
+
+static void C42_CALL reactor_watch_cb
+(
+    c42_reactor_t * reactor,
+    c42_reactor_watch_t * watch,
+    unsigned int events
+)
+{
+    reactor_check_t * c = watch->context;
+    size_t i = watch - c->w;
+    c->w_calls[i]++;
+    if (i == 0)
+    {
+        /* first stream: drops the other ones, then waits for writability */
+        if (events & C42_POLL_IN)
+        {
+            c42_reactor_unwatch(reactor, &c->w[1]);
+            c42_reactor_rewatch(reactor, watch, C42_POLL_OUT);
+        }
+        else c42_reactor_unwatch(reactor, watch);
+    }
+    else c42_reactor_unwatch(reactor, watch);
+}
+
+static int test_reactor (void)
+{
+    static fake_poller_t fp;
+    static reactor_check_t c;
+    c42_poller_t poller;
+    c42_clock_t clk;
+    c42_reactor_t r;
+    c42_io8mr_t s[3];
+    uint64_t rnd = 7;
+    size_t i;
+
+    C42_VAR_CLEAR(fp);
+    C42_VAR_CLEAR(c);
+    fp.now = 5000000000ULL;
+    c.fp = &fp;
+    clk.monotonic_ns = fake_poll_clock_ns;
+    clk.context = &fp;
+    poller.add = fake_poll_add;
+    poller.modify = fake_poll_modify;
+    poller.remove = fake_poll_remove;
+    poller.wait = fake_poll_wait;
+    poller.close = NULL;
+    poller.context = &fp;
+    c42_reactor_init(&r, &poller, &clk, 0);
+
+    /* timers spanning several wheel revolutions; every 10th is stopped */
+    for (i = 0; i < 1000; ++i)
+    {
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        c.due[i] = (rnd >> 33) % 700000000;
+        c42_reactor_timer_start(&r, &c.timer[i], c.due[i], reactor_timer_cb,
+                                &c);
+        c.due[i] += fp.now;
+    }
+    for (i = 0; i < 1000; i += 10) c42_reactor_timer_stop(&r, &c.timer[i]);
+    c42_reactor_timer_start(&r, &c.timer[10], 0, reactor_timer_cb, &c);
+    c.due[10] = fp.now;
+    T(r.timer_n == 901);
+    T(c42_reactor_run(&r) == 0);
+    T(c.fired == 901 && c.late == 0 && r.timer_n == 0);
+    T(fp.wait_n < 800);
+    for (i = 0; i < 1000; i += 10) T((c.due[i] == 0) == (i == 10));
+
+    /* a timer restarting itself from its callback */
+    c42_reactor_timer_start(&r, &c.timer[0], 3000000, reactor_repeat_cb, &c);
+    T(c42_reactor_run(&r) == 0 && c.repeat == 3);
+
+    /* readiness dispatch */
+    for (i = 0; i < 3; ++i)
+    {
+        c42_io8mr_init(&s[i], NULL, 0, 0);
+        T(c42_reactor_watch(&r, &c.w[i], &s[i].io8, C42_POLL_IN,
+                            reactor_watch_cb, &c) == 0);
+        fp.e[i].ready = C42_POLL_IN | C42_POLL_OUT;
+    }
+    T(c42_reactor_watch(&r, &c.w[2], &s[2].io8, C42_POLL_IN,
+                        reactor_watch_cb, &c) == C42_POLL_EXISTS);
+    T(c42_reactor_run_once(&r, 0) == 0);
+    T(c.w_calls[0] == 1 && c.w_calls[1] == 0 && c.w_calls[2] == 1);
+    T(r.watch_n == 1 && fp.e[0].events == C42_POLL_OUT);
+    T(c42_reactor_run(&r) == 0);
+    T(c.w_calls[0] == 2 && r.watch_n == 0);
+    return 0;
+}
+
+/* in-memory file system for the record log: files are io8mem streams; the
+ * write handles count syncs and maps are private copies */
+typedef struct mem_file_s mem_file_t;
+struct mem_file_s
+{
+    char name[64];
+    c42_io8mem_t mem;
+    uint8_t used;
+    uint8_t open;
+};
+
+static mem_file_t mem_files[64];
+static size_t mem_sync_n;
+static unsigned int mem_sync_wait; /* simulated sync latency */
+static int mem_open_left = -1; /* opens allowed before failing; -1: all */
+static unsigned int mem_bad_close; /* closes of streams not open */
+
+static mem_file_t * mem_file_find (uint8_t const * path)
+{
+    size_t i;
+    for (i = 0; i < C42_ARRAY_LIT_COUNT(mem_files); ++i)
+        if (mem_files[i].used && !strcmp(mem_files[i].name, (char const *) path))
+            return &mem_files[i];
+    return NULL;
+}
+
+static void mem_files_clear (void)
+{
+    size_t i;
+    for (i = 0; i < C42_ARRAY_LIT_COUNT(mem_files); ++i)
+    {
+        if (mem_files[i].used) c42_io8mem_finish(&mem_files[i].mem);
+        mem_files[i].used = 0;
+    }
+    mem_sync_n = 0;
+}
+
+static uint_fast8_t C42_CALL mem_file_write
+(
+    uintptr_t ctx,
+    uint8_t const * data,
+    size_t size,
+    size_t * wsize
+)
+{
+    return c42_io8_write(&((mem_file_t *) ctx)->mem.io8, data, size, wsize);
+}
+
+static uint_fast8_t C42_CALL mem_file_sync (uintptr_t ctx, int flags)
+{
+    unsigned int i;
+    (void) ctx;
+    (void) flags;
+    /* a real sync blocks, letting other committers queue up */
+    for (i = 0; i < mem_sync_wait; ++i) sched_yield();
+    mem_sync_n++;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL mem_file_close (uintptr_t ctx, int mode)
+{
+    mem_file_t * f = (mem_file_t *) ctx;
+    (void) mode;
+    if (!f->open) mem_bad_close++;
+    f->open = 0;
+    return 0;
+}
+
+static c42_io8_class_t mem_file_class =
+{
+    NULL, mem_file_write, NULL, NULL, NULL, mem_file_close, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, mem_file_sync, NULL, 0
+};
+
+static uint_fast8_t C42_CALL mem_file_open
+(
+    c42_io8_t * io,
+    uint8_t const * path,
+    int mode,
+    void * context
+)
+{
+    mem_file_t * f = mem_file_find(path);
+    size_t i;
+    uint64_t pos;
+    (void) context;
+    if ((mode & 7) != C42_FSA_CREATE_ALWAYS) return C42_FSA_BAD_MODE;
+    if (mem_open_left == 0) return C42_FSA_SOME_ERROR;
+    if (mem_open_left > 0) mem_open_left--;
+    if (!f)
+    {
+        for (i = 0; mem_files[i].used; ++i)
+            if (i + 1 == C42_ARRAY_LIT_COUNT(mem_files)) return C42_FSA_NO_MEM;
+        f = &mem_files[i];
+        strcpy(f->name, (char const *) path);
+        c42_io8mem_init(&f->mem, &std_ma, 0, 0);
+        f->used = 1;
+    }
+    c42_io8_seek64(&f->mem.io8, 0, C42_IO8_SEEK_SET, &pos);
+    c42_io8_truncate(&f->mem.io8);
+    f->open = 1;
+    io->io8_class = &mem_file_class;
+    io->context = (uintptr_t) f;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL mem_file_map
+(
+    c42_fsa_map_t * map,
+    uint8_t const * path,
+    uint64_t offset,
+    size_t size,
+    int mode,
+    int advice,
+    void * context
+)
+{
+    mem_file_t * f = mem_file_find(path);
+    (void) mode;
+    (void) advice;
+    (void) context;
+    if (!f) return C42_FSA_NOT_FOUND;
+    if (offset || size) return C42_FSA_NOT_SUPPORTED;
+    map->size = (size_t) f->mem.size;
+    map->data = malloc(map->size + 1);
+    if (!map->data) return C42_FSA_NO_MEM;
+    if (c42_io8_pread_full(&f->mem.io8, map->data, map->size, 0, NULL))
+    {
+        free(map->data);
+        return C42_FSA_SOME_ERROR;
+    }
+    return 0;
+}
+
+static uint_fast8_t C42_CALL mem_file_unmap
+(
+    c42_fsa_map_t * map,
+    void * context
+)
+{
+    (void) context;
+    free(map->data);
+    return 0;
+}
+
+static c42_fsa_t mem_fsa =
+{
+    mem_file_open, NULL, mem_file_map, NULL, mem_file_unmap, NULL,
+    NULL, NULL, NULL, NULL, NULL
+};
+
+typedef struct rlog_worker_s rlog_worker_t;
+struct rlog_worker_s
+{
+    c42_rlog_t * log;
+    uint32_t id;
+    uint32_t n;
+};
+
+static uint8_t C42_CALL rlog_worker (void * arg)
+{
+    rlog_worker_t * w = arg;
+    uint32_t rec[2], i;
+    uint64_t seq;
+    for (i = 0; i < w->n; ++i)
+    {
+        rec[0] = w->id;
+        rec[1] = i;
+        if (c42_rlog_append(w->log, rec, sizeof(rec), &seq)
+            || c42_rlog_commit(w->log, seq)) return 1;
+    }
+    return 0;
+}
+
+static int test_rlog (void)
+{
+    static uint8_t rec[300];
+    static size_t const batch_a[] = { 1, 16, 256 };
+    static uint32_t next[4];
+    c42_rlog_t log;
+    c42_rlog_reader_t rd;
+    rlog_worker_t w[4];
+    c42_smt_tid_t tid[4];
+    uint8_t const * data;
+    uint8_t name[C42_RLOG_NAME_SIZE];
+    mem_file_t * f;
+    uint32_t u[2];
+    uint64_t seq;
+    size_t i, k, n, b, z;
+    clock_t t0;
+    double dt;
+
+    c42_rlog_segment_name(name, 0x1234ABCDULL);
+    T(C42_U8A_EQLIT(name, "000000001234abcd.rlog") && name[21] == 0);
+    for (i = 0; i < sizeof(rec); ++i) rec[i] = (uint8_t) (i * 31 + 7);
+
+    /* records of varying size rotate segments at 1000 bytes */
+    T(c42_rlog_open(&log, &mem_fsa, &pt_smt, &std_ma, (uint8_t const *) "w/",
+                    100, 1000, 0) == 0);
+    for (i = 0; i < 40; ++i)
+    {
+        T(c42_rlog_append(&log, rec, i * 7, &seq) == 0 && seq == 100 + i);
+        if (i % 5 == 4)
+        {
+            T(c42_rlog_commit(&log, seq) == 0);
+        }
+    }
+    T(c42_rlog_commit(&log, 1000) == 0 && log.durable_seq == 140);
+    T(c42_rlog_close(&log) == 0);
+    T(mem_file_find((uint8_t const *) "w/0000000000000064.rlog"));
+    for (i = n = 0; i < C42_ARRAY_LIT_COUNT(mem_files); ++i)
+    {
+        if (!mem_files[i].used) continue;
+        n++;
+        T(mem_files[i].mem.size <= 1000);
+    }
+    T(n > 3 && mem_sync_n >= 8);
+
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "w/",
+                           100) == 0);
+    for (i = 0; i < 40; ++i)
+    {
+        T(c42_rlog_read(&rd, &data, &z, &seq) == 0);
+        T(seq == 100 + i && z == i * 7 && C42_U8A_EQUAL(data, rec, z));
+    }
+    T(c42_rlog_read(&rd, &data, &z, &seq) == C42_RLOG_END);
+    c42_rlog_reader_close(&rd);
+
+    /* a torn tail is reported, unless a newer segment supersedes it */
+    for (i = 0, f = NULL; i < C42_ARRAY_LIT_COUNT(mem_files); ++i)
+        if (mem_files[i].used && (!f || strcmp(mem_files[i].name, f->name) > 0))
+            f = &mem_files[i];
+    T(c42_io8_seek64(&f->mem.io8, -3, C42_IO8_SEEK_END, &seq) == 0);
+    T(c42_io8_truncate(&f->mem.io8) == 0);
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "w/",
+                           100) == 0);
+    for (i = 0; (k = c42_rlog_read(&rd, &data, &z, &seq)) == 0; ++i);
+    T(k == C42_RLOG_TORN && i == 39 && seq == 138);
+    c42_rlog_reader_close(&rd);
+    T(c42_rlog_open(&log, &mem_fsa, &pt_smt, &std_ma, (uint8_t const *) "w/",
+                    139, 1000, 0) == 0);
+    T(c42_rlog_append(&log, "new", 3, &seq) == 0 && seq == 139);
+    T(c42_rlog_close(&log) == 0);
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "w/",
+                           100) == 0);
+    for (i = 0; c42_rlog_read(&rd, &data, &z, &seq) == 0; ++i);
+    T(i == 40);
+    c42_rlog_reader_close(&rd);
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "w/",
+                           139) == 0);
+    T(c42_rlog_read(&rd, &data, &z, &seq) == 0 && seq == 139);
+    T(z == 3 && C42_U8A_EQLIT(data, "new"));
+    T(c42_rlog_read(&rd, &data, &z, &seq) == C42_RLOG_END);
+    c42_rlog_reader_close(&rd);
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "w/",
+                           7) == C42_RLOG_FSA_ERROR);
+    T(mem_bad_close == 0);
+    mem_files_clear();
+
+    /* failing to open the next segment leaves nothing to close */
+    mem_open_left = 1;
+    T(c42_rlog_open(&log, &mem_fsa, &pt_smt, &std_ma, (uint8_t const *) "f/",
+                    0, 1000, 0) == 0);
+    for (i = 0; i < 10; ++i) T(c42_rlog_append(&log, rec, 200, &seq) == 0);
+    T(c42_rlog_commit(&log, seq) == C42_RLOG_FSA_ERROR);
+    T(c42_rlog_close(&log) == C42_RLOG_FSA_ERROR);
+    T(mem_bad_close == 0);
+    mem_open_left = -1;
+    mem_files_clear();
+
+    /* concurrent committers share syncs */
+    mem_sync_wait = 4;
+    T(c42_rlog_open(&log, &mem_fsa, &pt_smt, &std_ma, (uint8_t const *) "m/",
+                    0, 1 << 14, 0) == 0);
+    for (i = 0; i < 4; ++i)
+    {
+        w[i].log = &log;
+        w[i].id = (uint32_t) i;
+        w[i].n = 2000;
+        T(c42_smt_thread_create(&pt_smt, &tid[i], rlog_worker, &w[i]) == 0);
+    }
+    for (i = 0; i < 4; ++i) T(c42_smt_thread_join(&pt_smt, tid[i], NULL) == 0);
+    T(c42_rlog_close(&log) == 0);
+    T(mem_sync_n < 6000);
+    T(c42_rlog_reader_open(&rd, &mem_fsa, &std_ma, (uint8_t const *) "m/",
+                           0) == 0);
+    for (n = 0; c42_rlog_read(&rd, &data, &z, &seq) == 0; ++n)
+    {
+        T(z == 8 && seq == n);
+        c42_u8a_copy((uint8_t *) u, data, 8);
+        T(u[0] < 4 && u[1] == next[u[0]]);
+        next[u[0]]++;
+    }
+    T(n == 8000);
+    c42_rlog_reader_close(&rd);
+    printf("rlog: 4 threads x 2000 commits, %u syncs;",
+           (unsigned int) mem_sync_n);
+    mem_files_clear();
+
+    /* throughput by batch size: 100-byte records, one commit per batch */
+    for (b = 0; b < C42_ARRAY_LIT_COUNT(batch_a); ++b)
+    {
+        T(c42_rlog_open(&log, &mem_fsa, &pt_smt, &std_ma,
+                        (uint8_t const *) "b/", 0, 1 << 22, 0) == 0);
+        t0 = clock();
+        for (k = 0; k < 100000; k += batch_a[b])
+        {
+            for (i = 0; i < batch_a[b]; ++i)
+                T(c42_rlog_append(&log, rec, 100, &seq) == 0);
+            T(c42_rlog_commit(&log, seq) == 0);
+        }
+        dt = (double) (clock() - t0) / CLOCKS_PER_SEC;
+        T(c42_rlog_close(&log) == 0);
+        printf(" batch %u: %.0f rec/s", (unsigned int) batch_a[b],
+               dt > 0 ? k / dt : 0.0);
+        mem_files_clear();
+    }
+    printf("\n");
+    mem_sync_wait = 0;
+    return 0;
+}
+
+/* socket provider over POSIX sockets, used to run the io8 socket tests
+ * against a local echo server */
+#if defined(__linux__)
+static uint_fast8_t sk_io_error (int e)
+{
+    switch (e)
+    {
+    case EINTR: return C42_IO8_INTERRUPTED;
+    case EAGAIN: return C42_IO8_WOULD_BLOCK;
+    case EPIPE: case ECONNRESET: return C42_IO8_BROKEN_PIPE;
+    case EBADF: return C42_IO8_BAD_FILE;
+    default: return C42_IO8_IO_ERROR;
+    }
+}
+
+static uint_fast8_t sk_net_error (int e)
+{
+    switch (e)
+    {
+    case ENOMEM: case ENOBUFS: return C42_NET_NO_MEM;
+    case EADDRINUSE: return C42_NET_ADDR_IN_USE;
+    case ECONNREFUSED: case ENOENT: return C42_NET_REFUSED;
+    case EINPROGRESS: return C42_NET_IN_PROGRESS;
+    case EAGAIN: return C42_NET_WOULD_BLOCK;
+    case ENOPROTOOPT: case EOPNOTSUPP: return C42_NET_NOT_SUPPORTED;
+    default: return C42_NET_OTHER_ERROR;
+    }
+}
+
+static uint_fast8_t C42_CALL sk_read
+    (uintptr_t ctx, uint8_t * data, size_t size, size_t * rsize)
+{
+    ssize_t n = recv((int) ctx, data, size, 0);
+    if (n < 0) { *rsize = 0; return sk_io_error(errno); }
+    *rsize = (size_t) n;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL sk_write
+    (uintptr_t ctx, uint8_t const * data, size_t size, size_t * wsize)
+{
+    ssize_t n = send((int) ctx, data, size, MSG_NOSIGNAL);
+    if (n < 0) { *wsize = 0; return sk_io_error(errno); }
+    *wsize = (size_t) n;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL sk_close (uintptr_t ctx, int mode)
+{
+    if (mode == C42_IO8_OP_WRITE)
+        return shutdown((int) ctx, SHUT_WR) ? sk_io_error(errno) : 0;
+    return close((int) ctx) ? sk_io_error(errno) : 0;
+}
+
+static uint_fast8_t C42_CALL sk_file_read
+    (uintptr_t ctx, uint8_t * data, size_t size, size_t * rsize)
+{
+    ssize_t n = read((int) ctx, data, size);
+    if (n < 0) { *rsize = 0; return sk_io_error(errno); }
+    *rsize = (size_t) n;
+    return 0;
+}
+
+static c42_io8_class_t sk_file_class =
+{
+    sk_file_read, NULL, NULL, NULL, NULL, sk_close, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0
+};
+
+static unsigned int sk_sendfile_calls;
+
+/* zero-copy send from a file of this provider */
+static uint_fast8_t C42_CALL sk_copy_from
+    (uintptr_t ctx, c42_io8_t * src, uint64_t size, uint64_t * csize)
+{
+    uint64_t total = 0;
+    ssize_t n;
+    size_t chunk;
+
+    if (src->io8_class != &sk_file_class) return C42_IO8_NA;
+    sk_sendfile_calls++;
+    while (total < size)
+    {
+        chunk = size - total < 0x40000000 ? (size_t) (size - total)
+            : 0x40000000;
+        n = sendfile((int) ctx, (int) src->context, NULL, chunk);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            *csize = total;
+            return sk_io_error(errno);
+        }
+        if (n == 0) break;
+        total += (uint64_t) n;
+    }
+    *csize = total;
+    return 0;
+}
+
+static c42_io8_class_t sk_class =
+{
+    sk_read, sk_write, NULL, NULL, NULL, sk_close, NULL, NULL, NULL, NULL,
+    NULL, sk_copy_from, NULL, NULL, NULL, NULL, NULL, NULL, 0
+};
+
+static c42_io8_class_t sk_listen_class =
+{
+    NULL, NULL, NULL, NULL, NULL, sk_close, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0
+};
+
+typedef union sk_addr_u sk_addr_t;
+union sk_addr_u
+{
+    struct sockaddr sa;
+    struct sockaddr_in in4;
+    struct sockaddr_in6 in6;
+    struct sockaddr_un un;
+};
+
+static uint_fast8_t sk_addr_parse
+(
+    sk_addr_t * a,
+    socklen_t * len,
+    int family,
+    uint8_t const * addr
+)
+{
+    char host[64];
+    char const * s = (char const *) addr;
+    char const * colon;
+    char * end;
+    unsigned long port;
+    size_t n;
+
+    memset(a, 0, sizeof(*a));
+    if (family == C42_NET_UNIX)
+    {
+        n = strlen(s);
+        if (n == 0 || n >= sizeof(a->un.sun_path)) return C42_NET_BAD_ADDR;
+        a->un.sun_family = AF_UNIX;
+        memcpy(a->un.sun_path, s, n + 1);
+        *len = sizeof(a->un);
+        return 0;
+    }
+    if (family != C42_NET_TCP) return C42_NET_NOT_SUPPORTED;
+    colon = strrchr(s, ':');
+    if (!colon) return C42_NET_BAD_ADDR;
+    port = strtoul(colon + 1, &end, 10);
+    if (colon[1] == 0 || *end || port > 0xFFFF) return C42_NET_BAD_ADDR;
+    if (*s == '[')
+    {
+        n = (size_t) (colon - s);
+        if (n < 2 || s[n - 1] != ']' || n - 2 >= sizeof(host))
+            return C42_NET_BAD_ADDR;
+        memcpy(host, s + 1, n - 2);
+        host[n - 2] = 0;
+        if (inet_pton(AF_INET6, host, &a->in6.sin6_addr) != 1)
+            return C42_NET_BAD_ADDR;
+        a->in6.sin6_family = AF_INET6;
+        a->in6.sin6_port = htons((uint16_t) port);
+        *len = sizeof(a->in6);
+        return 0;
+    }
+    n = (size_t) (colon - s);
+    if (n >= sizeof(host)) return C42_NET_BAD_ADDR;
+    memcpy(host, s, n);
+    host[n] = 0;
+    if (inet_pton(AF_INET, host, &a->in4.sin_addr) != 1)
+        return C42_NET_BAD_ADDR;
+    a->in4.sin_family = AF_INET;
+    a->in4.sin_port = htons((uint16_t) port);
+    *len = sizeof(a->in4);
+    return 0;
+}
+
+static uint_fast8_t sk_fd_options (int fd, unsigned int mask, unsigned int values)
+{
+    int fl, on;
+    if (mask & C42_NET_NONBLOCK)
+    {
+        fl = fcntl(fd, F_GETFL);
+        if (fl < 0) return sk_net_error(errno);
+        fl = (values & C42_NET_NONBLOCK) ? fl | O_NONBLOCK : fl & ~O_NONBLOCK;
+        if (fcntl(fd, F_SETFL, fl)) return sk_net_error(errno);
+    }
+    if (mask & C42_NET_NODELAY)
+    {
+        on = (values & C42_NET_NODELAY) != 0;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)))
+            return sk_net_error(errno);
+    }
+    if (mask & C42_NET_CORK)
+    {
+        on = (values & C42_NET_CORK) != 0;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)))
+            return sk_net_error(errno);
+    }
+    return 0;
+}
+
+static uint_fast8_t C42_CALL sk_listen
+(
+    c42_io8_t * lsn,
+    int family,
+    uint8_t const * addr,
+    unsigned int backlog,
+    unsigned int flags,
+    void * context
+)
+{
+    sk_addr_t a;
+    socklen_t len;
+    uint_fast8_t e;
+    int fd, on = 1;
+    (void) context;
+
+    e = sk_addr_parse(&a, &len, family, addr);
+    if (e) return e;
+    fd = socket(a.sa.sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return sk_net_error(errno);
+    if (family == C42_NET_TCP)
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, &a.sa, len) || listen(fd, backlog ? (int) backlog : 128))
+    {
+        e = sk_net_error(errno);
+        close(fd);
+        return e;
+    }
+    e = sk_fd_options(fd, flags & C42_NET_NONBLOCK, flags);
+    if (e) { close(fd); return e; }
+    lsn->io8_class = &sk_listen_class;
+    lsn->context = (uintptr_t) fd;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL sk_accept
+(
+    c42_io8_t * lsn,
+    c42_io8_t * io,
+    unsigned int flags,
+    void * context
+)
+{
+    uint_fast8_t e;
+    int fd;
+    (void) context;
+
+    if (lsn->io8_class != &sk_listen_class) return C42_NET_BAD_STREAM;
+    do fd = accept((int) lsn->context, NULL, NULL);
+    while (fd < 0 && errno == EINTR);
+    if (fd < 0) return sk_net_error(errno);
+    e = sk_fd_options(fd, flags, flags);
+    if (e) { close(fd); return e; }
+    io->io8_class = &sk_class;
+    io->context = (uintptr_t) fd;
+    return 0;
+}
+
+static uint_fast8_t C42_CALL sk_connect
+(
+    c42_io8_t * io,
+    int family,
+    uint8_t const * addr,
+    unsigned int flags,
+    void * context
+)
+{
+    sk_addr_t a;
+    socklen_t len;
+    uint_fast8_t e;
+    int fd;
+    (void) context;
+
+    e = sk_addr_parse(&a, &len, family, addr);
+    if (e) return e;
+    fd = socket(a.sa.sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return sk_net_error(errno);
+    e = sk_fd_options(fd, flags, flags);
+    if (!e && connect(fd, &a.sa, len)) e = sk_net_error(errno);
+    if (e && e != C42_NET_IN_PROGRESS) { close(fd); return e; }
+    io->io8_class = &sk_class;
+    io->context = (uintptr_t) fd;
+    return e;
+}
+
+static uint_fast8_t C42_CALL sk_set_options
+(
+    c42_io8_t * io,
+    unsigned int mask,
+    unsigned int values,
+    void * context
+)
+{
+    (void) context;
+    if (io->io8_class != &sk_class && io->io8_class != &sk_listen_class)
+        return C42_NET_BAD_STREAM;
+    return sk_fd_options((int) io->context, mask, values);
+}
+
+static uint_fast8_t C42_CALL sk_local_addr
+(
+    c42_io8_t * io,
+    uint8_t * addr,
+    size_t size,
+    void * context
+)
+{
+    sk_addr_t a;
+    socklen_t len = sizeof(a);
+    char host[64];
+    int n;
+    (void) context;
+
+    if (io->io8_class != &sk_class && io->io8_class != &sk_listen_class)
+        return C42_NET_BAD_STREAM;
+    if (getsockname((int) io->context, &a.sa, &len))
+        return sk_net_error(errno);
+    switch (a.sa.sa_family)
+    {
+    case AF_UNIX:
+        n = snprintf((char *) addr, size, "%s", a.un.sun_path);
+        break;
+    case AF_INET:
+        inet_ntop(AF_INET, &a.in4.sin_addr, host, sizeof(host));
+        n = snprintf((char *) addr, size, "%s:%u", host,
+                     ntohs(a.in4.sin_port));
+        break;
+    case AF_INET6:
+        inet_ntop(AF_INET6, &a.in6.sin6_addr, host, sizeof(host));
+        n = snprintf((char *) addr, size, "[%s]:%u", host,
+                     ntohs(a.in6.sin6_port));
+        break;
+    default:
+        return C42_NET_NOT_SUPPORTED;
+    }
+    return n < 0 || (size_t) n >= size ? C42_NET_NO_MEM : 0;
+}
+
+static c42_net_t sk_net =
+{
+    sk_listen, sk_accept, sk_connect, sk_set_options, sk_local_addr, NULL
+};
+
+/* accepts one connection and echoes everything back until the peer shuts
+ * down its side */
+static uint8_t C42_CALL echo_server (void * arg)
+{
+    c42_io8_t * lsn = arg;
+    c42_io8_t io;
+    uint8_t buf[0x1000];
+    size_t n, w;
+
+    T(c42_net_accept(&sk_net, lsn, &io, C42_NET_NODELAY) == 0);
+    for (;;)
+    {
+        T(c42_io8_read(&io, buf, sizeof(buf), &n) == 0);
+        if (n == 0) break;
+        T(c42_io8_write_full(&io, buf, n, &w) == 0);
+    }
+    T(c42_io8_close(&io, C42_IO8_OP_READ | C42_IO8_OP_WRITE) == 0);
+    return 0;
+}
+
+static int read_all (c42_io8_t * io, uint8_t * buf, size_t size, size_t * len)
+{
+    size_t n;
+    *len = 0;
+    for (;;)
+    {
+        T(c42_io8_read(io, buf + *len, size - *len, &n) == 0);
+        if (n == 0) return 0;
+        *len += n;
+        T(*len < size);
+    }
+}
+
+static int test_net (void)
+{
+    static uint8_t file_data[0xC000];
+    static uint8_t echo[0xD000];
+    c42_io8_t lsn, io, srv, file;
+    c42_smt_tid_t tid;
+    uint8_t addr[128];
+    char path[64];
+    uint64_t csize;
+    size_t i, n, w;
+    uint32_t ec;
+    int fd;
+
+    T(c42_net_listen(&sk_net, &lsn, C42_NET_TCP, (uint8_t const *) "127.0.0.1",
+                     0, 0) == C42_NET_BAD_ADDR);
+    T(c42_net_listen(&sk_net, &lsn, C42_NET_TCP,
+                     (uint8_t const *) "127.0.0.1:0", 0, 0) == 0);
+    T(c42_net_local_addr(&sk_net, &lsn, addr, 10) == C42_NET_NO_MEM);
+    T(c42_net_local_addr(&sk_net, &lsn, addr, sizeof(addr)) == 0);
+    T(!memcmp(addr, "127.0.0.1:", 10) && addr[10] != '0');
+    T(c42_smt_thread_create(&pt_smt, &tid, echo_server, &lsn) == 0);
+    T(c42_net_connect(&sk_net, &io, C42_NET_TCP, addr, C42_NET_NODELAY) == 0);
+    T(C42_IO8_WRITE_LIT(&io, "hello") == 0);
+    for (n = 0; n < 5; n += w)
+        T(c42_io8_read(&io, echo + n, 5 - n, &w) == 0 && w);
+    T(C42_U8A_EQLIT(echo, "hello"));
+
+    /* corked header followed by a file sent with sendfile */
+    for (i = 0; i < sizeof(file_data); ++i)
+        file_data[i] = (uint8_t) (i * 7 + (i >> 9));
+    sprintf(path, "/tmp/c42-net-%u.dat", (unsigned int) getpid());
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    T(fd >= 0);
+    T(write(fd, file_data, sizeof(file_data)) == (ssize_t) sizeof(file_data));
+    T(lseek(fd, 0, SEEK_SET) == 0);
+    unlink(path);
+    file.io8_class = &sk_file_class;
+    file.context = (uintptr_t) fd;
+    T(c42_net_set_options(&sk_net, &io, C42_NET_CORK, C42_NET_CORK) == 0);
+    T(C42_IO8_WRITE_LIT(&io, "HDR:") == 0);
+    sk_sendfile_calls = 0;
+    T(c42_io8_copy(&io, &file, UINT64_MAX, NULL, 0, &csize) == 0);
+    T(csize == sizeof(file_data) && sk_sendfile_calls == 1);
+    T(c42_net_set_options(&sk_net, &io, C42_NET_CORK, 0) == 0);
+    T(c42_io8_close(&file, C42_IO8_OP_READ) == 0);
+    T(c42_io8_close(&io, C42_IO8_OP_WRITE) == 0);
+    T(read_all(&io, echo, sizeof(echo), &n) == 0);
+    T(n == 4 + sizeof(file_data) && !memcmp(echo, "HDR:", 4));
+    T(!memcmp(echo + 4, file_data, sizeof(file_data)));
+    T(c42_io8_close(&io, C42_IO8_OP_READ) == 0);
+    T(c42_smt_thread_join(&pt_smt, tid, &ec) == 0 && ec == 0);
+    T(c42_io8_close(&lsn, C42_IO8_OP_READ | C42_IO8_OP_WRITE) == 0);
+
+    /* non-blocking unix-domain sockets */
+    sprintf(path, "/tmp/c42-net-%u.sock", (unsigned int) getpid());
+    unlink(path);
+    T(c42_net_connect(&sk_net, &io, C42_NET_UNIX, (uint8_t const *) path, 0)
+      == C42_NET_REFUSED);
+    T(c42_net_listen(&sk_net, &lsn, C42_NET_UNIX, (uint8_t const *) path, 4,
+                     C42_NET_NONBLOCK) == 0);
+    T(c42_net_listen(&sk_net, &srv, C42_NET_UNIX, (uint8_t const *) path, 4,
+                     0) == C42_NET_ADDR_IN_USE);
+    T(c42_net_local_addr(&sk_net, &lsn, addr, sizeof(addr)) == 0);
+    T(!strcmp((char const *) addr, path));
+    T(c42_net_accept(&sk_net, &lsn, &srv, 0) == C42_NET_WOULD_BLOCK);
+    T(c42_net_connect(&sk_net, &io, C42_NET_UNIX, (uint8_t const *) path, 0)
+      == 0);
+    T(c42_net_accept(&sk_net, &lsn, &srv, C42_NET_NONBLOCK) == 0);
+    T(c42_net_set_options(&sk_net, &srv, C42_NET_NODELAY, C42_NET_NODELAY)
+      == C42_NET_NOT_SUPPORTED);
+    T(c42_io8_read(&srv, echo, sizeof(echo), &n) == C42_IO8_WOULD_BLOCK);
+    T(C42_IO8_WRITE_LIT(&io, "ping") == 0);
+    T(c42_io8_read(&srv, echo, sizeof(echo), &n) == 0 && n == 4);
+    T(C42_U8A_EQLIT(echo, "ping"));
+    T(c42_io8_close(&io, C42_IO8_OP_READ | C42_IO8_OP_WRITE) == 0);
+    T(c42_io8_read(&srv, echo, sizeof(echo), &n) == 0 && n == 0);
+    T(c42_io8_close(&srv, C42_IO8_OP_READ | C42_IO8_OP_WRITE) == 0);
+    T(c42_io8_close(&lsn, C42_IO8_OP_READ | C42_IO8_OP_WRITE) == 0);
+    unlink(path);
+    return 0;
+}
+#else
+static int test_net (void)
+{
+    return 0;
+}
+#endif
+
 int main ()
 {
     uint8_t buf[0x400];
+    uint8_t vbuf[0x400];
+    uint8_t big[0x12D];
     unsigned int z;
     static uint8_t const s[] = "\a\b\t'\n\"\\\v\f\r\033\[0m\xAB\x43\xCD";
     c42_sbw_t sbw;
+    c42_sbw_t vsbw;
+    c42_io8bc_t bc;
+    c42_io8_t * io;
 
     printf("c42: %s\n", c42_lib_name());
 
@@ -51,6 +2262,110 @@ int main ()
                   "hex=$>20es", "\0033-rahat\n\xAB");
     printf("wf: %s\n", buf);
 
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_term_width, NULL,
+                    "x=$d y=$>8s z=$<5c|$xs|$>12es|", 123, "abc", 'Q',
+                    "\x01\xFE", "a\tb\033") == 0);
+    T(c42_writev_fmt(counting_vwriter, c42_sbw_init(&vsbw, vbuf, sizeof(vbuf)),
+                     c42_utf8_term_width, NULL,
+                     "x=$d y=$>8s z=$<5c|$xs|$>12es|", 123, "abc", 'Q',
+                     "\x01\xFE", "a\tb\033") == 0);
+    printf("wvf: %.*s\n", (int) vsbw.size, vbuf);
+    T(vwriter_calls == 1);
+    T(sbw.size == vsbw.size && C42_U8A_EQUAL(buf, vbuf, sbw.size));
+    /* escaped output larger than the formatter's scratch space */
+    c42_u8a_set(big, 1, sizeof(big) - 1);
+    big[sizeof(big) - 1] = 0;
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_term_width, NULL, "[$>1210es]", big) == 0);
+    T(sbw.size == 1212 && buf[10] == ' ' && buf[11] == '\\');
+    T(c42_writev_fmt(counting_vwriter, c42_sbw_init(&vsbw, vbuf, sizeof(vbuf)),
+                     c42_utf8_term_width, NULL, "[$>1210es]", big) == 0);
+    T(vsbw.size == 1212 && C42_U8A_EQUAL(buf, vbuf, sizeof(buf)));
+    /* zero-filled widths larger than the default number scratch */
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_term_width, NULL, "[$0300/1:Xd]", 0xABu) == 0);
+    T(sbw.size == 302 && buf[1] == ':' && C42_U8A_EQLIT(buf + 297, ":A:B]"));
+    T(c42_writev_fmt(counting_vwriter, c42_sbw_init(&vsbw, vbuf, sizeof(vbuf)),
+                     c42_utf8_term_width, NULL, "x$01000dy", 7u) == 0);
+    T(vsbw.size == 1002 && vbuf[1] == '0' && C42_U8A_EQLIT(vbuf + 999, "07y"));
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_term_width, NULL, "$01023d", 7u)
+      == C42_FMT_MALFORMED);
+
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_term_width, NULL,
+                    "x=$d y=$>8s z=$<5c|$xs|$>12es|", 123, "abc", 'Q',
+                    "\x01\xFE", "a\tb\033") == 0);
+    io = c42_io8bc_init(&bc, vbuf, sizeof(vbuf));
+    T(c42_io8_fmt(io, "x=$d y=$>8s z=$<5c|$xs|$>12es|", 123, "abc", 'Q',
+                  "\x01\xFE", "a\tb\033") == 0);
+    T(bc.size == sbw.size && C42_U8A_EQUAL(buf, vbuf, sbw.size));
+
+    {
+        c42_fmt_arg_t a[3];
+        a[0] = c42_fmt_arg_uint(0xABCD, 2);
+        a[1] = c42_fmt_arg_sint(-5, 4);
+        a[2] = c42_fmt_arg_cstr("xyz", 4);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$Xw $D $>4s", a, 3) == 0);
+        T(sbw.size == 12 && C42_U8A_EQLIT(buf, "ABCD -5  xyz"));
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$b", a, 1)
+          == C42_FMT_ARG_MISMATCH);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$s", a, 1)
+          == C42_FMT_ARG_MISMATCH);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$w", a, 2)
+          == C42_FMT_ARG_MISMATCH);
+        /* signedness: only values the field can represent are accepted */
+        a[0] = c42_fmt_arg_sint(-1, 4);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$d", a, 1)
+          == C42_FMT_ARG_MISMATCH);
+        a[0] = c42_fmt_arg_sint(7, 4);
+        a[1] = c42_fmt_arg_uint(0x7FFFFFFF, 4);
+        a[2] = c42_fmt_arg_uint(0xFF, 1);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$d $D $B", a, 3)
+          == C42_FMT_ARG_MISMATCH);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$d $D $W", a, 3) == 0);
+        T(sbw.size == 16 && C42_U8A_EQLIT(buf, "7 2147483647 255"));
+        a[1] = c42_fmt_arg_uint(0x80000000, 4);
+        T(c42_write_afmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                         c42_utf8_term_width, NULL, "$d $D $W", a, 3)
+          == C42_FMT_ARG_MISMATCH);
+    }
+#if __STDC_VERSION__ >= 201112L
+    T(C42_FMT(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+              "[$<6s|$>5Q|$c]", "ab", (int64_t) -42, 'z') == 0);
+    T(sbw.size == 16 && C42_U8A_EQLIT(buf, "[ab    |  -42|z]"));
+    T(C42_FMT(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+              "lit") == 0);
+    T(sbw.size == 3);
+    T(C42_FMT(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+              "$d", (uint64_t) 1) == C42_FMT_ARG_MISMATCH);
+    T(C42_FMT(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+              "$i", -1) == C42_FMT_ARG_MISMATCH);
+    T(C42_FMT(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+              "$i/$I", 3, 4u) == 0);
+    T(sbw.size == 3 && C42_U8A_EQLIT(buf, "3/4"));
+    io = c42_io8bc_init(&bc, vbuf, sizeof(vbuf));
+    T(C42_IO8_FMT(io, "$z:$s", sizeof(buf), "ok") == 0);
+    T(bc.size == 7 && C42_U8A_EQLIT(vbuf, "1024:ok"));
+#endif
+
+    T(c42_utf8_ansi_term_width((uint8_t const *) "\033[1;31mred\033[0m", 14,
+                               NULL) == 3);
+    T(c42_utf8_ansi_term_width((uint8_t const *) "\033]0;t\007x\033]8;;u\033\\",
+                               15, NULL) == 1);
+    T(c42_utf8_ansi_term_width((uint8_t const *) "a\033[31", 5, NULL) == -1);
+    T(c42_write_fmt(c42_sbw_write, c42_sbw_init(&sbw, buf, sizeof(buf)),
+                    c42_utf8_ansi_term_width, NULL, "[$>5s]",
+                    "\033[32mok\033[0m") == 0);
+    T(sbw.size == 16 && C42_U8A_EQLIT(buf, "[   \033[32mok\033[0m]"));
     T(c42_utf16le_to_utf8_len((uint8_t const *) "\x00\xD8", 1, 0) == -1);
     T(c42_utf16le_to_utf8_len((uint8_t const *) "\x00\xD8", 2, 0) == -2);
     T(c42_utf16le_to_utf8_len((uint8_t const *) "\x00\xD8", 2, 
@@ -59,6 +2374,43 @@ int main ()
     T(c42_utf16le_to_utf8_len((uint8_t const *) "\x45\xDB\x0C\xDC", 4, 
                               C42_NEVER_PAIR_SURROGATES) == 6);
     T(c42_utf16le_to_utf8_len((uint8_t const *) "\x0C\xDC\x45\xDB", 4, 0) == -2);
+    T(test_dlog() == 0);
+    T(test_io8buf() == 0);
+    T(test_io8buf_readahead() == 0);
+    T(test_aiopool() == 0);
+    T(test_io8mem() == 0);
+    T(test_pipe() == 0);
+    T(test_lz() == 0);
+    T(test_line_reader() == 0);
+    T(test_checksums() == 0);
+    T(test_io8stats() == 0);
+    T(test_dir() == 0);
+    T(test_parallel_read() == 0);
+    T(test_reactor() == 0);
+    T(test_rlog() == 0);
+    T(test_net() == 0);
+    {
+        c42_io8mr_t mr;
+        uint8_t const * p;
+        size_t n, w;
+        uint64_t pos;
+        c42_u8a_copy(vbuf, (uint8_t const *) "0123456789", 10);
+        io = c42_io8mr_init(&mr, vbuf, 10, 0);
+        T(c42_io8_peek(io, 4, &p, &n) == 0 && p == vbuf && n == 10);
+        T(c42_io8_consume(io, 3) == 0);
+        T(c42_io8_read(io, buf, 4, &w) == 0 && w == 4);
+        T(C42_U8A_EQLIT(buf, "3456"));
+        T(C42_IO8_WRITE_LIT(io, "x") == C42_IO8_BAD_OP);
+        T(c42_io8_seek64(io, -2, C42_IO8_SEEK_END, &pos) == 0 && pos == 8);
+        T(c42_io8_seek64(io, 3, C42_IO8_SEEK_CUR, &pos) == C42_IO8_BAD_POS);
+        T(c42_io8_seek64(io, INT64_MIN, C42_IO8_SEEK_END, &pos)
+          == C42_IO8_BAD_POS);
+        io = c42_io8mr_init(&mr, vbuf, 10, 1);
+        T(c42_io8_seek64(io, 8, C42_IO8_SEEK_SET, &pos) == 0);
+        T(c42_io8_write(io, (uint8_t const *) "abc", 3, &w) == 0 && w == 2);
+        T(C42_U8A_EQLIT(vbuf + 7, "7ab"));
+        T(C42_IO8_WRITE_LIT(io, "c") == C42_IO8_NO_SPACE);
+    }
     printf("all done!\n");
     return 0;
 }